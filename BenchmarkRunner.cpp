@@ -0,0 +1,77 @@
+//-----------------------------------------------------------------------------
+// <copyright file="BenchmarkRunner.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation. All rights reserved.
+// </copyright>
+//-----------------------------------------------------------------------------
+
+// Command line entry point that times the per-pixel kernels without a window or a Kinect. It is
+// not part of the Windows project, where the /benchmark option of the application runs the same
+// benchmark; build it together with the portable sources, for example on Linux:
+//
+//   g++ -O2 BenchmarkRunner.cpp KernelBenchmark.cpp FrameConversion.cpp FilterChain.cpp Overlay.cpp
+//       SkeletonProjector.cpp DepthRecording.cpp DepthCodec.cpp -lopencv_core -lopencv_imgproc
+//
+// Record a session with the /record option of the application to also time the depth kernels on
+// recorded frames.
+
+#include "Platform.h"
+#include <stdio.h>
+#include <string.h>
+
+#include "KernelBenchmark.h"
+
+// Report written unless another one is given
+static const char* DEFAULT_OUTPUT_FILE_NAME = "KernelBenchmark.csv";
+
+/// <summary>
+/// Prints the command line options
+/// </summary>
+/// <param name="program">name the program was run as</param>
+static void PrintUsage(const char* program)
+{
+    fprintf(stderr,
+        "Usage: %s [--recording <file>] [--output <file>]\n"
+        "  --recording  depth recording to also run the depth kernels on\n"
+        "  --output     CSV report, %s by default\n",
+        program, DEFAULT_OUTPUT_FILE_NAME);
+}
+
+/// <summary>
+/// Entry point
+/// </summary>
+/// <param name="argc">number of arguments</param>
+/// <param name="argv">arguments</param>
+/// <returns>0 if the report was written, 1 otherwise</returns>
+int main(int argc, char* argv[])
+{
+    const char* recordingFileName = NULL;
+    const char* outputFileName = DEFAULT_OUTPUT_FILE_NAME;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--recording") == 0 && i + 1 < argc)
+        {
+            recordingFileName = argv[++i];
+        }
+        else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc)
+        {
+            outputFileName = argv[++i];
+        }
+        else
+        {
+            PrintUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (FAILED(RunKernelBenchmark(outputFileName, recordingFileName)))
+    {
+        fprintf(stderr, "Cannot run the benchmark; check that %s can be written%s%s\n", outputFileName,
+            recordingFileName ? " and that this depth recording can be read: " : "",
+            recordingFileName ? recordingFileName : "");
+        return 1;
+    }
+
+    fprintf(stderr, "Wrote %s\n", outputFileName);
+    return 0;
+}
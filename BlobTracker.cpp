@@ -0,0 +1,374 @@
+//-----------------------------------------------------------------------------
+// <copyright file="BlobTracker.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation. All rights reserved.
+// </copyright>
+//-----------------------------------------------------------------------------
+
+#include "BlobTracker.h"
+#include <algorithm>
+
+using namespace cv;
+
+/// <summary>
+/// Constructor
+/// </summary>
+BlobTracker::BlobTracker() :
+    m_minBlobArea(50),
+    m_maxMatchDistance(40.0f),
+    m_maxMissedFrames(5),
+    m_detectionCount(0),
+    m_blobCount(0),
+    m_nextBlobId(1)
+{
+}
+
+/// <summary>
+/// Sets the smallest region, in pixels, that is reported as a blob
+/// </summary>
+/// <param name="minArea">minimum blob area in pixels</param>
+void BlobTracker::SetMinBlobArea(int minArea)
+{
+    m_minBlobArea = minArea;
+}
+
+/// <summary>
+/// Sets how far, in pixels, a blob may move between frames and keep its id
+/// </summary>
+/// <param name="maxDistance">maximum centroid displacement in pixels</param>
+void BlobTracker::SetMaxMatchDistance(float maxDistance)
+{
+    m_maxMatchDistance = maxDistance;
+}
+
+/// <summary>
+/// Sets how many frames a blob may go unseen before it is dropped
+/// </summary>
+/// <param name="maxMissedFrames">number of frames to keep an unmatched blob</param>
+void BlobTracker::SetMaxMissedFrames(int maxMissedFrames)
+{
+    m_maxMissedFrames = maxMissedFrames;
+}
+
+/// <summary>
+/// Labels the connected regions of the given motion mask and matches them against the tracked blobs
+/// </summary>
+/// <param name="pMask">pointer to 8-bit single channel mask, non-zero where motion was detected</param>
+/// <returns>S_OK if successful, an error code otherwise</returns>
+HRESULT BlobTracker::Update(const Mat* pMask)
+{
+    // Fail if pointer is invalid
+    if (!pMask)
+    {
+        return E_POINTER;
+    }
+
+    // Fail if Mat contains no data or is not a single channel 8-bit mask
+    if (pMask->empty() || pMask->type() != CV_8UC1)
+    {
+        return E_INVALIDARG;
+    }
+
+    // A row holds at most (width + 1) / 2 runs, so reserving for the worst case
+    // means labeling never allocates once the resolution is fixed
+    size_t maxRuns = static_cast<size_t>((pMask->cols + 1) / 2) * pMask->rows;
+    if (m_runs.capacity() < maxRuns)
+    {
+        m_runs.reserve(maxRuns);
+        m_runRegion.reserve(maxRuns);
+        m_regions.reserve(maxRuns);
+    }
+
+    LabelRuns(pMask);
+    CollectRegions();
+    MatchBlobs();
+
+    return S_OK;
+}
+
+/// <summary>
+/// Forgets all tracked blobs
+/// </summary>
+void BlobTracker::Reset()
+{
+    m_detectionCount = 0;
+    m_blobCount = 0;
+}
+
+/// <summary>
+/// Gets the number of tracked blobs
+/// </summary>
+/// <returns>number of entries returned by GetBlobs</returns>
+int BlobTracker::GetBlobCount() const
+{
+    return m_blobCount;
+}
+
+/// <summary>
+/// Gets the tracked blobs, including those missed in the latest frame
+/// </summary>
+/// <returns>pointer to GetBlobCount() tracked blobs</returns>
+const TrackedBlob* BlobTracker::GetBlobs() const
+{
+    return m_blobs;
+}
+
+/// <summary>
+/// Extracts the runs of the mask and joins overlapping runs of adjacent rows in a single scan
+/// </summary>
+/// <param name="pMask">pointer to mask to label</param>
+void BlobTracker::LabelRuns(const Mat* pMask)
+{
+    m_runs.clear();
+
+    // Runs of the previous row are [prevStart, prevEnd)
+    int prevStart = 0;
+    int prevEnd = 0;
+
+    for (int y = 0; y < pMask->rows; ++y)
+    {
+        const BYTE* pMaskRow = pMask->ptr<BYTE>(y);
+        int rowStart = static_cast<int>(m_runs.size());
+        int prev = prevStart;
+
+        int x = 0;
+        while (x < pMask->cols)
+        {
+            // Skip background pixels
+            while (x < pMask->cols && !pMaskRow[x])
+            {
+                ++x;
+            }
+            if (x == pMask->cols)
+            {
+                break;
+            }
+
+            // Find the end of this run
+            Run run;
+            run.y = y;
+            run.xStart = x;
+            while (x < pMask->cols && pMaskRow[x])
+            {
+                ++x;
+            }
+            run.xEnd = x - 1;
+            run.parent = static_cast<int>(m_runs.size());
+            m_runs.push_back(run);
+
+            // Join with every run of the previous row that touches this one, including diagonally.
+            // Both rows are sorted, so runs that end before this one starts are never needed again.
+            while (prev < prevEnd && m_runs[prev].xEnd + 1 < run.xStart)
+            {
+                ++prev;
+            }
+            for (int p = prev; p < prevEnd && m_runs[p].xStart <= run.xEnd + 1; ++p)
+            {
+                JoinRuns(p, run.parent);
+            }
+        }
+
+        prevStart = rowStart;
+        prevEnd = static_cast<int>(m_runs.size());
+    }
+}
+
+/// <summary>
+/// Collects the statistics of each labeled region and keeps the largest as detections
+/// </summary>
+void BlobTracker::CollectRegions()
+{
+    int runCount = static_cast<int>(m_runs.size());
+    m_runRegion.assign(runCount, -1);
+    m_regions.clear();
+
+    for (int i = 0; i < runCount; ++i)
+    {
+        const Run& run = m_runs[i];
+        int root = FindRoot(i);
+
+        // Roots always come before the runs joined to them, so the region already exists unless this is the root
+        int regionIndex = m_runRegion[root];
+        if (regionIndex < 0)
+        {
+            Region region = {0, 0.0, 0.0, run.xStart, run.y, run.xEnd, run.y};
+            regionIndex = static_cast<int>(m_regions.size());
+            m_regions.push_back(region);
+            m_runRegion[root] = regionIndex;
+        }
+
+        int length = run.xEnd - run.xStart + 1;
+        Region& region = m_regions[regionIndex];
+        region.area += length;
+        region.sumX += 0.5 * (run.xStart + run.xEnd) * length;
+        region.sumY += static_cast<double>(run.y) * length;
+        region.minX = min(region.minX, run.xStart);
+        region.maxX = max(region.maxX, run.xEnd);
+        region.minY = min(region.minY, run.y);
+        region.maxY = max(region.maxY, run.y);
+    }
+
+    // Keep the largest regions, sorted by decreasing area
+    m_detectionCount = 0;
+    for (size_t i = 0; i < m_regions.size(); ++i)
+    {
+        const Region& region = m_regions[i];
+        if (region.area < m_minBlobArea)
+        {
+            continue;
+        }
+
+        if (m_detectionCount == MAX_BLOBS && region.area <= m_detections[MAX_BLOBS - 1].area)
+        {
+            continue;
+        }
+
+        int slot = (m_detectionCount < MAX_BLOBS) ? m_detectionCount++ : MAX_BLOBS - 1;
+        while (slot > 0 && m_detections[slot - 1].area < region.area)
+        {
+            m_detections[slot] = m_detections[slot - 1];
+            --slot;
+        }
+        m_detections[slot] = region;
+    }
+}
+
+/// <summary>
+/// Matches the current detections against the tracked blobs
+/// </summary>
+void BlobTracker::MatchBlobs()
+{
+    // Candidate pairings of tracked blob and detection within matching distance
+    struct Pairing
+    {
+        float distanceSquared;
+        int blob;
+        int detection;
+
+        bool operator<(const Pairing& other) const
+        {
+            return distanceSquared < other.distanceSquared;
+        }
+    };
+
+    Pairing pairings[MAX_BLOBS * MAX_BLOBS];
+    int pairingCount = 0;
+    float maxDistanceSquared = m_maxMatchDistance * m_maxMatchDistance;
+
+    for (int b = 0; b < m_blobCount; ++b)
+    {
+        for (int d = 0; d < m_detectionCount; ++d)
+        {
+            float dx = static_cast<float>(m_detections[d].sumX / m_detections[d].area) - m_blobs[b].centroid.x;
+            float dy = static_cast<float>(m_detections[d].sumY / m_detections[d].area) - m_blobs[b].centroid.y;
+            float distanceSquared = dx * dx + dy * dy;
+            if (distanceSquared <= maxDistanceSquared)
+            {
+                Pairing pairing = {distanceSquared, b, d};
+                pairings[pairingCount++] = pairing;
+            }
+        }
+    }
+
+    // Greedily accept the closest pairings first
+    std::sort(pairings, pairings + pairingCount);
+
+    bool blobMatched[MAX_BLOBS] = {false};
+    bool detectionMatched[MAX_BLOBS] = {false};
+
+    for (int i = 0; i < pairingCount; ++i)
+    {
+        const Pairing& pairing = pairings[i];
+        if (blobMatched[pairing.blob] || detectionMatched[pairing.detection])
+        {
+            continue;
+        }
+
+        blobMatched[pairing.blob] = true;
+        detectionMatched[pairing.detection] = true;
+
+        const Region& region = m_detections[pairing.detection];
+        TrackedBlob& blob = m_blobs[pairing.blob];
+        Point2f centroid(static_cast<float>(region.sumX / region.area), static_cast<float>(region.sumY / region.area));
+
+        blob.velocity = Point2f(centroid.x - blob.centroid.x, centroid.y - blob.centroid.y);
+        blob.centroid = centroid;
+        blob.bounds = Rect(region.minX, region.minY, region.maxX - region.minX + 1, region.maxY - region.minY + 1);
+        blob.area = region.area;
+        blob.age++;
+        blob.missedFrames = 0;
+    }
+
+    // Age unmatched blobs and drop those that have been missing for too long
+    int kept = 0;
+    for (int b = 0; b < m_blobCount; ++b)
+    {
+        if (!blobMatched[b])
+        {
+            m_blobs[b].missedFrames++;
+            m_blobs[b].velocity = Point2f(0.0f, 0.0f);
+        }
+
+        if (m_blobs[b].missedFrames <= m_maxMissedFrames)
+        {
+            m_blobs[kept++] = m_blobs[b];
+        }
+    }
+    m_blobCount = kept;
+
+    // Start tracking new detections while there is room, largest first
+    for (int d = 0; d < m_detectionCount && m_blobCount < MAX_BLOBS; ++d)
+    {
+        if (detectionMatched[d])
+        {
+            continue;
+        }
+
+        const Region& region = m_detections[d];
+        TrackedBlob& blob = m_blobs[m_blobCount++];
+        blob.id = m_nextBlobId++;
+        blob.centroid = Point2f(static_cast<float>(region.sumX / region.area), static_cast<float>(region.sumY / region.area));
+        blob.bounds = Rect(region.minX, region.minY, region.maxX - region.minX + 1, region.maxY - region.minY + 1);
+        blob.area = region.area;
+        blob.velocity = Point2f(0.0f, 0.0f);
+        blob.age = 1;
+        blob.missedFrames = 0;
+    }
+}
+
+/// <summary>
+/// Finds the root run of the region that contains the given run
+/// </summary>
+/// <param name="run">index of run</param>
+/// <returns>index of root run</returns>
+int BlobTracker::FindRoot(int run)
+{
+    // Path halving keeps the trees shallow without recursion
+    while (m_runs[run].parent != run)
+    {
+        m_runs[run].parent = m_runs[m_runs[run].parent].parent;
+        run = m_runs[run].parent;
+    }
+
+    return run;
+}
+
+/// <summary>
+/// Joins the regions containing the two given runs
+/// </summary>
+/// <param name="runA">index of first run</param>
+/// <param name="runB">index of second run</param>
+void BlobTracker::JoinRuns(int runA, int runB)
+{
+    int rootA = FindRoot(runA);
+    int rootB = FindRoot(runB);
+
+    // The earlier run becomes the root so that roots precede the runs joined to them
+    if (rootA < rootB)
+    {
+        m_runs[rootB].parent = rootA;
+    }
+    else if (rootB < rootA)
+    {
+        m_runs[rootA].parent = rootB;
+    }
+}
@@ -0,0 +1,175 @@
+//-----------------------------------------------------------------------------
+// <copyright file="BlobTracker.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation. All rights reserved.
+// </copyright>
+//-----------------------------------------------------------------------------
+
+#pragma once
+
+#include "Platform.h"
+#include <vector>
+
+// Suppress warnings that come from compiling OpenCV code since we have no control over it
+#pragma warning(push)
+#pragma warning(disable : 6294 6031)
+#include <opencv2/core/core.hpp>
+#pragma warning(pop)
+
+using namespace cv;
+
+/// <summary>
+/// Connected region of a motion mask that is tracked from frame to frame
+/// </summary>
+struct TrackedBlob
+{
+    // Identifier that stays the same for as long as the blob is tracked
+    int id;
+
+    // Centroid and bounding box in mask pixel coordinates
+    Point2f centroid;
+    Rect bounds;
+
+    // Number of mask pixels in the blob
+    int area;
+
+    // Centroid displacement since the previous frame, in pixels
+    Point2f velocity;
+
+    // Number of frames the blob has been tracked
+    int age;
+
+    // Number of consecutive frames in which no matching region was found
+    int missedFrames;
+};
+
+class BlobTracker
+{
+public:
+    // Constants:
+    // Maximum number of blobs that are tracked at once
+    static const int MAX_BLOBS = 16;
+
+    // Functions:
+    /// <summary>
+    /// Constructor
+    /// </summary>
+    BlobTracker();
+
+    /// <summary>
+    /// Sets the smallest region, in pixels, that is reported as a blob
+    /// </summary>
+    /// <param name="minArea">minimum blob area in pixels</param>
+    void SetMinBlobArea(int minArea);
+
+    /// <summary>
+    /// Sets how far, in pixels, a blob may move between frames and keep its id
+    /// </summary>
+    /// <param name="maxDistance">maximum centroid displacement in pixels</param>
+    void SetMaxMatchDistance(float maxDistance);
+
+    /// <summary>
+    /// Sets how many frames a blob may go unseen before it is dropped
+    /// </summary>
+    /// <param name="maxMissedFrames">number of frames to keep an unmatched blob</param>
+    void SetMaxMissedFrames(int maxMissedFrames);
+
+    /// <summary>
+    /// Labels the connected regions of the given motion mask and matches them against the tracked blobs
+    /// </summary>
+    /// <param name="pMask">pointer to 8-bit single channel mask, non-zero where motion was detected</param>
+    /// <returns>S_OK if successful, an error code otherwise</returns>
+    HRESULT Update(const Mat* pMask);
+
+    /// <summary>
+    /// Forgets all tracked blobs
+    /// </summary>
+    void Reset();
+
+    /// <summary>
+    /// Gets the number of tracked blobs
+    /// </summary>
+    /// <returns>number of entries returned by GetBlobs</returns>
+    int GetBlobCount() const;
+
+    /// <summary>
+    /// Gets the tracked blobs, including those missed in the latest frame
+    /// </summary>
+    /// <returns>pointer to GetBlobCount() tracked blobs</returns>
+    const TrackedBlob* GetBlobs() const;
+
+private:
+    // Types:
+    // Horizontal run of mask pixels; xEnd is inclusive
+    struct Run
+    {
+        int y;
+        int xStart;
+        int xEnd;
+        int parent;
+    };
+
+    // Statistics of a labeled region
+    struct Region
+    {
+        int area;
+        double sumX;
+        double sumY;
+        int minX;
+        int minY;
+        int maxX;
+        int maxY;
+    };
+
+    // Functions:
+    /// <summary>
+    /// Extracts the runs of the mask and joins overlapping runs of adjacent rows in a single scan
+    /// </summary>
+    /// <param name="pMask">pointer to mask to label</param>
+    void LabelRuns(const Mat* pMask);
+
+    /// <summary>
+    /// Collects the statistics of each labeled region and keeps the largest as detections
+    /// </summary>
+    void CollectRegions();
+
+    /// <summary>
+    /// Matches the current detections against the tracked blobs
+    /// </summary>
+    void MatchBlobs();
+
+    /// <summary>
+    /// Finds the root run of the region that contains the given run
+    /// </summary>
+    /// <param name="run">index of run</param>
+    /// <returns>index of root run</returns>
+    int FindRoot(int run);
+
+    /// <summary>
+    /// Joins the regions containing the two given runs
+    /// </summary>
+    /// <param name="runA">index of first run</param>
+    /// <param name="runB">index of second run</param>
+    void JoinRuns(int runA, int runB);
+
+    // Variables:
+    // Tracking parameters
+    int m_minBlobArea;
+    float m_maxMatchDistance;
+    int m_maxMissedFrames;
+
+    // Labeling scratch space, sized once for the mask resolution and reused every frame
+    std::vector<Run> m_runs;
+    std::vector<int> m_runRegion;
+    std::vector<Region> m_regions;
+
+    // Largest regions found in the current frame
+    Region m_detections[MAX_BLOBS];
+    int m_detectionCount;
+
+    // Blobs being tracked
+    TrackedBlob m_blobs[MAX_BLOBS];
+    int m_blobCount;
+
+    // Identifier to give the next new blob
+    int m_nextBlobId;
+};
@@ -0,0 +1,944 @@
+//-----------------------------------------------------------------------------
+// <copyright file="DepthCodec.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation. All rights reserved.
+// </copyright>
+//-----------------------------------------------------------------------------
+
+#include "DepthCodec.h"
+#ifdef _WIN32
+#include <NuiApi.h>
+#endif
+#include <string.h>
+
+// SSE2 is always available on x64 and on the x86 targets the Kinect SDK supports
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define DEPTH_CODEC_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+using namespace cv;
+
+// Width and height at the start of every encoded frame
+static const size_t ENCODED_SIZE_LENGTH = 2 * sizeof(DWORD);
+
+// Code lengths of the symbols follow the frame size, 4 bits each
+static const size_t ENCODED_HEADER_LENGTH = ENCODED_SIZE_LENGTH + DEPTH_CODEC_SYMBOL_COUNT / 2;
+
+// Largest frame in pixels, so that the length of a run of unknown pixels fits in 49 bits
+static const int MAX_PIXEL_COUNT = 1 << 24;
+
+// Longest code; the decoder looks codes up in a table indexed by this many bits
+static const int MAX_CODE_LENGTH = 12;
+
+// Most bits one pixel costs: an escape code followed by the 16-bit difference
+static const int MAX_PIXEL_BITS = MAX_CODE_LENGTH + 16;
+
+// Symbols after the differences: an escape followed by a difference too large for a symbol of its own,
+// an unknown pixel between two known ones, and the start of a longer run of unknown pixels, followed by
+// its length
+static const int ESCAPE_SYMBOL = DEPTH_CODEC_SYMBOL_COUNT - 3;
+static const int UNKNOWN_PIXEL_SYMBOL = DEPTH_CODEC_SYMBOL_COUNT - 2;
+static const int UNKNOWN_RUN_SYMBOL = DEPTH_CODEC_SYMBOL_COUNT - 1;
+
+// Marks the encoder's code table entries of the symbols followed by more bits
+static const UINT EXTENDED_SYMBOL_FLAG = 1u << 16;
+
+// Fields of the decoder's table entries above the code length of the first symbol: the number of pixels
+// the entry decodes, the length of both codes where it decodes two, which of the pixels are unknown,
+// and the differences themselves, 8 bits each, or the symbol where it decodes none
+static const int DECODE_PIXEL_COUNT_SHIFT = 4;
+static const int DECODE_PAIR_LENGTH_SHIFT = 8;
+static const int DECODE_UNKNOWN_SHIFT = 12;
+static const int DECODE_DIFFERENCE_SHIFT = 16;
+
+/// <summary>
+/// Gets the index of the lowest set bit
+/// </summary>
+/// <param name="mask">mask with at least one bit set</param>
+/// <returns>index of the bit</returns>
+static inline int FindLowestSetBit(unsigned int mask)
+{
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return static_cast<int>(index);
+#else
+    return __builtin_ctz(mask);
+#endif
+}
+
+/// <summary>
+/// Gets the index of the highest set bit
+/// </summary>
+/// <param name="mask">mask with at least one bit set</param>
+/// <returns>index of the bit</returns>
+static inline int FindHighestSetBit(unsigned int mask)
+{
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanReverse(&index, mask);
+    return static_cast<int>(index);
+#else
+    return 31 - __builtin_clz(mask);
+#endif
+}
+
+/// <summary>
+/// Counts the pixels from pPixel on that are all unknown, or all known
+/// </summary>
+/// <param name="pPixel">pointer to first pixel of the run</param>
+/// <param name="pEnd">pointer past the last pixel of the frame</param>
+/// <param name="isKnown">true to count known pixels, false to count unknown ones</param>
+/// <returns>length of the run</returns>
+static size_t CountRun(const USHORT* pPixel, const USHORT* pEnd, bool isKnown)
+{
+    const USHORT* pStart = pPixel;
+
+#ifdef DEPTH_CODEC_USE_SSE2
+    // Eight pixels at a time; the mask has two bits per pixel that are set where the pixel ends the run
+    const __m128i zero = _mm_setzero_si128();
+    const int allContinue = isKnown ? 0 : 0xFFFF;
+    for (; pPixel + 8 <= pEnd; pPixel += 8)
+    {
+        __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pPixel));
+        int isZero = _mm_movemask_epi8(_mm_cmpeq_epi16(pixels, zero));
+        int isEnd = isZero ^ allContinue;
+        if (isEnd != 0)
+        {
+            return (pPixel - pStart) + FindLowestSetBit(static_cast<unsigned int>(isEnd)) / 2;
+        }
+    }
+#endif
+
+    while (pPixel < pEnd && (*pPixel != 0) == isKnown)
+    {
+        ++pPixel;
+    }
+
+    return pPixel - pStart;
+}
+
+/// <summary>
+/// Moves the player index from the low bits of a raw depth pixel to the high bits
+/// </summary>
+/// <param name="raw">raw depth pixel</param>
+/// <returns>rotated pixel</returns>
+static inline int RotatePlayerIndexHigh(USHORT raw)
+{
+    return ((raw >> NUI_IMAGE_PLAYER_INDEX_SHIFT) | (raw << (16 - NUI_IMAGE_PLAYER_INDEX_SHIFT))) & 0xFFFF;
+}
+
+/// <summary>
+/// Moves the player index from the high bits of a rotated pixel back to the low bits
+/// </summary>
+/// <param name="rotated">rotated pixel</param>
+/// <returns>raw depth pixel</returns>
+static inline USHORT RotatePlayerIndexLow(int rotated)
+{
+    return static_cast<USHORT>((rotated << NUI_IMAGE_PLAYER_INDEX_SHIFT) | ((rotated & 0xFFFF) >> (16 - NUI_IMAGE_PLAYER_INDEX_SHIFT)));
+}
+
+/// <summary>
+/// Gets the symbol that codes a difference
+/// </summary>
+/// <param name="zigzag">zigzag coded difference</param>
+/// <returns>the difference itself if it has a symbol, the escape symbol otherwise</returns>
+static inline int GetSymbol(USHORT zigzag)
+{
+    return (zigzag < ESCAPE_SYMBOL) ? zigzag : ESCAPE_SYMBOL;
+}
+
+/// <summary>
+/// Computes the symbol of every pixel: for a known pixel, the zigzag coded difference from the known
+/// pixel before it, so that small differences of either sign become small numbers, and for an unknown
+/// pixel the unknown pixel symbol if it is alone, the run symbol otherwise. Differences are taken
+/// modulo 2^16.
+/// </summary>
+/// <param name="pPixel">pointer to first raw pixel of the frame</param>
+/// <param name="count">number of pixels</param>
+/// <param name="pZigzag">pointer in which to return the difference of every known pixel</param>
+/// <param name="pSymbols">pointer in which to return the symbol of every pixel</param>
+/// <returns>number of runs of more than one unknown pixel</returns>
+static size_t ComputeSymbols(const USHORT* pPixel, size_t count, USHORT* pZigzag, BYTE* pSymbols)
+{
+    size_t runCount = 0;
+    size_t i = 0;
+    int previous = 0;
+    bool wasKnown = true;
+
+#ifdef DEPTH_CODEC_USE_SSE2
+    // Eight pixels at a time, without a branch on the pixels, while the pixel after them is in the frame.
+    // Every lane of last holds the rotated value of the last known pixel so far, and every lane of
+    // lastKnown whether the pixel before is known.
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i allOnes = _mm_cmpeq_epi16(zero, zero);
+    const __m128i escape = _mm_set1_epi16(ESCAPE_SYMBOL);
+    const __m128i unknownPixel = _mm_set1_epi16(UNKNOWN_PIXEL_SYMBOL);
+    const __m128i unknownRun = _mm_set1_epi16(UNKNOWN_RUN_SYMBOL);
+    __m128i last = zero;
+    __m128i lastKnown = allOnes;
+    while (i + 9 <= count)
+    {
+        // Run starts are counted in 16-bit lanes, which are emptied before they can overflow
+        size_t blockEnd = (count - i > 8 * 4096) ? i + 8 * 4096 : count;
+        __m128i runStarts = zero;
+        for (; i + 9 <= blockEnd; i += 8)
+        {
+            __m128i raw = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pPixel + i));
+            __m128i rawAfter = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pPixel + i + 1));
+            __m128i known = _mm_xor_si128(_mm_cmpeq_epi16(raw, zero), allOnes);
+            __m128i knownAfter = _mm_xor_si128(_mm_cmpeq_epi16(rawAfter, zero), allOnes);
+            __m128i knownBefore = _mm_or_si128(_mm_slli_si128(known, 2), _mm_srli_si128(lastKnown, 14));
+            __m128i current = _mm_or_si128(_mm_srli_epi16(raw, NUI_IMAGE_PLAYER_INDEX_SHIFT), _mm_slli_epi16(raw, 16 - NUI_IMAGE_PLAYER_INDEX_SHIFT));
+
+            // Fill every unknown pixel with the known pixel before it, looking 1, 2 and 4 pixels back, then
+            // with the last known pixel of the blocks before if there is none in this block
+            __m128i filled = current;
+            __m128i filledKnown = known;
+            __m128i back = _mm_or_si128(_mm_slli_si128(filled, 2), _mm_srli_si128(last, 14));
+            filled = _mm_or_si128(_mm_and_si128(filledKnown, filled), _mm_andnot_si128(filledKnown, back));
+            filledKnown = _mm_or_si128(filledKnown, _mm_or_si128(_mm_slli_si128(filledKnown, 2), _mm_srli_si128(allOnes, 14)));
+            back = _mm_or_si128(_mm_slli_si128(filled, 4), _mm_srli_si128(last, 12));
+            filled = _mm_or_si128(_mm_and_si128(filledKnown, filled), _mm_andnot_si128(filledKnown, back));
+            filledKnown = _mm_or_si128(filledKnown, _mm_or_si128(_mm_slli_si128(filledKnown, 4), _mm_srli_si128(allOnes, 12)));
+            back = _mm_or_si128(_mm_slli_si128(filled, 8), _mm_srli_si128(last, 8));
+            filled = _mm_or_si128(_mm_and_si128(filledKnown, filled), _mm_andnot_si128(filledKnown, back));
+            filledKnown = _mm_or_si128(filledKnown, _mm_or_si128(_mm_slli_si128(filledKnown, 8), _mm_srli_si128(allOnes, 8)));
+            filled = _mm_or_si128(_mm_and_si128(filledKnown, filled), _mm_andnot_si128(filledKnown, last));
+
+            // Differences from the known pixel before each pixel, and their symbols, min(zigzag, escape)
+            __m128i before = _mm_or_si128(_mm_slli_si128(filled, 2), _mm_srli_si128(last, 14));
+            __m128i differences = _mm_sub_epi16(current, before);
+            __m128i zigzag = _mm_xor_si128(_mm_slli_epi16(differences, 1), _mm_srai_epi16(differences, 15));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(pZigzag + i), zigzag);
+
+            __m128i alone = _mm_and_si128(knownBefore, knownAfter);
+            __m128i unknownSymbols = _mm_or_si128(_mm_and_si128(alone, unknownPixel), _mm_andnot_si128(alone, unknownRun));
+            __m128i symbols = _mm_sub_epi16(zigzag, _mm_subs_epu16(zigzag, escape));
+            symbols = _mm_or_si128(_mm_and_si128(known, symbols), _mm_andnot_si128(known, unknownSymbols));
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(pSymbols + i), _mm_packus_epi16(symbols, symbols));
+
+            // A run starts at every unknown pixel after a known one that is followed by another unknown
+            // one; lanes of -1 count up
+            __m128i unknownAfter = _mm_xor_si128(knownAfter, allOnes);
+            runStarts = _mm_sub_epi16(runStarts, _mm_and_si128(_mm_andnot_si128(known, knownBefore), unknownAfter));
+
+            last = _mm_shufflehi_epi16(filled, 0xFF);
+            last = _mm_unpackhi_epi64(last, last);
+            lastKnown = _mm_shufflehi_epi16(known, 0xFF);
+            lastKnown = _mm_unpackhi_epi64(lastKnown, lastKnown);
+        }
+
+        int laneSums[4];
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(laneSums), _mm_madd_epi16(runStarts, _mm_set1_epi16(1)));
+        runCount += laneSums[0] + laneSums[1] + laneSums[2] + laneSums[3];
+    }
+
+    previous = _mm_cvtsi128_si32(last) & 0xFFFF;
+    wasKnown = (_mm_cvtsi128_si32(lastKnown) != 0);
+#endif
+
+    for (; i < count; ++i)
+    {
+        if (pPixel[i] == 0)
+        {
+            bool isAlone = wasKnown && (i + 1 == count || pPixel[i + 1] != 0);
+            pSymbols[i] = static_cast<BYTE>(isAlone ? UNKNOWN_PIXEL_SYMBOL : UNKNOWN_RUN_SYMBOL);
+            runCount += (wasKnown && !isAlone) ? 1 : 0;
+            wasKnown = false;
+        }
+        else
+        {
+            int current = RotatePlayerIndexHigh(pPixel[i]);
+            int difference = static_cast<short>(current - previous);
+            pZigzag[i] = static_cast<USHORT>((static_cast<UINT>(difference) << 1) ^ (difference >> 15));
+            pSymbols[i] = static_cast<BYTE>(GetSymbol(pZigzag[i]));
+            previous = current;
+            wasKnown = true;
+        }
+    }
+
+    return runCount;
+}
+
+/// <summary>
+/// Gets the difference a zigzag coded value stands for
+/// </summary>
+/// <param name="zigzag">zigzag coded difference</param>
+/// <returns>difference</returns>
+static inline int DecodeZigzag(UINT zigzag)
+{
+    return static_cast<int>(zigzag >> 1) ^ -static_cast<int>(zigzag & 1);
+}
+
+/// <summary>
+/// Gets the fields of a decoder table entry for a symbol of a single pixel
+/// </summary>
+/// <param name="symbol">difference or unknown pixel symbol</param>
+/// <param name="position">0 for the first pixel of the entry, 1 for the second</param>
+/// <returns>fields of the entry</returns>
+static UINT GetPixelEntry(UINT symbol, int position)
+{
+    if (symbol == UNKNOWN_PIXEL_SYMBOL)
+    {
+        return 1u << (DECODE_UNKNOWN_SHIFT + position);
+    }
+    return static_cast<UINT>(static_cast<BYTE>(DecodeZigzag(symbol))) << (DECODE_DIFFERENCE_SHIFT + 8 * position);
+}
+
+/// <summary>
+/// Computes the lengths of a prefix code for the symbols from how often they occur: a Huffman code,
+/// flattened if needed until no code is longer than MAX_CODE_LENGTH
+/// </summary>
+/// <param name="counts">number of times each symbol occurs</param>
+/// <param name="lengths">array in which to return the code length of each symbol, 0 for unused symbols</param>
+static void BuildCodeLengths(const UINT counts[DEPTH_CODEC_SYMBOL_COUNT], BYTE lengths[DEPTH_CODEC_SYMBOL_COUNT])
+{
+    // Leaves sorted by weight, followed by the internal nodes as they are made, which come out sorted too
+    UINT weights[2 * DEPTH_CODEC_SYMBOL_COUNT];
+    int symbols[DEPTH_CODEC_SYMBOL_COUNT];
+    int parents[2 * DEPTH_CODEC_SYMBOL_COUNT];
+    int depths[2 * DEPTH_CODEC_SYMBOL_COUNT];
+
+    int leafCount = 0;
+    for (int symbol = 0; symbol < DEPTH_CODEC_SYMBOL_COUNT; ++symbol)
+    {
+        lengths[symbol] = 0;
+        if (counts[symbol] > 0)
+        {
+            symbols[leafCount++] = symbol;
+        }
+    }
+
+    if (leafCount == 0)
+    {
+        return;
+    }
+
+    if (leafCount == 1)
+    {
+        lengths[symbols[0]] = 1;
+        return;
+    }
+
+    UINT scaledCounts[DEPTH_CODEC_SYMBOL_COUNT];
+    memcpy(scaledCounts, counts, sizeof(scaledCounts));
+
+    for (;;)
+    {
+        // Insertion sort: few symbols occur, and they are mostly in order from the last attempt
+        for (int i = 1; i < leafCount; ++i)
+        {
+            int symbol = symbols[i];
+            int j = i;
+            for (; j > 0 && scaledCounts[symbols[j - 1]] > scaledCounts[symbol]; --j)
+            {
+                symbols[j] = symbols[j - 1];
+            }
+            symbols[j] = symbol;
+        }
+        for (int i = 0; i < leafCount; ++i)
+        {
+            weights[i] = scaledCounts[symbols[i]];
+        }
+
+        // Two queues: the next leaf and the next internal node are the only candidates for the lightest node
+        int nextLeaf = 0;
+        int nextNode = leafCount;
+        int nodeCount = leafCount;
+        for (int made = 0; made < leafCount - 1; ++made)
+        {
+            int children[2];
+            for (int c = 0; c < 2; ++c)
+            {
+                if (nextLeaf < leafCount && (nextNode >= nodeCount || weights[nextLeaf] <= weights[nextNode]))
+                {
+                    children[c] = nextLeaf++;
+                }
+                else
+                {
+                    children[c] = nextNode++;
+                }
+            }
+
+            weights[nodeCount] = weights[children[0]] + weights[children[1]];
+            parents[children[0]] = nodeCount;
+            parents[children[1]] = nodeCount;
+            ++nodeCount;
+        }
+
+        // Parents come after their children, so depths are filled in from the root down
+        int maxDepth = 0;
+        depths[nodeCount - 1] = 0;
+        for (int node = nodeCount - 2; node >= 0; --node)
+        {
+            depths[node] = depths[parents[node]] + 1;
+            if (depths[node] > maxDepth)
+            {
+                maxDepth = depths[node];
+            }
+        }
+
+        if (maxDepth <= MAX_CODE_LENGTH)
+        {
+            for (int i = 0; i < leafCount; ++i)
+            {
+                lengths[symbols[i]] = static_cast<BYTE>(depths[i]);
+            }
+            return;
+        }
+
+        // Too deep: bring the rare symbols closer to the common ones and try again
+        for (int i = 0; i < leafCount; ++i)
+        {
+            scaledCounts[symbols[i]] = (scaledCounts[symbols[i]] >> 1) | 1;
+        }
+    }
+}
+
+/// <summary>
+/// Assigns canonical codes to code lengths, as in deflate, bit-reversed so that they can be written and
+/// looked up starting from the lowest bit
+/// </summary>
+/// <param name="lengths">code length of each symbol, 0 for unused symbols</param>
+/// <param name="codes">array in which to return the code of each symbol</param>
+/// <returns>true if the lengths describe a prefix code</returns>
+static bool AssignCodes(const BYTE lengths[DEPTH_CODEC_SYMBOL_COUNT], UINT codes[DEPTH_CODEC_SYMBOL_COUNT])
+{
+    int lengthCounts[MAX_CODE_LENGTH + 1] = {0};
+    for (int symbol = 0; symbol < DEPTH_CODEC_SYMBOL_COUNT; ++symbol)
+    {
+        if (lengths[symbol] > MAX_CODE_LENGTH)
+        {
+            return false;
+        }
+        lengthCounts[lengths[symbol]]++;
+    }
+
+    // Fail if the codes would not fit in the code space
+    UINT nextCodes[MAX_CODE_LENGTH + 1];
+    UINT code = 0;
+    lengthCounts[0] = 0;
+    for (int length = 1; length <= MAX_CODE_LENGTH; ++length)
+    {
+        code = (code + lengthCounts[length - 1]) << 1;
+        nextCodes[length] = code;
+        if (code + lengthCounts[length] > (1u << length))
+        {
+            return false;
+        }
+    }
+
+    for (int symbol = 0; symbol < DEPTH_CODEC_SYMBOL_COUNT; ++symbol)
+    {
+        int length = lengths[symbol];
+        codes[symbol] = 0;
+        if (length > 0)
+        {
+            UINT canonical = nextCodes[length]++;
+            UINT reversed = 0;
+            for (int bit = 0; bit < length; ++bit)
+            {
+                reversed |= ((canonical >> bit) & 1) << (length - 1 - bit);
+            }
+            codes[symbol] = reversed;
+        }
+    }
+
+    return true;
+}
+
+/// <summary>
+/// Packs codes into bytes, starting from the lowest bit. Bits are gathered in a 64-bit value that is
+/// stored in little-endian order, which is the byte order of every platform the application and the
+/// replay tools run on.
+/// </summary>
+class BitWriter
+{
+public:
+    /// <summary>
+    /// Constructor
+    /// </summary>
+    /// <param name="pOutput">pointer to buffer large enough for every bit that will be written, and 8 bytes more</param>
+    explicit BitWriter(BYTE* pOutput) :
+        m_pOutput(pOutput),
+        m_bits(0),
+        m_count(0)
+    {
+    }
+
+    /// <summary>
+    /// Appends bits. All gathered bits are stored every time and the whole bytes among them are passed,
+    /// which costs less than a branch that is taken at random.
+    /// </summary>
+    /// <param name="bits">bits to write, the first in the lowest bit</param>
+    /// <param name="count">number of bits, at most 56</param>
+    inline void Write(unsigned long long bits, int count)
+    {
+        m_bits |= bits << m_count;
+        m_count += count;
+        memcpy(m_pOutput, &m_bits, sizeof(m_bits));
+
+        int byteCount = m_count >> 3;
+        m_pOutput += byteCount;
+        m_bits >>= 8 * byteCount;
+        m_count &= 7;
+    }
+
+    /// <summary>
+    /// Stores the bits that are still gathered, padding the last byte with 0 bits
+    /// </summary>
+    /// <returns>pointer past the last byte written</returns>
+    BYTE* Finish()
+    {
+        int length = (m_count + 7) / 8;
+        memcpy(m_pOutput, &m_bits, length);
+        m_pOutput += length;
+        m_bits = 0;
+        m_count = 0;
+        return m_pOutput;
+    }
+
+private:
+    // Variables:
+    BYTE* m_pOutput;
+    unsigned long long m_bits;
+    int m_count;
+};
+
+/// <summary>
+/// Reads bits written by BitWriter into a 64-bit value, topped up from the data without a branch on the
+/// number of bits left in it. Reads never go past the end of the data; bits beyond it read as 0.
+/// </summary>
+class BitReader
+{
+public:
+    /// <summary>
+    /// Constructor
+    /// </summary>
+    /// <param name="pData">pointer to the bits</param>
+    /// <param name="length">length of the data in bytes</param>
+    BitReader(const BYTE* pData, size_t length) :
+        m_pData(pData),
+        m_length(length),
+        m_offset(0),
+        m_bits(0),
+        m_count(0)
+    {
+    }
+
+    /// <summary>
+    /// Loads whole bytes until at least 56 bits are ready
+    /// </summary>
+    inline void Refill()
+    {
+        unsigned long long word = 0;
+        if (m_offset + sizeof(word) <= m_length)
+        {
+            memcpy(&word, m_pData + m_offset, sizeof(word));
+        }
+        else if (m_offset < m_length)
+        {
+            memcpy(&word, m_pData + m_offset, m_length - m_offset);
+        }
+
+        m_bits |= word << m_count;
+        m_offset += (63 - m_count) >> 3;
+        m_count |= 56;
+    }
+
+    /// <summary>
+    /// Gets the next bits without consuming them
+    /// </summary>
+    /// <returns>the bits that are ready, the first in the lowest bit</returns>
+    inline unsigned long long Peek() const
+    {
+        return m_bits;
+    }
+
+    /// <summary>
+    /// Consumes bits
+    /// </summary>
+    /// <param name="count">number of bits, no more than are ready</param>
+    inline void Skip(int count)
+    {
+        m_bits >>= count;
+        m_count -= count;
+    }
+
+    /// <summary>
+    /// Gets whether every bit consumed was in the data
+    /// </summary>
+    /// <returns>true if no bit was consumed past the end</returns>
+    bool IsInside() const
+    {
+        return m_offset * 8 - m_count <= m_length * 8;
+    }
+
+private:
+    // Variables:
+    const BYTE* m_pData;
+    size_t m_length;
+    size_t m_offset;
+    unsigned long long m_bits;
+    int m_count;
+};
+
+/// <summary>
+/// Constructor
+/// </summary>
+DepthEncoder::DepthEncoder()
+{
+}
+
+/// <summary>
+/// Compresses a raw depth frame. The returned data is overwritten by the next call.
+/// </summary>
+/// <param name="pRawDepth">pointer to raw 16-bit depth Mat, with the player index in the low bits</param>
+/// <param name="ppData">pointer in which to return the encoded frame</param>
+/// <param name="pLength">pointer in which to return the length of the encoded frame in bytes</param>
+/// <returns>S_OK if successful, an error code otherwise</returns>
+HRESULT DepthEncoder::Encode(const Mat* pRawDepth, const BYTE** ppData, size_t* pLength)
+{
+    // Fail if any pointer is invalid
+    if (!pRawDepth || !ppData || !pLength)
+    {
+        return E_POINTER;
+    }
+
+    // Fail if Mat is not a raw depth frame that run lengths can describe
+    if (pRawDepth->empty() || pRawDepth->type() != CV_16U || pRawDepth->total() > static_cast<size_t>(MAX_PIXEL_COUNT))
+    {
+        return E_INVALIDARG;
+    }
+
+    const Mat* pFrame = pRawDepth;
+    if (!pRawDepth->isContinuous())
+    {
+        pRawDepth->copyTo(m_continuous);
+        pFrame = &m_continuous;
+    }
+
+    // The buffers only grow, so that a steady stream of frames does not allocate
+    size_t maxLength = GetMaxEncodedLength(pFrame->size());
+    if (m_buffer.size() < maxLength)
+    {
+        m_buffer.resize(maxLength);
+    }
+    if (m_zigzag.size() < pFrame->total())
+    {
+        m_zigzag.resize(pFrame->total());
+        m_symbols.resize(pFrame->total());
+    }
+
+    // First pass: the symbol of every pixel, and how often each symbol occurs. Counts are spread over
+    // four tables, so that neighboring pixels with the same symbol do not wait on each other.
+    size_t pixelCount = pFrame->total();
+    const USHORT* pBegin = pFrame->ptr<USHORT>(0);
+    const USHORT* pEnd = pBegin + pixelCount;
+    const USHORT* pZigzag = &m_zigzag[0];
+    const BYTE* pSymbols = &m_symbols[0];
+    size_t runCount = ComputeSymbols(pBegin, pixelCount, &m_zigzag[0], &m_symbols[0]);
+
+    UINT counts[4][DEPTH_CODEC_SYMBOL_COUNT];
+    memset(counts, 0, sizeof(counts));
+    size_t i = 0;
+    for (; i + 4 <= pixelCount; i += 4)
+    {
+        counts[0][pSymbols[i]]++;
+        counts[1][pSymbols[i + 1]]++;
+        counts[2][pSymbols[i + 2]]++;
+        counts[3][pSymbols[i + 3]]++;
+    }
+    for (; i < pixelCount; ++i)
+    {
+        counts[0][pSymbols[i]]++;
+    }
+
+    for (int symbol = 0; symbol < DEPTH_CODEC_SYMBOL_COUNT; ++symbol)
+    {
+        counts[0][symbol] += counts[1][symbol] + counts[2][symbol] + counts[3][symbol];
+    }
+
+    // Every unknown pixel in a run was counted; the run symbol is only written where the run starts
+    counts[0][UNKNOWN_RUN_SYMBOL] = static_cast<UINT>(runCount);
+
+    // The code, described by its lengths after the frame size
+    BYTE lengths[DEPTH_CODEC_SYMBOL_COUNT];
+    UINT codes[DEPTH_CODEC_SYMBOL_COUNT];
+    BuildCodeLengths(counts[0], lengths);
+    AssignCodes(lengths, codes);
+
+    DWORD size[2] = { static_cast<DWORD>(pFrame->cols), static_cast<DWORD>(pFrame->rows) };
+    memcpy(&m_buffer[0], size, ENCODED_SIZE_LENGTH);
+    for (int symbol = 0; symbol < DEPTH_CODEC_SYMBOL_COUNT; symbol += 2)
+    {
+        m_buffer[ENCODED_SIZE_LENGTH + symbol / 2] = static_cast<BYTE>(lengths[symbol] | (lengths[symbol + 1] << 4));
+    }
+
+    // Code and length of every symbol in one value, with a flag on the symbols followed by more bits
+    UINT entries[DEPTH_CODEC_SYMBOL_COUNT];
+    for (int symbol = 0; symbol < DEPTH_CODEC_SYMBOL_COUNT; ++symbol)
+    {
+        entries[symbol] = codes[symbol] | (lengths[symbol] << MAX_CODE_LENGTH) | ((symbol == ESCAPE_SYMBOL || symbol == UNKNOWN_RUN_SYMBOL) ? EXTENDED_SYMBOL_FLAG : 0);
+    }
+
+    // Second pass: the codes, four symbols at a time. Four codes take at most 48 bits, so they are
+    // joined without waiting on the writer and written at once.
+    const UINT codeMask = (1u << MAX_CODE_LENGTH) - 1;
+    BitWriter writer(&m_buffer[ENCODED_HEADER_LENGTH]);
+    i = 0;
+    while (i < pixelCount)
+    {
+        if (i + 4 <= pixelCount)
+        {
+            UINT entry0 = entries[pSymbols[i]];
+            UINT entry1 = entries[pSymbols[i + 1]];
+            UINT entry2 = entries[pSymbols[i + 2]];
+            UINT entry3 = entries[pSymbols[i + 3]];
+
+            if (((entry0 | entry1 | entry2 | entry3) & EXTENDED_SYMBOL_FLAG) == 0)
+            {
+                int length0 = entry0 >> MAX_CODE_LENGTH;
+                int length01 = length0 + (entry1 >> MAX_CODE_LENGTH);
+                int length012 = length01 + (entry2 >> MAX_CODE_LENGTH);
+                unsigned long long bits = (entry0 & codeMask) |
+                    (static_cast<unsigned long long>(entry1 & codeMask) << length0) |
+                    (static_cast<unsigned long long>(entry2 & codeMask) << length01) |
+                    (static_cast<unsigned long long>(entry3 & codeMask) << length012);
+                writer.Write(bits, length012 + (entry3 >> MAX_CODE_LENGTH));
+                i += 4;
+                continue;
+            }
+        }
+
+        int symbol = pSymbols[i];
+        if ((entries[symbol] & EXTENDED_SYMBOL_FLAG) == 0)
+        {
+            writer.Write(codes[symbol], lengths[symbol]);
+            ++i;
+        }
+        else if (symbol == ESCAPE_SYMBOL)
+        {
+            writer.Write(codes[ESCAPE_SYMBOL] | (static_cast<UINT>(pZigzag[i]) << lengths[ESCAPE_SYMBOL]), lengths[ESCAPE_SYMBOL] + 16);
+            ++i;
+        }
+        else
+        {
+            // Exponential-Golomb coded length: as many 0 bits as the length has bits after its highest,
+            // then the length from its highest bit up
+            UINT unknownCount = static_cast<UINT>(CountRun(pBegin + i, pEnd, false));
+            int highestBit = FindHighestSetBit(unknownCount);
+            writer.Write(codes[UNKNOWN_RUN_SYMBOL], lengths[UNKNOWN_RUN_SYMBOL]);
+            writer.Write(1u << highestBit, highestBit + 1);
+            writer.Write(unknownCount & ((1u << highestBit) - 1), highestBit);
+            i += unknownCount;
+        }
+    }
+
+    *ppData = &m_buffer[0];
+    *pLength = writer.Finish() - &m_buffer[0];
+
+    return S_OK;
+}
+
+/// <summary>
+/// Gets the largest encoded length of a frame
+/// </summary>
+/// <param name="size">size of the frame</param>
+/// <returns>length in bytes</returns>
+size_t DepthEncoder::GetMaxEncodedLength(Size size)
+{
+    // A known pixel takes at most MAX_PIXEL_BITS. A run of n unknown pixels takes a code and
+    // 2 log2(n) + 1 bits, which is no more. Every store of BitWriter may reach 8 bytes further.
+    size_t pixelCount = static_cast<size_t>(size.area());
+    return ENCODED_HEADER_LENGTH + (pixelCount * MAX_PIXEL_BITS + 7) / 8 + sizeof(unsigned long long);
+}
+
+/// <summary>
+/// Constructor
+/// </summary>
+DepthDecoder::DepthDecoder()
+{
+}
+
+/// <summary>
+/// Decompresses a raw depth frame
+/// </summary>
+/// <param name="pData">pointer to encoded frame</param>
+/// <param name="length">length of the encoded frame in bytes</param>
+/// <param name="pRawDepth">pointer to 16-bit depth Mat in which to return the frame; only reallocated if its size differs</param>
+/// <returns>S_OK if successful, E_INVALIDARG if the data is not a whole encoded frame, an error code otherwise</returns>
+HRESULT DepthDecoder::Decode(const BYTE* pData, size_t length, Mat* pRawDepth)
+{
+    // Fail if either pointer is invalid
+    if (!pData || !pRawDepth)
+    {
+        return E_POINTER;
+    }
+
+    // Fail if the data is too short to hold the frame size and the code
+    if (length < ENCODED_HEADER_LENGTH)
+    {
+        return E_INVALIDARG;
+    }
+
+    DWORD size[2];
+    memcpy(size, pData, ENCODED_SIZE_LENGTH);
+
+    // Fail if the frame size is not one an encoder writes
+    if (size[0] == 0 || size[1] == 0 || size[0] > static_cast<DWORD>(MAX_PIXEL_COUNT) ||
+        size[1] > static_cast<DWORD>(MAX_PIXEL_COUNT) / size[0])
+    {
+        return E_INVALIDARG;
+    }
+
+    // Fail if the code lengths do not describe a prefix code
+    BYTE lengths[DEPTH_CODEC_SYMBOL_COUNT];
+    UINT codes[DEPTH_CODEC_SYMBOL_COUNT];
+    for (int symbol = 0; symbol < DEPTH_CODEC_SYMBOL_COUNT; symbol += 2)
+    {
+        BYTE packed = pData[ENCODED_SIZE_LENGTH + symbol / 2];
+        lengths[symbol] = packed & 0x0F;
+        lengths[symbol + 1] = packed >> 4;
+    }
+    if (!AssignCodes(lengths, codes))
+    {
+        return E_INVALIDARG;
+    }
+
+    // Every MAX_CODE_LENGTH bit pattern starts with exactly one code, or with none if the code is not
+    // complete. Entries hold the symbol and its code length, or for the symbols of single pixels, the
+    // difference, and where the pattern also holds the code of a second such symbol, both and the
+    // length of their codes together. Unknown pixels decode like a difference of 0, but are stored as 0.
+    UINT symbolEntries[1 << MAX_CODE_LENGTH];
+    memset(symbolEntries, 0, sizeof(symbolEntries));
+    for (int symbol = 0; symbol < DEPTH_CODEC_SYMBOL_COUNT; ++symbol)
+    {
+        int codeLength = lengths[symbol];
+        if (codeLength > 0)
+        {
+            for (UINT index = codes[symbol]; index < (1u << MAX_CODE_LENGTH); index += 1u << codeLength)
+            {
+                symbolEntries[index] = (symbol << 4) | codeLength;
+            }
+        }
+    }
+
+    m_table.resize(static_cast<size_t>(1) << MAX_CODE_LENGTH);
+    for (UINT index = 0; index < (1u << MAX_CODE_LENGTH); ++index)
+    {
+        UINT first = symbolEntries[index];
+        int firstLength = first & 0x0F;
+        UINT firstSymbol = first >> 4;
+        if (firstLength == 0 || firstSymbol == ESCAPE_SYMBOL || firstSymbol == UNKNOWN_RUN_SYMBOL)
+        {
+            m_table[index] = (firstSymbol << DECODE_DIFFERENCE_SHIFT) | firstLength;
+            continue;
+        }
+
+        // Entries of one pixel read as two with a second difference of 0, so that both kinds decode alike
+        UINT entry = GetPixelEntry(firstSymbol, 0) | firstLength;
+        UINT second = symbolEntries[index >> firstLength];
+        int secondLength = second & 0x0F;
+        UINT secondSymbol = second >> 4;
+        if (secondLength > 0 && firstLength + secondLength <= MAX_CODE_LENGTH && secondSymbol != ESCAPE_SYMBOL && secondSymbol != UNKNOWN_RUN_SYMBOL)
+        {
+            entry |= GetPixelEntry(secondSymbol, 1) | (2 << DECODE_PIXEL_COUNT_SHIFT) | ((firstLength + secondLength) << DECODE_PAIR_LENGTH_SHIFT);
+        }
+        else
+        {
+            entry |= (1 << DECODE_PIXEL_COUNT_SHIFT) | (firstLength << DECODE_PAIR_LENGTH_SHIFT);
+        }
+        m_table[index] = entry;
+    }
+
+    // Runs span rows, so the frame must be contiguous
+    if (!pRawDepth->isContinuous())
+    {
+        pRawDepth->release();
+    }
+    pRawDepth->create(static_cast<int>(size[1]), static_cast<int>(size[0]), CV_16U);
+
+    const UINT* pTable = &m_table[0];
+    const UINT tableMask = (1u << MAX_CODE_LENGTH) - 1;
+    BitReader reader(pData + ENCODED_HEADER_LENGTH, length - ENCODED_HEADER_LENGTH);
+    USHORT* pPixel = pRawDepth->ptr<USHORT>(0);
+    USHORT* pEnd = pPixel + pRawDepth->total();
+    int previous = 0;
+    while (pPixel < pEnd)
+    {
+        reader.Refill();
+        unsigned long long bits = reader.Peek();
+        UINT entry = pTable[static_cast<UINT>(bits) & tableMask];
+        int codeLength = entry & 0x0F;
+        int pixelCount = (entry >> DECODE_PIXEL_COUNT_SHIFT) & 3;
+
+        // One or two differences. Two pixels are stored either way, without a branch that is taken at
+        // random; after a single difference the second is stored again with the next code.
+        if (pixelCount > 0 && pPixel + 1 < pEnd)
+        {
+            int first = (previous + static_cast<signed char>(entry >> DECODE_DIFFERENCE_SHIFT)) & 0xFFFF;
+            previous = (first + static_cast<signed char>(entry >> (DECODE_DIFFERENCE_SHIFT + 8))) & 0xFFFF;
+            pPixel[0] = RotatePlayerIndexLow(first) & static_cast<USHORT>(((entry >> DECODE_UNKNOWN_SHIFT) & 1) - 1);
+            pPixel[1] = RotatePlayerIndexLow(previous) & static_cast<USHORT>(((entry >> (DECODE_UNKNOWN_SHIFT + 1)) & 1) - 1);
+            pPixel += pixelCount;
+            reader.Skip((entry >> DECODE_PAIR_LENGTH_SHIFT) & 0x0F);
+            continue;
+        }
+
+        // The last pixel of the frame, from the first difference only
+        if (pixelCount > 0)
+        {
+            previous = (previous + static_cast<signed char>(entry >> DECODE_DIFFERENCE_SHIFT)) & 0xFFFF;
+            *pPixel++ = RotatePlayerIndexLow(previous) & static_cast<USHORT>(((entry >> DECODE_UNKNOWN_SHIFT) & 1) - 1);
+            reader.Skip(codeLength);
+            continue;
+        }
+
+        UINT symbol = (entry >> DECODE_DIFFERENCE_SHIFT) & 0xFF;
+        if (codeLength == 0)
+        {
+            return E_INVALIDARG;
+        }
+
+        if (symbol == UNKNOWN_RUN_SYMBOL)
+        {
+            // The length is preceded by as many 0 bits as it has bits after its highest
+            reader.Skip(codeLength);
+            reader.Refill();
+            bits = reader.Peek();
+            UINT zeros = static_cast<UINT>(bits) | (1u << 31);
+            int highestBit = FindLowestSetBit(zeros);
+            if (highestBit > 24)
+            {
+                return E_INVALIDARG;
+            }
+
+            reader.Skip(highestBit + 1);
+            UINT unknownCount = (1u << highestBit) | (static_cast<UINT>(reader.Peek()) & ((1u << highestBit) - 1));
+            reader.Skip(highestBit);
+            if (unknownCount > static_cast<size_t>(pEnd - pPixel))
+            {
+                return E_INVALIDARG;
+            }
+
+            memset(pPixel, 0, unknownCount * sizeof(USHORT));
+            pPixel += unknownCount;
+            continue;
+        }
+
+        // An escape, followed by the 16-bit zigzag coded difference
+        UINT zigzag = static_cast<UINT>(bits >> codeLength) & 0xFFFF;
+        reader.Skip(codeLength + 16);
+        previous = (previous + DecodeZigzag(zigzag)) & 0xFFFF;
+        *pPixel++ = RotatePlayerIndexLow(previous);
+    }
+
+    // Fail if the frame ran past the end of the data
+    return reader.IsInside() ? S_OK : E_INVALIDARG;
+}
@@ -0,0 +1,106 @@
+//-----------------------------------------------------------------------------
+// <copyright file="DepthCodec.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation. All rights reserved.
+// </copyright>
+//-----------------------------------------------------------------------------
+
+#pragma once
+
+#include "Platform.h"
+#include <stddef.h>
+#include <vector>
+
+// Suppress warnings that come from compiling OpenCV code since we have no control over it
+#pragma warning(push)
+#pragma warning(disable : 6294 6031)
+#include <opencv2/core/core.hpp>
+#pragma warning(pop)
+
+using namespace cv;
+
+// Lossless compression of raw 16-bit depth frames, in the style of RVL (run length and variable
+// length coding). Pixels are visited in scan order as runs of unknown (0) pixels and the zigzag
+// coded difference of each known pixel from the previous known pixel. Before the difference is
+// taken, the player index is rotated from the low bits of a raw pixel to the high bits, so that
+// neighboring depths of the same player differ by small numbers.
+//
+// Differences below DEPTH_CODEC_SYMBOL_COUNT - 3 are symbols of their own; larger ones are an escape
+// symbol followed by the 16-bit zigzag value. An unknown pixel between two known ones has a symbol of its
+// own, and a longer run of unknown pixels is a run symbol followed by its exponential-Golomb coded length.
+// Symbols are written with a Huffman code made for the frame, so that sensor noise costs close to its
+// entropy rather than whole nibbles.
+//
+// An encoded frame is self-contained: two 32-bit little-endian values for the width and height, the
+// code length of every symbol in 4 bits, two per byte with the first in the low half, then the codes,
+// packed from the lowest bit of each byte.
+
+// Symbols of the code: the zigzag coded differences 0 to 252, the escape, the lone unknown pixel and the
+// run of unknown pixels
+#define DEPTH_CODEC_SYMBOL_COUNT 256
+
+/// <summary>
+/// Compresses raw depth frames, reusing its buffers from one frame to the next
+/// </summary>
+class DepthEncoder
+{
+public:
+    // Functions:
+    /// <summary>
+    /// Constructor
+    /// </summary>
+    DepthEncoder();
+
+    /// <summary>
+    /// Compresses a raw depth frame. The returned data is overwritten by the next call.
+    /// </summary>
+    /// <param name="pRawDepth">pointer to raw 16-bit depth Mat, with the player index in the low bits</param>
+    /// <param name="ppData">pointer in which to return the encoded frame</param>
+    /// <param name="pLength">pointer in which to return the length of the encoded frame in bytes</param>
+    /// <returns>S_OK if successful, an error code otherwise</returns>
+    HRESULT Encode(const Mat* pRawDepth, const BYTE** ppData, size_t* pLength);
+
+    /// <summary>
+    /// Gets the largest encoded length of a frame
+    /// </summary>
+    /// <param name="size">size of the frame</param>
+    /// <returns>length in bytes</returns>
+    static size_t GetMaxEncodedLength(Size size);
+
+private:
+    // Variables:
+    std::vector<BYTE> m_buffer;
+
+    // Zigzag coded difference of every known pixel, and the symbol of every pixel, counted before they are coded
+    std::vector<USHORT> m_zigzag;
+    std::vector<BYTE> m_symbols;
+
+    // Copy of frames whose rows are not contiguous, so that runs can span rows
+    Mat m_continuous;
+};
+
+/// <summary>
+/// Decompresses frames written by DepthEncoder, reusing its buffers from one frame to the next
+/// </summary>
+class DepthDecoder
+{
+public:
+    // Functions:
+    /// <summary>
+    /// Constructor
+    /// </summary>
+    DepthDecoder();
+
+    /// <summary>
+    /// Decompresses a raw depth frame
+    /// </summary>
+    /// <param name="pData">pointer to encoded frame</param>
+    /// <param name="length">length of the encoded frame in bytes</param>
+    /// <param name="pRawDepth">pointer to 16-bit depth Mat in which to return the frame; only reallocated if its size differs</param>
+    /// <returns>S_OK if successful, E_INVALIDARG if the data is not a whole encoded frame, an error code otherwise</returns>
+    HRESULT Decode(const BYTE* pData, size_t length, Mat* pRawDepth);
+
+private:
+    // Variables:
+    // Differences, or the symbol, decoded from every 12-bit pattern and the length of their codes
+    std::vector<UINT> m_table;
+};
@@ -0,0 +1,453 @@
+//-----------------------------------------------------------------------------
+// <copyright file="DepthColorRegistration.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation. All rights reserved.
+// </copyright>
+//-----------------------------------------------------------------------------
+
+#include "DepthColorRegistration.h"
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <fstream>
+
+using namespace cv;
+
+// Identifies a registration cache file and the layout of its contents
+static const char CACHE_MAGIC[4] = {'K', 'R', 'E', 'G'};
+static const int CACHE_VERSION = 1;
+
+// Largest depth the per-millimeter bucket table covers; the 13-bit depth of the Kinect fits
+static const int MAX_TABLE_DEPTH = 8191;
+
+/// <summary>
+/// Header written before the table in a cache file
+/// </summary>
+struct RegistrationCacheHeader
+{
+    char magic[4];
+    int version;
+    int depthWidth;
+    int depthHeight;
+    int colorWidth;
+    int colorHeight;
+    int buckets;
+    int minDepth;
+    int maxDepth;
+};
+
+/// <summary>
+/// Constructor
+/// </summary>
+DepthColorRegistration::DepthColorRegistration() :
+    m_depthResolution(NUI_IMAGE_RESOLUTION_INVALID),
+    m_colorResolution(NUI_IMAGE_RESOLUTION_INVALID)
+{
+    BuildDepthBuckets();
+}
+
+/// <summary>
+/// Makes the table for the given resolutions available, loading it from the cache file or building and caching it.
+/// Does nothing if the table already matches.
+/// </summary>
+/// <param name="depthResolution">resolution of depth image stream</param>
+/// <param name="colorResolution">resolution of color image stream</param>
+/// <returns>S_OK if successful, an error code otherwise</returns>
+HRESULT DepthColorRegistration::Initialize(NUI_IMAGE_RESOLUTION depthResolution, NUI_IMAGE_RESOLUTION colorResolution)
+{
+    if (IsInitialized(depthResolution, colorResolution))
+    {
+        return S_OK;
+    }
+
+    // Fail if either resolution is invalid
+    if (depthResolution == NUI_IMAGE_RESOLUTION_INVALID || colorResolution == NUI_IMAGE_RESOLUTION_INVALID)
+    {
+        return E_INVALIDARG;
+    }
+
+    DWORD depthWidth, depthHeight, colorWidth, colorHeight;
+    NuiImageResolutionToSize(depthResolution, depthWidth, depthHeight);
+    NuiImageResolutionToSize(colorResolution, colorWidth, colorHeight);
+
+    m_depthResolution = NUI_IMAGE_RESOLUTION_INVALID;
+    m_colorResolution = NUI_IMAGE_RESOLUTION_INVALID;
+    m_depthSize = Size(depthWidth, depthHeight);
+    m_colorSize = Size(colorWidth, colorHeight);
+
+    char path[64];
+    sprintf_s(path, "Registration_%dx%d_%dx%d.lut", m_depthSize.width, m_depthSize.height, m_colorSize.width, m_colorSize.height);
+
+    // Building takes one SDK call per bucket over a whole frame, so the result is kept for the next run
+    HRESULT hr = Load(path);
+    if (hr != S_OK)
+    {
+        hr = Build();
+        if (FAILED(hr))
+        {
+            m_table.clear();
+            return hr;
+        }
+
+        // A cache that cannot be written only costs the next run a rebuild
+        Save(path);
+    }
+
+    m_depthResolution = depthResolution;
+    m_colorResolution = colorResolution;
+
+    return S_OK;
+}
+
+/// <summary>
+/// Gets whether the table matches the given resolutions
+/// </summary>
+/// <param name="depthResolution">resolution of depth image stream</param>
+/// <param name="colorResolution">resolution of color image stream</param>
+/// <returns>true if Initialize succeeded for these resolutions</returns>
+bool DepthColorRegistration::IsInitialized(NUI_IMAGE_RESOLUTION depthResolution, NUI_IMAGE_RESOLUTION colorResolution) const
+{
+    return m_depthResolution != NUI_IMAGE_RESOLUTION_INVALID &&
+        m_depthResolution == depthResolution && m_colorResolution == colorResolution;
+}
+
+/// <summary>
+/// Maps one depth pixel to color image coordinates
+/// </summary>
+/// <param name="x">column of depth pixel</param>
+/// <param name="y">row of depth pixel</param>
+/// <param name="depth">depth of pixel in millimeters</param>
+/// <param name="pColor">pointer in which to return the color image coordinates, which may lie outside the image</param>
+/// <returns>S_OK if successful, an error code otherwise</returns>
+HRESULT DepthColorRegistration::MapDepthPixel(int x, int y, int depth, Point* pColor) const
+{
+    // Fail if pointer is invalid
+    if (!pColor)
+    {
+        return E_POINTER;
+    }
+
+    // Fail if there is no table
+    if (m_depthResolution == NUI_IMAGE_RESOLUTION_INVALID)
+    {
+        return E_NOT_VALID_STATE;
+    }
+
+    // Fail if the pixel is outside the depth image or its depth is unknown
+    if (x < 0 || y < 0 || x >= m_depthSize.width || y >= m_depthSize.height || depth <= 0)
+    {
+        return E_INVALIDARG;
+    }
+
+    Interpolate(y * m_depthSize.width + x, depth, &pColor->x, &pColor->y);
+
+    return S_OK;
+}
+
+/// <summary>
+/// Renders the depth from the color camera's point of view. Where several depth pixels land on the
+/// same color pixel the nearest wins; color pixels no depth pixel lands on are 0.
+/// </summary>
+/// <param name="pDepth">pointer to 16-bit depth Mat in millimeters, at the depth resolution</param>
+/// <param name="pAligned">pointer in which to return 16-bit depth at the color resolution</param>
+/// <returns>S_OK if successful, an error code otherwise</returns>
+HRESULT DepthColorRegistration::AlignDepthToColor(const Mat* pDepth, Mat* pAligned) const
+{
+    // Fail if either pointer is invalid
+    if (!pDepth || !pAligned)
+    {
+        return E_POINTER;
+    }
+
+    // Fail if there is no table
+    if (m_depthResolution == NUI_IMAGE_RESOLUTION_INVALID)
+    {
+        return E_NOT_VALID_STATE;
+    }
+
+    // Fail if the depth does not match the table
+    if (pDepth->size() != m_depthSize || pDepth->type() != CV_16UC1)
+    {
+        return E_INVALIDARG;
+    }
+
+    pAligned->create(m_colorSize, CV_16UC1);
+    pAligned->setTo(Scalar(0));
+
+    for (int y = 0; y < m_depthSize.height; ++y)
+    {
+        const USHORT* pDepthRow = pDepth->ptr<USHORT>(y);
+        int pixel = y * m_depthSize.width;
+
+        for (int x = 0; x < m_depthSize.width; ++x, ++pixel)
+        {
+            int depth = pDepthRow[x];
+            if (depth == 0)
+            {
+                continue;
+            }
+
+            int colorX, colorY;
+            Interpolate(pixel, depth, &colorX, &colorY);
+            if (colorX < 0 || colorY < 0 || colorX >= m_colorSize.width || colorY >= m_colorSize.height)
+            {
+                continue;
+            }
+
+            // Keep the nearest surface
+            USHORT& aligned = pAligned->ptr<USHORT>(colorY)[colorX];
+            if (aligned == 0 || depth < aligned)
+            {
+                aligned = static_cast<USHORT>(depth);
+            }
+        }
+    }
+
+    return S_OK;
+}
+
+/// <summary>
+/// Samples the color image at every depth pixel; pixels with unknown depth or outside the color image are 0
+/// </summary>
+/// <param name="pDepth">pointer to 16-bit depth Mat in millimeters, at the depth resolution</param>
+/// <param name="pColor">pointer to color image Mat, at the color resolution</param>
+/// <param name="pAligned">pointer in which to return a color image at the depth resolution</param>
+/// <returns>S_OK if successful, an error code otherwise</returns>
+HRESULT DepthColorRegistration::AlignColorToDepth(const Mat* pDepth, const Mat* pColor, Mat* pAligned) const
+{
+    // Fail if any pointer is invalid
+    if (!pDepth || !pColor || !pAligned)
+    {
+        return E_POINTER;
+    }
+
+    // Fail if there is no table
+    if (m_depthResolution == NUI_IMAGE_RESOLUTION_INVALID)
+    {
+        return E_NOT_VALID_STATE;
+    }
+
+    // Fail if the images do not match the table
+    if (pDepth->size() != m_depthSize || pDepth->type() != CV_16UC1 || pColor->size() != m_colorSize || pColor->type() != CV_8UC4)
+    {
+        return E_INVALIDARG;
+    }
+
+    pAligned->create(m_depthSize, CV_8UC4);
+
+    for (int y = 0; y < m_depthSize.height; ++y)
+    {
+        const USHORT* pDepthRow = pDepth->ptr<USHORT>(y);
+        Vec4b* pAlignedRow = pAligned->ptr<Vec4b>(y);
+        int pixel = y * m_depthSize.width;
+
+        for (int x = 0; x < m_depthSize.width; ++x, ++pixel)
+        {
+            int depth = pDepthRow[x];
+            int colorX = -1;
+            int colorY = -1;
+            if (depth != 0)
+            {
+                Interpolate(pixel, depth, &colorX, &colorY);
+            }
+
+            if (colorX < 0 || colorY < 0 || colorX >= m_colorSize.width || colorY >= m_colorSize.height)
+            {
+                pAlignedRow[x] = Vec4b(0, 0, 0, 0);
+            }
+            else
+            {
+                pAlignedRow[x] = pColor->ptr<Vec4b>(colorY)[colorX];
+            }
+        }
+    }
+
+    return S_OK;
+}
+
+/// <summary>
+/// Exchanges tables with another registration, so that a table built elsewhere is taken over without a copy
+/// </summary>
+/// <param name="pOther">pointer to the registration to exchange with</param>
+void DepthColorRegistration::Swap(DepthColorRegistration* pOther)
+{
+    std::swap(m_depthResolution, pOther->m_depthResolution);
+    std::swap(m_colorResolution, pOther->m_colorResolution);
+    std::swap(m_depthSize, pOther->m_depthSize);
+    std::swap(m_colorSize, pOther->m_colorSize);
+    m_table.swap(pOther->m_table);
+}
+
+/// <summary>
+/// Forgets the table and frees its memory
+/// </summary>
+void DepthColorRegistration::Reset()
+{
+    m_depthResolution = NUI_IMAGE_RESOLUTION_INVALID;
+    m_colorResolution = NUI_IMAGE_RESOLUTION_INVALID;
+    std::vector<short>().swap(m_table);
+}
+
+/// <summary>
+/// Builds the table from the Kinect SDK's mapping, one constant-depth frame per bucket
+/// </summary>
+/// <returns>S_OK if successful, E_NOTIMPL without the Kinect SDK, an error code otherwise</returns>
+HRESULT DepthColorRegistration::Build()
+{
+#ifdef _WIN32
+    DWORD pixelCount = static_cast<DWORD>(m_depthSize.area());
+    std::vector<USHORT> depthFrame(pixelCount);
+    std::vector<LONG> colorCoordinates(2 * pixelCount);
+
+    m_table.resize(static_cast<size_t>(pixelCount) * DEPTH_BUCKETS * 2);
+
+    NUI_IMAGE_RESOLUTION depthResolution = (m_depthSize.width == 640) ? NUI_IMAGE_RESOLUTION_640x480 :
+        (m_depthSize.width == 320) ? NUI_IMAGE_RESOLUTION_320x240 : NUI_IMAGE_RESOLUTION_80x60;
+    NUI_IMAGE_RESOLUTION colorResolution = (m_colorSize.width == 1280) ? NUI_IMAGE_RESOLUTION_1280x960 : NUI_IMAGE_RESOLUTION_640x480;
+
+    for (int bucket = 0; bucket < DEPTH_BUCKETS; ++bucket)
+    {
+        // The SDK takes packed depth, with the player index in the low bits
+        USHORT depth = static_cast<USHORT>(cvRound(GetBucketDepth(bucket)));
+        std::fill(depthFrame.begin(), depthFrame.end(), static_cast<USHORT>(depth << NUI_IMAGE_PLAYER_INDEX_SHIFT));
+
+        HRESULT hr = NuiImageGetColorPixelCoordinateFrameFromDepthPixelFrameAtResolution(colorResolution, depthResolution,
+            pixelCount, &depthFrame[0], 2 * pixelCount, &colorCoordinates[0]);
+        if (FAILED(hr))
+        {
+            return hr;
+        }
+
+        for (DWORD pixel = 0; pixel < pixelCount; ++pixel)
+        {
+            short* pEntry = &m_table[(pixel * DEPTH_BUCKETS + bucket) * 2];
+            pEntry[0] = saturate_cast<short>(colorCoordinates[2 * pixel]);
+            pEntry[1] = saturate_cast<short>(colorCoordinates[2 * pixel + 1]);
+        }
+    }
+
+    return S_OK;
+#else
+    // Without the Kinect SDK there is no mapping to sample, only tables cached where it was available
+    return E_NOTIMPL;
+#endif
+}
+
+/// <summary>
+/// Reads the table from the given cache file if it was built for the current resolutions
+/// </summary>
+/// <param name="path">path of cache file</param>
+/// <returns>S_OK if the table was read, S_FALSE if there is no usable cache, an error code otherwise</returns>
+HRESULT DepthColorRegistration::Load(const std::string& path)
+{
+    std::ifstream file(path.c_str(), std::ios::binary);
+    if (!file.is_open())
+    {
+        return S_FALSE;
+    }
+
+    RegistrationCacheHeader header;
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+
+    // A cache from another version, resolution pair or sampling is rebuilt rather than trusted
+    if (!file || memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0 || header.version != CACHE_VERSION ||
+        header.depthWidth != m_depthSize.width || header.depthHeight != m_depthSize.height ||
+        header.colorWidth != m_colorSize.width || header.colorHeight != m_colorSize.height ||
+        header.buckets != DEPTH_BUCKETS || header.minDepth != MIN_DEPTH || header.maxDepth != MAX_DEPTH)
+    {
+        return S_FALSE;
+    }
+
+    m_table.resize(static_cast<size_t>(m_depthSize.area()) * DEPTH_BUCKETS * 2);
+    file.read(reinterpret_cast<char*>(&m_table[0]), m_table.size() * sizeof(short));
+
+    return file ? S_OK : S_FALSE;
+}
+
+/// <summary>
+/// Writes the table to the given cache file
+/// </summary>
+/// <param name="path">path of cache file</param>
+/// <returns>S_OK if successful, an error code otherwise</returns>
+HRESULT DepthColorRegistration::Save(const std::string& path) const
+{
+    std::ofstream file(path.c_str(), std::ios::binary);
+    if (!file.is_open())
+    {
+        return E_FAIL;
+    }
+
+    RegistrationCacheHeader header;
+    memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    header.version = CACHE_VERSION;
+    header.depthWidth = m_depthSize.width;
+    header.depthHeight = m_depthSize.height;
+    header.colorWidth = m_colorSize.width;
+    header.colorHeight = m_colorSize.height;
+    header.buckets = DEPTH_BUCKETS;
+    header.minDepth = MIN_DEPTH;
+    header.maxDepth = MAX_DEPTH;
+
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(&m_table[0]), m_table.size() * sizeof(short));
+
+    return file.good() ? S_OK : E_FAIL;
+}
+
+/// <summary>
+/// Gets the depth in millimeters that the given bucket is sampled at; bucket 0 is the farthest
+/// </summary>
+/// <param name="bucket">index of bucket</param>
+/// <returns>depth in millimeters</returns>
+float DepthColorRegistration::GetBucketDepth(int bucket)
+{
+    // The shift between the cameras grows with inverse depth, so the buckets are spaced evenly in it
+    float farInverse = 1.0f / MAX_DEPTH;
+    float nearInverse = 1.0f / MIN_DEPTH;
+    return 1.0f / (farInverse + bucket * (nearInverse - farInverse) / (DEPTH_BUCKETS - 1));
+}
+
+/// <summary>
+/// Fills the per-millimeter table of which buckets each depth lies between
+/// </summary>
+void DepthColorRegistration::BuildDepthBuckets()
+{
+    float farInverse = 1.0f / MAX_DEPTH;
+    float nearInverse = 1.0f / MIN_DEPTH;
+
+    m_depthBuckets.resize(MAX_TABLE_DEPTH + 1);
+    m_depthFractions.resize(MAX_TABLE_DEPTH + 1);
+
+    for (int depth = 1; depth <= MAX_TABLE_DEPTH; ++depth)
+    {
+        float position = (1.0f / depth - farInverse) / (nearInverse - farInverse) * (DEPTH_BUCKETS - 1);
+        position = min(static_cast<float>(DEPTH_BUCKETS - 1), max(0.0f, position));
+
+        int bucket = min(DEPTH_BUCKETS - 2, static_cast<int>(position));
+        m_depthBuckets[depth] = static_cast<BYTE>(bucket);
+        m_depthFractions[depth] = position - bucket;
+    }
+
+    m_depthBuckets[0] = 0;
+    m_depthFractions[0] = 0.0f;
+}
+
+/// <summary>
+/// Interpolates the color coordinates of a depth pixel between the buckets around its depth
+/// </summary>
+/// <param name="pixel">index of depth pixel</param>
+/// <param name="depth">depth in millimeters, not 0</param>
+/// <param name="pX">pointer in which to return the color column</param>
+/// <param name="pY">pointer in which to return the color row</param>
+void DepthColorRegistration::Interpolate(int pixel, int depth, int* pX, int* pY) const
+{
+    depth = min(depth, MAX_TABLE_DEPTH);
+    int bucket = m_depthBuckets[depth];
+    float fraction = m_depthFractions[depth];
+
+    const short* pFar = &m_table[(static_cast<size_t>(pixel) * DEPTH_BUCKETS + bucket) * 2];
+    const short* pNear = pFar + 2;
+
+    *pX = cvRound(pFar[0] + (pNear[0] - pFar[0]) * fraction);
+    *pY = cvRound(pFar[1] + (pNear[1] - pFar[1]) * fraction);
+}
@@ -0,0 +1,160 @@
+//-----------------------------------------------------------------------------
+// <copyright file="DepthColorRegistration.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation. All rights reserved.
+// </copyright>
+//-----------------------------------------------------------------------------
+
+#pragma once
+
+#include "Platform.h"
+#include <string>
+#include <vector>
+
+// Suppress warnings that come from compiling OpenCV code since we have no control over it
+#pragma warning(push)
+#pragma warning(disable : 6294 6031)
+#include <opencv2/core/core.hpp>
+#pragma warning(pop)
+
+#ifdef _WIN32
+#include <NuiApi.h>
+#endif
+
+using namespace cv;
+
+/// <summary>
+/// Lookup table from every depth pixel to color image coordinates. Where a depth pixel lands in the
+/// color image depends on its depth, so the table holds the color coordinates at a few depths spaced
+/// evenly in inverse depth and interpolates between them. It is built once per resolution pair from the
+/// Kinect SDK's mapping and cached on disk, after which whole frames are registered in a single pass.
+/// Without the Kinect SDK, for example when replaying a recording, the table can only be loaded from the cache.
+/// </summary>
+class DepthColorRegistration
+{
+public:
+    // Constants:
+    // Number of depths the table is sampled at
+    static const int DEPTH_BUCKETS = 8;
+
+    // Range of depths sampled, in millimeters; depths outside it use the nearest end
+    static const int MIN_DEPTH = 400;
+    static const int MAX_DEPTH = 8000;
+
+    // Functions:
+    /// <summary>
+    /// Constructor
+    /// </summary>
+    DepthColorRegistration();
+
+    /// <summary>
+    /// Makes the table for the given resolutions available, loading it from the cache file or building and caching it.
+    /// Does nothing if the table already matches.
+    /// </summary>
+    /// <param name="depthResolution">resolution of depth image stream</param>
+    /// <param name="colorResolution">resolution of color image stream</param>
+    /// <returns>S_OK if successful, an error code otherwise</returns>
+    HRESULT Initialize(NUI_IMAGE_RESOLUTION depthResolution, NUI_IMAGE_RESOLUTION colorResolution);
+
+    /// <summary>
+    /// Gets whether the table matches the given resolutions
+    /// </summary>
+    /// <param name="depthResolution">resolution of depth image stream</param>
+    /// <param name="colorResolution">resolution of color image stream</param>
+    /// <returns>true if Initialize succeeded for these resolutions</returns>
+    bool IsInitialized(NUI_IMAGE_RESOLUTION depthResolution, NUI_IMAGE_RESOLUTION colorResolution) const;
+
+    /// <summary>
+    /// Maps one depth pixel to color image coordinates
+    /// </summary>
+    /// <param name="x">column of depth pixel</param>
+    /// <param name="y">row of depth pixel</param>
+    /// <param name="depth">depth of pixel in millimeters</param>
+    /// <param name="pColor">pointer in which to return the color image coordinates, which may lie outside the image</param>
+    /// <returns>S_OK if successful, an error code otherwise</returns>
+    HRESULT MapDepthPixel(int x, int y, int depth, Point* pColor) const;
+
+    /// <summary>
+    /// Renders the depth from the color camera's point of view. Where several depth pixels land on the
+    /// same color pixel the nearest wins; color pixels no depth pixel lands on are 0.
+    /// </summary>
+    /// <param name="pDepth">pointer to 16-bit depth Mat in millimeters, at the depth resolution</param>
+    /// <param name="pAligned">pointer in which to return 16-bit depth at the color resolution</param>
+    /// <returns>S_OK if successful, an error code otherwise</returns>
+    HRESULT AlignDepthToColor(const Mat* pDepth, Mat* pAligned) const;
+
+    /// <summary>
+    /// Samples the color image at every depth pixel; pixels with unknown depth or outside the color image are 0
+    /// </summary>
+    /// <param name="pDepth">pointer to 16-bit depth Mat in millimeters, at the depth resolution</param>
+    /// <param name="pColor">pointer to color image Mat, at the color resolution</param>
+    /// <param name="pAligned">pointer in which to return a color image at the depth resolution</param>
+    /// <returns>S_OK if successful, an error code otherwise</returns>
+    HRESULT AlignColorToDepth(const Mat* pDepth, const Mat* pColor, Mat* pAligned) const;
+
+    /// <summary>
+    /// Exchanges tables with another registration, so that a table built elsewhere is taken over without a copy
+    /// </summary>
+    /// <param name="pOther">pointer to the registration to exchange with</param>
+    void Swap(DepthColorRegistration* pOther);
+
+    /// <summary>
+    /// Forgets the table and frees its memory
+    /// </summary>
+    void Reset();
+
+private:
+    // Functions:
+    /// <summary>
+    /// Builds the table from the Kinect SDK's mapping, one constant-depth frame per bucket
+    /// </summary>
+    /// <returns>S_OK if successful, E_NOTIMPL without the Kinect SDK, an error code otherwise</returns>
+    HRESULT Build();
+
+    /// <summary>
+    /// Reads the table from the given cache file if it was built for the current resolutions
+    /// </summary>
+    /// <param name="path">path of cache file</param>
+    /// <returns>S_OK if the table was read, S_FALSE if there is no usable cache, an error code otherwise</returns>
+    HRESULT Load(const std::string& path);
+
+    /// <summary>
+    /// Writes the table to the given cache file
+    /// </summary>
+    /// <param name="path">path of cache file</param>
+    /// <returns>S_OK if successful, an error code otherwise</returns>
+    HRESULT Save(const std::string& path) const;
+
+    /// <summary>
+    /// Gets the depth in millimeters that the given bucket is sampled at; bucket 0 is the farthest
+    /// </summary>
+    /// <param name="bucket">index of bucket</param>
+    /// <returns>depth in millimeters</returns>
+    static float GetBucketDepth(int bucket);
+
+    /// <summary>
+    /// Fills the per-millimeter table of which buckets each depth lies between
+    /// </summary>
+    void BuildDepthBuckets();
+
+    /// <summary>
+    /// Interpolates the color coordinates of a depth pixel between the buckets around its depth
+    /// </summary>
+    /// <param name="pixel">index of depth pixel</param>
+    /// <param name="depth">depth in millimeters, not 0</param>
+    /// <param name="pX">pointer in which to return the color column</param>
+    /// <param name="pY">pointer in which to return the color row</param>
+    void Interpolate(int pixel, int depth, int* pX, int* pY) const;
+
+    // Variables:
+    NUI_IMAGE_RESOLUTION m_depthResolution;
+    NUI_IMAGE_RESOLUTION m_colorResolution;
+    Size m_depthSize;
+    Size m_colorSize;
+
+    // Color x and y for each depth pixel and bucket, as [pixel][bucket][x, y]
+    std::vector<short> m_table;
+
+    // For every depth in millimeters, the farther of the two buckets it lies between and the weight of the nearer one
+    std::vector<BYTE> m_depthBuckets;
+    std::vector<float> m_depthFractions;
+};
@@ -0,0 +1,694 @@
+//-----------------------------------------------------------------------------
+// <copyright file="DepthFilters.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation. All rights reserved.
+// </copyright>
+//-----------------------------------------------------------------------------
+
+#include "DepthFilters.h"
+#include <limits.h>
+#include <vector>
+
+// Suppress warnings that come from compiling OpenCV code since we have no control over it
+#pragma warning(push)
+#pragma warning(disable : 6294 6031)
+#include <opencv2/imgproc/imgproc.hpp>
+#pragma warning(pop)
+
+// SSE2 is always available on x64 and on the x86 targets the Kinect SDK supports
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define DEPTH_FILTERS_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+using namespace cv;
+
+/// <summary>
+/// Fails unless the source is a 16-bit depth plane and the destination is a different Mat
+/// </summary>
+/// <param name="pSrc">pointer to source Mat</param>
+/// <param name="pDst">pointer to destination Mat</param>
+/// <returns>S_OK if the arguments are valid, an error code otherwise</returns>
+static HRESULT VerifyDepthArguments(const Mat* pSrc, const Mat* pDst)
+{
+    // Fail if either pointer is invalid
+    if (!pSrc || !pDst)
+    {
+        return E_POINTER;
+    }
+
+    // Fail if Mat contains no data, is not a depth plane, or would be filtered in place
+    if (pSrc->empty() || pSrc->type() != CV_16UC1 || pSrc == pDst)
+    {
+        return E_INVALIDARG;
+    }
+
+    return S_OK;
+}
+
+/// <summary>
+/// Replaces every pixel with the median of its neighborhood
+/// </summary>
+/// <param name="pSrc">pointer to 16-bit depth Mat to filter</param>
+/// <param name="pDst">pointer to 16-bit depth Mat in which to return the result</param>
+/// <param name="kernelSize">neighborhood width, 3 or 5</param>
+/// <returns>S_OK if successful, an error code otherwise</returns>
+HRESULT MedianDepthFilter(const Mat* pSrc, Mat* pDst, int kernelSize)
+{
+    HRESULT hr = VerifyDepthArguments(pSrc, pDst);
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+
+    // Fail if OpenCV has no 16-bit median for the kernel size
+    if (kernelSize != 3 && kernelSize != 5)
+    {
+        return E_INVALIDARG;
+    }
+
+    medianBlur(*pSrc, *pDst, kernelSize);
+
+    return S_OK;
+}
+
+/// <summary>
+/// Filters one pixel of the edge preserving filter, clamping the neighborhood to the image
+/// </summary>
+/// <param name="src">depth Mat to filter</param>
+/// <param name="x">column of pixel</param>
+/// <param name="y">row of pixel</param>
+/// <param name="radius">neighborhood radius in pixels</param>
+/// <param name="rangeThreshold">largest depth difference for a neighbor to be averaged</param>
+/// <returns>filtered depth</returns>
+static USHORT FilterEdgePreservingPixel(const Mat& src, int x, int y, int radius, int rangeThreshold)
+{
+    int center = src.ptr<USHORT>(y)[x];
+    if (center == 0)
+    {
+        return 0;
+    }
+
+    int sum = 0;
+    int count = 0;
+    for (int ny = max(0, y - radius); ny <= min(src.rows - 1, y + radius); ++ny)
+    {
+        const USHORT* pRow = src.ptr<USHORT>(ny);
+        for (int nx = max(0, x - radius); nx <= min(src.cols - 1, x + radius); ++nx)
+        {
+            int neighbor = pRow[nx];
+            int difference = neighbor - center;
+            if (neighbor != 0 && difference <= rangeThreshold && -difference <= rangeThreshold)
+            {
+                sum += neighbor;
+                ++count;
+            }
+        }
+    }
+
+    // The center pixel always counts, so count is at least 1. Rounds the same way as the vector path.
+    return static_cast<USHORT>(cvRound(static_cast<float>(sum) / count));
+}
+
+/// <summary>
+/// Runs the edge preserving filter over a range of rows
+/// </summary>
+class EdgePreservingBody : public ParallelLoopBody
+{
+public:
+    /// <summary>
+    /// Constructor
+    /// </summary>
+    /// <param name="src">depth Mat to filter</param>
+    /// <param name="dst">depth Mat in which to write the result</param>
+    /// <param name="radius">neighborhood radius in pixels</param>
+    /// <param name="rangeThreshold">largest depth difference for a neighbor to be averaged</param>
+    EdgePreservingBody(const Mat& src, Mat& dst, int radius, int rangeThreshold) :
+        m_src(src),
+        m_dst(dst),
+        m_radius(radius),
+        m_rangeThreshold(rangeThreshold)
+    {
+    }
+
+    /// <summary>
+    /// Filters the given rows
+    /// </summary>
+    /// <param name="rows">range of rows to filter</param>
+    void operator()(const Range& rows) const
+    {
+        for (int y = rows.start; y < rows.end; ++y)
+        {
+            USHORT* pDstRow = m_dst.ptr<USHORT>(y);
+
+            // Pixels whose neighborhood crosses the border of the image need clamping
+            bool isBorderRow = (y < m_radius || y >= m_src.rows - m_radius);
+            int x = 0;
+            for (; x < m_src.cols && (isBorderRow || x < m_radius); ++x)
+            {
+                pDstRow[x] = FilterEdgePreservingPixel(m_src, x, y, m_radius, m_rangeThreshold);
+            }
+
+#ifdef DEPTH_FILTERS_USE_SSE2
+            if (!isBorderRow)
+            {
+                x = FilterInteriorSse2(y, x, pDstRow);
+            }
+#endif
+
+            for (; x < m_src.cols; ++x)
+            {
+                pDstRow[x] = FilterEdgePreservingPixel(m_src, x, y, m_radius, m_rangeThreshold);
+            }
+        }
+    }
+
+private:
+    // The body only refers to the Mats, so it cannot be assigned
+    EdgePreservingBody& operator=(const EdgePreservingBody&);
+
+#ifdef DEPTH_FILTERS_USE_SSE2
+    /// <summary>
+    /// Filters the interior of a row eight pixels at a time, without branches
+    /// </summary>
+    /// <param name="y">row to filter, at least radius rows from the top and bottom</param>
+    /// <param name="x">first column to filter, at least radius columns from the left</param>
+    /// <param name="pDstRow">pointer to destination row</param>
+    /// <returns>first column that was not filtered</returns>
+    int FilterInteriorSse2(int y, int x, USHORT* pDstRow) const
+    {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i threshold = _mm_set1_epi16(static_cast<short>(m_rangeThreshold));
+        const USHORT* pCenterRow = m_src.ptr<USHORT>(y);
+
+        for (; x + 8 + m_radius <= m_src.cols; x += 8)
+        {
+            __m128i center = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pCenterRow + x));
+            __m128i sumLow = zero;
+            __m128i sumHigh = zero;
+            __m128i count = zero;
+
+            for (int dy = -m_radius; dy <= m_radius; ++dy)
+            {
+                const USHORT* pRow = m_src.ptr<USHORT>(y + dy);
+                for (int dx = -m_radius; dx <= m_radius; ++dx)
+                {
+                    __m128i neighbor = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pRow + x + dx));
+
+                    // |neighbor - center| <= threshold, using saturating unsigned subtraction
+                    __m128i difference = _mm_or_si128(_mm_subs_epu16(neighbor, center), _mm_subs_epu16(center, neighbor));
+                    __m128i isClose = _mm_cmpeq_epi16(_mm_subs_epu16(difference, threshold), zero);
+                    __m128i isKnown = _mm_xor_si128(_mm_cmpeq_epi16(neighbor, zero), _mm_set1_epi16(-1));
+                    __m128i isUsed = _mm_and_si128(isClose, isKnown);
+
+                    // Masks are all ones, so subtracting them counts
+                    __m128i used = _mm_and_si128(neighbor, isUsed);
+                    sumLow = _mm_add_epi32(sumLow, _mm_unpacklo_epi16(used, zero));
+                    sumHigh = _mm_add_epi32(sumHigh, _mm_unpackhi_epi16(used, zero));
+                    count = _mm_sub_epi16(count, isUsed);
+                }
+            }
+
+            // Round to nearest; unknown centers have count 0 and are forced back to 0
+            __m128i isCenterKnown = _mm_xor_si128(_mm_cmpeq_epi16(center, zero), _mm_set1_epi16(-1));
+            __m128i safeCount = _mm_max_epi16(count, _mm_set1_epi16(1));
+            __m128 countLow = _mm_cvtepi32_ps(_mm_unpacklo_epi16(safeCount, zero));
+            __m128 countHigh = _mm_cvtepi32_ps(_mm_unpackhi_epi16(safeCount, zero));
+            __m128i meanLow = _mm_cvtps_epi32(_mm_div_ps(_mm_cvtepi32_ps(sumLow), countLow));
+            __m128i meanHigh = _mm_cvtps_epi32(_mm_div_ps(_mm_cvtepi32_ps(sumHigh), countHigh));
+
+            // Means fit in 16 bits, so bias into the signed range to pack them without saturating
+            const __m128i bias = _mm_set1_epi32(32768);
+            __m128i mean = _mm_packs_epi32(_mm_sub_epi32(meanLow, bias), _mm_sub_epi32(meanHigh, bias));
+            mean = _mm_add_epi16(mean, _mm_set1_epi16(-32768));
+            mean = _mm_and_si128(mean, isCenterKnown);
+
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(pDstRow + x), mean);
+        }
+
+        return x;
+    }
+#endif
+
+    // Variables:
+    const Mat& m_src;
+    Mat& m_dst;
+    int m_radius;
+    int m_rangeThreshold;
+};
+
+/// <summary>
+/// Smooths depth without blurring across edges: each known pixel becomes the mean of the known
+/// neighbors whose depth is within rangeThreshold of its own. Unknown pixels stay unknown.
+/// Rows are split across threads and the interior of each row is processed eight pixels at a time.
+/// </summary>
+/// <param name="pSrc">pointer to 16-bit depth Mat to filter</param>
+/// <param name="pDst">pointer to 16-bit depth Mat in which to return the result</param>
+/// <param name="radius">neighborhood radius in pixels, 1 to 3</param>
+/// <param name="rangeThreshold">largest depth difference in millimeters for a neighbor to be averaged</param>
+/// <returns>S_OK if successful, an error code otherwise</returns>
+HRESULT EdgePreservingDepthFilter(const Mat* pSrc, Mat* pDst, int radius, int rangeThreshold)
+{
+    HRESULT hr = VerifyDepthArguments(pSrc, pDst);
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+
+    // Fail if the radius is unsupported or the threshold does not fit the 16-bit vector compare
+    if (radius < 1 || radius > 3 || rangeThreshold < 0 || rangeThreshold > SHRT_MAX)
+    {
+        return E_INVALIDARG;
+    }
+
+    pDst->create(pSrc->size(), CV_16UC1);
+    parallel_for_(Range(0, pSrc->rows), EdgePreservingBody(*pSrc, *pDst, radius, rangeThreshold));
+
+    return S_OK;
+}
+
+/// <summary>
+/// Applies a morphological operation with a square kernel. Because unknown pixels are 0,
+/// closing fills small holes and opening removes small isolated readings.
+/// </summary>
+/// <param name="pSrc">pointer to 16-bit depth Mat to filter</param>
+/// <param name="pDst">pointer to 16-bit depth Mat in which to return the result</param>
+/// <param name="operation">MORPH_OPEN, MORPH_CLOSE, MORPH_ERODE or MORPH_DILATE</param>
+/// <param name="kernel">structuring element</param>
+/// <returns>S_OK if successful, an error code otherwise</returns>
+HRESULT MorphologyDepthFilter(const Mat* pSrc, Mat* pDst, int operation, const Mat& kernel)
+{
+    HRESULT hr = VerifyDepthArguments(pSrc, pDst);
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+
+    switch (operation)
+    {
+    case MORPH_ERODE:
+        erode(*pSrc, *pDst, kernel);
+        break;
+    case MORPH_DILATE:
+        dilate(*pSrc, *pDst, kernel);
+        break;
+    case MORPH_OPEN:
+    case MORPH_CLOSE:
+        morphologyEx(*pSrc, *pDst, operation, kernel);
+        break;
+    default:
+        return E_INVALIDARG;
+    }
+
+    return S_OK;
+}
+
+/// <summary>
+/// Filters one pixel of the temporal filter
+/// </summary>
+/// <param name="depth">depth of the new frame</param>
+/// <param name="pState">pointer to filtered depth of the pixel, updated in place</param>
+/// <param name="pAge">pointer to age of the pixel, updated in place</param>
+/// <param name="keepWeight">weight of the previous depth, in 65536ths</param>
+/// <param name="takeWeight">weight of the new depth, in 65536ths</param>
+/// <param name="jumpThreshold">largest change that is smoothed</param>
+/// <param name="maxAge">number of frames a pixel is held</param>
+static void FilterTemporalPixel(USHORT depth, USHORT* pState, BYTE* pAge, int keepWeight, int takeWeight, int jumpThreshold, int maxAge)
+{
+    int previous = *pState;
+
+    if (depth != 0)
+    {
+        int difference = depth - previous;
+        bool isSmoothed = (previous != 0 && difference <= jumpThreshold && -difference <= jumpThreshold);
+
+        // Weighs the same way as the vector path, which can only keep the high half of each product
+        *pState = isSmoothed ? static_cast<USHORT>(((static_cast<UINT>(previous) * keepWeight) >> 16) + ((static_cast<UINT>(depth) * takeWeight) >> 16)) : depth;
+        *pAge = 0;
+    }
+    else if (previous != 0 && *pAge < maxAge)
+    {
+        ++*pAge;
+    }
+    else
+    {
+        *pState = 0;
+        *pAge = static_cast<BYTE>(maxAge);
+    }
+}
+
+#ifdef DEPTH_FILTERS_USE_SSE2
+/// <summary>
+/// Picks between two vectors using a mask that is all ones or all zeros in each lane
+/// </summary>
+/// <param name="mask">lanes to take from a</param>
+/// <param name="a">vector to take where mask is set</param>
+/// <param name="b">vector to take where mask is clear</param>
+/// <returns>blended vector</returns>
+static inline __m128i SelectSse2(__m128i mask, __m128i a, __m128i b)
+{
+    return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+/// <summary>
+/// Runs the temporal filter over a row eight pixels at a time
+/// </summary>
+/// <param name="pSrcRow">pointer to new depth row</param>
+/// <param name="pStateRow">pointer to filtered depth row, updated in place</param>
+/// <param name="pAgeRow">pointer to age row, updated in place</param>
+/// <param name="cols">number of pixels in the row</param>
+/// <param name="keepWeight">weight of the previous depth, in 65536ths</param>
+/// <param name="takeWeight">weight of the new depth, in 65536ths</param>
+/// <param name="jumpThreshold">largest change that is smoothed</param>
+/// <param name="maxAge">number of frames a pixel is held</param>
+/// <returns>first column that was not filtered</returns>
+static int FilterTemporalRowSse2(const USHORT* pSrcRow, USHORT* pStateRow, BYTE* pAgeRow, int cols,
+    int keepWeight, int takeWeight, int jumpThreshold, int maxAge)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i one = _mm_set1_epi16(1);
+    const __m128i keep = _mm_set1_epi16(static_cast<short>(keepWeight));
+    const __m128i take = _mm_set1_epi16(static_cast<short>(takeWeight));
+    const __m128i jump = _mm_set1_epi16(static_cast<short>(jumpThreshold));
+    const __m128i oldest = _mm_set1_epi16(static_cast<short>(maxAge));
+
+    int x = 0;
+    for (; x + 8 <= cols; x += 8)
+    {
+        __m128i depth = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSrcRow + x));
+        __m128i previous = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pStateRow + x));
+        __m128i age = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(pAgeRow + x)), zero);
+
+        __m128i isDepthUnknown = _mm_cmpeq_epi16(depth, zero);
+        __m128i isPreviousUnknown = _mm_cmpeq_epi16(previous, zero);
+
+        // Smooth where both are known and |depth - previous| <= jump
+        __m128i difference = _mm_or_si128(_mm_subs_epu16(depth, previous), _mm_subs_epu16(previous, depth));
+        __m128i isClose = _mm_cmpeq_epi16(_mm_subs_epu16(difference, jump), zero);
+        __m128i isSmoothed = _mm_andnot_si128(_mm_or_si128(isDepthUnknown, isPreviousUnknown), isClose);
+        __m128i smoothed = _mm_add_epi16(_mm_mulhi_epu16(previous, keep), _mm_mulhi_epu16(depth, take));
+        __m128i measured = SelectSse2(isSmoothed, smoothed, depth);
+
+        // Hold where the reading dropped out, the previous depth is known and it has not been held too long
+        __m128i isHeld = _mm_andnot_si128(isPreviousUnknown, _mm_and_si128(isDepthUnknown, _mm_cmpgt_epi16(oldest, age)));
+
+        __m128i state = SelectSse2(isDepthUnknown, _mm_and_si128(isHeld, previous), measured);
+        __m128i newAge = _mm_and_si128(isDepthUnknown, SelectSse2(isHeld, _mm_add_epi16(age, one), oldest));
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(pStateRow + x), state);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(pAgeRow + x), _mm_packus_epi16(newAge, newAge));
+    }
+
+    return x;
+}
+#endif
+
+/// <summary>
+/// Smooths known depth over time and holds the last known depth where a reading drops out.
+/// pState holds the filtered depth of the previous frame and is updated in place, so it is both
+/// the history and the result; pAge counts the frames each held pixel has gone unmeasured.
+/// Both are reset to 0 when their size differs from the source. Where SSE2 is available, pixels are
+/// processed eight at a time without branches.
+/// </summary>
+/// <param name="pSrc">pointer to 16-bit depth Mat of the new frame</param>
+/// <param name="pState">pointer to 16-bit depth Mat holding the filtered depth</param>
+/// <param name="pAge">pointer to 8-bit Mat holding the age of each held pixel</param>
+/// <param name="weight">weight of the new frame in 256ths, 1 to 255</param>
+/// <param name="jumpThreshold">largest change in millimeters that is smoothed; larger changes are taken as they are</param>
+/// <param name="maxAge">number of frames a pixel is held after its reading drops out, 0 to 254</param>
+/// <returns>S_OK if successful, an error code otherwise</returns>
+HRESULT TemporalDepthFilter(const Mat* pSrc, Mat* pState, Mat* pAge, int weight, int jumpThreshold, int maxAge)
+{
+    HRESULT hr = VerifyDepthArguments(pSrc, pState);
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+
+    // Fail if age pointer is invalid
+    if (!pAge)
+    {
+        return E_POINTER;
+    }
+
+    // Fail if a setting does not fit the 16-bit vector arithmetic
+    if (weight < 1 || weight > 255 || jumpThreshold < 0 || jumpThreshold > SHRT_MAX || maxAge < 0 || maxAge > 254)
+    {
+        return E_INVALIDARG;
+    }
+
+    // Start over when the resolution changes
+    if (pState->size() != pSrc->size() || pState->type() != CV_16UC1 || pAge->size() != pSrc->size() || pAge->type() != CV_8UC1)
+    {
+        pState->create(pSrc->size(), CV_16UC1);
+        pState->setTo(Scalar(0));
+        pAge->create(pSrc->size(), CV_8UC1);
+        pAge->setTo(Scalar(0));
+    }
+
+    int keepWeight = (256 - weight) << 8;
+    int takeWeight = weight << 8;
+
+    for (int y = 0; y < pSrc->rows; ++y)
+    {
+        const USHORT* pSrcRow = pSrc->ptr<USHORT>(y);
+        USHORT* pStateRow = pState->ptr<USHORT>(y);
+        BYTE* pAgeRow = pAge->ptr<BYTE>(y);
+
+        int x = 0;
+#ifdef DEPTH_FILTERS_USE_SSE2
+        x = FilterTemporalRowSse2(pSrcRow, pStateRow, pAgeRow, pSrc->cols, keepWeight, takeWeight, jumpThreshold, maxAge);
+#endif
+
+        for (; x < pSrc->cols; ++x)
+        {
+            FilterTemporalPixel(pSrcRow[x], &pStateRow[x], &pAgeRow[x], keepWeight, takeWeight, jumpThreshold, maxAge);
+        }
+    }
+
+    return S_OK;
+}
+
+// Distance to the nearest known pixel of a row where there is none. Distances saturate at it, so the length
+// of a gap is exact whenever it can be filled.
+static const int NO_KNOWN_DISTANCE = SHRT_MAX;
+
+/// <summary>
+/// Finds the nearest known pixel at or after each pixel of part of a row, going from its end to its start
+/// </summary>
+/// <param name="pRow">pointer to depth row</param>
+/// <param name="begin">first column to visit</param>
+/// <param name="end">column after the last one to visit</param>
+/// <param name="pNextDepth">pointer to row in which to return the depth of each pixel's next known pixel</param>
+/// <param name="pNextDistance">pointer to row in which to return the distance to each pixel's next known pixel</param>
+/// <param name="pDepth">pointer to depth of the next known pixel after end, updated to the one at or after begin</param>
+/// <param name="pDistance">pointer to distance from end - 1 to that pixel, updated to the distance from begin</param>
+static void FindNextKnownPixels(const USHORT* pRow, int begin, int end, USHORT* pNextDepth, USHORT* pNextDistance, USHORT* pDepth, int* pDistance)
+{
+    USHORT depth = *pDepth;
+    int distance = *pDistance;
+    for (int x = end - 1; x >= begin; --x)
+    {
+        bool isKnown = (pRow[x] != 0);
+        depth = isKnown ? pRow[x] : depth;
+        distance = isKnown ? 0 : min(distance + 1, NO_KNOWN_DISTANCE);
+        pNextDepth[x] = depth;
+        pNextDistance[x] = static_cast<USHORT>(distance);
+    }
+
+    *pDepth = depth;
+    *pDistance = distance;
+}
+
+/// <summary>
+/// Fills the unknown pixels of part of a row whose gap is short enough, going from its start to its end
+/// </summary>
+/// <param name="pRow">pointer to depth row to fill in place</param>
+/// <param name="begin">first column to fill</param>
+/// <param name="end">column after the last one to fill</param>
+/// <param name="pNextDepth">pointer to depth of each pixel's next known pixel</param>
+/// <param name="pNextDistance">pointer to distance to each pixel's next known pixel</param>
+/// <param name="maxGap">longest run in pixels that is filled</param>
+/// <param name="pDepth">pointer to depth of the last known pixel before begin, updated to the one before end</param>
+/// <param name="pDistance">pointer to distance from begin - 1 to that pixel, updated to the distance from end - 1</param>
+static void FillGapPixels(USHORT* pRow, int begin, int end, const USHORT* pNextDepth, const USHORT* pNextDistance, int maxGap,
+    USHORT* pDepth, int* pDistance)
+{
+    USHORT depth = *pDepth;
+    int distance = *pDistance;
+    for (int x = begin; x < end; ++x)
+    {
+        USHORT raw = pRow[x];
+        bool isKnown = (raw != 0);
+        depth = isKnown ? raw : depth;
+        distance = isKnown ? 0 : min(distance + 1, NO_KNOWN_DISTANCE);
+
+        // The gap runs from the last known pixel to the next one, exclusive
+        bool isFilled = !isKnown && distance + pNextDistance[x] <= maxGap + 1;
+        pRow[x] = isFilled ? max(depth, pNextDepth[x]) : raw;
+    }
+
+    *pDepth = depth;
+    *pDistance = distance;
+}
+
+#ifdef DEPTH_FILTERS_USE_SSE2
+/// <summary>
+/// Takes the depth and distance of a candidate known pixel in the lanes where it is nearer
+/// </summary>
+/// <param name="candidateDepth">depth of the candidate in each lane</param>
+/// <param name="candidateDistance">distance to the candidate in each lane</param>
+/// <param name="pDepth">pointer to depth of the nearest known pixel so far, updated in place</param>
+/// <param name="pDistance">pointer to distance to the nearest known pixel so far, updated in place</param>
+static inline void TakeNearerSse2(__m128i candidateDepth, __m128i candidateDistance, __m128i* pDepth, __m128i* pDistance)
+{
+    __m128i isNearer = _mm_cmpgt_epi16(*pDistance, candidateDistance);
+    *pDepth = SelectSse2(isNearer, candidateDepth, *pDepth);
+    *pDistance = SelectSse2(isNearer, candidateDistance, *pDistance);
+}
+
+/// <summary>
+/// Finds the nearest known pixel at or after each pixel of the start of a row, eight pixels at a time
+/// </summary>
+/// <param name="pRow">pointer to depth row</param>
+/// <param name="end">column after the last one to visit, a multiple of 8</param>
+/// <param name="pNextDepth">pointer to row in which to return the depth of each pixel's next known pixel</param>
+/// <param name="pNextDistance">pointer to row in which to return the distance to each pixel's next known pixel</param>
+/// <param name="pDepth">pointer to depth of the next known pixel after end, updated to the one at or after 0</param>
+/// <param name="pDistance">pointer to distance from end - 1 to that pixel, updated to the distance from 0</param>
+static void FindNextKnownPixelsSse2(const USHORT* pRow, int end, USHORT* pNextDepth, USHORT* pNextDistance, USHORT* pDepth, int* pDistance)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i none = _mm_set1_epi16(NO_KNOWN_DISTANCE);
+    const __m128i laneDistance = _mm_setr_epi16(8, 7, 6, 5, 4, 3, 2, 1);
+    __m128i carryDepth = _mm_set1_epi16(static_cast<short>(*pDepth));
+    __m128i carryDistance = _mm_set1_epi16(static_cast<short>(*pDistance));
+
+    for (int x = end - 8; x >= 0; x -= 8)
+    {
+        __m128i raw = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pRow + x));
+        __m128i isUnknown = _mm_cmpeq_epi16(raw, zero);
+
+        // Look 1, 2 and 4 pixels ahead within the block, then past it for lanes with no known pixel in it
+        __m128i depth = raw;
+        __m128i distance = _mm_and_si128(isUnknown, none);
+        TakeNearerSse2(_mm_srli_si128(depth, 2), _mm_adds_epi16(_mm_or_si128(_mm_srli_si128(distance, 2), _mm_slli_si128(none, 14)), _mm_set1_epi16(1)), &depth, &distance);
+        TakeNearerSse2(_mm_srli_si128(depth, 4), _mm_adds_epi16(_mm_or_si128(_mm_srli_si128(distance, 4), _mm_slli_si128(none, 12)), _mm_set1_epi16(2)), &depth, &distance);
+        TakeNearerSse2(_mm_srli_si128(depth, 8), _mm_adds_epi16(_mm_or_si128(_mm_srli_si128(distance, 8), _mm_slli_si128(none, 8)), _mm_set1_epi16(4)), &depth, &distance);
+        TakeNearerSse2(carryDepth, _mm_adds_epi16(carryDistance, laneDistance), &depth, &distance);
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(pNextDepth + x), depth);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(pNextDistance + x), distance);
+
+        carryDepth = _mm_shuffle_epi32(_mm_shufflelo_epi16(depth, 0), 0);
+        carryDistance = _mm_shuffle_epi32(_mm_shufflelo_epi16(distance, 0), 0);
+    }
+
+    *pDepth = static_cast<USHORT>(_mm_cvtsi128_si32(carryDepth));
+    *pDistance = _mm_cvtsi128_si32(carryDistance) & 0xFFFF;
+}
+
+/// <summary>
+/// Fills the unknown pixels of the start of a row whose gap is short enough, eight pixels at a time
+/// </summary>
+/// <param name="pRow">pointer to depth row to fill in place</param>
+/// <param name="end">column after the last one to fill, a multiple of 8</param>
+/// <param name="pNextDepth">pointer to depth of each pixel's next known pixel</param>
+/// <param name="pNextDistance">pointer to distance to each pixel's next known pixel</param>
+/// <param name="maxGap">longest run in pixels that is filled</param>
+/// <param name="pDepth">pointer to depth of the last known pixel before 0, updated to the one before end</param>
+/// <param name="pDistance">pointer to distance from -1 to that pixel, updated to the distance from end - 1</param>
+static void FillGapPixelsSse2(USHORT* pRow, int end, const USHORT* pNextDepth, const USHORT* pNextDistance, int maxGap,
+    USHORT* pDepth, int* pDistance)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i none = _mm_set1_epi16(NO_KNOWN_DISTANCE);
+    const __m128i laneDistance = _mm_setr_epi16(1, 2, 3, 4, 5, 6, 7, 8);
+    const __m128i longestSum = _mm_set1_epi16(static_cast<short>(maxGap + 2));
+    __m128i carryDepth = _mm_set1_epi16(static_cast<short>(*pDepth));
+    __m128i carryDistance = _mm_set1_epi16(static_cast<short>(*pDistance));
+
+    for (int x = 0; x < end; x += 8)
+    {
+        __m128i raw = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pRow + x));
+        __m128i isUnknown = _mm_cmpeq_epi16(raw, zero);
+
+        // Look 1, 2 and 4 pixels back within the block, then before it for lanes with no known pixel in it
+        __m128i depth = raw;
+        __m128i distance = _mm_and_si128(isUnknown, none);
+        TakeNearerSse2(_mm_slli_si128(depth, 2), _mm_adds_epi16(_mm_or_si128(_mm_slli_si128(distance, 2), _mm_srli_si128(none, 14)), _mm_set1_epi16(1)), &depth, &distance);
+        TakeNearerSse2(_mm_slli_si128(depth, 4), _mm_adds_epi16(_mm_or_si128(_mm_slli_si128(distance, 4), _mm_srli_si128(none, 12)), _mm_set1_epi16(2)), &depth, &distance);
+        TakeNearerSse2(_mm_slli_si128(depth, 8), _mm_adds_epi16(_mm_or_si128(_mm_slli_si128(distance, 8), _mm_srli_si128(none, 8)), _mm_set1_epi16(4)), &depth, &distance);
+        TakeNearerSse2(carryDepth, _mm_adds_epi16(carryDistance, laneDistance), &depth, &distance);
+
+        // Fill where distance + next distance <= maxGap + 1, with the larger depth, max(a, b) = (a -sat b) + b
+        __m128i nextDepth = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pNextDepth + x));
+        __m128i nextDistance = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pNextDistance + x));
+        __m128i isFilled = _mm_and_si128(isUnknown, _mm_cmpgt_epi16(longestSum, _mm_adds_epi16(distance, nextDistance)));
+        __m128i fill = _mm_add_epi16(_mm_subs_epu16(depth, nextDepth), nextDepth);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(pRow + x), SelectSse2(isFilled, fill, raw));
+
+        carryDepth = _mm_shuffle_epi32(_mm_shufflehi_epi16(depth, 0xFF), 0xFF);
+        carryDistance = _mm_shuffle_epi32(_mm_shufflehi_epi16(distance, 0xFF), 0xFF);
+    }
+
+    *pDepth = static_cast<USHORT>(_mm_cvtsi128_si32(carryDepth));
+    *pDistance = _mm_cvtsi128_si32(carryDistance) & 0xFFFF;
+}
+#endif
+
+/// <summary>
+/// Fills horizontal runs of unknown depth that have known depth on both sides with the farther of
+/// the two, so holes along the edge of a near object take the background depth rather than growing the object.
+/// Each row is visited twice, once from its end to find the next known pixel of every pixel and once from its
+/// start to fill; where SSE2 is available, both are done eight pixels at a time without branches.
+/// </summary>
+/// <param name="pDepth">pointer to 16-bit depth Mat to fill in place</param>
+/// <param name="maxGap">longest run in pixels that is filled, 0 to 32765</param>
+/// <returns>S_OK if successful, an error code otherwise</returns>
+HRESULT FillDepthGaps(Mat* pDepth, int maxGap)
+{
+    // Fail if pointer is invalid
+    if (!pDepth)
+    {
+        return E_POINTER;
+    }
+
+    // Fail if Mat contains no data, is not a depth plane, or the gap does not fit the 16-bit vector arithmetic
+    if (pDepth->empty() || pDepth->type() != CV_16UC1 || maxGap < 0 || maxGap > NO_KNOWN_DISTANCE - 2)
+    {
+        return E_INVALIDARG;
+    }
+
+    int cols = pDepth->cols;
+    std::vector<USHORT> nextKnown(2 * cols);
+    USHORT* pNextDepth = &nextKnown[0];
+    USHORT* pNextDistance = pNextDepth + cols;
+
+    // Columns visited eight at a time; the rest are visited one at a time
+    int vectorEnd = 0;
+#ifdef DEPTH_FILTERS_USE_SSE2
+    vectorEnd = cols - cols % 8;
+#endif
+
+    for (int y = 0; y < pDepth->rows; ++y)
+    {
+        USHORT* pRow = pDepth->ptr<USHORT>(y);
+
+        // Runs touching the border of the image have only one side and are left alone
+        USHORT depth = 0;
+        int distance = NO_KNOWN_DISTANCE;
+        FindNextKnownPixels(pRow, vectorEnd, cols, pNextDepth, pNextDistance, &depth, &distance);
+#ifdef DEPTH_FILTERS_USE_SSE2
+        FindNextKnownPixelsSse2(pRow, vectorEnd, pNextDepth, pNextDistance, &depth, &distance);
+#endif
+
+        depth = 0;
+        distance = NO_KNOWN_DISTANCE;
+#ifdef DEPTH_FILTERS_USE_SSE2
+        FillGapPixelsSse2(pRow, vectorEnd, pNextDepth, pNextDistance, maxGap, &depth, &distance);
+#endif
+        FillGapPixels(pRow, vectorEnd, cols, pNextDepth, pNextDistance, maxGap, &depth, &distance);
+    }
+
+    return S_OK;
+}
@@ -0,0 +1,79 @@
+//-----------------------------------------------------------------------------
+// <copyright file="DepthFilters.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation. All rights reserved.
+// </copyright>
+//-----------------------------------------------------------------------------
+
+#pragma once
+
+#include "Platform.h"
+
+// Suppress warnings that come from compiling OpenCV code since we have no control over it
+#pragma warning(push)
+#pragma warning(disable : 6294 6031)
+#include <opencv2/core/core.hpp>
+#pragma warning(pop)
+
+using namespace cv;
+
+// Filters for 16-bit depth planes in millimeters, where 0 marks unknown depth.
+// Source and destination must be different Mats of the same size; the destination
+// is only reallocated if its size or type differs from the source.
+
+/// <summary>
+/// Replaces every pixel with the median of its neighborhood
+/// </summary>
+/// <param name="pSrc">pointer to 16-bit depth Mat to filter</param>
+/// <param name="pDst">pointer to 16-bit depth Mat in which to return the result</param>
+/// <param name="kernelSize">neighborhood width, 3 or 5</param>
+/// <returns>S_OK if successful, an error code otherwise</returns>
+HRESULT MedianDepthFilter(const Mat* pSrc, Mat* pDst, int kernelSize);
+
+/// <summary>
+/// Smooths depth without blurring across edges: each known pixel becomes the mean of the known
+/// neighbors whose depth is within rangeThreshold of its own. Unknown pixels stay unknown.
+/// Rows are split across threads and the interior of each row is processed eight pixels at a time.
+/// </summary>
+/// <param name="pSrc">pointer to 16-bit depth Mat to filter</param>
+/// <param name="pDst">pointer to 16-bit depth Mat in which to return the result</param>
+/// <param name="radius">neighborhood radius in pixels, 1 to 3</param>
+/// <param name="rangeThreshold">largest depth difference in millimeters for a neighbor to be averaged</param>
+/// <returns>S_OK if successful, an error code otherwise</returns>
+HRESULT EdgePreservingDepthFilter(const Mat* pSrc, Mat* pDst, int radius, int rangeThreshold);
+
+/// <summary>
+/// Applies a morphological operation with a square kernel. Because unknown pixels are 0,
+/// closing fills small holes and opening removes small isolated readings.
+/// </summary>
+/// <param name="pSrc">pointer to 16-bit depth Mat to filter</param>
+/// <param name="pDst">pointer to 16-bit depth Mat in which to return the result</param>
+/// <param name="operation">MORPH_OPEN, MORPH_CLOSE, MORPH_ERODE or MORPH_DILATE</param>
+/// <param name="kernel">structuring element</param>
+/// <returns>S_OK if successful, an error code otherwise</returns>
+HRESULT MorphologyDepthFilter(const Mat* pSrc, Mat* pDst, int operation, const Mat& kernel);
+
+/// <summary>
+/// Smooths known depth over time and holds the last known depth where a reading drops out.
+/// pState holds the filtered depth of the previous frame and is updated in place, so it is both
+/// the history and the result; pAge counts the frames each held pixel has gone unmeasured.
+/// Both are reset to 0 when their size differs from the source. Where SSE2 is available, pixels are
+/// processed eight at a time without branches.
+/// </summary>
+/// <param name="pSrc">pointer to 16-bit depth Mat of the new frame</param>
+/// <param name="pState">pointer to 16-bit depth Mat holding the filtered depth</param>
+/// <param name="pAge">pointer to 8-bit Mat holding the age of each held pixel</param>
+/// <param name="weight">weight of the new frame in 256ths, 1 to 255</param>
+/// <param name="jumpThreshold">largest change in millimeters that is smoothed; larger changes are taken as they are</param>
+/// <param name="maxAge">number of frames a pixel is held after its reading drops out, 0 to 254</param>
+/// <returns>S_OK if successful, an error code otherwise</returns>
+HRESULT TemporalDepthFilter(const Mat* pSrc, Mat* pState, Mat* pAge, int weight, int jumpThreshold, int maxAge);
+
+/// <summary>
+/// Fills horizontal runs of unknown depth that have known depth on both sides with the farther of
+/// the two, so holes along the edge of a near object take the background depth rather than growing the object.
+/// Where SSE2 is available, pixels are processed eight at a time without branches.
+/// </summary>
+/// <param name="pDepth">pointer to 16-bit depth Mat to fill in place</param>
+/// <param name="maxGap">longest run in pixels that is filled, 0 to 32765</param>
+/// <returns>S_OK if successful, an error code otherwise</returns>
+HRESULT FillDepthGaps(Mat* pDepth, int maxGap);
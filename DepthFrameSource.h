@@ -0,0 +1,37 @@
+//-----------------------------------------------------------------------------
+// <copyright file="DepthFrameSource.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation. All rights reserved.
+// </copyright>
+//-----------------------------------------------------------------------------
+
+#pragma once
+
+#include "Platform.h"
+
+// Suppress warnings that come from compiling OpenCV code since we have no control over it
+#pragma warning(push)
+#pragma warning(disable : 6294 6031)
+#include <opencv2/core/core.hpp>
+#pragma warning(pop)
+
+using namespace cv;
+
+/// <summary>
+/// Supplies raw depth frames to the detection engine, from a sensor or a recording
+/// </summary>
+class DepthFrameSource
+{
+public:
+    /// <summary>
+    /// Destructor
+    /// </summary>
+    virtual ~DepthFrameSource() {}
+
+    /// <summary>
+    /// Gets the next raw depth frame, waiting for it if necessary
+    /// </summary>
+    /// <param name="pRawDepth">pointer in which to return the 16-bit depth Mat, with the player index in the low bits</param>
+    /// <param name="pTimestamp">pointer in which to return the capture time of the frame in milliseconds</param>
+    /// <returns>S_OK if a frame was returned, S_FALSE if there are no more frames, an error code otherwise</returns>
+    virtual HRESULT GetFrame(Mat* pRawDepth, DWORD* pTimestamp) = 0;
+};
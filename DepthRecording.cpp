@@ -0,0 +1,306 @@
+//-----------------------------------------------------------------------------
+// <copyright file="DepthRecording.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation. All rights reserved.
+// </copyright>
+//-----------------------------------------------------------------------------
+
+#include "DepthRecording.h"
+#include <string.h>
+
+using namespace cv;
+
+// Identifies a depth recording file and the layout of its contents. Version 1 files hold raw
+// frames; they are still read, but new recordings are compressed.
+static const char RECORDING_MAGIC[4] = {'K', 'D', 'E', 'P'};
+static const int RECORDING_VERSION_RAW = 1;
+static const int RECORDING_VERSION = 2;
+
+// Time assumed between the last frame of a looping recording and its first frame, in milliseconds
+static const DWORD LOOP_FRAME_INTERVAL = 33;
+
+/// <summary>
+/// Header written at the start of a recording file. Each frame follows as a 32-bit
+/// timestamp in milliseconds, the 32-bit length of the frame and the frame as encoded
+/// by DepthEncoder. In version 1 files, the timestamp is followed by width * height raw
+/// 16-bit depth values instead.
+/// </summary>
+struct DepthRecordingHeader
+{
+    char magic[4];
+    int version;
+    int width;
+    int height;
+};
+
+/// <summary>
+/// Constructor
+/// </summary>
+DepthRecordingWriter::DepthRecordingWriter()
+{
+}
+
+/// <summary>
+/// Creates the recording file for frames of the given size, replacing any existing file
+/// </summary>
+/// <param name="path">path of the file to create</param>
+/// <param name="size">size of the depth frames that will be written</param>
+/// <returns>S_OK if successful, an error code otherwise</returns>
+HRESULT DepthRecordingWriter::Open(const std::string& path, Size size)
+{
+    // Fail if there would be nothing to record
+    if (size.area() == 0)
+    {
+        return E_INVALIDARG;
+    }
+
+    Close();
+
+    m_file.open(path.c_str(), std::ios::binary | std::ios::trunc);
+    if (!m_file.is_open())
+    {
+        return E_FAIL;
+    }
+
+    DepthRecordingHeader header;
+    memcpy(header.magic, RECORDING_MAGIC, sizeof(RECORDING_MAGIC));
+    header.version = RECORDING_VERSION;
+    header.width = size.width;
+    header.height = size.height;
+    m_file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    m_size = size;
+
+    if (!m_file)
+    {
+        Close();
+        return E_FAIL;
+    }
+
+    return S_OK;
+}
+
+/// <summary>
+/// Appends a raw depth frame to the recording
+/// </summary>
+/// <param name="pRawDepth">pointer to raw 16-bit depth Mat of the size given to Open</param>
+/// <param name="timestamp">capture time of the frame in milliseconds</param>
+/// <returns>S_OK if successful, an error code otherwise</returns>
+HRESULT DepthRecordingWriter::WriteFrame(const Mat* pRawDepth, DWORD timestamp)
+{
+    // Fail if pointer is invalid
+    if (!pRawDepth)
+    {
+        return E_POINTER;
+    }
+
+    // Fail if no file is open
+    if (!m_file.is_open())
+    {
+        return E_NOT_VALID_STATE;
+    }
+
+    // Fail if Mat is not a raw depth frame of the recorded size
+    if (pRawDepth->type() != CV_16U || pRawDepth->size() != m_size)
+    {
+        return E_INVALIDARG;
+    }
+
+    const BYTE* pEncoded;
+    size_t encodedLength;
+    HRESULT hr = m_encoder.Encode(pRawDepth, &pEncoded, &encodedLength);
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+
+    DWORD length = static_cast<DWORD>(encodedLength);
+    m_file.write(reinterpret_cast<const char*>(&timestamp), sizeof(timestamp));
+    m_file.write(reinterpret_cast<const char*>(&length), sizeof(length));
+    m_file.write(reinterpret_cast<const char*>(pEncoded), encodedLength);
+
+    return m_file ? S_OK : E_FAIL;
+}
+
+/// <summary>
+/// Closes the recording file
+/// </summary>
+void DepthRecordingWriter::Close()
+{
+    if (m_file.is_open())
+    {
+        m_file.close();
+    }
+    m_file.clear();
+    m_size = Size();
+}
+
+/// <summary>
+/// Gets whether a recording file is open
+/// </summary>
+/// <returns>true if frames can be written</returns>
+bool DepthRecordingWriter::IsOpen() const
+{
+    return m_file.is_open();
+}
+
+/// <summary>
+/// Constructor
+/// </summary>
+DepthRecordingReader::DepthRecordingReader() :
+    m_firstFramePosition(0),
+    m_version(0),
+    m_isLooping(false),
+    m_firstTimestamp(0),
+    m_lastTimestamp(0),
+    m_timestampOffset(0),
+    m_hasFirstTimestamp(false)
+{
+}
+
+/// <summary>
+/// Opens a recording file
+/// </summary>
+/// <param name="path">path of the file to open</param>
+/// <param name="isLooping">whether to start over from the first frame once the last one was read</param>
+/// <returns>S_OK if successful, E_INVALIDARG if the file is not a depth recording, an error code otherwise</returns>
+HRESULT DepthRecordingReader::Open(const std::string& path, bool isLooping)
+{
+    if (m_file.is_open())
+    {
+        m_file.close();
+    }
+    m_file.clear();
+    m_frame.release();
+
+    m_file.open(path.c_str(), std::ios::binary);
+    if (!m_file.is_open())
+    {
+        return E_FAIL;
+    }
+
+    DepthRecordingHeader header;
+    m_file.read(reinterpret_cast<char*>(&header), sizeof(header));
+
+    // Fail if the file was written by something else or by another version
+    if (!m_file || memcmp(header.magic, RECORDING_MAGIC, sizeof(RECORDING_MAGIC)) != 0 ||
+        (header.version != RECORDING_VERSION && header.version != RECORDING_VERSION_RAW) || header.width <= 0 || header.height <= 0)
+    {
+        m_file.close();
+        return E_INVALIDARG;
+    }
+
+    m_frame.create(header.height, header.width, CV_16U);
+    m_version = header.version;
+    m_firstFramePosition = m_file.tellg();
+    m_isLooping = isLooping;
+    m_firstTimestamp = 0;
+    m_lastTimestamp = 0;
+    m_timestampOffset = 0;
+    m_hasFirstTimestamp = false;
+
+    return S_OK;
+}
+
+/// <summary>
+/// Gets the size of the recorded depth frames
+/// </summary>
+/// <returns>frame size, empty if no recording is open</returns>
+Size DepthRecordingReader::GetFrameSize() const
+{
+    return m_frame.size();
+}
+
+/// <summary>
+/// Reads the next raw depth frame. The returned Mat shares a buffer that the next call overwrites.
+/// </summary>
+/// <param name="pRawDepth">pointer in which to return the 16-bit depth Mat, with the player index in the low bits</param>
+/// <param name="pTimestamp">pointer in which to return the capture time of the frame in milliseconds</param>
+/// <returns>S_OK if a frame was returned, S_FALSE at the end of a recording that does not loop, an error code otherwise</returns>
+HRESULT DepthRecordingReader::GetFrame(Mat* pRawDepth, DWORD* pTimestamp)
+{
+    // Fail if either pointer is invalid
+    if (!pRawDepth || !pTimestamp)
+    {
+        return E_POINTER;
+    }
+
+    // Fail if no recording is open
+    if (!m_file.is_open())
+    {
+        return E_NOT_VALID_STATE;
+    }
+
+    DWORD timestamp;
+    if (!ReadFrame(&timestamp))
+    {
+        // A recording without a single whole frame would loop forever
+        if (!m_isLooping || !m_hasFirstTimestamp)
+        {
+            return S_FALSE;
+        }
+
+        m_file.clear();
+        m_file.seekg(m_firstFramePosition);
+        m_timestampOffset += m_lastTimestamp - m_firstTimestamp + LOOP_FRAME_INTERVAL;
+        if (!ReadFrame(&timestamp))
+        {
+            return E_FAIL;
+        }
+    }
+
+    if (!m_hasFirstTimestamp)
+    {
+        m_firstTimestamp = timestamp;
+        m_hasFirstTimestamp = true;
+    }
+    m_lastTimestamp = timestamp;
+
+    *pRawDepth = m_frame;
+    *pTimestamp = timestamp + m_timestampOffset;
+
+    return S_OK;
+}
+
+/// <summary>
+/// Reads one frame at the current file position into the frame buffer
+/// </summary>
+/// <param name="pTimestamp">pointer in which to return the recorded timestamp</param>
+/// <returns>true if a whole frame was read</returns>
+bool DepthRecordingReader::ReadFrame(DWORD* pTimestamp)
+{
+    m_file.read(reinterpret_cast<char*>(pTimestamp), sizeof(DWORD));
+
+    if (m_version == RECORDING_VERSION_RAW)
+    {
+        // m_frame was created by Open, so its rows are contiguous
+        m_file.read(reinterpret_cast<char*>(m_frame.data), m_frame.total() * sizeof(USHORT));
+        return !m_file.fail();
+    }
+
+    // A length no encoder writes for this frame size means the file is damaged
+    DWORD length = 0;
+    m_file.read(reinterpret_cast<char*>(&length), sizeof(length));
+    if (m_file.fail() || length == 0 || length > DepthEncoder::GetMaxEncodedLength(m_frame.size()))
+    {
+        return false;
+    }
+
+    if (m_encoded.size() < length)
+    {
+        m_encoded.resize(length);
+    }
+    m_file.read(reinterpret_cast<char*>(&m_encoded[0]), length);
+    if (m_file.fail())
+    {
+        return false;
+    }
+
+    // Every frame has the size in the file header, so the decoder never reallocates the frame
+    Size size = m_frame.size();
+    if (FAILED(m_decoder.Decode(&m_encoded[0], length, &m_frame)) || m_frame.size() != size)
+    {
+        m_frame.create(size, CV_16U);
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,135 @@
+//-----------------------------------------------------------------------------
+// <copyright file="DepthRecording.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation. All rights reserved.
+// </copyright>
+//-----------------------------------------------------------------------------
+
+#pragma once
+
+#include "Platform.h"
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Suppress warnings that come from compiling OpenCV code since we have no control over it
+#pragma warning(push)
+#pragma warning(disable : 6294 6031)
+#include <opencv2/core/core.hpp>
+#pragma warning(pop)
+
+#include "DepthFrameSource.h"
+#include "DepthCodec.h"
+
+using namespace cv;
+
+/// <summary>
+/// Writes raw depth frames to a recording file that DepthRecordingReader can replay.
+/// Frames are compressed losslessly with DepthEncoder.
+/// </summary>
+class DepthRecordingWriter
+{
+public:
+    // Functions:
+    /// <summary>
+    /// Constructor
+    /// </summary>
+    DepthRecordingWriter();
+
+    /// <summary>
+    /// Creates the recording file for frames of the given size, replacing any existing file
+    /// </summary>
+    /// <param name="path">path of the file to create</param>
+    /// <param name="size">size of the depth frames that will be written</param>
+    /// <returns>S_OK if successful, an error code otherwise</returns>
+    HRESULT Open(const std::string& path, Size size);
+
+    /// <summary>
+    /// Appends a raw depth frame to the recording
+    /// </summary>
+    /// <param name="pRawDepth">pointer to raw 16-bit depth Mat of the size given to Open</param>
+    /// <param name="timestamp">capture time of the frame in milliseconds</param>
+    /// <returns>S_OK if successful, an error code otherwise</returns>
+    HRESULT WriteFrame(const Mat* pRawDepth, DWORD timestamp);
+
+    /// <summary>
+    /// Closes the recording file
+    /// </summary>
+    void Close();
+
+    /// <summary>
+    /// Gets whether a recording file is open
+    /// </summary>
+    /// <returns>true if frames can be written</returns>
+    bool IsOpen() const;
+
+private:
+    // Variables:
+    std::ofstream m_file;
+    Size m_size;
+    DepthEncoder m_encoder;
+};
+
+/// <summary>
+/// Replays the raw depth frames of a recording file
+/// </summary>
+class DepthRecordingReader : public DepthFrameSource
+{
+public:
+    // Functions:
+    /// <summary>
+    /// Constructor
+    /// </summary>
+    DepthRecordingReader();
+
+    /// <summary>
+    /// Opens a recording file
+    /// </summary>
+    /// <param name="path">path of the file to open</param>
+    /// <param name="isLooping">whether to start over from the first frame once the last one was read</param>
+    /// <returns>S_OK if successful, E_INVALIDARG if the file is not a depth recording, an error code otherwise</returns>
+    HRESULT Open(const std::string& path, bool isLooping);
+
+    /// <summary>
+    /// Gets the size of the recorded depth frames
+    /// </summary>
+    /// <returns>frame size, empty if no recording is open</returns>
+    Size GetFrameSize() const;
+
+    /// <summary>
+    /// Reads the next raw depth frame. The returned Mat shares a buffer that the next call overwrites.
+    /// </summary>
+    /// <param name="pRawDepth">pointer in which to return the 16-bit depth Mat, with the player index in the low bits</param>
+    /// <param name="pTimestamp">pointer in which to return the capture time of the frame in milliseconds</param>
+    /// <returns>S_OK if a frame was returned, S_FALSE at the end of a recording that does not loop, an error code otherwise</returns>
+    virtual HRESULT GetFrame(Mat* pRawDepth, DWORD* pTimestamp);
+
+private:
+    // Functions:
+    /// <summary>
+    /// Reads one frame at the current file position into the frame buffer
+    /// </summary>
+    /// <param name="pTimestamp">pointer in which to return the recorded timestamp</param>
+    /// <returns>true if a whole frame was read</returns>
+    bool ReadFrame(DWORD* pTimestamp);
+
+    // Variables:
+    std::ifstream m_file;
+    std::streampos m_firstFramePosition;
+    bool m_isLooping;
+
+    // Layout of the frames, from the file header
+    int m_version;
+
+    // Buffer the frames are read into, allocated once when the file is opened, and
+    // the encoded frame they are decoded from
+    Mat m_frame;
+    std::vector<BYTE> m_encoded;
+    DepthDecoder m_decoder;
+
+    // Recorded timestamps of the first and latest frame, and what is added to them so that
+    // timestamps keep increasing when a looping recording starts over
+    DWORD m_firstTimestamp;
+    DWORD m_lastTimestamp;
+    DWORD m_timestampOffset;
+    bool m_hasFirstTimestamp;
+};
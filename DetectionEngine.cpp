@@ -0,0 +1,249 @@
+//-----------------------------------------------------------------------------
+// <copyright file="DetectionEngine.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation. All rights reserved.
+// </copyright>
+//-----------------------------------------------------------------------------
+
+#include "DetectionEngine.h"
+#include "Trace.h"
+
+using namespace cv;
+
+/// <summary>
+/// Constructor
+/// </summary>
+DetectionEngine::DetectionEngine() :
+    m_pPublisher(NULL),
+    m_frameTimestamp(0)
+{
+}
+
+/// <summary>
+/// Builds the detection pipeline from a config file, or from the defaults if it cannot be used
+/// </summary>
+/// <param name="configFileName">path of the pipeline config file</param>
+/// <returns>S_OK if built from the file, S_FALSE if built from the defaults, an error code otherwise</returns>
+HRESULT DetectionEngine::Initialize(const std::string& configFileName)
+{
+    PipelineConfig config;
+    HRESULT hr = config.Load(configFileName.c_str());
+    if (SUCCEEDED(hr))
+    {
+        hr = m_detectionPipeline.Build(&config);
+    }
+
+    // Fall back to the default stages rather than running without detection
+    bool isDefault = FAILED(hr);
+    if (isDefault)
+    {
+        PipelineConfig defaultConfig;
+        hr = m_detectionPipeline.Build(&defaultConfig);
+    }
+
+    m_detectionPipeline.SetDetectionCallback(&DetectionEngine::DetectionProc, this);
+    m_blobTracker.Reset();
+    m_sweepEventDetector.Reset();
+
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+
+    return isDefault ? S_FALSE : S_OK;
+}
+
+/// <summary>
+/// Sets where the results of every frame are published
+/// </summary>
+/// <param name="pPublisher">pointer to publisher, or NULL to only run detection</param>
+void DetectionEngine::SetPublisher(DetectionPublisher* pPublisher)
+{
+    m_pPublisher = pPublisher;
+}
+
+/// <summary>
+/// Starts writing every processed raw depth frame to a recording file that can be replayed later
+/// </summary>
+/// <param name="fileName">path of the recording file</param>
+/// <param name="size">size of the depth frames</param>
+/// <returns>S_OK if successful, an error code otherwise</returns>
+HRESULT DetectionEngine::StartRecording(const std::string& fileName, Size size)
+{
+    return m_recordingWriter.Open(fileName, size);
+}
+
+/// <summary>
+/// Stops writing depth frames to the recording file
+/// </summary>
+void DetectionEngine::StopRecording()
+{
+    m_recordingWriter.Close();
+}
+
+/// <summary>
+/// Runs detection on a raw depth frame and publishes the results
+/// </summary>
+/// <param name="pRawDepth">pointer to raw 16-bit depth Mat</param>
+/// <param name="timestamp">capture time of the frame in milliseconds</param>
+/// <returns>S_OK if successful, an error code otherwise</returns>
+HRESULT DetectionEngine::ProcessFrame(const Mat* pRawDepth, DWORD timestamp)
+{
+    TRACE_SCOPE("ProcessFrame");
+
+    // Fail if pointer is invalid
+    if (!pRawDepth)
+    {
+        return E_POINTER;
+    }
+
+    // A recording that cannot be written, for example because the resolution changed, is stopped
+    // rather than failing detection
+    if (m_recordingWriter.IsOpen() && FAILED(m_recordingWriter.WriteFrame(pRawDepth, timestamp)))
+    {
+        m_recordingWriter.Close();
+    }
+
+    // The publish stage calls back into HandleDetection
+    m_frameTimestamp = timestamp;
+    return m_detectionPipeline.Process(pRawDepth);
+}
+
+/// <summary>
+/// Processes the frames of a source until it runs out or the frame limit is reached
+/// </summary>
+/// <param name="pSource">pointer to source of raw depth frames</param>
+/// <param name="maxFrames">maximum number of frames to process, or 0 for no limit</param>
+/// <param name="pStats">pointer in which to return the frame counts and timing, or NULL</param>
+/// <returns>S_OK if the source ran out or the limit was reached, an error code otherwise</returns>
+HRESULT DetectionEngine::Run(DepthFrameSource* pSource, int maxFrames, DetectionRunStats* pStats)
+{
+    // Fail if pointer is invalid
+    if (!pSource)
+    {
+        return E_POINTER;
+    }
+
+    DetectionRunStats stats = {0, 0, 0.0, 0.0};
+    int64 processTicks = 0;
+    int64 runStart = getTickCount();
+
+    HRESULT hr = S_OK;
+    Mat rawDepth;
+    DWORD timestamp;
+    while (maxFrames <= 0 || stats.frameCount < maxFrames)
+    {
+        hr = pSource->GetFrame(&rawDepth, &timestamp);
+        if (hr != S_OK)
+        {
+            break;
+        }
+        ++stats.frameCount;
+
+        int64 start = getTickCount();
+        if (SUCCEEDED(ProcessFrame(&rawDepth, timestamp)))
+        {
+            ++stats.processedCount;
+        }
+        processTicks += getTickCount() - start;
+    }
+
+    stats.processSeconds = static_cast<double>(processTicks) / getTickFrequency();
+    stats.totalSeconds = static_cast<double>(getTickCount() - runStart) / getTickFrequency();
+    if (pStats)
+    {
+        *pStats = stats;
+    }
+
+    // Running out of frames is the normal end of a run
+    return SUCCEEDED(hr) ? S_OK : hr;
+}
+
+/// <summary>
+/// Gets ready for depth frames of another resolution, so that the first of them is not held up
+/// </summary>
+/// <param name="size">size of the depth frames to come</param>
+/// <returns>S_OK if successful, an error code otherwise</returns>
+HRESULT DetectionEngine::Prepare(Size size)
+{
+    // Blob positions of the old resolution mean nothing at the new one
+    m_blobTracker.Reset();
+
+    return m_detectionPipeline.Prepare(size);
+}
+
+/// <summary>
+/// Gets the detection pipeline, for its filtered depth and motion mask
+/// </summary>
+/// <returns>pointer to the pipeline</returns>
+const DetectionPipeline* DetectionEngine::GetPipeline() const
+{
+    return &m_detectionPipeline;
+}
+
+/// <summary>
+/// Gets the blob tracker, updated with the latest frame
+/// </summary>
+/// <returns>pointer to the blob tracker</returns>
+const BlobTracker* DetectionEngine::GetBlobTracker() const
+{
+    return &m_blobTracker;
+}
+
+/// <summary>
+/// Gets whether a sweep is in progress
+/// </summary>
+/// <returns>true between a start and a stop event</returns>
+bool DetectionEngine::IsSweeping() const
+{
+    return m_sweepEventDetector.IsSweeping();
+}
+
+/// <summary>
+/// Callback to handle the results of the detection pipeline, redirects to the class handler
+/// </summary>
+/// <param name="pFrame">pointer to the results of the frame</param>
+/// <param name="pUserData">instance pointer</param>
+void CALLBACK DetectionEngine::DetectionProc(const DetectionFrame* pFrame, void* pUserData)
+{
+    reinterpret_cast<DetectionEngine*>(pUserData)->HandleDetection(pFrame);
+}
+
+/// <summary>
+/// Handles the results of the detection pipeline: detects sweep events, tracks blobs and publishes them
+/// </summary>
+/// <param name="pFrame">pointer to the results of the frame</param>
+void DetectionEngine::HandleDetection(const DetectionFrame* pFrame)
+{
+    const MotionStats& motionStats = pFrame->stats;
+
+    // Events are timed with the capture time so that a replay detects the same sweeps as the live run
+    SweepEvent sweepEvent;
+    bool hasEvent = m_sweepEventDetector.Update(static_cast<float>(motionStats.count), m_frameTimestamp, &sweepEvent);
+
+    // Track the moving regions of the frame
+    bool hasBlobs = SUCCEEDED(m_blobTracker.Update(&pFrame->mask));
+
+    if (!m_pPublisher)
+    {
+        return;
+    }
+
+    // Publish only when sweeping starts, stops or changes intensity; 0 means sweeping stopped
+    if (hasEvent)
+    {
+        m_pPublisher->PublishSweepEvent(&sweepEvent);
+    }
+
+    // Give the robot a position to steer toward for as long as the sweep lasts
+    if (m_sweepEventDetector.IsSweeping() && motionStats.count > 0)
+    {
+        m_pPublisher->PublishSweepPosition(&motionStats);
+    }
+
+    if (hasBlobs)
+    {
+        m_pPublisher->PublishBlobs(m_blobTracker.GetBlobs(), m_blobTracker.GetBlobCount());
+    }
+
+    m_pPublisher->PublishPointCloud(&pFrame->cloud);
+}
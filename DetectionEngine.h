@@ -0,0 +1,147 @@
+//-----------------------------------------------------------------------------
+// <copyright file="DetectionEngine.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation. All rights reserved.
+// </copyright>
+//-----------------------------------------------------------------------------
+
+#pragma once
+
+#include "Platform.h"
+#include <string>
+
+// Suppress warnings that come from compiling OpenCV code since we have no control over it
+#pragma warning(push)
+#pragma warning(disable : 6294 6031)
+#include <opencv2/core/core.hpp>
+#pragma warning(pop)
+
+#include "BlobTracker.h"
+#include "DepthFrameSource.h"
+#include "DepthRecording.h"
+#include "DetectionPipeline.h"
+#include "DetectionPublisher.h"
+#include "SweepEventDetector.h"
+
+using namespace cv;
+
+/// <summary>
+/// Frame counts and timing of a DetectionEngine::Run
+/// </summary>
+struct DetectionRunStats
+{
+    // Frames taken from the source, and how many of those the pipeline processed successfully
+    int frameCount;
+    int processedCount;
+
+    // Time spent in ProcessFrame, and wall time of the whole run including reading the frames, in seconds
+    double processSeconds;
+    double totalSeconds;
+};
+
+/// <summary>
+/// Runs the detection pipeline on raw depth frames and hands the results to a publisher.
+/// Owns everything between the frame source and the publisher, so that it runs the same
+/// with or without a window, a Kinect or a ROS connection.
+/// </summary>
+class DetectionEngine
+{
+public:
+    // Functions:
+    /// <summary>
+    /// Constructor
+    /// </summary>
+    DetectionEngine();
+
+    /// <summary>
+    /// Builds the detection pipeline from a config file, or from the defaults if it cannot be used
+    /// </summary>
+    /// <param name="configFileName">path of the pipeline config file</param>
+    /// <returns>S_OK if built from the file, S_FALSE if built from the defaults, an error code otherwise</returns>
+    HRESULT Initialize(const std::string& configFileName);
+
+    /// <summary>
+    /// Sets where the results of every frame are published
+    /// </summary>
+    /// <param name="pPublisher">pointer to publisher, or NULL to only run detection</param>
+    void SetPublisher(DetectionPublisher* pPublisher);
+
+    /// <summary>
+    /// Starts writing every processed raw depth frame to a recording file that can be replayed later
+    /// </summary>
+    /// <param name="fileName">path of the recording file</param>
+    /// <param name="size">size of the depth frames</param>
+    /// <returns>S_OK if successful, an error code otherwise</returns>
+    HRESULT StartRecording(const std::string& fileName, Size size);
+
+    /// <summary>
+    /// Stops writing depth frames to the recording file
+    /// </summary>
+    void StopRecording();
+
+    /// <summary>
+    /// Runs detection on a raw depth frame and publishes the results
+    /// </summary>
+    /// <param name="pRawDepth">pointer to raw 16-bit depth Mat</param>
+    /// <param name="timestamp">capture time of the frame in milliseconds</param>
+    /// <returns>S_OK if successful, an error code otherwise</returns>
+    HRESULT ProcessFrame(const Mat* pRawDepth, DWORD timestamp);
+
+    /// <summary>
+    /// Gets ready for depth frames of another resolution, so that the first of them is not held up
+    /// </summary>
+    /// <param name="size">size of the depth frames to come</param>
+    /// <returns>S_OK if successful, an error code otherwise</returns>
+    HRESULT Prepare(Size size);
+
+    /// <summary>
+    /// Processes the frames of a source until it runs out or the frame limit is reached
+    /// </summary>
+    /// <param name="pSource">pointer to source of raw depth frames</param>
+    /// <param name="maxFrames">maximum number of frames to process, or 0 for no limit</param>
+    /// <param name="pStats">pointer in which to return the frame counts and timing, or NULL</param>
+    /// <returns>S_OK if the source ran out or the limit was reached, an error code otherwise</returns>
+    HRESULT Run(DepthFrameSource* pSource, int maxFrames, DetectionRunStats* pStats);
+
+    /// <summary>
+    /// Gets the detection pipeline, for its filtered depth and motion mask
+    /// </summary>
+    /// <returns>pointer to the pipeline</returns>
+    const DetectionPipeline* GetPipeline() const;
+
+    /// <summary>
+    /// Gets the blob tracker, updated with the latest frame
+    /// </summary>
+    /// <returns>pointer to the blob tracker</returns>
+    const BlobTracker* GetBlobTracker() const;
+
+    /// <summary>
+    /// Gets whether a sweep is in progress
+    /// </summary>
+    /// <returns>true between a start and a stop event</returns>
+    bool IsSweeping() const;
+
+private:
+    // Functions:
+    /// <summary>
+    /// Callback to handle the results of the detection pipeline, redirects to the class handler
+    /// </summary>
+    /// <param name="pFrame">pointer to the results of the frame</param>
+    /// <param name="pUserData">instance pointer</param>
+    static void CALLBACK DetectionProc(const DetectionFrame* pFrame, void* pUserData);
+
+    /// <summary>
+    /// Handles the results of the detection pipeline: detects sweep events, tracks blobs and publishes them
+    /// </summary>
+    /// <param name="pFrame">pointer to the results of the frame</param>
+    void HandleDetection(const DetectionFrame* pFrame);
+
+    // Variables:
+    DetectionPipeline m_detectionPipeline;
+    BlobTracker m_blobTracker;
+    SweepEventDetector m_sweepEventDetector;
+    DetectionPublisher* m_pPublisher;
+    DepthRecordingWriter m_recordingWriter;
+
+    // Capture time of the frame being processed
+    DWORD m_frameTimestamp;
+};
@@ -0,0 +1,271 @@
+//-----------------------------------------------------------------------------
+// <copyright file="DetectionPipeline.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation. All rights reserved.
+// </copyright>
+//-----------------------------------------------------------------------------
+
+#include "DetectionPipeline.h"
+#include "DetectionStages.h"
+#ifdef _WIN32
+#include <NuiApi.h>
+#endif
+
+using namespace cv;
+
+// Stages run when the config does not list any
+static const char* DEFAULT_STAGES = "convert, holefill, depthfilter, temporaldiff, threshold, morphology, statistics, pointcloud, publish";
+
+/// <summary>
+/// Constructor
+/// </summary>
+DetectionPipeline::DetectionPipeline()
+{
+    m_frame.pRawDepth = NULL;
+    m_frame.stats.count = 0;
+    m_frame.callback = NULL;
+    m_frame.pCallbackData = NULL;
+}
+
+/// <summary>
+/// Destructor
+/// </summary>
+DetectionPipeline::~DetectionPipeline()
+{
+    Clear();
+}
+
+/// <summary>
+/// Creates and configures the stages listed in the [Pipeline] Stages setting of the config
+/// </summary>
+/// <param name="pConfig">pointer to config to build from</param>
+/// <returns>S_OK if successful, E_INVALIDARG if a stage name is unknown, an error code otherwise</returns>
+HRESULT DetectionPipeline::Build(const PipelineConfig* pConfig)
+{
+    // Fail if pointer is invalid
+    if (!pConfig)
+    {
+        return E_POINTER;
+    }
+
+    Clear();
+
+    std::vector<std::string> names;
+    pConfig->GetList("Pipeline", "Stages", DEFAULT_STAGES, &names);
+
+    for (size_t i = 0; i < names.size(); ++i)
+    {
+        DetectionStage* pStage = CreateDetectionStage(names[i]);
+        if (!pStage)
+        {
+            Clear();
+            return E_INVALIDARG;
+        }
+        m_stages.push_back(pStage);
+
+        HRESULT hr = pStage->Configure(pConfig);
+        if (FAILED(hr))
+        {
+            Clear();
+            return hr;
+        }
+    }
+
+    return S_OK;
+}
+
+/// <summary>
+/// Sets the function the publish stage delivers results to
+/// </summary>
+/// <param name="callback">function to call, or NULL</param>
+/// <param name="pUserData">data passed to the function</param>
+void DetectionPipeline::SetDetectionCallback(DetectionCallback callback, void* pUserData)
+{
+    m_frame.callback = callback;
+    m_frame.pCallbackData = pUserData;
+}
+
+/// <summary>
+/// Runs the stages on a raw depth frame, planning the buffers first if the resolution changed
+/// </summary>
+/// <param name="pDepth">pointer to raw 16-bit depth Mat</param>
+/// <returns>S_OK if successful, an error code otherwise</returns>
+HRESULT DetectionPipeline::Process(const Mat* pDepth)
+{
+    // Fail if pointer is invalid
+    if (!pDepth)
+    {
+        return E_POINTER;
+    }
+
+    // Fail if Mat contains no data or is not a depth image
+    if (pDepth->empty() || pDepth->type() != CV_16UC1)
+    {
+        return E_INVALIDARG;
+    }
+
+    if (pDepth->size() != m_plannedSize)
+    {
+        HRESULT hr = Plan(pDepth->size());
+        if (FAILED(hr))
+        {
+            return hr;
+        }
+    }
+
+    m_frame.pRawDepth = pDepth;
+    m_frame.cloud.Clear();
+    for (size_t i = 0; i < m_stages.size(); ++i)
+    {
+        HRESULT hr = m_stages[i]->Process(&m_frame);
+        if (FAILED(hr))
+        {
+            return hr;
+        }
+    }
+
+    return S_OK;
+}
+
+/// <summary>
+/// Plans the buffers for a depth resolution ahead of the first frame at that resolution
+/// </summary>
+/// <param name="size">size of the depth frames to come</param>
+/// <returns>S_OK if successful, an error code otherwise</returns>
+HRESULT DetectionPipeline::Prepare(Size size)
+{
+    // Fail if size is empty
+    if (size.width <= 0 || size.height <= 0)
+    {
+        return E_INVALIDARG;
+    }
+
+    if (size == m_plannedSize)
+    {
+        return S_OK;
+    }
+
+    return Plan(size);
+}
+
+/// <summary>
+/// Gets the filtered depth plane of the latest frame
+/// </summary>
+/// <param name="pDepth">pointer in which to return the 16-bit depth in millimeters</param>
+/// <returns>S_OK if successful, an error code otherwise</returns>
+HRESULT DetectionPipeline::GetDepth(Mat* pDepth) const
+{
+    // Fail if pointer is invalid
+    if (!pDepth)
+    {
+        return E_POINTER;
+    }
+
+    // Fail if no frame has been processed yet
+    if (m_frame.depth.empty())
+    {
+        return E_NUI_FRAME_NO_DATA;
+    }
+
+    // Share the data rather than copying it; the depth is overwritten by the next frame
+    *pDepth = m_frame.depth;
+
+    return S_OK;
+}
+
+/// <summary>
+/// Gets the motion mask of the latest frame
+/// </summary>
+/// <param name="pMask">pointer in which to return the 8-bit mask, non-zero where motion was detected</param>
+/// <returns>S_OK if successful, an error code otherwise</returns>
+HRESULT DetectionPipeline::GetMotionMask(Mat* pMask) const
+{
+    // Fail if pointer is invalid
+    if (!pMask)
+    {
+        return E_POINTER;
+    }
+
+    // Fail if no frame has been processed yet
+    if (m_frame.mask.empty())
+    {
+        return E_NUI_FRAME_NO_DATA;
+    }
+
+    // Share the data rather than copying it; the mask is overwritten by the next frame
+    *pMask = m_frame.mask;
+
+    return S_OK;
+}
+
+/// <summary>
+/// Gets where motion was found in the latest frame
+/// </summary>
+/// <param name="pStats">pointer in which to return the motion statistics</param>
+/// <returns>S_OK if successful, an error code otherwise</returns>
+HRESULT DetectionPipeline::GetMotionStats(MotionStats* pStats) const
+{
+    // Fail if pointer is invalid
+    if (!pStats)
+    {
+        return E_POINTER;
+    }
+
+    // Fail if no frame has been processed yet
+    if (m_frame.mask.empty())
+    {
+        return E_NUI_FRAME_NO_DATA;
+    }
+
+    *pStats = m_frame.stats;
+
+    return S_OK;
+}
+
+/// <summary>
+/// Deletes all stages
+/// </summary>
+void DetectionPipeline::Clear()
+{
+    for (size_t i = 0; i < m_stages.size(); ++i)
+    {
+        delete m_stages[i];
+    }
+
+    m_stages.clear();
+    m_plannedSize = Size();
+}
+
+/// <summary>
+/// Allocates the shared buffers and the buffers of every stage for the given depth resolution
+/// </summary>
+/// <param name="size">size of the depth frames</param>
+/// <returns>S_OK if successful, an error code otherwise</returns>
+HRESULT DetectionPipeline::Plan(Size size)
+{
+    // Every stage can rely on the shared buffers existing, even if no earlier stage fills them. The table of
+    // the zeroed difference holds until a stage rewrites it, and keeps its buffer for every later frame.
+    m_frame.depth.create(size, CV_16UC1);
+    m_frame.depth.setTo(Scalar(0));
+    m_frame.difference.create(size, CV_16UC1);
+    m_frame.difference.setTo(Scalar(0));
+    m_frame.differenceIntegral.Compute(&m_frame.difference);
+    m_frame.mask.create(size, CV_8UC1);
+    m_frame.mask.setTo(Scalar(0));
+    m_frame.maskScratch.create(size, CV_8UC1);
+    m_frame.columnCounts.assign(size.width, 0);
+    m_frame.rowCounts.assign(size.height, 0);
+    m_frame.stats.count = 0;
+
+    for (size_t i = 0; i < m_stages.size(); ++i)
+    {
+        HRESULT hr = m_stages[i]->Plan(size, &m_frame);
+        if (FAILED(hr))
+        {
+            m_plannedSize = Size();
+            return hr;
+        }
+    }
+
+    m_plannedSize = size;
+    return S_OK;
+}
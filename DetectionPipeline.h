@@ -0,0 +1,192 @@
+//-----------------------------------------------------------------------------
+// <copyright file="DetectionPipeline.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation. All rights reserved.
+// </copyright>
+//-----------------------------------------------------------------------------
+
+#pragma once
+
+#include "Platform.h"
+#include <string>
+#include <vector>
+
+// Suppress warnings that come from compiling OpenCV code since we have no control over it
+#pragma warning(push)
+#pragma warning(disable : 6294 6031)
+#include <opencv2/core/core.hpp>
+#pragma warning(pop)
+
+#include "IntegralImage.h"
+#include "MotionStats.h"
+#include "PointCloud.h"
+#include "PipelineConfig.h"
+
+using namespace cv;
+
+struct DetectionFrame;
+
+/// <summary>
+/// Callback invoked by the publish stage with the results of a frame
+/// </summary>
+typedef void (CALLBACK* DetectionCallback)(const DetectionFrame* pFrame, void* pUserData);
+
+/// <summary>
+/// Buffers shared by the stages of the detection pipeline. They are allocated once when the
+/// pipeline is planned for a depth resolution and are overwritten in place every frame.
+/// </summary>
+struct DetectionFrame
+{
+    // Raw depth frame as given to the pipeline, with the player index in the low bits
+    const Mat* pRawDepth;
+
+    // Depth in millimeters, 0 where unknown
+    Mat depth;
+
+    // Magnitude of the temporal depth change in millimeters, 0 where it could not be measured
+    Mat difference;
+
+    // Summed-area table of the difference, for region sums and wide smoothing. A stage that rewrites the
+    // difference invalidates it; the first stage that needs it afterwards computes it and later stages share it.
+    IntegralImage differenceIntegral;
+
+    // 255 where motion was detected, 0 elsewhere
+    Mat mask;
+
+    // Mask sized scratch image for stages that cannot work in place
+    Mat maskScratch;
+
+    // Moving pixels per column and per row, and the statistics derived from them
+    std::vector<int> columnCounts;
+    std::vector<int> rowCounts;
+    MotionStats stats;
+
+    // Points of the depth plane in meters, empty unless the point cloud stage ran this frame
+    PointCloud cloud;
+
+    // Where the publish stage delivers the results
+    DetectionCallback callback;
+    void* pCallbackData;
+};
+
+/// <summary>
+/// One step of the detection pipeline
+/// </summary>
+class DetectionStage
+{
+public:
+    /// <summary>
+    /// Destructor
+    /// </summary>
+    virtual ~DetectionStage() {}
+
+    /// <summary>
+    /// Reads the stage settings from the given config
+    /// </summary>
+    /// <param name="pConfig">pointer to config to read</param>
+    /// <returns>S_OK if successful, an error code otherwise</returns>
+    virtual HRESULT Configure(const PipelineConfig* pConfig) = 0;
+
+    /// <summary>
+    /// Allocates the buffers the stage needs for the given depth resolution and forgets any history
+    /// </summary>
+    /// <param name="size">size of the depth frames</param>
+    /// <param name="pFrame">pointer to the shared frame buffers</param>
+    /// <returns>S_OK if successful, an error code otherwise</returns>
+    virtual HRESULT Plan(Size size, DetectionFrame* pFrame) = 0;
+
+    /// <summary>
+    /// Runs the stage on the current frame
+    /// </summary>
+    /// <param name="pFrame">pointer to the shared frame buffers</param>
+    /// <returns>S_OK if successful, an error code otherwise</returns>
+    virtual HRESULT Process(DetectionFrame* pFrame) = 0;
+};
+
+class DetectionPipeline
+{
+public:
+    // Functions:
+    /// <summary>
+    /// Constructor
+    /// </summary>
+    DetectionPipeline();
+
+    /// <summary>
+    /// Destructor
+    /// </summary>
+    ~DetectionPipeline();
+
+    /// <summary>
+    /// Creates and configures the stages listed in the [Pipeline] Stages setting of the config
+    /// </summary>
+    /// <param name="pConfig">pointer to config to build from</param>
+    /// <returns>S_OK if successful, E_INVALIDARG if a stage name is unknown, an error code otherwise</returns>
+    HRESULT Build(const PipelineConfig* pConfig);
+
+    /// <summary>
+    /// Sets the function the publish stage delivers results to
+    /// </summary>
+    /// <param name="callback">function to call, or NULL</param>
+    /// <param name="pUserData">data passed to the function</param>
+    void SetDetectionCallback(DetectionCallback callback, void* pUserData);
+
+    /// <summary>
+    /// Runs the stages on a raw depth frame, planning the buffers first if the resolution changed
+    /// </summary>
+    /// <param name="pDepth">pointer to raw 16-bit depth Mat</param>
+    /// <returns>S_OK if successful, an error code otherwise</returns>
+    HRESULT Process(const Mat* pDepth);
+
+    /// <summary>
+    /// Plans the buffers for a depth resolution ahead of the first frame at that resolution
+    /// </summary>
+    /// <param name="size">size of the depth frames to come</param>
+    /// <returns>S_OK if successful, an error code otherwise</returns>
+    HRESULT Prepare(Size size);
+
+    /// <summary>
+    /// Gets the filtered depth plane of the latest frame
+    /// </summary>
+    /// <param name="pDepth">pointer in which to return the 16-bit depth in millimeters</param>
+    /// <returns>S_OK if successful, an error code otherwise</returns>
+    HRESULT GetDepth(Mat* pDepth) const;
+
+    /// <summary>
+    /// Gets the motion mask of the latest frame
+    /// </summary>
+    /// <param name="pMask">pointer in which to return the 8-bit mask, non-zero where motion was detected</param>
+    /// <returns>S_OK if successful, an error code otherwise</returns>
+    HRESULT GetMotionMask(Mat* pMask) const;
+
+    /// <summary>
+    /// Gets where motion was found in the latest frame
+    /// </summary>
+    /// <param name="pStats">pointer in which to return the motion statistics</param>
+    /// <returns>S_OK if successful, an error code otherwise</returns>
+    HRESULT GetMotionStats(MotionStats* pStats) const;
+
+private:
+    // Functions:
+    // The stages are owned by the pipeline, so it cannot be copied
+    DetectionPipeline(const DetectionPipeline&);
+    DetectionPipeline& operator=(const DetectionPipeline&);
+
+    /// <summary>
+    /// Deletes all stages
+    /// </summary>
+    void Clear();
+
+    /// <summary>
+    /// Allocates the shared buffers and the buffers of every stage for the given depth resolution
+    /// </summary>
+    /// <param name="size">size of the depth frames</param>
+    /// <returns>S_OK if successful, an error code otherwise</returns>
+    HRESULT Plan(Size size);
+
+    // Variables:
+    std::vector<DetectionStage*> m_stages;
+    DetectionFrame m_frame;
+
+    // Resolution the buffers are planned for, empty until the first frame
+    Size m_plannedSize;
+};
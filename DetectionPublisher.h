@@ -0,0 +1,50 @@
+//-----------------------------------------------------------------------------
+// <copyright file="DetectionPublisher.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation. All rights reserved.
+// </copyright>
+//-----------------------------------------------------------------------------
+
+#pragma once
+
+#include "Platform.h"
+#include "BlobTracker.h"
+#include "MotionStats.h"
+#include "PointCloud.h"
+#include "SweepEventDetector.h"
+
+/// <summary>
+/// Receives the results of the detection engine, for example to send them to the robot
+/// </summary>
+class DetectionPublisher
+{
+public:
+    /// <summary>
+    /// Destructor
+    /// </summary>
+    virtual ~DetectionPublisher() {}
+
+    /// <summary>
+    /// Publishes a change in sweeping state
+    /// </summary>
+    /// <param name="pEvent">pointer to the detected event</param>
+    virtual void PublishSweepEvent(const SweepEvent* pEvent) = 0;
+
+    /// <summary>
+    /// Publishes where the moving pixels of the latest depth frame are, while a sweep is in progress
+    /// </summary>
+    /// <param name="pStats">pointer to motion statistics of the frame</param>
+    virtual void PublishSweepPosition(const MotionStats* pStats) = 0;
+
+    /// <summary>
+    /// Publishes the tracked blobs after they were updated with the latest depth frame
+    /// </summary>
+    /// <param name="pBlobs">pointer to the tracked blobs, including those missed in the latest frame</param>
+    /// <param name="count">number of tracked blobs</param>
+    virtual void PublishBlobs(const TrackedBlob* pBlobs, int count) = 0;
+
+    /// <summary>
+    /// Publishes the point cloud of the latest depth frame, if the point cloud stage produced any
+    /// </summary>
+    /// <param name="pCloud">pointer to point cloud of the frame</param>
+    virtual void PublishPointCloud(const PointCloud* pCloud) = 0;
+};
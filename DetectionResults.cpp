@@ -0,0 +1,125 @@
+//-----------------------------------------------------------------------------
+// <copyright file="DetectionResults.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation. All rights reserved.
+// </copyright>
+//-----------------------------------------------------------------------------
+
+#include "DetectionResults.h"
+
+/// <summary>
+/// Constructor
+/// </summary>
+DetectionResults::DetectionResults() :
+    m_hasSweepPosition(false),
+    m_hasBlobs(false),
+    m_hasPointCloud(false)
+{
+}
+
+/// <summary>
+/// Forgets the results of the previous frame
+/// </summary>
+void DetectionResults::Clear()
+{
+    m_sweepEvents.clear();
+    m_hasSweepPosition = false;
+    m_hasBlobs = false;
+    m_blobs.clear();
+    m_hasPointCloud = false;
+    m_pointCloud.Clear();
+}
+
+/// <summary>
+/// Hands the kept results to a publisher, in the order the engine published them
+/// </summary>
+/// <param name="pPublisher">pointer to publisher to hand the results to</param>
+void DetectionResults::PublishTo(DetectionPublisher* pPublisher) const
+{
+    if (!pPublisher)
+    {
+        return;
+    }
+
+    for (size_t i = 0; i < m_sweepEvents.size(); ++i)
+    {
+        pPublisher->PublishSweepEvent(&m_sweepEvents[i]);
+    }
+
+    if (m_hasSweepPosition)
+    {
+        pPublisher->PublishSweepPosition(&m_sweepPosition);
+    }
+
+    if (m_hasBlobs)
+    {
+        pPublisher->PublishBlobs(m_blobs.empty() ? NULL : &m_blobs[0], static_cast<int>(m_blobs.size()));
+    }
+
+    if (m_hasPointCloud)
+    {
+        pPublisher->PublishPointCloud(&m_pointCloud);
+    }
+}
+
+/// <summary>
+/// Keeps a change in sweeping state
+/// </summary>
+/// <param name="pEvent">pointer to the detected event</param>
+void DetectionResults::PublishSweepEvent(const SweepEvent* pEvent)
+{
+    m_sweepEvents.push_back(*pEvent);
+}
+
+/// <summary>
+/// Keeps where the moving pixels of the frame are
+/// </summary>
+/// <param name="pStats">pointer to motion statistics of the frame</param>
+void DetectionResults::PublishSweepPosition(const MotionStats* pStats)
+{
+    m_hasSweepPosition = true;
+    m_sweepPosition = *pStats;
+}
+
+/// <summary>
+/// Keeps the tracked blobs after they were updated with the frame
+/// </summary>
+/// <param name="pBlobs">pointer to the tracked blobs, including those missed in the frame</param>
+/// <param name="count">number of tracked blobs</param>
+void DetectionResults::PublishBlobs(const TrackedBlob* pBlobs, int count)
+{
+    m_hasBlobs = true;
+    m_blobs.assign(pBlobs, pBlobs + count);
+}
+
+/// <summary>
+/// Keeps the point cloud of the frame
+/// </summary>
+/// <param name="pCloud">pointer to point cloud of the frame</param>
+void DetectionResults::PublishPointCloud(const PointCloud* pCloud)
+{
+    m_hasPointCloud = true;
+
+    // Only the points are copied; the rays the cloud was generated with are not needed to publish it
+    int count = pCloud->GetCount();
+    const float* pX = pCloud->GetX();
+    const float* pY = pCloud->GetY();
+    const float* pZ = pCloud->GetZ();
+
+    m_pointCloud.Clear();
+    m_pointCloud.Reserve(count);
+    for (int i = 0; i < count; ++i)
+    {
+        m_pointCloud.AddPoint(pX[i], pY[i], pZ[i]);
+    }
+}
+
+/// <summary>
+/// Gets the tracked blobs that were kept
+/// </summary>
+/// <param name="pCount">pointer in which to return the number of blobs</param>
+/// <returns>pointer to the blobs, or NULL if none were published</returns>
+const TrackedBlob* DetectionResults::GetBlobs(int* pCount) const
+{
+    *pCount = static_cast<int>(m_blobs.size());
+    return m_blobs.empty() ? NULL : &m_blobs[0];
+}
@@ -0,0 +1,84 @@
+//-----------------------------------------------------------------------------
+// <copyright file="DetectionResults.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation. All rights reserved.
+// </copyright>
+//-----------------------------------------------------------------------------
+
+#pragma once
+
+#include "Platform.h"
+#include <vector>
+
+#include "DetectionPublisher.h"
+
+/// <summary>
+/// Keeps a copy of everything the detection engine published for one frame, so that it can be
+/// handed to the real publisher later on another thread. The buffers keep their capacity when
+/// cleared, so that a results object reused every frame stops allocating after the first few.
+/// </summary>
+class DetectionResults : public DetectionPublisher
+{
+public:
+    // Functions:
+    /// <summary>
+    /// Constructor
+    /// </summary>
+    DetectionResults();
+
+    /// <summary>
+    /// Forgets the results of the previous frame
+    /// </summary>
+    void Clear();
+
+    /// <summary>
+    /// Hands the kept results to a publisher, in the order the engine published them
+    /// </summary>
+    /// <param name="pPublisher">pointer to publisher to hand the results to</param>
+    void PublishTo(DetectionPublisher* pPublisher) const;
+
+    /// <summary>
+    /// Keeps a change in sweeping state
+    /// </summary>
+    /// <param name="pEvent">pointer to the detected event</param>
+    virtual void PublishSweepEvent(const SweepEvent* pEvent);
+
+    /// <summary>
+    /// Keeps where the moving pixels of the frame are
+    /// </summary>
+    /// <param name="pStats">pointer to motion statistics of the frame</param>
+    virtual void PublishSweepPosition(const MotionStats* pStats);
+
+    /// <summary>
+    /// Keeps the tracked blobs after they were updated with the frame
+    /// </summary>
+    /// <param name="pBlobs">pointer to the tracked blobs, including those missed in the frame</param>
+    /// <param name="count">number of tracked blobs</param>
+    virtual void PublishBlobs(const TrackedBlob* pBlobs, int count);
+
+    /// <summary>
+    /// Keeps the point cloud of the frame
+    /// </summary>
+    /// <param name="pCloud">pointer to point cloud of the frame</param>
+    virtual void PublishPointCloud(const PointCloud* pCloud);
+
+    /// <summary>
+    /// Gets the tracked blobs that were kept
+    /// </summary>
+    /// <param name="pCount">pointer in which to return the number of blobs</param>
+    /// <returns>pointer to the blobs, or NULL if none were published</returns>
+    const TrackedBlob* GetBlobs(int* pCount) const;
+
+private:
+    // Variables:
+    // Sweep events in the order they were published
+    std::vector<SweepEvent> m_sweepEvents;
+
+    bool m_hasSweepPosition;
+    MotionStats m_sweepPosition;
+
+    bool m_hasBlobs;
+    std::vector<TrackedBlob> m_blobs;
+
+    bool m_hasPointCloud;
+    PointCloud m_pointCloud;
+};
@@ -0,0 +1,927 @@
+//-----------------------------------------------------------------------------
+// <copyright file="DetectionStages.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation. All rights reserved.
+// </copyright>
+//-----------------------------------------------------------------------------
+
+#include "DetectionStages.h"
+#include "DepthFilters.h"
+#ifdef _WIN32
+#include <NuiApi.h>
+#endif
+#include <ctype.h>
+#include <limits.h>
+#include <algorithm>
+
+// Suppress warnings that come from compiling OpenCV code since we have no control over it
+#pragma warning(push)
+#pragma warning(disable : 6294 6031)
+#include <opencv2/imgproc/imgproc.hpp>
+#pragma warning(pop)
+
+using namespace cv;
+
+// Operations of the morphology stage
+enum MorphologyOperation
+{
+    MORPHOLOGY_NONE,
+    MORPHOLOGY_OPEN,
+    MORPHOLOGY_CLOSE,
+    MORPHOLOGY_ERODE,
+    MORPHOLOGY_DILATE
+};
+
+/// <summary>
+/// Computes the summed-area table of the difference, unless it is still valid for the current difference
+/// </summary>
+/// <param name="pFrame">pointer to the shared frame buffers</param>
+/// <returns>S_OK if successful, an error code otherwise</returns>
+static HRESULT UpdateDifferenceIntegral(DetectionFrame* pFrame)
+{
+    if (pFrame->differenceIntegral.IsValid())
+    {
+        return S_OK;
+    }
+
+    return pFrame->differenceIntegral.Compute(&pFrame->difference);
+}
+
+/// <summary>
+/// Creates the stage with the given name
+/// </summary>
+/// <param name="name">case insensitive stage name as used in the [Pipeline] Stages setting</param>
+/// <returns>new stage owned by the caller, or NULL if the name is unknown</returns>
+DetectionStage* CreateDetectionStage(const std::string& name)
+{
+    std::string lowerName(name);
+    for (size_t i = 0; i < lowerName.size(); ++i)
+    {
+        lowerName[i] = static_cast<char>(tolower(static_cast<unsigned char>(lowerName[i])));
+    }
+
+    if (lowerName == "convert")
+    {
+        return new ConvertStage();
+    }
+    if (lowerName == "holefill")
+    {
+        return new HoleFillStage();
+    }
+    if (lowerName == "depthfilter")
+    {
+        return new DepthFilterStage();
+    }
+    if (lowerName == "temporaldiff")
+    {
+        return new TemporalDiffStage();
+    }
+    if (lowerName == "smooth")
+    {
+        return new SmoothStage();
+    }
+    if (lowerName == "threshold")
+    {
+        return new ThresholdStage();
+    }
+    if (lowerName == "morphology")
+    {
+        return new MorphologyStage();
+    }
+    if (lowerName == "statistics")
+    {
+        return new StatisticsStage();
+    }
+    if (lowerName == "pointcloud")
+    {
+        return new PointCloudStage();
+    }
+    if (lowerName == "publish")
+    {
+        return new PublishStage();
+    }
+
+    return NULL;
+}
+
+/// <summary>
+/// The convert stage has no settings
+/// </summary>
+/// <param name="pConfig">pointer to config to read</param>
+/// <returns>S_OK</returns>
+HRESULT ConvertStage::Configure(const PipelineConfig* pConfig)
+{
+    UNREFERENCED_PARAMETER(pConfig);
+    return S_OK;
+}
+
+/// <summary>
+/// The convert stage writes into the shared depth buffer and needs nothing of its own
+/// </summary>
+/// <param name="size">size of the depth frames</param>
+/// <param name="pFrame">pointer to the shared frame buffers</param>
+/// <returns>S_OK</returns>
+HRESULT ConvertStage::Plan(Size size, DetectionFrame* pFrame)
+{
+    UNREFERENCED_PARAMETER(size);
+    UNREFERENCED_PARAMETER(pFrame);
+    return S_OK;
+}
+
+/// <summary>
+/// Strips the player index from the raw depth frame, leaving millimeters
+/// </summary>
+/// <param name="pFrame">pointer to the shared frame buffers</param>
+/// <returns>S_OK if successful, an error code otherwise</returns>
+HRESULT ConvertStage::Process(DetectionFrame* pFrame)
+{
+    const Mat& raw = *pFrame->pRawDepth;
+    for (int y = 0; y < raw.rows; ++y)
+    {
+        const USHORT* pRawRow = raw.ptr<USHORT>(y);
+        USHORT* pDepthRow = pFrame->depth.ptr<USHORT>(y);
+
+        for (int x = 0; x < raw.cols; ++x)
+        {
+            pDepthRow[x] = static_cast<USHORT>(pRawRow[x] >> NUI_IMAGE_PLAYER_INDEX_SHIFT);
+        }
+    }
+
+    return S_OK;
+}
+
+/// <summary>
+/// Constructor
+/// </summary>
+HoleFillStage::HoleFillStage() :
+    m_weight(128),
+    m_jumpThreshold(32),
+    m_maxAge(3),
+    m_maxGap(8)
+{
+}
+
+/// <summary>
+/// Reads the smoothing and filling parameters
+/// </summary>
+/// <param name="pConfig">pointer to config to read</param>
+/// <returns>S_OK if successful, E_INVALIDARG if a setting is out of range</returns>
+HRESULT HoleFillStage::Configure(const PipelineConfig* pConfig)
+{
+    float weight = pConfig->GetFloat("HoleFill", "Weight", 0.5f);
+    m_jumpThreshold = pConfig->GetInt("HoleFill", "JumpThreshold", 32);
+    m_maxAge = pConfig->GetInt("HoleFill", "MaxAge", 3);
+    m_maxGap = pConfig->GetInt("HoleFill", "MaxGap", 8);
+
+    // Fail if a setting is outside what the filters support
+    if (weight < 0.0f || weight > 1.0f || m_jumpThreshold < 0 || m_jumpThreshold > SHRT_MAX ||
+        m_maxAge < 0 || m_maxAge > 254 || m_maxGap < 0 || m_maxGap > SHRT_MAX - 2)
+    {
+        return E_INVALIDARG;
+    }
+
+    // The filter weighs in 256ths and always keeps a little of both frames
+    m_weight = min(255, max(1, cvRound(weight * 256.0f)));
+
+    return S_OK;
+}
+
+/// <summary>
+/// Clears the running depth so that the first frame is taken as it is
+/// </summary>
+/// <param name="size">size of the depth frames</param>
+/// <param name="pFrame">pointer to the shared frame buffers</param>
+/// <returns>S_OK</returns>
+HRESULT HoleFillStage::Plan(Size size, DetectionFrame* pFrame)
+{
+    UNREFERENCED_PARAMETER(pFrame);
+
+    m_state.create(size, CV_16UC1);
+    m_state.setTo(Scalar(0));
+    m_age.create(size, CV_8UC1);
+    m_age.setTo(Scalar(0));
+
+    return S_OK;
+}
+
+/// <summary>
+/// Smooths the depth over time, holds dropped readings and fills the remaining gaps
+/// </summary>
+/// <param name="pFrame">pointer to the shared frame buffers</param>
+/// <returns>S_OK if successful, an error code otherwise</returns>
+HRESULT HoleFillStage::Process(DetectionFrame* pFrame)
+{
+    HRESULT hr = TemporalDepthFilter(&pFrame->depth, &m_state, &m_age, m_weight, m_jumpThreshold, m_maxAge);
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+
+    // The running depth is kept for the next frame and only holds measured depth, so the gaps are filled in
+    // the copy later stages get
+    m_state.copyTo(pFrame->depth);
+
+    return FillDepthGaps(&pFrame->depth, m_maxGap);
+}
+
+/// <summary>
+/// Constructor
+/// </summary>
+DepthFilterStage::DepthFilterStage() :
+    m_medianSize(5),
+    m_radius(2),
+    m_rangeThreshold(50)
+{
+}
+
+/// <summary>
+/// Reads the filters to apply and their parameters
+/// </summary>
+/// <param name="pConfig">pointer to config to read</param>
+/// <returns>S_OK if successful, E_INVALIDARG if a filter is unknown or a setting is out of range</returns>
+HRESULT DepthFilterStage::Configure(const PipelineConfig* pConfig)
+{
+    std::vector<std::string> names;
+    pConfig->GetList("DepthFilter", "Filters", "edgepreserving", &names);
+
+    m_filters.clear();
+    for (size_t i = 0; i < names.size(); ++i)
+    {
+        std::string name(names[i]);
+        for (size_t c = 0; c < name.size(); ++c)
+        {
+            name[c] = static_cast<char>(tolower(static_cast<unsigned char>(name[c])));
+        }
+
+        Filter filter = {DEPTH_FILTER_MORPHOLOGY, 0};
+        if (name == "median")
+        {
+            filter.type = DEPTH_FILTER_MEDIAN;
+        }
+        else if (name == "edgepreserving")
+        {
+            filter.type = DEPTH_FILTER_EDGE_PRESERVING;
+        }
+        else if (name == "open")
+        {
+            filter.operation = MORPH_OPEN;
+        }
+        else if (name == "close")
+        {
+            filter.operation = MORPH_CLOSE;
+        }
+        else if (name == "erode")
+        {
+            filter.operation = MORPH_ERODE;
+        }
+        else if (name == "dilate")
+        {
+            filter.operation = MORPH_DILATE;
+        }
+        else
+        {
+            return E_INVALIDARG;
+        }
+
+        m_filters.push_back(filter);
+    }
+
+    m_medianSize = pConfig->GetInt("DepthFilter", "MedianSize", 5);
+    m_radius = pConfig->GetInt("DepthFilter", "Radius", 2);
+    m_rangeThreshold = pConfig->GetInt("DepthFilter", "RangeThreshold", 50);
+    int kernelSize = pConfig->GetInt("DepthFilter", "KernelSize", 3);
+
+    // Fail if a setting is outside what the filters support
+    if ((m_medianSize != 3 && m_medianSize != 5) || m_radius < 1 || m_radius > 3 ||
+        m_rangeThreshold < 0 || m_rangeThreshold > SHRT_MAX || kernelSize < 1)
+    {
+        return E_INVALIDARG;
+    }
+
+    m_kernel = getStructuringElement(MORPH_RECT, Size(kernelSize, kernelSize));
+
+    return S_OK;
+}
+
+/// <summary>
+/// Allocates the buffer the filters write to
+/// </summary>
+/// <param name="size">size of the depth frames</param>
+/// <param name="pFrame">pointer to the shared frame buffers</param>
+/// <returns>S_OK</returns>
+HRESULT DepthFilterStage::Plan(Size size, DetectionFrame* pFrame)
+{
+    UNREFERENCED_PARAMETER(pFrame);
+
+    m_scratch.create(size, CV_16UC1);
+
+    return S_OK;
+}
+
+/// <summary>
+/// Applies the configured filters in order to the depth plane
+/// </summary>
+/// <param name="pFrame">pointer to the shared frame buffers</param>
+/// <returns>S_OK if successful, an error code otherwise</returns>
+HRESULT DepthFilterStage::Process(DetectionFrame* pFrame)
+{
+    for (size_t i = 0; i < m_filters.size(); ++i)
+    {
+        HRESULT hr;
+        switch (m_filters[i].type)
+        {
+        case DEPTH_FILTER_MEDIAN:
+            hr = MedianDepthFilter(&pFrame->depth, &m_scratch, m_medianSize);
+            break;
+        case DEPTH_FILTER_EDGE_PRESERVING:
+            hr = EdgePreservingDepthFilter(&pFrame->depth, &m_scratch, m_radius, m_rangeThreshold);
+            break;
+        default:
+            hr = MorphologyDepthFilter(&pFrame->depth, &m_scratch, m_filters[i].operation, m_kernel);
+            break;
+        }
+
+        if (FAILED(hr))
+        {
+            return hr;
+        }
+
+        // Swapping headers hands the result to the next step without copying; both buffers stay allocated
+        swap(pFrame->depth, m_scratch);
+    }
+
+    return S_OK;
+}
+
+/// <summary>
+/// Constructor
+/// </summary>
+TemporalDiffStage::TemporalDiffStage() :
+    m_order(2),
+    m_interval(2),
+    m_historyLength(0),
+    m_newest(0),
+    m_framesSeen(0)
+{
+}
+
+/// <summary>
+/// Reads the difference order and the interval between the differenced frames
+/// </summary>
+/// <param name="pConfig">pointer to config to read</param>
+/// <returns>S_OK if successful, E_INVALIDARG if a setting is out of range</returns>
+HRESULT TemporalDiffStage::Configure(const PipelineConfig* pConfig)
+{
+    m_order = pConfig->GetInt("TemporalDiff", "Order", 2);
+    m_interval = pConfig->GetInt("TemporalDiff", "Interval", 2);
+
+    // Fail if the settings would need more history than is kept
+    if (m_order < 1 || m_order > 2 || m_interval < 1 || m_interval > MAX_INTERVAL)
+    {
+        return E_INVALIDARG;
+    }
+
+    return S_OK;
+}
+
+/// <summary>
+/// Allocates the frame history and forgets the frames seen so far
+/// </summary>
+/// <param name="size">size of the depth frames</param>
+/// <param name="pFrame">pointer to the shared frame buffers</param>
+/// <returns>S_OK</returns>
+HRESULT TemporalDiffStage::Plan(Size size, DetectionFrame* pFrame)
+{
+    UNREFERENCED_PARAMETER(pFrame);
+
+    m_historyLength = m_order * m_interval + 1;
+    for (int i = 0; i < m_historyLength; ++i)
+    {
+        m_history[i].create(size, CV_16UC1);
+    }
+    m_newest = 0;
+    m_framesSeen = 0;
+
+    return S_OK;
+}
+
+/// <summary>
+/// Adds the depth frame to the history and measures the change against the older frames
+/// </summary>
+/// <param name="pFrame">pointer to the shared frame buffers</param>
+/// <returns>S_OK if successful, an error code otherwise</returns>
+HRESULT TemporalDiffStage::Process(DetectionFrame* pFrame)
+{
+    m_newest = (m_newest + 1) % m_historyLength;
+    pFrame->depth.copyTo(m_history[m_newest]);
+
+    // The difference is rewritten below, so its table no longer matches
+    pFrame->differenceIntegral.Invalidate();
+
+    // Report no change until enough frames have been seen
+    if (m_framesSeen < m_historyLength)
+    {
+        ++m_framesSeen;
+    }
+    if (m_framesSeen < m_historyLength)
+    {
+        pFrame->difference.setTo(Scalar(0));
+        return S_OK;
+    }
+
+    const Mat& current = m_history[m_newest];
+    const Mat& previous = m_history[(m_newest + m_historyLength - m_interval) % m_historyLength];
+
+    // Only the second order difference keeps a frame two intervals back; with Order = 1 the history is
+    // too short for that index to exist
+    const Mat* pOldest = (m_order == 2) ? &m_history[(m_newest + m_historyLength - 2 * m_interval) % m_historyLength] : NULL;
+
+    for (int y = 0; y < current.rows; ++y)
+    {
+        const USHORT* pCurrentRow = current.ptr<USHORT>(y);
+        const USHORT* pPreviousRow = previous.ptr<USHORT>(y);
+        const USHORT* pOldestRow = pOldest ? pOldest->ptr<USHORT>(y) : NULL;
+        USHORT* pDifferenceRow = pFrame->difference.ptr<USHORT>(y);
+
+        for (int x = 0; x < current.cols; ++x)
+        {
+            int a = pCurrentRow[x];
+            int b = pPreviousRow[x];
+            int change;
+
+            if (m_order == 1)
+            {
+                change = (a && b) ? a - b : 0;
+            }
+            else
+            {
+                int c = pOldestRow[x];
+                change = (a && b && c) ? a - 2 * b + c : 0;
+            }
+
+            if (change < 0)
+            {
+                change = -change;
+            }
+            pDifferenceRow[x] = static_cast<USHORT>(change > USHRT_MAX ? USHRT_MAX : change);
+        }
+    }
+
+    return S_OK;
+}
+
+/// <summary>
+/// Constructor
+/// </summary>
+SmoothStage::SmoothStage() :
+    m_radius(8),
+    m_passes(1)
+{
+}
+
+/// <summary>
+/// Reads the box radius and the number of passes
+/// </summary>
+/// <param name="pConfig">pointer to config to read</param>
+/// <returns>S_OK if successful, E_INVALIDARG if a setting is out of range</returns>
+HRESULT SmoothStage::Configure(const PipelineConfig* pConfig)
+{
+    m_radius = pConfig->GetInt("Smooth", "Radius", 8);
+    m_passes = pConfig->GetInt("Smooth", "Passes", 1);
+
+    if (m_radius < 1 || m_passes < 1 || m_passes > 3)
+    {
+        return E_INVALIDARG;
+    }
+
+    return S_OK;
+}
+
+/// <summary>
+/// Allocates the buffer the passes write to
+/// </summary>
+/// <param name="size">size of the depth frames</param>
+/// <param name="pFrame">pointer to the shared frame buffers</param>
+/// <returns>S_OK</returns>
+HRESULT SmoothStage::Plan(Size size, DetectionFrame* pFrame)
+{
+    UNREFERENCED_PARAMETER(pFrame);
+
+    m_scratch.create(size, CV_16UC1);
+    m_scratch.setTo(Scalar(0));
+
+    return S_OK;
+}
+
+/// <summary>
+/// Box filters the difference the configured number of times
+/// </summary>
+/// <param name="pFrame">pointer to the shared frame buffers</param>
+/// <returns>S_OK if successful, an error code otherwise</returns>
+HRESULT SmoothStage::Process(DetectionFrame* pFrame)
+{
+    // The first pass reuses the frame's table if an earlier stage already computed it
+    for (int pass = 0; pass < m_passes; ++pass)
+    {
+        HRESULT hr = UpdateDifferenceIntegral(pFrame);
+        if (FAILED(hr))
+        {
+            return hr;
+        }
+
+        hr = pFrame->differenceIntegral.BoxFilter(m_radius, &m_scratch);
+        if (FAILED(hr))
+        {
+            return hr;
+        }
+
+        // Each pass filters the result of the previous one, which the table no longer matches
+        swap(pFrame->difference, m_scratch);
+        pFrame->differenceIntegral.Invalidate();
+    }
+
+    return S_OK;
+}
+
+/// <summary>
+/// Constructor
+/// </summary>
+ThresholdStage::ThresholdStage() :
+    m_minDifference(32),
+    m_maxDifference(2000)
+{
+}
+
+/// <summary>
+/// Reads the range of depth changes, in millimeters, that count as motion
+/// </summary>
+/// <param name="pConfig">pointer to config to read</param>
+/// <returns>S_OK if successful, E_INVALIDARG if the range is empty</returns>
+HRESULT ThresholdStage::Configure(const PipelineConfig* pConfig)
+{
+    m_minDifference = pConfig->GetInt("Threshold", "MinDifference", 32);
+    m_maxDifference = pConfig->GetInt("Threshold", "MaxDifference", 2000);
+
+    // Fail if no change could ever count as motion
+    if (m_minDifference < 1 || m_maxDifference < m_minDifference)
+    {
+        return E_INVALIDARG;
+    }
+
+    return S_OK;
+}
+
+/// <summary>
+/// The threshold stage writes into the shared mask and needs nothing of its own
+/// </summary>
+/// <param name="size">size of the depth frames</param>
+/// <param name="pFrame">pointer to the shared frame buffers</param>
+/// <returns>S_OK</returns>
+HRESULT ThresholdStage::Plan(Size size, DetectionFrame* pFrame)
+{
+    UNREFERENCED_PARAMETER(size);
+    UNREFERENCED_PARAMETER(pFrame);
+    return S_OK;
+}
+
+/// <summary>
+/// Marks the pixels whose depth change is within the configured range
+/// </summary>
+/// <param name="pFrame">pointer to the shared frame buffers</param>
+/// <returns>S_OK if successful, an error code otherwise</returns>
+HRESULT ThresholdStage::Process(DetectionFrame* pFrame)
+{
+    // The mask is already the right size and type, so inRange fills it in place
+    inRange(pFrame->difference, Scalar(m_minDifference), Scalar(m_maxDifference), pFrame->mask);
+
+    return S_OK;
+}
+
+/// <summary>
+/// Constructor
+/// </summary>
+MorphologyStage::MorphologyStage() :
+    m_operation(MORPHOLOGY_OPEN),
+    m_kernelSize(3)
+{
+}
+
+/// <summary>
+/// Reads the operation and kernel size
+/// </summary>
+/// <param name="pConfig">pointer to config to read</param>
+/// <returns>S_OK if successful, E_INVALIDARG if a setting is not recognized</returns>
+HRESULT MorphologyStage::Configure(const PipelineConfig* pConfig)
+{
+    std::string operation = pConfig->GetString("Morphology", "Operation", "open");
+    for (size_t i = 0; i < operation.size(); ++i)
+    {
+        operation[i] = static_cast<char>(tolower(static_cast<unsigned char>(operation[i])));
+    }
+
+    if (operation == "none")
+    {
+        m_operation = MORPHOLOGY_NONE;
+    }
+    else if (operation == "open")
+    {
+        m_operation = MORPHOLOGY_OPEN;
+    }
+    else if (operation == "close")
+    {
+        m_operation = MORPHOLOGY_CLOSE;
+    }
+    else if (operation == "erode")
+    {
+        m_operation = MORPHOLOGY_ERODE;
+    }
+    else if (operation == "dilate")
+    {
+        m_operation = MORPHOLOGY_DILATE;
+    }
+    else
+    {
+        return E_INVALIDARG;
+    }
+
+    m_kernelSize = pConfig->GetInt("Morphology", "KernelSize", 3);
+    if (m_kernelSize < 1)
+    {
+        return E_INVALIDARG;
+    }
+
+    return S_OK;
+}
+
+/// <summary>
+/// Builds the structuring element; the shared mask scratch buffer holds the intermediate result
+/// </summary>
+/// <param name="size">size of the depth frames</param>
+/// <param name="pFrame">pointer to the shared frame buffers</param>
+/// <returns>S_OK</returns>
+HRESULT MorphologyStage::Plan(Size size, DetectionFrame* pFrame)
+{
+    UNREFERENCED_PARAMETER(size);
+    UNREFERENCED_PARAMETER(pFrame);
+
+    m_kernel = getStructuringElement(MORPH_RECT, Size(m_kernelSize, m_kernelSize));
+
+    return S_OK;
+}
+
+/// <summary>
+/// Applies the configured operation to the motion mask
+/// </summary>
+/// <param name="pFrame">pointer to the shared frame buffers</param>
+/// <returns>S_OK if successful, an error code otherwise</returns>
+HRESULT MorphologyStage::Process(DetectionFrame* pFrame)
+{
+    // Two step operations go through the scratch buffer so that neither step works in place
+    switch (m_operation)
+    {
+    case MORPHOLOGY_OPEN:
+        erode(pFrame->mask, pFrame->maskScratch, m_kernel);
+        dilate(pFrame->maskScratch, pFrame->mask, m_kernel);
+        break;
+    case MORPHOLOGY_CLOSE:
+        dilate(pFrame->mask, pFrame->maskScratch, m_kernel);
+        erode(pFrame->maskScratch, pFrame->mask, m_kernel);
+        break;
+    case MORPHOLOGY_ERODE:
+        erode(pFrame->mask, pFrame->maskScratch, m_kernel);
+        pFrame->maskScratch.copyTo(pFrame->mask);
+        break;
+    case MORPHOLOGY_DILATE:
+        dilate(pFrame->mask, pFrame->maskScratch, m_kernel);
+        pFrame->maskScratch.copyTo(pFrame->mask);
+        break;
+    default:
+        break;
+    }
+
+    return S_OK;
+}
+
+/// <summary>
+/// The statistics stage has no settings
+/// </summary>
+/// <param name="pConfig">pointer to config to read</param>
+/// <returns>S_OK</returns>
+HRESULT StatisticsStage::Configure(const PipelineConfig* pConfig)
+{
+    UNREFERENCED_PARAMETER(pConfig);
+    return S_OK;
+}
+
+/// <summary>
+/// The statistics stage fills the shared histograms and needs nothing of its own
+/// </summary>
+/// <param name="size">size of the depth frames</param>
+/// <param name="pFrame">pointer to the shared frame buffers</param>
+/// <returns>S_OK</returns>
+HRESULT StatisticsStage::Plan(Size size, DetectionFrame* pFrame)
+{
+    UNREFERENCED_PARAMETER(size);
+    UNREFERENCED_PARAMETER(pFrame);
+    return S_OK;
+}
+
+/// <summary>
+/// Counts the moving pixels per column and per row and derives the motion statistics from them and the difference
+/// </summary>
+/// <param name="pFrame">pointer to the shared frame buffers</param>
+/// <returns>S_OK if successful, an error code otherwise</returns>
+HRESULT StatisticsStage::Process(DetectionFrame* pFrame)
+{
+    const Mat& mask = pFrame->mask;
+    std::fill(pFrame->columnCounts.begin(), pFrame->columnCounts.end(), 0);
+    int* pColumnCounts = &pFrame->columnCounts[0];
+
+    for (int y = 0; y < mask.rows; ++y)
+    {
+        const BYTE* pMaskRow = mask.ptr<BYTE>(y);
+        int rowCount = 0;
+
+        for (int x = 0; x < mask.cols; ++x)
+        {
+            // The mask is 0 or 255, so this adds 0 or 1 without a branch
+            int isMoving = pMaskRow[x] >> 7;
+            pColumnCounts[x] += isMoving;
+            rowCount += isMoving;
+        }
+
+        pFrame->rowCounts[y] = rowCount;
+    }
+
+    // Median, centroid and extent only need the histograms, not another pass over the frame
+    HRESULT hr = ComputeMotionStats(pFrame->columnCounts, pFrame->rowCounts, &pFrame->stats);
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+
+    // The depth change inside the extent takes four lookups in the table the smoothing may already have built
+    hr = UpdateDifferenceIntegral(pFrame);
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+
+    return ComputeMotionChange(&pFrame->differenceIntegral, &pFrame->stats);
+}
+
+/// <summary>
+/// Constructor
+/// </summary>
+PointCloudStage::PointCloudStage() :
+    m_step(4),
+    m_source(POINT_SOURCE_MOTION),
+    m_maxDepth(4000),
+    m_voxelSize(0.05f),
+    m_maxVoxels(400)
+{
+}
+
+/// <summary>
+/// Reads the sampling step, which pixels become points and the farthest depth kept
+/// </summary>
+/// <param name="pConfig">pointer to config to read</param>
+/// <returns>S_OK if successful, E_INVALIDARG if a setting is out of range</returns>
+HRESULT PointCloudStage::Configure(const PipelineConfig* pConfig)
+{
+    std::string source = pConfig->GetString("PointCloud", "Source", "motion");
+    for (size_t i = 0; i < source.size(); ++i)
+    {
+        source[i] = static_cast<char>(tolower(static_cast<unsigned char>(source[i])));
+    }
+
+    if (source == "all")
+    {
+        m_source = POINT_SOURCE_ALL;
+    }
+    else if (source == "motion")
+    {
+        m_source = POINT_SOURCE_MOTION;
+    }
+    else if (source == "player")
+    {
+        m_source = POINT_SOURCE_PLAYER;
+    }
+    else
+    {
+        return E_INVALIDARG;
+    }
+
+    m_step = pConfig->GetInt("PointCloud", "Step", 4);
+    m_maxDepth = pConfig->GetInt("PointCloud", "MaxDepth", 4000);
+    m_voxelSize = pConfig->GetFloat("PointCloud", "VoxelSize", 0.05f);
+    m_maxVoxels = pConfig->GetInt("PointCloud", "MaxVoxels", 400);
+    if (m_step < 1 || m_maxDepth < 1 || m_voxelSize < 0.0f || m_maxVoxels < 1)
+    {
+        return E_INVALIDARG;
+    }
+
+    return (m_voxelSize > 0.0f) ? m_voxelGrid.Configure(m_voxelSize, m_maxVoxels) : S_OK;
+}
+
+/// <summary>
+/// Computes the rays of the sampled pixels and sizes the shared point buffers
+/// </summary>
+/// <param name="size">size of the depth frames</param>
+/// <param name="pFrame">pointer to the shared frame buffers</param>
+/// <returns>S_OK if successful, an error code otherwise</returns>
+HRESULT PointCloudStage::Plan(Size size, DetectionFrame* pFrame)
+{
+    if (m_source == POINT_SOURCE_PLAYER)
+    {
+        m_playerMask.create(size, CV_8UC1);
+    }
+
+    if (m_voxelSize > 0.0f)
+    {
+        pFrame->cloud.Reserve(m_maxVoxels);
+        return m_fullCloud.Plan(size, m_step);
+    }
+
+    return pFrame->cloud.Plan(size, m_step);
+}
+
+/// <summary>
+/// Fills the shared point cloud from the depth plane
+/// </summary>
+/// <param name="pFrame">pointer to the shared frame buffers</param>
+/// <returns>S_OK if successful, an error code otherwise</returns>
+HRESULT PointCloudStage::Process(DetectionFrame* pFrame)
+{
+    const Mat* pMask = NULL;
+    if (m_source == POINT_SOURCE_MOTION)
+    {
+        pMask = &pFrame->mask;
+    }
+    else if (m_source == POINT_SOURCE_PLAYER)
+    {
+        // The player index sits in the low bits of the raw depth; only sampled pixels are needed
+        const Mat* pRaw = pFrame->pRawDepth;
+        for (int y = 0; y < pRaw->rows; y += m_step)
+        {
+            const USHORT* pRawRow = pRaw->ptr<USHORT>(y);
+            BYTE* pMaskRow = m_playerMask.ptr<BYTE>(y);
+            for (int x = 0; x < pRaw->cols; x += m_step)
+            {
+                pMaskRow[x] = static_cast<BYTE>(pRawRow[x] & NUI_IMAGE_PLAYER_INDEX_MASK);
+            }
+        }
+        pMask = &m_playerMask;
+    }
+
+    if (m_voxelSize <= 0.0f)
+    {
+        return pFrame->cloud.Generate(&pFrame->depth, pMask, m_maxDepth);
+    }
+
+    HRESULT hr = m_fullCloud.Generate(&pFrame->depth, pMask, m_maxDepth);
+    if (SUCCEEDED(hr))
+    {
+        hr = m_voxelGrid.Filter(&m_fullCloud, &pFrame->cloud);
+    }
+
+    return hr;
+}
+
+/// <summary>
+/// The publish stage has no settings
+/// </summary>
+/// <param name="pConfig">pointer to config to read</param>
+/// <returns>S_OK</returns>
+HRESULT PublishStage::Configure(const PipelineConfig* pConfig)
+{
+    UNREFERENCED_PARAMETER(pConfig);
+    return S_OK;
+}
+
+/// <summary>
+/// The publish stage needs no buffers
+/// </summary>
+/// <param name="size">size of the depth frames</param>
+/// <param name="pFrame">pointer to the shared frame buffers</param>
+/// <returns>S_OK</returns>
+HRESULT PublishStage::Plan(Size size, DetectionFrame* pFrame)
+{
+    UNREFERENCED_PARAMETER(size);
+    UNREFERENCED_PARAMETER(pFrame);
+    return S_OK;
+}
+
+/// <summary>
+/// Hands the frame to the detection callback
+/// </summary>
+/// <param name="pFrame">pointer to the shared frame buffers</param>
+/// <returns>S_OK</returns>
+HRESULT PublishStage::Process(DetectionFrame* pFrame)
+{
+    if (pFrame->callback)
+    {
+        pFrame->callback(pFrame, pFrame->pCallbackData);
+    }
+
+    return S_OK;
+}
@@ -0,0 +1,244 @@
+//-----------------------------------------------------------------------------
+// <copyright file="DetectionStages.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation. All rights reserved.
+// </copyright>
+//-----------------------------------------------------------------------------
+
+#pragma once
+
+#include "DetectionPipeline.h"
+#include "VoxelGrid.h"
+
+/// <summary>
+/// Creates the stage with the given name
+/// </summary>
+/// <param name="name">case insensitive stage name as used in the [Pipeline] Stages setting</param>
+/// <returns>new stage owned by the caller, or NULL if the name is unknown</returns>
+DetectionStage* CreateDetectionStage(const std::string& name);
+
+/// <summary>
+/// Strips the player index from the raw depth frame, leaving millimeters
+/// </summary>
+class ConvertStage : public DetectionStage
+{
+public:
+    HRESULT Configure(const PipelineConfig* pConfig) override;
+    HRESULT Plan(Size size, DetectionFrame* pFrame) override;
+    HRESULT Process(DetectionFrame* pFrame) override;
+};
+
+/// <summary>
+/// Steadies the depth plane so that flickering readings do not show up as motion.
+/// [HoleFill] Weight is the share of the new frame in the running depth (0 to 1); changes larger than
+/// JumpThreshold millimeters are taken as they are. Dropped readings keep their last depth for MaxAge
+/// frames, and remaining gaps of up to MaxGap pixels are filled from their neighbors.
+/// </summary>
+class HoleFillStage : public DetectionStage
+{
+public:
+    HoleFillStage();
+    HRESULT Configure(const PipelineConfig* pConfig) override;
+    HRESULT Plan(Size size, DetectionFrame* pFrame) override;
+    HRESULT Process(DetectionFrame* pFrame) override;
+
+private:
+    // Variables:
+    int m_weight;
+    int m_jumpThreshold;
+    int m_maxAge;
+    int m_maxGap;
+
+    // Filtered depth of the previous frame and the number of frames each pixel has been held
+    Mat m_state;
+    Mat m_age;
+};
+
+/// <summary>
+/// Filters the depth plane in millimeters before anything is measured on it.
+/// [DepthFilter] Filters lists median, edgepreserving, open, close, erode or dilate, applied in order;
+/// MedianSize, Radius, RangeThreshold and KernelSize set their parameters.
+/// </summary>
+class DepthFilterStage : public DetectionStage
+{
+public:
+    DepthFilterStage();
+    HRESULT Configure(const PipelineConfig* pConfig) override;
+    HRESULT Plan(Size size, DetectionFrame* pFrame) override;
+    HRESULT Process(DetectionFrame* pFrame) override;
+
+private:
+    // Types:
+    enum DepthFilterType
+    {
+        DEPTH_FILTER_MEDIAN,
+        DEPTH_FILTER_EDGE_PRESERVING,
+        DEPTH_FILTER_MORPHOLOGY
+    };
+
+    // Filter to apply and, for morphology, its operation
+    struct Filter
+    {
+        DepthFilterType type;
+        int operation;
+    };
+
+    // Variables:
+    std::vector<Filter> m_filters;
+    int m_medianSize;
+    int m_radius;
+    int m_rangeThreshold;
+    Mat m_kernel;
+
+    // Each filter writes here and is then swapped with the shared depth buffer
+    Mat m_scratch;
+};
+
+/// <summary>
+/// Measures how much the depth changed over the last few frames.
+/// [TemporalDiff] Order = 1 gives |D(t) - D(t-k)| and Order = 2 gives |D(t) - 2 D(t-k) + D(t-2k)|,
+/// where k is the Interval in frames. Pixels with unknown depth in any of the frames give 0.
+/// </summary>
+class TemporalDiffStage : public DetectionStage
+{
+    // Constants:
+    // Largest supported interval, which bounds the number of frames kept
+    static const int MAX_INTERVAL = 8;
+    static const int MAX_HISTORY = 2 * MAX_INTERVAL + 1;
+
+public:
+    TemporalDiffStage();
+    HRESULT Configure(const PipelineConfig* pConfig) override;
+    HRESULT Plan(Size size, DetectionFrame* pFrame) override;
+    HRESULT Process(DetectionFrame* pFrame) override;
+
+private:
+    // Variables:
+    int m_order;
+    int m_interval;
+
+    // Ring of the most recent depth frames; m_newest indexes the latest one
+    Mat m_history[MAX_HISTORY];
+    int m_historyLength;
+    int m_newest;
+    int m_framesSeen;
+};
+
+/// <summary>
+/// Spreads the depth change over a wide neighborhood so that scattered changes add up to a motion-energy map.
+/// [Smooth] Radius is the half width of the box in pixels; Passes = 1 gives a box filter, and 2 or 3
+/// repeated boxes approximate a Gaussian. Each pass costs the same whatever the radius.
+/// </summary>
+class SmoothStage : public DetectionStage
+{
+public:
+    SmoothStage();
+    HRESULT Configure(const PipelineConfig* pConfig) override;
+    HRESULT Plan(Size size, DetectionFrame* pFrame) override;
+    HRESULT Process(DetectionFrame* pFrame) override;
+
+private:
+    // Variables:
+    int m_radius;
+    int m_passes;
+
+    // Each pass writes here and is then swapped with the shared difference buffer
+    Mat m_scratch;
+};
+
+/// <summary>
+/// Marks the pixels whose depth change is within [Threshold] MinDifference to MaxDifference millimeters
+/// </summary>
+class ThresholdStage : public DetectionStage
+{
+public:
+    ThresholdStage();
+    HRESULT Configure(const PipelineConfig* pConfig) override;
+    HRESULT Plan(Size size, DetectionFrame* pFrame) override;
+    HRESULT Process(DetectionFrame* pFrame) override;
+
+private:
+    // Variables:
+    int m_minDifference;
+    int m_maxDifference;
+};
+
+/// <summary>
+/// Cleans up the motion mask with [Morphology] Operation = open, close, erode, dilate or none,
+/// using a square kernel of KernelSize pixels
+/// </summary>
+class MorphologyStage : public DetectionStage
+{
+public:
+    MorphologyStage();
+    HRESULT Configure(const PipelineConfig* pConfig) override;
+    HRESULT Plan(Size size, DetectionFrame* pFrame) override;
+    HRESULT Process(DetectionFrame* pFrame) override;
+
+private:
+    // Variables:
+    int m_operation;
+    int m_kernelSize;
+    Mat m_kernel;
+};
+
+/// <summary>
+/// Counts the moving pixels per column and per row and derives the motion statistics from them. The depth
+/// change inside the extent of the moving pixels comes from the frame's summed-area table of the difference.
+/// </summary>
+class StatisticsStage : public DetectionStage
+{
+public:
+    HRESULT Configure(const PipelineConfig* pConfig) override;
+    HRESULT Plan(Size size, DetectionFrame* pFrame) override;
+    HRESULT Process(DetectionFrame* pFrame) override;
+};
+
+/// <summary>
+/// Converts the depth plane into points in meters for the robot.
+/// [PointCloud] Step samples every Step-th row and column; Source = all, motion or player keeps every
+/// known pixel, the pixels of the motion mask or the pixels the sensor assigned to a player; points
+/// farther than MaxDepth millimeters are left out. A VoxelSize in meters above 0 reduces the points to
+/// the centroids of at most MaxVoxels occupied voxels, enlarged as needed to cover every point.
+/// </summary>
+class PointCloudStage : public DetectionStage
+{
+public:
+    PointCloudStage();
+    HRESULT Configure(const PipelineConfig* pConfig) override;
+    HRESULT Plan(Size size, DetectionFrame* pFrame) override;
+    HRESULT Process(DetectionFrame* pFrame) override;
+
+private:
+    // Types:
+    enum PointSource
+    {
+        POINT_SOURCE_ALL,
+        POINT_SOURCE_MOTION,
+        POINT_SOURCE_PLAYER
+    };
+
+    // Variables:
+    int m_step;
+    PointSource m_source;
+    int m_maxDepth;
+    float m_voxelSize;
+    int m_maxVoxels;
+
+    // Full resolution points, reduced into the frame's cloud when voxel downsampling is on
+    PointCloud m_fullCloud;
+    VoxelGrid m_voxelGrid;
+
+    // Non-zero where the sensor assigned a player, rebuilt every frame for the player source
+    Mat m_playerMask;
+};
+
+/// <summary>
+/// Hands the frame to the detection callback
+/// </summary>
+class PublishStage : public DetectionStage
+{
+public:
+    HRESULT Configure(const PipelineConfig* pConfig) override;
+    HRESULT Plan(Size size, DetectionFrame* pFrame) override;
+    HRESULT Process(DetectionFrame* pFrame) override;
+};
@@ -0,0 +1,199 @@
+//-----------------------------------------------------------------------------
+// <copyright file="FilterChain.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation. All rights reserved.
+// </copyright>
+//-----------------------------------------------------------------------------
+
+#include "FilterChain.h"
+
+using namespace cv;
+
+/// <summary>
+/// Constructor
+/// </summary>
+FilterChain::FilterChain()
+{
+}
+
+/// <summary>
+/// Removes all steps
+/// </summary>
+void FilterChain::Clear()
+{
+    m_steps.clear();
+    m_kernels.clear();
+}
+
+/// <summary>
+/// Appends a step to the chain
+/// </summary>
+/// <param name="step">step to append</param>
+void FilterChain::AddStep(const FilterStep& step)
+{
+    m_steps.push_back(step);
+
+    if (step.type == FILTER_DILATE || step.type == FILTER_ERODE)
+    {
+        m_kernels.push_back(getStructuringElement(MORPH_RECT, Size(step.kernelSize, step.kernelSize)));
+    }
+    else
+    {
+        m_kernels.push_back(Mat());
+    }
+}
+
+/// <summary>
+/// Replaces the steps with those of one of the offered filters
+/// </summary>
+/// <param name="mode">filter to build</param>
+/// <param name="isColor">whether the filter is for color images rather than colorized depth images</param>
+void FilterChain::Build(FilterMode mode, bool isColor)
+{
+    Clear();
+
+    switch (mode)
+    {
+    case FILTER_MODE_GAUSSIAN_BLUR:
+        {
+            FilterStep gaussian = {FILTER_GAUSSIAN_BLUR, isColor ? 7 : 5, 0.0, 0.0};
+            AddStep(gaussian);
+        }
+        break;
+    case FILTER_MODE_DILATE:
+        {
+            FilterStep dilation = {FILTER_DILATE, 3, 0.0, 0.0};
+            AddStep(dilation);
+        }
+        break;
+    case FILTER_MODE_ERODE:
+        {
+            FilterStep erosion = {FILTER_ERODE, 3, 0.0, 0.0};
+            AddStep(erosion);
+        }
+        break;
+    case FILTER_MODE_CANNY_EDGE:
+        {
+            // Depth images have much weaker gradients than color images
+            const double minThreshold = isColor ? 30.0 : 5.0;
+            const double maxThreshold = isColor ? 50.0 : 20.0;
+
+            // Convert image to grayscale, remove noise, then find edges
+            FilterStep grayscale = {FILTER_GRAYSCALE, 0, 0.0, 0.0};
+            FilterStep noise = {FILTER_BOX_BLUR, 3, 0.0, 0.0};
+            FilterStep edges = {FILTER_CANNY, 0, minThreshold, maxThreshold};
+            AddStep(grayscale);
+            AddStep(noise);
+            AddStep(edges);
+        }
+        break;
+    }
+}
+
+/// <summary>
+/// Gets whether the chain has no steps and leaves images unchanged
+/// </summary>
+/// <returns>true if the chain has no steps</returns>
+bool FilterChain::IsEmpty() const
+{
+    return m_steps.empty();
+}
+
+/// <summary>
+/// Runs the steps in order on the given RGBA image, leaving the result in it.
+/// Intermediate results go to scratch buffers owned by the chain, so once the
+/// buffers have been sized for the image the chain does not allocate image storage.
+/// </summary>
+/// <param name="pImg">pointer to RGBA Mat to filter</param>
+/// <returns>S_OK if successful, an error code otherwise</returns>
+HRESULT FilterChain::Apply(Mat* pImg)
+{
+    // Fail if pointer is invalid
+    if (!pImg)
+    {
+        return E_POINTER;
+    }
+
+    // Fail if Mat contains no data or is not an RGBA image
+    if (pImg->empty() || pImg->type() != CV_8UC4)
+    {
+        return E_INVALIDARG;
+    }
+
+    if (m_steps.empty())
+    {
+        return S_OK;
+    }
+
+    // Only reallocates when the image size changes
+    m_colorScratch.create(pImg->size(), CV_8UC4);
+    m_grayScratch[0].create(pImg->size(), CV_8UC1);
+    m_grayScratch[1].create(pImg->size(), CV_8UC1);
+
+    Mat* pCurrent = pImg;
+    bool isGray = false;
+
+    for (size_t i = 0; i < m_steps.size(); ++i)
+    {
+        const FilterStep& step = m_steps[i];
+
+        // Edge detection needs a single channel image
+        if ((step.type == FILTER_GRAYSCALE || step.type == FILTER_CANNY) && !isGray)
+        {
+            cvtColor(*pCurrent, m_grayScratch[0], CV_RGBA2GRAY);
+            pCurrent = &m_grayScratch[0];
+            isGray = true;
+        }
+
+        if (step.type == FILTER_GRAYSCALE)
+        {
+            continue;
+        }
+
+        // Every other step writes to the buffer of the same format that it is not reading from
+        Mat* pTarget;
+        if (isGray)
+        {
+            pTarget = (pCurrent == &m_grayScratch[0]) ? &m_grayScratch[1] : &m_grayScratch[0];
+        }
+        else
+        {
+            pTarget = (pCurrent == pImg) ? &m_colorScratch : pImg;
+        }
+
+        Size kernel(step.kernelSize, step.kernelSize);
+        switch (step.type)
+        {
+        case FILTER_GAUSSIAN_BLUR:
+            GaussianBlur(*pCurrent, *pTarget, kernel, 0);
+            break;
+        case FILTER_BOX_BLUR:
+            blur(*pCurrent, *pTarget, kernel);
+            break;
+        case FILTER_DILATE:
+            dilate(*pCurrent, *pTarget, m_kernels[i]);
+            break;
+        case FILTER_ERODE:
+            erode(*pCurrent, *pTarget, m_kernels[i]);
+            break;
+        case FILTER_CANNY:
+            Canny(*pCurrent, *pTarget, step.threshold1, step.threshold2);
+            break;
+        default:
+            return E_INVALIDARG;
+        }
+
+        pCurrent = pTarget;
+    }
+
+    // Bring the result back into the caller's image, whose storage already has the right size and type
+    if (isGray)
+    {
+        cvtColor(*pCurrent, *pImg, CV_GRAY2RGBA);
+    }
+    else if (pCurrent != pImg)
+    {
+        pCurrent->copyTo(*pImg);
+    }
+
+    return S_OK;
+}
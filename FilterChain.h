@@ -0,0 +1,114 @@
+//-----------------------------------------------------------------------------
+// <copyright file="FilterChain.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation. All rights reserved.
+// </copyright>
+//-----------------------------------------------------------------------------
+
+#pragma once
+
+#include "Platform.h"
+#include <vector>
+
+// Suppress warnings that come from compiling OpenCV code since we have no control over it
+#pragma warning(push)
+#pragma warning(disable : 6294 6031)
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#pragma warning(pop)
+
+using namespace cv;
+
+/// <summary>
+/// Operations that can be chained by a FilterChain
+/// </summary>
+enum FilterType
+{
+    FILTER_GAUSSIAN_BLUR,
+    FILTER_BOX_BLUR,
+    FILTER_DILATE,
+    FILTER_ERODE,
+    FILTER_GRAYSCALE,
+    FILTER_CANNY
+};
+
+/// <summary>
+/// Filters offered for the color and depth images
+/// </summary>
+enum FilterMode
+{
+    FILTER_MODE_NONE,
+    FILTER_MODE_GAUSSIAN_BLUR,
+    FILTER_MODE_DILATE,
+    FILTER_MODE_ERODE,
+    FILTER_MODE_CANNY_EDGE
+};
+
+/// <summary>
+/// One operation of a filter chain and its parameters
+/// </summary>
+struct FilterStep
+{
+    FilterType type;
+
+    // Kernel width and height in pixels for the blurs, dilate and erode
+    int kernelSize;
+
+    // Lower and upper hysteresis thresholds for Canny
+    double threshold1;
+    double threshold2;
+};
+
+class FilterChain
+{
+public:
+    // Functions:
+    /// <summary>
+    /// Constructor
+    /// </summary>
+    FilterChain();
+
+    /// <summary>
+    /// Removes all steps
+    /// </summary>
+    void Clear();
+
+    /// <summary>
+    /// Appends a step to the chain
+    /// </summary>
+    /// <param name="step">step to append</param>
+    void AddStep(const FilterStep& step);
+
+    /// <summary>
+    /// Replaces the steps with those of one of the offered filters
+    /// </summary>
+    /// <param name="mode">filter to build</param>
+    /// <param name="isColor">whether the filter is for color images rather than colorized depth images</param>
+    void Build(FilterMode mode, bool isColor);
+
+    /// <summary>
+    /// Gets whether the chain has no steps and leaves images unchanged
+    /// </summary>
+    /// <returns>true if the chain has no steps</returns>
+    bool IsEmpty() const;
+
+    /// <summary>
+    /// Runs the steps in order on the given RGBA image, leaving the result in it.
+    /// Intermediate results go to scratch buffers owned by the chain, so once the
+    /// buffers have been sized for the image the chain does not allocate image storage.
+    /// </summary>
+    /// <param name="pImg">pointer to RGBA Mat to filter</param>
+    /// <returns>S_OK if successful, an error code otherwise</returns>
+    HRESULT Apply(Mat* pImg);
+
+private:
+    // Variables:
+    std::vector<FilterStep> m_steps;
+
+    // Structuring element of each step, built when the step is added rather than every frame
+    std::vector<Mat> m_kernels;
+
+    // Scratch buffers; color steps alternate between the image and m_colorScratch,
+    // grayscale steps alternate between the two gray buffers
+    Mat m_colorScratch;
+    Mat m_grayScratch[2];
+};
@@ -0,0 +1,271 @@
+//-----------------------------------------------------------------------------
+// <copyright file="FrameConversion.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation. All rights reserved.
+// </copyright>
+//-----------------------------------------------------------------------------
+
+#include "FrameConversion.h"
+
+#ifdef _WIN32
+#include <NuiApi.h>
+#endif
+
+/// <summary>
+/// Converts a 13-bit depth value with a player index into a set of RGB values
+/// </summary>
+/// <param name="depth">raw depth value to convert</param>
+/// <param name="pRedPixel">pointer in which to return the value of the red pixel</param>
+/// <param name="pGreenPixel">pointer in which to return the value of the green pixel</param>
+/// <param name="pBluePixel">pointer in which to return the value of the blue pixel</param>
+void DepthShortToRgb(USHORT depth, UINT8* pRedPixel, UINT8* pGreenPixel, UINT8* pBluePixel)
+{
+    int realDepth = depth >> NUI_IMAGE_PLAYER_INDEX_SHIFT;
+    USHORT playerIndex = depth & NUI_IMAGE_PLAYER_INDEX_MASK;
+
+    // Convert depth info into an intensity for display
+    BYTE b = 255 - static_cast<BYTE>(256 * realDepth / 0x0fff);
+
+    // Color the output based on the player index
+    switch (playerIndex)
+    {
+    case 0:
+        *pRedPixel = b / 2;
+        *pGreenPixel = b / 2;
+        *pBluePixel = b / 2;
+        break;
+
+    case 1:
+        *pRedPixel = b;
+        *pGreenPixel = 0;
+        *pBluePixel = 0;
+        break;
+
+    case 2:
+        *pRedPixel = 0;
+        *pGreenPixel = b;
+        *pBluePixel = 0;
+        break;
+
+    case 3:
+        *pRedPixel = b / 4;
+        *pGreenPixel = b;
+        *pBluePixel = b;
+        break;
+
+    case 4:
+        *pRedPixel = b;
+        *pGreenPixel = b;
+        *pBluePixel = b / 4;
+        break;
+
+    case 5:
+        *pRedPixel = b;
+        *pGreenPixel = b / 4;
+        *pBluePixel = b;
+        break;
+
+    case 6:
+        *pRedPixel = b / 2;
+        *pGreenPixel = b / 2;
+        *pBluePixel = b;
+        break;
+
+    case 7:
+        *pRedPixel = 255 - (b / 2);
+        *pGreenPixel = 255 - (b / 2);
+        *pBluePixel = 255 - (b / 2);
+        break;
+
+    default:
+        *pRedPixel = 0;
+        *pGreenPixel = 0;
+        *pBluePixel = 0;
+        break;
+    }
+}
+
+/// <summary>
+/// Copies a color frame buffer into a 4-channel image
+/// </summary>
+/// <param name="pBuffer">pointer to the frame, 4 bytes per pixel</param>
+/// <param name="pitch">bytes from one row of the frame to the next</param>
+/// <param name="pImage">pointer to CV_8UC4 Mat in which to return the image</param>
+/// <returns>S_OK if successful, an error code otherwise</returns>
+HRESULT ConvertColorFrame(const BYTE* pBuffer, int pitch, Mat* pImage)
+{
+    // Fail if either pointer is invalid
+    if (!pBuffer || !pImage)
+    {
+        return E_POINTER;
+    }
+
+    // Fail if the image is not a 4-channel image the rows fit in
+    if (pImage->empty() || pImage->type() != CV_8UC4 || pitch < pImage->cols * 4)
+    {
+        return E_INVALIDARG;
+    }
+
+    for (int y = 0; y < pImage->rows; ++y)
+    {
+        const BYTE* pBufferRow = pBuffer + y * pitch;
+        Vec4b* pColorRow = pImage->ptr<Vec4b>(y);
+
+        for (int x = 0; x < pImage->cols; ++x)
+        {
+            pColorRow[x] = Vec4b(pBufferRow[x * 4 + 0], pBufferRow[x * 4 + 1], pBufferRow[x * 4 + 2], pBufferRow[x * 4 + 3]);
+        }
+    }
+
+    return S_OK;
+}
+
+/// <summary>
+/// Copies a raw depth frame buffer into a 16-bit depth Mat, keeping the player index in the low bits
+/// </summary>
+/// <param name="pBuffer">pointer to the frame, 2 bytes per pixel</param>
+/// <param name="pitch">bytes from one row of the frame to the next</param>
+/// <param name="pImage">pointer to CV_16U Mat in which to return the depth</param>
+/// <returns>S_OK if successful, an error code otherwise</returns>
+HRESULT ConvertDepthFrame(const BYTE* pBuffer, int pitch, Mat* pImage)
+{
+    // Fail if either pointer is invalid
+    if (!pBuffer || !pImage)
+    {
+        return E_POINTER;
+    }
+
+    // Fail if the Mat is not a depth plane the rows fit in
+    if (pImage->empty() || pImage->type() != CV_16U || pitch < pImage->cols * 2)
+    {
+        return E_INVALIDARG;
+    }
+
+    for (int y = 0; y < pImage->rows; ++y)
+    {
+        const USHORT* pBufferRow = reinterpret_cast<const USHORT*>(pBuffer + y * pitch);
+        USHORT* pDepthRow = pImage->ptr<USHORT>(y);
+
+        for (int x = 0; x < pImage->cols; ++x)
+        {
+            pDepthRow[x] = pBufferRow[x];
+        }
+    }
+
+    return S_OK;
+}
+
+/// <summary>
+/// Colorizes a raw depth frame buffer straight into a 4-channel image
+/// </summary>
+/// <param name="pBuffer">pointer to the frame, 2 bytes per pixel</param>
+/// <param name="pitch">bytes from one row of the frame to the next</param>
+/// <param name="pImage">pointer to CV_8UC4 Mat in which to return the image</param>
+/// <returns>S_OK if successful, an error code otherwise</returns>
+HRESULT ConvertDepthFrameToArgb(const BYTE* pBuffer, int pitch, Mat* pImage)
+{
+    // Fail if either pointer is invalid
+    if (!pBuffer || !pImage)
+    {
+        return E_POINTER;
+    }
+
+    // Fail if the image is not a 4-channel image the rows fit in
+    if (pImage->empty() || pImage->type() != CV_8UC4 || pitch < pImage->cols * 2)
+    {
+        return E_INVALIDARG;
+    }
+
+    for (int y = 0; y < pImage->rows; ++y)
+    {
+        const USHORT* pBufferRow = reinterpret_cast<const USHORT*>(pBuffer + y * pitch);
+        Vec4b* pDepthRgbRow = pImage->ptr<Vec4b>(y);
+
+        for (int x = 0; x < pImage->cols; ++x)
+        {
+            UINT8 redPixel, greenPixel, bluePixel;
+            DepthShortToRgb(pBufferRow[x], &redPixel, &greenPixel, &bluePixel);
+            pDepthRgbRow[x] = Vec4b(redPixel, greenPixel, bluePixel, 1);
+        }
+    }
+
+    return S_OK;
+}
+
+/// <summary>
+/// Colorizes a raw depth Mat
+/// </summary>
+/// <param name="pRawDepth">pointer to the raw CV_16U depth frame</param>
+/// <param name="pImage">pointer to CV_8UC4 Mat of the same size in which to return the image</param>
+/// <returns>S_OK if successful, an error code otherwise</returns>
+HRESULT ColorizeRawDepth(const Mat* pRawDepth, Mat* pImage)
+{
+    // Fail if either pointer is invalid
+    if (!pRawDepth || !pImage)
+    {
+        return E_POINTER;
+    }
+
+    // Fail if the Mats are not a depth plane and an image of the same size
+    if (pRawDepth->empty() || pRawDepth->type() != CV_16U || pImage->size() != pRawDepth->size() || pImage->type() != CV_8UC4)
+    {
+        return E_INVALIDARG;
+    }
+
+    for (int y = 0; y < pRawDepth->rows; ++y)
+    {
+        const USHORT* pRawDepthRow = pRawDepth->ptr<USHORT>(y);
+        Vec4b* pDepthRgbRow = pImage->ptr<Vec4b>(y);
+
+        for (int x = 0; x < pRawDepth->cols; ++x)
+        {
+            UINT8 redPixel, greenPixel, bluePixel;
+            DepthShortToRgb(pRawDepthRow[x], &redPixel, &greenPixel, &bluePixel);
+            pDepthRgbRow[x] = Vec4b(redPixel, greenPixel, bluePixel, 1);
+        }
+    }
+
+    return S_OK;
+}
+
+/// <summary>
+/// Colorizes a depth plane in millimeters, taking the player index from the raw frame it was filtered from
+/// </summary>
+/// <param name="pDepth">pointer to CV_16U depth in millimeters</param>
+/// <param name="pRawDepth">pointer to the raw CV_16U depth frame, of the same size</param>
+/// <param name="pImage">pointer to CV_8UC4 Mat of the same size in which to return the image</param>
+/// <returns>S_OK if successful, an error code otherwise</returns>
+HRESULT ColorizeFilteredDepth(const Mat* pDepth, const Mat* pRawDepth, Mat* pImage)
+{
+    // Fail if any pointer is invalid
+    if (!pDepth || !pRawDepth || !pImage)
+    {
+        return E_POINTER;
+    }
+
+    // Fail if the Mats are not depth planes of one size, with an image to match
+    if (pRawDepth->empty() || pDepth->type() != CV_16U || pRawDepth->type() != CV_16U ||
+        pDepth->size() != pRawDepth->size() || pImage->size() != pRawDepth->size() || pImage->type() != CV_8UC4)
+    {
+        return E_INVALIDARG;
+    }
+
+    for (int y = 0; y < pRawDepth->rows; ++y)
+    {
+        const USHORT* pDepthRow = pDepth->ptr<USHORT>(y);
+        const USHORT* pRawDepthRow = pRawDepth->ptr<USHORT>(y);
+        Vec4b* pDepthRgbRow = pImage->ptr<Vec4b>(y);
+
+        for (int x = 0; x < pRawDepth->cols; ++x)
+        {
+            // Recombine the filtered depth with the frame's player index so the coloring matches the raw stream
+            USHORT playerIndex = pRawDepthRow[x] & NUI_IMAGE_PLAYER_INDEX_MASK;
+            USHORT packed = static_cast<USHORT>((pDepthRow[x] << NUI_IMAGE_PLAYER_INDEX_SHIFT) | playerIndex);
+
+            UINT8 redPixel, greenPixel, bluePixel;
+            DepthShortToRgb(packed, &redPixel, &greenPixel, &bluePixel);
+            pDepthRgbRow[x] = Vec4b(redPixel, greenPixel, bluePixel, 1);
+        }
+    }
+
+    return S_OK;
+}
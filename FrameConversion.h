@@ -0,0 +1,75 @@
+//-----------------------------------------------------------------------------
+// <copyright file="FrameConversion.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation. All rights reserved.
+// </copyright>
+//-----------------------------------------------------------------------------
+
+#pragma once
+
+#include "Platform.h"
+
+// Suppress warnings that come from compiling OpenCV code since we have no control over it
+#pragma warning(push)
+#pragma warning(disable : 6294 6031)
+#include <opencv2/core/core.hpp>
+#pragma warning(pop)
+
+using namespace cv;
+
+// Per-pixel conversions from Kinect frame buffers into OpenCV Mats. They only read the buffers and
+// Mats they are given, so that OpenCVFrameHelper can run them on the frames it took from the sensor
+// and the benchmarks can run them on synthetic and recorded frames without a sensor.
+// Output Mats must already have the size of the frame.
+
+/// <summary>
+/// Converts a 13-bit depth value with a player index into a set of RGB values
+/// </summary>
+/// <param name="depth">raw depth value to convert</param>
+/// <param name="pRedPixel">pointer in which to return the value of the red pixel</param>
+/// <param name="pGreenPixel">pointer in which to return the value of the green pixel</param>
+/// <param name="pBluePixel">pointer in which to return the value of the blue pixel</param>
+void DepthShortToRgb(USHORT depth, UINT8* pRedPixel, UINT8* pGreenPixel, UINT8* pBluePixel);
+
+/// <summary>
+/// Copies a color frame buffer into a 4-channel image
+/// </summary>
+/// <param name="pBuffer">pointer to the frame, 4 bytes per pixel</param>
+/// <param name="pitch">bytes from one row of the frame to the next</param>
+/// <param name="pImage">pointer to CV_8UC4 Mat in which to return the image</param>
+/// <returns>S_OK if successful, an error code otherwise</returns>
+HRESULT ConvertColorFrame(const BYTE* pBuffer, int pitch, Mat* pImage);
+
+/// <summary>
+/// Copies a raw depth frame buffer into a 16-bit depth Mat, keeping the player index in the low bits
+/// </summary>
+/// <param name="pBuffer">pointer to the frame, 2 bytes per pixel</param>
+/// <param name="pitch">bytes from one row of the frame to the next</param>
+/// <param name="pImage">pointer to CV_16U Mat in which to return the depth</param>
+/// <returns>S_OK if successful, an error code otherwise</returns>
+HRESULT ConvertDepthFrame(const BYTE* pBuffer, int pitch, Mat* pImage);
+
+/// <summary>
+/// Colorizes a raw depth frame buffer straight into a 4-channel image
+/// </summary>
+/// <param name="pBuffer">pointer to the frame, 2 bytes per pixel</param>
+/// <param name="pitch">bytes from one row of the frame to the next</param>
+/// <param name="pImage">pointer to CV_8UC4 Mat in which to return the image</param>
+/// <returns>S_OK if successful, an error code otherwise</returns>
+HRESULT ConvertDepthFrameToArgb(const BYTE* pBuffer, int pitch, Mat* pImage);
+
+/// <summary>
+/// Colorizes a raw depth Mat
+/// </summary>
+/// <param name="pRawDepth">pointer to the raw CV_16U depth frame</param>
+/// <param name="pImage">pointer to CV_8UC4 Mat of the same size in which to return the image</param>
+/// <returns>S_OK if successful, an error code otherwise</returns>
+HRESULT ColorizeRawDepth(const Mat* pRawDepth, Mat* pImage);
+
+/// <summary>
+/// Colorizes a depth plane in millimeters, taking the player index from the raw frame it was filtered from
+/// </summary>
+/// <param name="pDepth">pointer to CV_16U depth in millimeters</param>
+/// <param name="pRawDepth">pointer to the raw CV_16U depth frame, of the same size</param>
+/// <param name="pImage">pointer to CV_8UC4 Mat of the same size in which to return the image</param>
+/// <returns>S_OK if successful, an error code otherwise</returns>
+HRESULT ColorizeFilteredDepth(const Mat* pDepth, const Mat* pRawDepth, Mat* pImage);
@@ -6,13 +6,20 @@
 
 #include "FrameRateTracker.h"
 
+// Nanoseconds between updates of the frame rate
+static const LONGLONG FPS_UPDATE_INTERVAL = 1000000000;
+
+// Jitter moves 1/16 of the way to each new interval difference, as in RFC 3550
+static const LONG JITTER_SMOOTHING = 16;
+
 // Functions:
 /// <summary>
 /// Constructor
 /// </summary>
-FrameRateTracker::FrameRateTracker(): m_frameCount(0), m_previousFrameCount(0), m_fps(0)
+FrameRateTracker::FrameRateTracker(): m_previousInterval(0), m_frameCount(0), m_previousFrameCount(0), m_fps(0), m_jitterNanoseconds(0)
 {
-    m_previousClock = clock();
+    m_previousTime = GetMonotonicNanoseconds();
+    m_previousFrameTime = m_previousTime;
 }
 
 /// <summary>
@@ -20,17 +27,37 @@ FrameRateTracker::FrameRateTracker(): m_frameCount(0), m_previousFrameCount(0),
 /// about how long it took to render the current frame.
 /// </summary>
 void FrameRateTracker::Tick() {
-    m_frameCount++;
+    LONGLONG currentTime = GetMonotonicNanoseconds();
+
+    // The first frame has no interval before it
+    if (m_frameCount > 0)
+    {
+        LONGLONG interval = currentTime - m_previousFrameTime;
+        m_intervals.Record(interval);
+
+        if (m_previousInterval > 0)
+        {
+            LONGLONG difference = interval - m_previousInterval;
+            if (difference < 0)
+            {
+                difference = -difference;
+            }
 
-    // Calculate how long it took to render the current frame
-    clock_t currentClock = clock();
-    clock_t milliseconds = (currentClock - m_previousClock) / (CLOCKS_PER_SEC / 1000);
+            // Differences beyond what a LONG holds are seconds long stalls; count them as the largest
+            LONG clamped = (difference > 0x7FFFFFFF) ? 0x7FFFFFFF : static_cast<LONG>(difference);
+            m_jitterNanoseconds = m_jitterNanoseconds + (clamped - m_jitterNanoseconds) / JITTER_SMOOTHING;
+        }
+        m_previousInterval = interval;
+    }
+    m_previousFrameTime = currentTime;
+    m_frameCount++;
 
     // Update the frame rate every 1 second
-    if (milliseconds >= 1000)
+    LONGLONG elapsed = currentTime - m_previousTime;
+    if (elapsed >= FPS_UPDATE_INTERVAL)
     {
-        m_fps = (UINT)((double)(m_frameCount - m_previousFrameCount) * 1000 / milliseconds);
-        m_previousClock = currentClock;
+        m_fps = static_cast<LONG>((double)(m_frameCount - m_previousFrameCount) * FPS_UPDATE_INTERVAL / elapsed + 0.5);
+        m_previousTime = currentTime;
         m_previousFrameCount = m_frameCount;
     }
 }
@@ -42,3 +69,19 @@ void FrameRateTracker::Tick() {
 const int FrameRateTracker::CurrentFPS() {
     return m_fps;
 }
+
+/// <summary>
+/// Gets percentiles of the intervals between frames so far
+/// </summary>
+/// <param name="pSummary">pointer in which to return the summary, in nanoseconds</param>
+void FrameRateTracker::GetIntervalSummary(LatencySummary* pSummary) const {
+    m_intervals.GetSummary(pSummary);
+}
+
+/// <summary>
+/// Gets the jitter of the stream: the smoothed difference between consecutive frame intervals, as in RFC 3550
+/// </summary>
+/// <returns>jitter in milliseconds</returns>
+double FrameRateTracker::GetJitterMilliseconds() const {
+    return m_jitterNanoseconds / 1e6;
+}
@@ -6,10 +6,13 @@
 
 #pragma once
 
-#include <ctime>
-#include <algorithm>
-#include <windows.h>
+#include "Platform.h"
+#include "LatencyHistogram.h"
 
+/// <summary>
+/// Tracks the frame rate of a stream, and the distribution and jitter of the intervals between its
+/// frames, with a monotonic nanosecond clock. One thread ticks; any thread can read the results.
+/// </summary>
 class FrameRateTracker {
 public:
     // Functions:
@@ -29,10 +32,26 @@ public:
     /// <returns>The current frame rate</returns>
     const int CurrentFPS();
 
+    /// <summary>
+    /// Gets percentiles of the intervals between frames so far
+    /// </summary>
+    /// <param name="pSummary">pointer in which to return the summary, in nanoseconds</param>
+    void GetIntervalSummary(LatencySummary* pSummary) const;
+
+    /// <summary>
+    /// Gets the jitter of the stream: the smoothed difference between consecutive frame intervals, as in RFC 3550
+    /// </summary>
+    /// <returns>jitter in milliseconds</returns>
+    double GetJitterMilliseconds() const;
+
 private:
     // Variables
-    // The clock tick from the last time the fps was calculated
-    clock_t m_previousClock;
+    // The time from the last time the fps was calculated, and of the latest frame, in nanoseconds
+    LONGLONG m_previousTime;
+    LONGLONG m_previousFrameTime;
+
+    // Interval before the latest frame in nanoseconds, 0 until there were two frames
+    LONGLONG m_previousInterval;
 
     // The current frame count
     DWORD m_frameCount;
@@ -41,5 +60,11 @@ private:
     DWORD m_previousFrameCount;
 
     // The current frame rate
-    int m_fps;
-};
\ No newline at end of file
+    volatile LONG m_fps;
+
+    // Smoothed difference between consecutive intervals in nanoseconds
+    volatile LONG m_jitterNanoseconds;
+
+    // Intervals between frames
+    LatencyHistogram m_intervals;
+};
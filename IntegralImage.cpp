@@ -0,0 +1,212 @@
+//-----------------------------------------------------------------------------
+// <copyright file="IntegralImage.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation. All rights reserved.
+// </copyright>
+//-----------------------------------------------------------------------------
+
+#include "IntegralImage.h"
+
+using namespace cv;
+
+/// <summary>
+/// Accumulates the table one row at a time from the row above
+/// </summary>
+/// <param name="src">image to sum</param>
+/// <param name="sums">table of (rows + 1) x (cols + 1) doubles, with the first row and column 0</param>
+template <typename Pixel>
+static void AccumulateSums(const Mat& src, Mat& sums)
+{
+    for (int y = 0; y < src.rows; ++y)
+    {
+        const Pixel* pSrcRow = src.ptr<Pixel>(y);
+        const double* pAboveRow = sums.ptr<double>(y);
+        double* pSumRow = sums.ptr<double>(y + 1);
+
+        double rowSum = 0.0;
+        for (int x = 0; x < src.cols; ++x)
+        {
+            rowSum += pSrcRow[x];
+            pSumRow[x + 1] = pAboveRow[x + 1] + rowSum;
+        }
+    }
+}
+
+/// <summary>
+/// Writes the box means of one image type
+/// </summary>
+/// <param name="sums">table to read</param>
+/// <param name="radius">half width of the box in pixels</param>
+/// <param name="dst">Mat of the source size in which to write the means</param>
+template <typename Pixel>
+static void WriteBoxMeans(const Mat& sums, int radius, Mat& dst)
+{
+    for (int y = 0; y < dst.rows; ++y)
+    {
+        int top = max(0, y - radius);
+        int bottom = min(dst.rows, y + radius + 1);
+        const double* pTopRow = sums.ptr<double>(top);
+        const double* pBottomRow = sums.ptr<double>(bottom);
+        Pixel* pDstRow = dst.ptr<Pixel>(y);
+
+        for (int x = 0; x < dst.cols; ++x)
+        {
+            int left = max(0, x - radius);
+            int right = min(dst.cols, x + radius + 1);
+            double sum = pBottomRow[right] - pBottomRow[left] - pTopRow[right] + pTopRow[left];
+            pDstRow[x] = saturate_cast<Pixel>(sum / ((bottom - top) * (right - left)));
+        }
+    }
+}
+
+/// <summary>
+/// Constructor
+/// </summary>
+IntegralImage::IntegralImage() :
+    m_sourceType(CV_8UC1),
+    m_isValid(false)
+{
+}
+
+/// <summary>
+/// Computes the table for the given image, reusing the buffer if the size is unchanged
+/// </summary>
+/// <param name="pSrc">pointer to 8-bit or 16-bit single channel Mat</param>
+/// <returns>S_OK if successful, an error code otherwise</returns>
+HRESULT IntegralImage::Compute(const Mat* pSrc)
+{
+    // Fail if pointer is invalid
+    if (!pSrc)
+    {
+        return E_POINTER;
+    }
+
+    // Fail if Mat contains no data or is not a supported type
+    if (pSrc->empty() || (pSrc->type() != CV_8UC1 && pSrc->type() != CV_16UC1))
+    {
+        return E_INVALIDARG;
+    }
+
+    // OpenCV's integral has no 16-bit input, so the table is accumulated here for both types
+    if (m_sums.rows != pSrc->rows + 1 || m_sums.cols != pSrc->cols + 1)
+    {
+        m_sums.create(pSrc->rows + 1, pSrc->cols + 1, CV_64FC1);
+        m_sums.setTo(Scalar(0));
+    }
+
+    if (pSrc->type() == CV_8UC1)
+    {
+        AccumulateSums<BYTE>(*pSrc, m_sums);
+    }
+    else
+    {
+        AccumulateSums<USHORT>(*pSrc, m_sums);
+    }
+
+    m_sourceType = pSrc->type();
+    m_isValid = true;
+
+    return S_OK;
+}
+
+/// <summary>
+/// Marks the table as out of date without releasing its buffer
+/// </summary>
+void IntegralImage::Invalidate()
+{
+    m_isValid = false;
+}
+
+/// <summary>
+/// Gets whether the table matches the image it was last computed for
+/// </summary>
+/// <returns>true if Compute succeeded since the last Invalidate</returns>
+bool IntegralImage::IsValid() const
+{
+    return m_isValid;
+}
+
+/// <summary>
+/// Gets the size of the image the table was computed for
+/// </summary>
+/// <returns>image size</returns>
+Size IntegralImage::GetSize() const
+{
+    return m_sums.empty() ? Size() : Size(m_sums.cols - 1, m_sums.rows - 1);
+}
+
+/// <summary>
+/// Sums the pixels inside the given rectangle, clipped to the image
+/// </summary>
+/// <param name="region">rectangle in image pixel coordinates</param>
+/// <returns>sum of the pixels, or 0 if the table is not valid or the rectangle is outside the image</returns>
+double IntegralImage::GetSum(Rect region) const
+{
+    if (!m_isValid)
+    {
+        return 0.0;
+    }
+
+    Size size = GetSize();
+    region = region & Rect(0, 0, size.width, size.height);
+    if (region.area() == 0)
+    {
+        return 0.0;
+    }
+
+    const double* pTopRow = m_sums.ptr<double>(region.y);
+    const double* pBottomRow = m_sums.ptr<double>(region.y + region.height);
+    int right = region.x + region.width;
+
+    return pBottomRow[right] - pBottomRow[region.x] - pTopRow[right] + pTopRow[region.x];
+}
+
+/// <summary>
+/// Averages the pixels inside the given rectangle, clipped to the image
+/// </summary>
+/// <param name="region">rectangle in image pixel coordinates</param>
+/// <returns>mean of the pixels, or 0 if the table is not valid or the rectangle is outside the image</returns>
+double IntegralImage::GetMean(Rect region) const
+{
+    Size size = GetSize();
+    region = region & Rect(0, 0, size.width, size.height);
+    if (!m_isValid || region.area() == 0)
+    {
+        return 0.0;
+    }
+
+    return GetSum(region) / region.area();
+}
+
+/// <summary>
+/// Replaces every pixel with the mean of the (2 * radius + 1) square around it. Near the border
+/// the square is clipped to the image, so the border does not darken.
+/// </summary>
+/// <param name="radius">half width of the square in pixels</param>
+/// <param name="pDst">pointer in which to return a Mat of the source size and type</param>
+/// <returns>S_OK if successful, an error code otherwise</returns>
+HRESULT IntegralImage::BoxFilter(int radius, Mat* pDst) const
+{
+    // Fail if pointer is invalid
+    if (!pDst)
+    {
+        return E_POINTER;
+    }
+
+    // Fail if there is nothing to filter
+    if (!m_isValid || radius < 0)
+    {
+        return E_INVALIDARG;
+    }
+
+    pDst->create(GetSize(), m_sourceType);
+    if (m_sourceType == CV_8UC1)
+    {
+        WriteBoxMeans<BYTE>(m_sums, radius, *pDst);
+    }
+    else
+    {
+        WriteBoxMeans<USHORT>(m_sums, radius, *pDst);
+    }
+
+    return S_OK;
+}
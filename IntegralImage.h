@@ -0,0 +1,88 @@
+//-----------------------------------------------------------------------------
+// <copyright file="IntegralImage.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation. All rights reserved.
+// </copyright>
+//-----------------------------------------------------------------------------
+
+#pragma once
+
+#include "Platform.h"
+
+// Suppress warnings that come from compiling OpenCV code since we have no control over it
+#pragma warning(push)
+#pragma warning(disable : 6294 6031)
+#include <opencv2/core/core.hpp>
+#pragma warning(pop)
+
+using namespace cv;
+
+/// <summary>
+/// Summed-area table of a single channel image. Once computed, the sum over any rectangle takes
+/// four lookups and a box filter costs the same per pixel whatever its radius.
+/// </summary>
+class IntegralImage
+{
+public:
+    // Functions:
+    /// <summary>
+    /// Constructor
+    /// </summary>
+    IntegralImage();
+
+    /// <summary>
+    /// Computes the table for the given image, reusing the buffer if the size is unchanged
+    /// </summary>
+    /// <param name="pSrc">pointer to 8-bit or 16-bit single channel Mat</param>
+    /// <returns>S_OK if successful, an error code otherwise</returns>
+    HRESULT Compute(const Mat* pSrc);
+
+    /// <summary>
+    /// Marks the table as out of date without releasing its buffer
+    /// </summary>
+    void Invalidate();
+
+    /// <summary>
+    /// Gets whether the table matches the image it was last computed for
+    /// </summary>
+    /// <returns>true if Compute succeeded since the last Invalidate</returns>
+    bool IsValid() const;
+
+    /// <summary>
+    /// Gets the size of the image the table was computed for
+    /// </summary>
+    /// <returns>image size</returns>
+    Size GetSize() const;
+
+    /// <summary>
+    /// Sums the pixels inside the given rectangle, clipped to the image
+    /// </summary>
+    /// <param name="region">rectangle in image pixel coordinates</param>
+    /// <returns>sum of the pixels, or 0 if the table is not valid or the rectangle is outside the image</returns>
+    double GetSum(Rect region) const;
+
+    /// <summary>
+    /// Averages the pixels inside the given rectangle, clipped to the image
+    /// </summary>
+    /// <param name="region">rectangle in image pixel coordinates</param>
+    /// <returns>mean of the pixels, or 0 if the table is not valid or the rectangle is outside the image</returns>
+    double GetMean(Rect region) const;
+
+    /// <summary>
+    /// Replaces every pixel with the mean of the (2 * radius + 1) square around it. Near the border
+    /// the square is clipped to the image, so the border does not darken.
+    /// </summary>
+    /// <param name="radius">half width of the square in pixels</param>
+    /// <param name="pDst">pointer in which to return a Mat of the source size and type</param>
+    /// <returns>S_OK if successful, an error code otherwise</returns>
+    HRESULT BoxFilter(int radius, Mat* pDst) const;
+
+private:
+    // Variables:
+    // (rows + 1) x (cols + 1) sums; doubles hold any 16-bit frame exactly, where 32-bit integers could overflow
+    Mat m_sums;
+
+    // Type of the image the table was computed for
+    int m_sourceType;
+
+    bool m_isValid;
+};
@@ -0,0 +1,694 @@
+//-----------------------------------------------------------------------------
+// <copyright file="KernelBenchmark.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation. All rights reserved.
+// </copyright>
+//-----------------------------------------------------------------------------
+
+#include "KernelBenchmark.h"
+#include <fstream>
+#include <vector>
+
+#include "DepthCodec.h"
+#include "DepthRecording.h"
+#include "FilterChain.h"
+#include "FrameConversion.h"
+#include "Overlay.h"
+#include "SkeletonProjector.h"
+
+#ifdef _WIN32
+#include <NuiApi.h>
+#endif
+
+using namespace cv;
+
+// Runs that size the scratch buffers and warm the caches before timing starts
+static const int WARMUP_ITERATIONS = 5;
+
+// Each kernel is timed for at least this many runs and this long, so that small frames are not
+// timed by a handful of clock ticks, and for at most this many runs
+static const int MIN_TIMED_ITERATIONS = 20;
+static const double MIN_TIMED_SECONDS = 0.25;
+static const int MAX_TIMED_ITERATIONS = 10000;
+
+// Different frames the runs go through, so that a kernel is not timed on one frame left in the cache
+static const int SYNTHETIC_FRAME_COUNT = 4;
+static const int RECORDED_FRAME_COUNT = 30;
+
+// Skeletons in a frame, of which the first are tracked and the next only have a position
+static const int SKELETON_COUNT = 6;
+static const int TRACKED_SKELETON_COUNT = 2;
+static const int POSITION_ONLY_SKELETON_COUNT = 2;
+
+// Resolutions each stream supports, as NUI_IMAGE_RESOLUTION_640x480 and up for color and
+// NUI_IMAGE_RESOLUTION_80x60 and up for depth
+static const Size COLOR_SIZES[] = {Size(640, 480), Size(1280, 960)};
+static const Size DEPTH_SIZES[] = {Size(80, 60), Size(320, 240), Size(640, 480)};
+
+/// <summary>
+/// Filter to benchmark and the name written to the report
+/// </summary>
+struct BenchmarkFilter
+{
+    FilterMode mode;
+    const char* name;
+};
+
+static const BenchmarkFilter FILTERS[] =
+{
+    {FILTER_MODE_NONE, "none"},
+    {FILTER_MODE_GAUSSIAN_BLUR, "gaussian"},
+    {FILTER_MODE_DILATE, "dilate"},
+    {FILTER_MODE_ERODE, "erode"},
+    {FILTER_MODE_CANNY_EDGE, "canny"}
+};
+
+/// <summary>
+/// Work that is timed one run at a time, each run on one input frame
+/// </summary>
+class BenchmarkKernel
+{
+public:
+    /// <summary>
+    /// Destructor
+    /// </summary>
+    virtual ~BenchmarkKernel() {}
+
+    /// <summary>
+    /// Sets up the input of the next run from a frame; this is not timed
+    /// </summary>
+    /// <param name="pFrame">pointer to the frame</param>
+    virtual void Prepare(const Mat* pFrame) = 0;
+
+    /// <summary>
+    /// Runs the kernel once on the prepared input
+    /// </summary>
+    virtual void Run() = 0;
+};
+
+/// <summary>
+/// GetColorData: copies a color frame buffer into an image
+/// </summary>
+class ColorDataKernel : public BenchmarkKernel
+{
+public:
+    virtual void Prepare(const Mat* pFrame)
+    {
+        m_pFrame = pFrame;
+        m_image.create(pFrame->size(), CV_8UC4);
+    }
+
+    virtual void Run()
+    {
+        ConvertColorFrame(m_pFrame->ptr(0), static_cast<int>(m_pFrame->step), &m_image);
+    }
+
+private:
+    const Mat* m_pFrame;
+    Mat m_image;
+};
+
+/// <summary>
+/// GetDepthData: copies a raw depth frame buffer into a depth Mat
+/// </summary>
+class DepthDataKernel : public BenchmarkKernel
+{
+public:
+    virtual void Prepare(const Mat* pFrame)
+    {
+        m_pFrame = pFrame;
+        m_depth.create(pFrame->size(), CV_16U);
+    }
+
+    virtual void Run()
+    {
+        ConvertDepthFrame(m_pFrame->ptr(0), static_cast<int>(m_pFrame->step), &m_depth);
+    }
+
+private:
+    const Mat* m_pFrame;
+    Mat m_depth;
+};
+
+/// <summary>
+/// GetDepthDataAsArgb: colorizes a raw depth frame buffer
+/// </summary>
+class DepthDataAsArgbKernel : public BenchmarkKernel
+{
+public:
+    virtual void Prepare(const Mat* pFrame)
+    {
+        m_pFrame = pFrame;
+        m_image.create(pFrame->size(), CV_8UC4);
+    }
+
+    virtual void Run()
+    {
+        ConvertDepthFrameToArgb(m_pFrame->ptr(0), static_cast<int>(m_pFrame->step), &m_image);
+    }
+
+private:
+    const Mat* m_pFrame;
+    Mat m_image;
+};
+
+/// <summary>
+/// DepthShortToRgb on every pixel of a raw depth frame, without storing the colors
+/// </summary>
+class DepthShortToRgbKernel : public BenchmarkKernel
+{
+public:
+    DepthShortToRgbKernel() : m_checksum(0) {}
+
+    virtual void Prepare(const Mat* pFrame)
+    {
+        m_pFrame = pFrame;
+    }
+
+    virtual void Run()
+    {
+        // The colors are summed so that the conversion cannot be left out
+        UINT sum = 0;
+        for (int y = 0; y < m_pFrame->rows; ++y)
+        {
+            const USHORT* pRow = m_pFrame->ptr<USHORT>(y);
+            for (int x = 0; x < m_pFrame->cols; ++x)
+            {
+                UINT8 redPixel, greenPixel, bluePixel;
+                DepthShortToRgb(pRow[x], &redPixel, &greenPixel, &bluePixel);
+                sum += redPixel + greenPixel + bluePixel;
+            }
+        }
+
+        m_checksum += sum;
+    }
+
+private:
+    const Mat* m_pFrame;
+    UINT m_checksum;
+};
+
+/// <summary>
+/// DepthEncoder::Encode: compresses a raw depth frame as the recorder does
+/// </summary>
+class DepthEncodeKernel : public BenchmarkKernel
+{
+public:
+    virtual void Prepare(const Mat* pFrame)
+    {
+        m_pFrame = pFrame;
+    }
+
+    virtual void Run()
+    {
+        const BYTE* pData;
+        size_t length;
+        m_encoder.Encode(m_pFrame, &pData, &length);
+    }
+
+private:
+    const Mat* m_pFrame;
+    DepthEncoder m_encoder;
+};
+
+/// <summary>
+/// DepthDecoder::Decode: decompresses a raw depth frame as replay does
+/// </summary>
+class DepthDecodeKernel : public BenchmarkKernel
+{
+public:
+    virtual void Prepare(const Mat* pFrame)
+    {
+        const BYTE* pData;
+        size_t length;
+        if (SUCCEEDED(m_encoder.Encode(pFrame, &pData, &length)))
+        {
+            m_encoded.assign(pData, pData + length);
+        }
+    }
+
+    virtual void Run()
+    {
+        m_decoder.Decode(&m_encoded[0], m_encoded.size(), &m_depth);
+    }
+
+private:
+    DepthEncoder m_encoder;
+    DepthDecoder m_decoder;
+    std::vector<BYTE> m_encoded;
+    Mat m_depth;
+};
+
+/// <summary>
+/// GetRawDepthImageAsArgb: colorizes a raw depth Mat
+/// </summary>
+class RawDepthImageAsArgbKernel : public BenchmarkKernel
+{
+public:
+    virtual void Prepare(const Mat* pFrame)
+    {
+        m_pFrame = pFrame;
+        m_image.create(pFrame->size(), CV_8UC4);
+    }
+
+    virtual void Run()
+    {
+        ColorizeRawDepth(m_pFrame, &m_image);
+    }
+
+private:
+    const Mat* m_pFrame;
+    Mat m_image;
+};
+
+/// <summary>
+/// GetFilteredDepthImageAsArgb: colorizes depth in millimeters with the player index of the raw frame
+/// </summary>
+class FilteredDepthImageAsArgbKernel : public BenchmarkKernel
+{
+public:
+    virtual void Prepare(const Mat* pFrame)
+    {
+        m_pFrame = pFrame;
+        m_image.create(pFrame->size(), CV_8UC4);
+
+        // Millimeters as the detection pipeline leaves them, here unfiltered
+        m_depth.create(pFrame->size(), CV_16U);
+        for (int y = 0; y < pFrame->rows; ++y)
+        {
+            const USHORT* pRawRow = pFrame->ptr<USHORT>(y);
+            USHORT* pDepthRow = m_depth.ptr<USHORT>(y);
+            for (int x = 0; x < pFrame->cols; ++x)
+            {
+                pDepthRow[x] = pRawRow[x] >> NUI_IMAGE_PLAYER_INDEX_SHIFT;
+            }
+        }
+    }
+
+    virtual void Run()
+    {
+        ColorizeFilteredDepth(&m_depth, m_pFrame, &m_image);
+    }
+
+private:
+    const Mat* m_pFrame;
+    Mat m_depth;
+    Mat m_image;
+};
+
+/// <summary>
+/// ApplyColorFilter and ApplyDepthFilter: runs one filter chain on a color image or colorized depth image
+/// </summary>
+class FilterKernel : public BenchmarkKernel
+{
+public:
+    FilterKernel(FilterMode mode, bool isColor) : m_isColor(isColor)
+    {
+        m_chain.Build(mode, isColor);
+    }
+
+    virtual void Prepare(const Mat* pFrame)
+    {
+        // Filters work in place, so every run starts from a fresh copy of the input
+        if (m_isColor)
+        {
+            pFrame->copyTo(m_image);
+        }
+        else
+        {
+            m_image.create(pFrame->size(), CV_8UC4);
+            ColorizeRawDepth(pFrame, &m_image);
+        }
+    }
+
+    virtual void Run()
+    {
+        m_chain.Apply(&m_image);
+    }
+
+private:
+    bool m_isColor;
+    FilterChain m_chain;
+    Mat m_image;
+};
+
+/// <summary>
+/// Skeleton drawing: projects the joints of a skeleton frame, adds the skeletons to an overlay and
+/// rasterizes it, as the skeleton drawing and the bitmap update of the application do
+/// </summary>
+class SkeletonKernel : public BenchmarkKernel
+{
+public:
+    SkeletonKernel(bool isColor) : m_isColor(isColor)
+    {
+        // Joints spread over the field of view at the distances players stand at; tracked skeletons
+        // have every joint, with some of them inferred, and the others only have a position
+        RNG rng(0x5eed);
+        m_count = 0;
+        for (int i = 0; i < TRACKED_SKELETON_COUNT + POSITION_ONLY_SKELETON_COUNT; ++i)
+        {
+            int jointCount = (i < TRACKED_SKELETON_COUNT) ? SKELETON_JOINT_COUNT : 1;
+            for (int j = 0; j < jointCount; ++j)
+            {
+                SkeletonPoint& point = m_points[m_count++];
+                point.z = rng.uniform(0.8f, 4.0f);
+                point.x = rng.uniform(-0.5f, 0.5f) * point.z;
+                point.y = rng.uniform(-0.4f, 0.4f) * point.z;
+                point.w = 1.0f;
+            }
+        }
+
+        for (int j = 0; j < SKELETON_JOINT_COUNT; ++j)
+        {
+            m_states[j] = (rng.uniform(0, 8) == 0) ? SKELETON_JOINT_INFERRED : SKELETON_JOINT_TRACKED;
+        }
+    }
+
+    virtual void Prepare(const Mat* pFrame)
+    {
+        m_image.create(pFrame->size(), CV_8UC4);
+    }
+
+    virtual void Run()
+    {
+        if (m_isColor)
+        {
+            m_projector.ProjectToColor(m_points, m_count, m_image.cols, m_image.rows, m_x, m_y);
+        }
+        else
+        {
+            m_projector.ProjectToDepth(m_points, m_count, m_image.cols, m_image.rows, m_x, m_y);
+        }
+
+        m_overlay.Clear(m_image.size());
+        for (int i = 0; i < TRACKED_SKELETON_COUNT + POSITION_ONLY_SKELETON_COUNT; ++i)
+        {
+            Scalar color(255, 64 * i, 0);
+            if (i < TRACKED_SKELETON_COUNT)
+            {
+                Point joints[SKELETON_JOINT_COUNT];
+                for (int j = 0; j < SKELETON_JOINT_COUNT; ++j)
+                {
+                    int point = i * SKELETON_JOINT_COUNT + j;
+                    joints[j] = Point(m_x[point], m_y[point]);
+                }
+                m_overlay.AddSkeleton(joints, m_states, color);
+            }
+            else
+            {
+                int point = TRACKED_SKELETON_COUNT * SKELETON_JOINT_COUNT + i - TRACKED_SKELETON_COUNT;
+                m_overlay.AddCircle(Point(m_x[point], m_y[point]), 7, color, CV_FILLED);
+            }
+        }
+
+        m_overlay.Render(&m_image);
+    }
+
+    /// <summary>
+    /// Gets the size of the joints projected per run
+    /// </summary>
+    /// <returns>size in bytes</returns>
+    int GetJointBytes() const
+    {
+        return m_count * static_cast<int>(sizeof(SkeletonPoint));
+    }
+
+private:
+    bool m_isColor;
+    SkeletonProjector m_projector;
+    Overlay m_overlay;
+    Mat m_image;
+
+    SkeletonPoint m_points[SKELETON_COUNT * SKELETON_JOINT_COUNT];
+    SkeletonJointState m_states[SKELETON_JOINT_COUNT];
+    int m_x[SKELETON_COUNT * SKELETON_JOINT_COUNT];
+    int m_y[SKELETON_COUNT * SKELETON_JOINT_COUNT];
+    int m_count;
+};
+
+/// <summary>
+/// Times one kernel on a set of frames of one size and appends a line to the report
+/// </summary>
+/// <param name="report">stream receiving the CSV line</param>
+/// <param name="kernelName">name of the kernel</param>
+/// <param name="variant">filter or target of the kernel, or an empty string</param>
+/// <param name="inputName">kind of frames the kernel runs on</param>
+/// <param name="pKernel">pointer to the kernel to time</param>
+/// <param name="frames">frames the runs take in turn</param>
+/// <param name="bytesPerRun">bytes the kernel reads and writes in one run</param>
+static void TimeKernel(std::ofstream& report, const char* kernelName, const char* variant, const char* inputName,
+                       BenchmarkKernel* pKernel, const std::vector<Mat>& frames, double bytesPerRun)
+{
+    double totalSeconds = 0.0;
+    double minSeconds = 0.0;
+    int64 totalCpuTicks = 0;
+    int timedCount = 0;
+
+    for (int i = 0; i < WARMUP_ITERATIONS + MAX_TIMED_ITERATIONS; ++i)
+    {
+        pKernel->Prepare(&frames[i % frames.size()]);
+
+        // The CPU tick counter is the time stamp counter on x86, which counts at the nominal clock rate
+        int64 startCpuTicks = getCPUTickCount();
+        int64 start = getTickCount();
+        pKernel->Run();
+        double seconds = static_cast<double>(getTickCount() - start) / getTickFrequency();
+        int64 cpuTicks = getCPUTickCount() - startCpuTicks;
+
+        if (i < WARMUP_ITERATIONS)
+        {
+            continue;
+        }
+
+        totalSeconds += seconds;
+        totalCpuTicks += cpuTicks;
+        if (timedCount == 0 || seconds < minSeconds)
+        {
+            minSeconds = seconds;
+        }
+
+        ++timedCount;
+        if (timedCount >= MIN_TIMED_ITERATIONS && totalSeconds >= MIN_TIMED_SECONDS)
+        {
+            break;
+        }
+    }
+
+    Size size = frames[0].size();
+    double meanSeconds = totalSeconds / timedCount;
+    double bytesPerCycle = (totalCpuTicks > 0) ? bytesPerRun * timedCount / totalCpuTicks : 0.0;
+
+    report << kernelName << ',' << variant << ',' << size.width << 'x' << size.height << ',' << inputName << ','
+        << 1000.0 * meanSeconds << ',' << 1000.0 * minSeconds << ',' << 1e9 * meanSeconds / size.area() << ','
+        << bytesPerCycle << '\n';
+}
+
+/// <summary>
+/// Times the color kernels on color frames of one size
+/// </summary>
+/// <param name="report">stream receiving the CSV lines</param>
+/// <param name="inputName">kind of frames</param>
+/// <param name="frames">CV_8UC4 color frames</param>
+static void TimeColorKernels(std::ofstream& report, const char* inputName, const std::vector<Mat>& frames)
+{
+    double pixels = frames[0].size().area();
+
+    ColorDataKernel colorData;
+    TimeKernel(report, "GetColorData", "", inputName, &colorData, frames, 8 * pixels);
+
+    for (size_t f = 0; f < sizeof(FILTERS) / sizeof(FILTERS[0]); ++f)
+    {
+        FilterKernel filter(FILTERS[f].mode, true);
+        TimeKernel(report, "ApplyColorFilter", FILTERS[f].name, inputName, &filter, frames, 8 * pixels);
+    }
+}
+
+/// <summary>
+/// Times the depth kernels on raw depth frames of one size
+/// </summary>
+/// <param name="report">stream receiving the CSV lines</param>
+/// <param name="inputName">kind of frames</param>
+/// <param name="frames">raw CV_16U depth frames</param>
+static void TimeDepthKernels(std::ofstream& report, const char* inputName, const std::vector<Mat>& frames)
+{
+    double pixels = frames[0].size().area();
+
+    DepthDataKernel depthData;
+    TimeKernel(report, "GetDepthData", "", inputName, &depthData, frames, 4 * pixels);
+
+    DepthDataAsArgbKernel depthDataAsArgb;
+    TimeKernel(report, "GetDepthDataAsArgb", "", inputName, &depthDataAsArgb, frames, 6 * pixels);
+
+    DepthShortToRgbKernel depthShortToRgb;
+    TimeKernel(report, "DepthShortToRgb", "", inputName, &depthShortToRgb, frames, 2 * pixels);
+
+    RawDepthImageAsArgbKernel rawDepthImageAsArgb;
+    TimeKernel(report, "GetRawDepthImageAsArgb", "", inputName, &rawDepthImageAsArgb, frames, 6 * pixels);
+
+    FilteredDepthImageAsArgbKernel filteredDepthImageAsArgb;
+    TimeKernel(report, "GetFilteredDepthImageAsArgb", "", inputName, &filteredDepthImageAsArgb, frames, 8 * pixels);
+
+    // The codec's bytes are those of the raw frame, whatever the frame compresses to
+    DepthEncodeKernel depthEncode;
+    TimeKernel(report, "DepthEncode", "", inputName, &depthEncode, frames, 2 * pixels);
+
+    DepthDecodeKernel depthDecode;
+    TimeKernel(report, "DepthDecode", "", inputName, &depthDecode, frames, 2 * pixels);
+
+    for (size_t f = 0; f < sizeof(FILTERS) / sizeof(FILTERS[0]); ++f)
+    {
+        FilterKernel filter(FILTERS[f].mode, false);
+        TimeKernel(report, "ApplyDepthFilter", FILTERS[f].name, inputName, &filter, frames, 8 * pixels);
+    }
+}
+
+/// <summary>
+/// Makes color frames of random noise, which is the worst case for edge detection, so the timings are an upper bound
+/// </summary>
+/// <param name="size">size of the frames</param>
+/// <param name="pFrames">pointer in which to return the CV_8UC4 frames</param>
+static void MakeSyntheticColorFrames(Size size, std::vector<Mat>* pFrames)
+{
+    pFrames->clear();
+    for (int i = 0; i < SYNTHETIC_FRAME_COUNT; ++i)
+    {
+        Mat frame(size, CV_8UC4);
+        randu(frame, Scalar::all(0), Scalar::all(256));
+        pFrames->push_back(frame);
+    }
+}
+
+/// <summary>
+/// Makes raw depth frames of a sheet seen from the side, with a player standing on it and the odd pixel
+/// without a reading
+/// </summary>
+/// <param name="size">size of the frames</param>
+/// <param name="pFrames">pointer in which to return the raw CV_16U frames</param>
+static void MakeSyntheticDepthFrames(Size size, std::vector<Mat>* pFrames)
+{
+    pFrames->clear();
+    RNG rng(0x5eed);
+    for (int i = 0; i < SYNTHETIC_FRAME_COUNT; ++i)
+    {
+        Mat frame(size, CV_16U);
+        Rect player(size.width / 3 + i, size.height / 4, size.width / 6, size.height / 2);
+
+        for (int y = 0; y < size.height; ++y)
+        {
+            USHORT* pRow = frame.ptr<USHORT>(y);
+            for (int x = 0; x < size.width; ++x)
+            {
+                // The sheet comes closer towards the bottom of the image
+                int depth = 4000 - 3200 * y / size.height + rng.uniform(-10, 10);
+                USHORT playerIndex = 0;
+                if (player.contains(Point(x, y)))
+                {
+                    depth = 2000 + rng.uniform(-10, 10);
+                    playerIndex = 1;
+                }
+
+                pRow[x] = (rng.uniform(0, 20) == 0) ? 0 : static_cast<USHORT>((depth << NUI_IMAGE_PLAYER_INDEX_SHIFT) | playerIndex);
+            }
+        }
+
+        pFrames->push_back(frame);
+    }
+}
+
+/// <summary>
+/// Reads the first frames of a depth recording
+/// </summary>
+/// <param name="path">path of the recording</param>
+/// <param name="pFrames">pointer in which to return the raw CV_16U frames</param>
+/// <returns>S_OK if at least one frame was read, an error code otherwise</returns>
+static HRESULT ReadRecordedFrames(const char* path, std::vector<Mat>* pFrames)
+{
+    DepthRecordingReader reader;
+    HRESULT hr = reader.Open(path, false);
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+
+    Mat frame;
+    DWORD timestamp;
+    while (pFrames->size() < RECORDED_FRAME_COUNT && S_OK == reader.GetFrame(&frame, &timestamp))
+    {
+        pFrames->push_back(frame.clone());
+    }
+
+    return pFrames->empty() ? E_FAIL : S_OK;
+}
+
+/// <summary>
+/// Times every per-pixel kernel of the frame path: the conversions from Kinect frame buffers, the depth
+/// colorization and compression, every color and depth filter and skeleton drawing, at every resolution
+/// of their stream. Each kernel runs on synthetic frames, and the depth kernels also on the frames of a
+/// recording if one is given. The results are written as CSV with the time per pixel and the bytes moved
+/// per CPU tick.
+/// </summary>
+/// <param name="outputPath">path of the CSV file to write</param>
+/// <param name="recordingPath">path of a depth recording to also run the depth kernels on, or NULL</param>
+/// <returns>S_OK if successful, an error code otherwise</returns>
+HRESULT RunKernelBenchmark(const char* outputPath, const char* recordingPath)
+{
+    // Fail if pointer is invalid
+    if (!outputPath)
+    {
+        return E_POINTER;
+    }
+
+    std::vector<Mat> recordedFrames;
+    if (recordingPath)
+    {
+        HRESULT hr = ReadRecordedFrames(recordingPath, &recordedFrames);
+        if (FAILED(hr))
+        {
+            return hr;
+        }
+    }
+
+    std::ofstream report(outputPath);
+    if (!report.is_open())
+    {
+        return E_FAIL;
+    }
+
+    report << "kernel,variant,resolution,input,mean_ms,min_ms,ns_per_pixel,bytes_per_cycle\n";
+
+    std::vector<Mat> frames;
+    for (size_t r = 0; r < sizeof(COLOR_SIZES) / sizeof(COLOR_SIZES[0]); ++r)
+    {
+        MakeSyntheticColorFrames(COLOR_SIZES[r], &frames);
+        TimeColorKernels(report, "synthetic", frames);
+
+        // Skeleton drawing reads joints rather than pixels, so its bytes are those of the projected joints
+        SkeletonKernel skeleton(true);
+        TimeKernel(report, "DrawSkeletons", "color", "synthetic", &skeleton, frames, skeleton.GetJointBytes());
+    }
+
+    for (size_t r = 0; r < sizeof(DEPTH_SIZES) / sizeof(DEPTH_SIZES[0]); ++r)
+    {
+        MakeSyntheticDepthFrames(DEPTH_SIZES[r], &frames);
+        TimeDepthKernels(report, "synthetic", frames);
+
+        SkeletonKernel skeleton(false);
+        TimeKernel(report, "DrawSkeletons", "depth", "synthetic", &skeleton, frames, skeleton.GetJointBytes());
+
+        if (recordedFrames.empty())
+        {
+            continue;
+        }
+
+        // Nearest neighbor scaling keeps depths and player indices as they were recorded
+        frames.clear();
+        for (size_t i = 0; i < recordedFrames.size(); ++i)
+        {
+            Mat frame;
+            resize(recordedFrames[i], frame, DEPTH_SIZES[r], 0.0, 0.0, INTER_NEAREST);
+            frames.push_back(frame);
+        }
+        TimeDepthKernels(report, "recorded", frames);
+    }
+
+    return report.good() ? S_OK : E_FAIL;
+}
@@ -0,0 +1,21 @@
+//-----------------------------------------------------------------------------
+// <copyright file="KernelBenchmark.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation. All rights reserved.
+// </copyright>
+//-----------------------------------------------------------------------------
+
+#pragma once
+
+#include "Platform.h"
+
+/// <summary>
+/// Times every per-pixel kernel of the frame path: the conversions from Kinect frame buffers, the depth
+/// colorization and compression, every color and depth filter and skeleton drawing, at every resolution
+/// of their stream. Each kernel runs on synthetic frames, and the depth kernels also on the frames of a
+/// recording if one is given. The results are written as CSV with the time per pixel and the bytes moved
+/// per CPU tick.
+/// </summary>
+/// <param name="outputPath">path of the CSV file to write</param>
+/// <param name="recordingPath">path of a depth recording to also run the depth kernels on, or NULL</param>
+/// <returns>S_OK if successful, an error code otherwise</returns>
+HRESULT RunKernelBenchmark(const char* outputPath, const char* recordingPath);
@@ -11,6 +11,9 @@
 #include <stdlib.h>
 #include <algorithm>
 #include <iterator>
+#include "FrameConversion.h"
+#include "LatencyHistogram.h"
+#include "Trace.h"
 
 namespace Microsoft {
     namespace KinectBridge {
@@ -172,6 +175,14 @@ namespace Microsoft {
             /// <returns>S_OK if successful, an error code otherwise</returns>
             HRESULT GetDepthImage(Image* pDepthImage) const;
 
+            /// <summary>
+            /// Gets when the latest depth frame was taken by the sensor and when it arrived
+            /// </summary>
+            /// <param name="pSensorMilliseconds">pointer in which to return the timestamp the sensor gave the frame in milliseconds</param>
+            /// <param name="pArrivalTime">pointer in which to return the monotonic time in nanoseconds the frame was taken from the stream</param>
+            /// <returns>S_OK if successful, an error code otherwise</returns>
+            HRESULT GetDepthFrameTime(LONGLONG* pSensorMilliseconds, LONGLONG* pArrivalTime) const;
+
             /// <summary>
             /// Gets the skeleton frame
             /// </summary>
@@ -184,7 +195,7 @@ namespace Microsoft {
             /// </summary>
             /// <param name="pDepthArgbImage">pointer in which to return the image</param>
             /// <returns>S_OK if successful, an error code otherwise</returns>
-			HRESULT GetDepthImageAsArgb(Image* pDepthArgbImage, Image* pImagePrev, Image* pDelta1Image, Image* pDelta2Image);
+            HRESULT GetDepthImageAsArgb(Image* pDepthArgbImage) const;
 
         protected:
             // Functions:
@@ -207,7 +218,7 @@ namespace Microsoft {
             /// </summary>
             /// <param name="pImage">pointer in which to return the image data</param>
             /// <returns>S_OK if successful, an error code otherwise</returns>
-			virtual HRESULT GetDepthDataAsArgb(Image* pImage, Image* pImagePrev, Image* pDelta1Image, Image* pDelta2Image) = 0;
+            virtual HRESULT GetDepthDataAsArgb(Image* pImage) const = 0;
 
             /// <summary>
             /// Verify image is of the given resolution
@@ -235,6 +246,10 @@ namespace Microsoft {
             INT m_depthBufferSize;
             INT m_depthBufferPitch;
 
+            // Timestamp and arrival time of the depth frame in the buffer
+            LONGLONG m_depthSensorTime;
+            LONGLONG m_depthArrivalTime;
+
             // Image stream resolution information
             NUI_IMAGE_RESOLUTION m_colorResolution;
             NUI_IMAGE_RESOLUTION m_depthResolution;
@@ -292,6 +307,8 @@ namespace Microsoft {
             m_pDepthBuffer(NULL),
             m_depthBufferSize(0),
             m_depthBufferPitch(0),
+            m_depthSensorTime(0),
+            m_depthArrivalTime(0),
             m_colorResolution(COLOR_DEFAULT_RESOLUTION),
             m_depthResolution(DEPTH_DEFAULT_RESOLUTION)
         {
@@ -388,9 +405,6 @@ namespace Microsoft {
                 return E_INVALIDARG;
             }
 
-            // Update color resolution variable
-            m_colorResolution = resolution;
-
             HRESULT hr = S_OK;
 
             // If color stream is already opened, update its resolution
@@ -403,8 +417,24 @@ namespace Microsoft {
                     2,
                     m_hNextColorFrameEvent,
                     &m_hColorStreamHandle);
+
+                // Fail if the stream could not be reopened, after reopening it at the resolution it had
+                if (FAILED(hr))
+                {
+                    m_pNuiSensor->NuiImageStreamOpen(
+                        NUI_IMAGE_TYPE_COLOR,
+                        m_colorResolution,
+                        0,
+                        2,
+                        m_hNextColorFrameEvent,
+                        &m_hColorStreamHandle);
+                    return hr;
+                }
             }
 
+            // Update color resolution variable
+            m_colorResolution = resolution;
+
             return hr;
         }
 
@@ -431,9 +461,6 @@ namespace Microsoft {
                 return E_INVALIDARG;
             }
 
-            // Update depth resolution variable
-            m_depthResolution = resolution;
-
             HRESULT hr = S_OK;
 
             // If depth stream is already open, update its resolution
@@ -446,8 +473,24 @@ namespace Microsoft {
                     2,
                     m_hNextDepthFrameEvent,
                     &m_hDepthStreamHandle);
+
+                // Fail if the stream could not be reopened, after reopening it at the resolution it had
+                if (FAILED(hr))
+                {
+                    m_pNuiSensor->NuiImageStreamOpen(
+                        m_isUsingPlayerIndex ? NUI_IMAGE_TYPE_DEPTH_AND_PLAYER_INDEX : NUI_IMAGE_TYPE_DEPTH,
+                        m_depthResolution,
+                        m_depthFlags,
+                        2,
+                        m_hNextDepthFrameEvent,
+                        &m_hDepthStreamHandle);
+                    return hr;
+                }
             }
 
+            // Update depth resolution variable
+            m_depthResolution = resolution;
+
             return hr;
         }
 
@@ -704,6 +747,8 @@ namespace Microsoft {
         template <typename Image>
         HRESULT KinectHelper<Image>::UpdateColorFrame(DWORD waitMillis /* = 0 */)
         {
+            TRACE_SCOPE("UpdateColorFrame");
+
             // Fail if Kinect is not initialized
             if (!m_pNuiSensor)
             {
@@ -771,6 +816,8 @@ namespace Microsoft {
         template <typename Image>
         HRESULT KinectHelper<Image>::UpdateDepthFrame(DWORD waitMillis /* = 0 */)
         {
+            TRACE_SCOPE("UpdateDepthFrame");
+
             // Fail if Kinect is not initialized
             if (!m_pNuiSensor)
             {
@@ -795,6 +842,8 @@ namespace Microsoft {
                 return hr;
             }
 
+            LONGLONG arrivalTime = GetMonotonicNanoseconds();
+
             // Lock frame texture to allow for copy
             INuiFrameTexture* pTexture = imageFrame.pFrameTexture;
             NUI_LOCKED_RECT lockedRect;
@@ -808,6 +857,9 @@ namespace Microsoft {
                 INT size =  lockedRect.size;
                 INT pitch = lockedRect.Pitch;
 
+                m_depthSensorTime = imageFrame.liTimeStamp.QuadPart;
+                m_depthArrivalTime = arrivalTime;
+
                 // Only reallocate memory if the buffer size has changed
                 if (size != m_depthBufferSize)
                 {
@@ -837,6 +889,8 @@ namespace Microsoft {
         template <typename Image>
         HRESULT KinectHelper<Image>::UpdateSkeletonFrame(DWORD waitMillis /* = 0 */)
         {
+            TRACE_SCOPE("UpdateSkeletonFrame");
+
             // Fail if Kinect is not initialized
             if (!m_pNuiSensor)
             {
@@ -1060,7 +1114,7 @@ namespace Microsoft {
             }
 
             // Fail if pDepthImage is not the correct size
-            HRESULT hr = VerifySize(pDepthImage, m_depthWidth, m_depthHeight);
+            HRESULT hr = VerifySize(pDepthImage, m_depthResolution);
             if (FAILED(hr))
             {
                 return hr;
@@ -1071,6 +1125,33 @@ namespace Microsoft {
             return hr;
         }
 
+        /// <summary>
+        /// Gets when the latest depth frame was taken by the sensor and when it arrived
+        /// </summary>
+        /// <param name="pSensorMilliseconds">pointer in which to return the timestamp the sensor gave the frame in milliseconds</param>
+        /// <param name="pArrivalTime">pointer in which to return the monotonic time in nanoseconds the frame was taken from the stream</param>
+        /// <returns>S_OK if successful, an error code otherwise</returns>
+        template <typename Image>
+        HRESULT KinectHelper<Image>::GetDepthFrameTime(LONGLONG* pSensorMilliseconds, LONGLONG* pArrivalTime) const
+        {
+            // Fail if pointer is invalid
+            if (!pSensorMilliseconds || !pArrivalTime)
+            {
+                return E_POINTER;
+            }
+
+            // Fail if no depth frame was taken yet
+            if (!m_pDepthBuffer)
+            {
+                return E_NUI_FRAME_NO_DATA;
+            }
+
+            *pSensorMilliseconds = m_depthSensorTime;
+            *pArrivalTime = m_depthArrivalTime;
+
+            return S_OK;
+        }
+
         /// <summary>
         /// Gets the skeleton frame
         /// </summary>
@@ -1108,7 +1189,7 @@ namespace Microsoft {
         /// <param name="pDepthArgbImage">pointer in which to return the image</param>
         /// <returns>S_OK if successful, an error code otherwise</returns>
         template <typename Image>
-        HRESULT KinectHelper<Image>::GetDepthImageAsArgb(Image* pDepthArgbImage, Image* pPrevImage, Image* pDelta1Image, Image* pDelta2Image)
+        HRESULT KinectHelper<Image>::GetDepthImageAsArgb(Image* pDepthArgbImage) const
         {
             // Fail if Kinect is not initialized
             if (!m_pNuiSensor) 
@@ -1136,7 +1217,7 @@ namespace Microsoft {
             }
 
             // Update output Mat to correct size
-            hr = GetDepthDataAsArgb(pDepthArgbImage, pPrevImage, pDelta1Image, pDelta2Image);
+            hr = GetDepthDataAsArgb(pDepthArgbImage);
 
             return hr;
         }
@@ -1152,70 +1233,7 @@ namespace Microsoft {
         template <typename Image>
         HRESULT KinectHelper<Image>::DepthShortToRgb(USHORT depth, UINT8* redPixel, UINT8* greenPixel, UINT8* bluePixel) const
         {
-            SHORT realDepth = NuiDepthPixelToDepth(depth);
-            USHORT playerIndex = NuiDepthPixelToPlayerIndex(depth);
-
-            // Convert depth info into an intensity for display
-            BYTE b = 255 - static_cast<BYTE>(256 * realDepth / 0x0fff);
-
-            // Color the output based on the player index
-            switch(playerIndex)
-            {
-            case 0:
-                *redPixel = b / 2;
-                *greenPixel = b / 2;
-                *bluePixel = b / 2;
-                break;
-
-            case 1:
-                *redPixel = b;
-                *greenPixel = 0;
-                *bluePixel = 0;
-                break;
-
-            case 2:
-                *redPixel = 0;
-                *greenPixel = b;
-                *bluePixel = 0;
-                break;
-
-            case 3:
-                *redPixel = b / 4;
-                *greenPixel = b;
-                *bluePixel = b;
-                break;
-
-            case 4:
-                *redPixel = b;
-                *greenPixel = b;
-                *bluePixel = b / 4;
-                break;
-
-            case 5:
-                *redPixel = b;
-                *greenPixel = b / 4;
-                *bluePixel = b;
-                break;
-
-            case 6:
-                *redPixel = b / 2;
-                *greenPixel = b / 2;
-                *bluePixel = b;
-                break;
-
-            case 7:
-                *redPixel = 255 - (b / 2);
-                *greenPixel = 255 - (b / 2);
-                *bluePixel = 255 - (b / 2);
-                break;
-
-            default:
-                *redPixel = 0;
-                *greenPixel = 0;
-                *bluePixel = 0;
-                break;
-            }
-
+            ::DepthShortToRgb(depth, redPixel, greenPixel, bluePixel);
 
             return S_OK;
         }
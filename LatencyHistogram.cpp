@@ -0,0 +1,172 @@
+//-----------------------------------------------------------------------------
+// <copyright file="LatencyHistogram.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation. All rights reserved.
+// </copyright>
+//-----------------------------------------------------------------------------
+
+#include "LatencyHistogram.h"
+#include <string.h>
+
+// Suppress warnings that come from compiling OpenCV code since we have no control over it
+#pragma warning(push)
+#pragma warning(disable : 6294 6031)
+#include <opencv2/core/core.hpp>
+#pragma warning(pop)
+
+using namespace cv;
+
+// OpenCV ticks per second, read once before main so that no thread races to set it
+static const LONGLONG TICKS_PER_SECOND = static_cast<LONGLONG>(getTickFrequency());
+static const LONGLONG NANOSECONDS_PER_SECOND = 1000000000;
+
+/// <summary>
+/// Constructor
+/// </summary>
+LatencyHistogram::LatencyHistogram() :
+    m_count(0),
+    m_sum(0),
+    m_max(0)
+{
+    for (int i = 0; i < BUCKET_COUNT; ++i)
+    {
+        m_counts[i] = 0;
+    }
+}
+
+/// <summary>
+/// Counts a duration
+/// </summary>
+/// <param name="nanoseconds">duration in nanoseconds; negative durations are counted as 0</param>
+void LatencyHistogram::Record(LONGLONG nanoseconds)
+{
+    if (nanoseconds < 0)
+    {
+        nanoseconds = 0;
+    }
+
+    InterlockedIncrement(&m_counts[GetBucketIndex(nanoseconds)]);
+    InterlockedExchangeAdd64(&m_sum, nanoseconds);
+    InterlockedIncrement(&m_count);
+
+    // Another thread may raise the maximum between the read and the exchange, so retry until this duration is not larger
+    LONGLONG max = m_max;
+    while (nanoseconds > max)
+    {
+        LONGLONG previous = InterlockedCompareExchange64(&m_max, nanoseconds, max);
+        if (previous == max)
+        {
+            break;
+        }
+        max = previous;
+    }
+}
+
+/// <summary>
+/// Computes percentiles of the durations counted so far. Durations recorded while the summary is
+/// computed may be left out, but the percentiles are always those of the counts that were read.
+/// </summary>
+/// <param name="pSummary">pointer in which to return the summary, all 0 if nothing was recorded</param>
+void LatencyHistogram::GetSummary(LatencySummary* pSummary) const
+{
+    memset(pSummary, 0, sizeof(*pSummary));
+
+    LONG counts[BUCKET_COUNT];
+    LONG total = 0;
+    for (int i = 0; i < BUCKET_COUNT; ++i)
+    {
+        counts[i] = m_counts[i];
+        total += counts[i];
+    }
+
+    if (total == 0)
+    {
+        return;
+    }
+
+    // 64-bit values are read with an interlocked operation so that they cannot tear on 32-bit builds
+    LONGLONG sum = InterlockedCompareExchange64(const_cast<volatile LONGLONG*>(&m_sum), 0, 0);
+    LONGLONG max = InterlockedCompareExchange64(const_cast<volatile LONGLONG*>(&m_max), 0, 0);
+    LONG count = m_count;
+
+    pSummary->count = total;
+    pSummary->mean = (count > 0) ? static_cast<double>(sum) / count : 0.0;
+    pSummary->max = static_cast<double>(max);
+
+    // A percentile is the value of the bucket that holds the duration of that rank
+    const double percentiles[3] = {0.50, 0.95, 0.99};
+    double* pValues[3] = {&pSummary->p50, &pSummary->p95, &pSummary->p99};
+    int percentile = 0;
+    LONG seen = 0;
+    for (int i = 0; i < BUCKET_COUNT && percentile < 3; ++i)
+    {
+        seen += counts[i];
+        while (percentile < 3 && seen >= percentiles[percentile] * total)
+        {
+            // The bucket middle may lie above the largest duration in it
+            double value = GetBucketValue(i);
+            *pValues[percentile] = (value < pSummary->max) ? value : pSummary->max;
+            ++percentile;
+        }
+    }
+}
+
+/// <summary>
+/// Gets the bucket that counts a duration
+/// </summary>
+/// <param name="nanoseconds">duration, at least 0</param>
+/// <returns>index of the bucket</returns>
+int LatencyHistogram::GetBucketIndex(LONGLONG nanoseconds)
+{
+    if (nanoseconds < SUB_BUCKET_COUNT)
+    {
+        return static_cast<int>(nanoseconds);
+    }
+
+    // Highest set bit, at least SUB_BUCKET_BITS
+    int highestBit = SUB_BUCKET_BITS;
+    while (highestBit < MAX_DURATION_BITS && (nanoseconds >> (highestBit + 1)) != 0)
+    {
+        ++highestBit;
+    }
+
+    if (highestBit >= MAX_DURATION_BITS)
+    {
+        return BUCKET_COUNT - 1;
+    }
+
+    // The SUB_BUCKET_BITS bits below the highest one select the bucket within the power of two
+    int shift = highestBit - SUB_BUCKET_BITS;
+    int subBucket = static_cast<int>(nanoseconds >> shift) - SUB_BUCKET_COUNT;
+    return SUB_BUCKET_COUNT * (shift + 1) + subBucket;
+}
+
+/// <summary>
+/// Gets the duration that stands for the durations counted in a bucket
+/// </summary>
+/// <param name="index">index of the bucket</param>
+/// <returns>middle of the durations of the bucket in nanoseconds</returns>
+double LatencyHistogram::GetBucketValue(int index)
+{
+    if (index < SUB_BUCKET_COUNT)
+    {
+        return index;
+    }
+
+    int shift = index / SUB_BUCKET_COUNT - 1;
+    int subBucket = index % SUB_BUCKET_COUNT;
+    double lowest = static_cast<double>(static_cast<LONGLONG>(SUB_BUCKET_COUNT + subBucket) << shift);
+    double width = static_cast<double>(1LL << shift);
+    return lowest + (width - 1) / 2;
+}
+
+/// <summary>
+/// Reads a monotonic clock with the resolution of the OpenCV tick counter, which is the performance
+/// counter on Windows and CLOCK_MONOTONIC elsewhere; unlike clock(), it measures wall time
+/// </summary>
+/// <returns>time in nanoseconds since an arbitrary start</returns>
+LONGLONG GetMonotonicNanoseconds()
+{
+    // Whole seconds and the remainder are converted apart, so that neither product overflows
+    LONGLONG ticks = getTickCount();
+    return ticks / TICKS_PER_SECOND * NANOSECONDS_PER_SECOND + ticks % TICKS_PER_SECOND * NANOSECONDS_PER_SECOND / TICKS_PER_SECOND;
+}
@@ -0,0 +1,89 @@
+//-----------------------------------------------------------------------------
+// <copyright file="LatencyHistogram.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation. All rights reserved.
+// </copyright>
+//-----------------------------------------------------------------------------
+
+#pragma once
+
+#include "Platform.h"
+
+/// <summary>
+/// Percentiles of the durations recorded in a LatencyHistogram, in nanoseconds
+/// </summary>
+struct LatencySummary
+{
+    LONG count;
+    double mean;
+    double p50;
+    double p95;
+    double p99;
+    double max;
+};
+
+/// <summary>
+/// Histogram of durations in the style of HdrHistogram: every power of two from 16 ns up is split
+/// into 16 equal buckets, so that a percentile is within 1/16 of the recorded durations at any scale
+/// while the whole range up to 2^40 ns (about 18 minutes) takes a fixed array of counters.
+/// Any number of threads can record at the same time, and any thread can read a summary, without locks.
+/// </summary>
+class LatencyHistogram
+{
+    // Constants:
+    // Buckets per power of two, which also hold every duration below the first power exactly
+    static const int SUB_BUCKET_BITS = 4;
+    static const int SUB_BUCKET_COUNT = 1 << SUB_BUCKET_BITS;
+
+    // Powers of two above the exact range; longer durations are counted in the last bucket
+    static const int MAX_DURATION_BITS = 40;
+    static const int BUCKET_COUNT = SUB_BUCKET_COUNT * (MAX_DURATION_BITS - SUB_BUCKET_BITS + 1);
+
+public:
+    // Functions:
+    /// <summary>
+    /// Constructor
+    /// </summary>
+    LatencyHistogram();
+
+    /// <summary>
+    /// Counts a duration
+    /// </summary>
+    /// <param name="nanoseconds">duration in nanoseconds; negative durations are counted as 0</param>
+    void Record(LONGLONG nanoseconds);
+
+    /// <summary>
+    /// Computes percentiles of the durations counted so far. Durations recorded while the summary is
+    /// computed may be left out, but the percentiles are always those of the counts that were read.
+    /// </summary>
+    /// <param name="pSummary">pointer in which to return the summary, all 0 if nothing was recorded</param>
+    void GetSummary(LatencySummary* pSummary) const;
+
+private:
+    // Functions:
+    /// <summary>
+    /// Gets the bucket that counts a duration
+    /// </summary>
+    /// <param name="nanoseconds">duration, at least 0</param>
+    /// <returns>index of the bucket</returns>
+    static int GetBucketIndex(LONGLONG nanoseconds);
+
+    /// <summary>
+    /// Gets the duration that stands for the durations counted in a bucket
+    /// </summary>
+    /// <param name="index">index of the bucket</param>
+    /// <returns>middle of the durations of the bucket in nanoseconds</returns>
+    static double GetBucketValue(int index);
+
+    // Variables:
+    volatile LONG m_counts[BUCKET_COUNT];
+    volatile LONG m_count;
+    volatile LONGLONG m_sum;
+    volatile LONGLONG m_max;
+};
+
+/// <summary>
+/// Reads a monotonic clock with the resolution of the OpenCV tick counter, which is the performance
+/// counter on Windows and CLOCK_MONOTONIC elsewhere; unlike clock(), it measures wall time
+/// </summary>
+/// <returns>time in nanoseconds since an arbitrary start</returns>
+LONGLONG GetMonotonicNanoseconds();
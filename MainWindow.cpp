@@ -5,28 +5,91 @@
 //-----------------------------------------------------------------------------
 
 #include "MainWindow.h"
-#include <ros.h>
-#include <std_msgs/Float32.h>
+#include "KernelBenchmark.h"
+#include "SkeletonProjectionBenchmark.h"
+#include "Trace.h"
 
-
-ros::NodeHandle nh;
-std_msgs::Float32 float_msg;
-ros::Publisher sweep_pub("sweep", &float_msg);
-char rosSrvrIp[20];
-char* port = "11411";
+// ROS server the detection results are published to
+static const char* ROS_SERVER_ADDRESS = "192.168.1.134";
+static const char* ROS_SERVER_PORT = "11411";
 
 
 using namespace cv;
 using namespace Microsoft::KinectBridge;
 using namespace std;
 
+const char* CMainWindow::PIPELINE_CONFIG_FILE_NAME = "DetectionPipeline.ini";
+const char* CMainWindow::TRACE_FILE_NAME = "Trace.json";
+
 // Entry point for the application
 int APIENTRY _tWinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPTSTR lpCmdLine, int nCmdShow)
 {
     UNREFERENCED_PARAMETER(hPrevInstance);
-    UNREFERENCED_PARAMETER(lpCmdLine);
+
+    // Time the per-pixel kernels and skeleton projection instead of running the application
+    const TCHAR* pBenchmarkOption = _tcsstr(lpCmdLine, _T("/benchmark"));
+    if (pBenchmarkOption)
+    {
+        // A depth recording to also run the depth kernels on may follow, as an ASCII path ending at the next space
+        std::string recordingPath;
+        const TCHAR* pChar = pBenchmarkOption + _tcslen(_T("/benchmark"));
+        if (*pChar == _T(' ') && *(pChar + 1) != _T('/'))
+        {
+            for (++pChar; *pChar && *pChar != _T(' '); ++pChar)
+            {
+                recordingPath += static_cast<char>(*pChar);
+            }
+        }
+
+        HRESULT hr = RunKernelBenchmark("KernelBenchmark.csv", recordingPath.empty() ? NULL : recordingPath.c_str());
+        if (SUCCEEDED(hr))
+        {
+            hr = RunSkeletonProjectionBenchmark("SkeletonProjectionBenchmark.csv");
+        }
+
+        return SUCCEEDED(hr) ? 0 : 1;
+    }
 
     CMainWindow application;
+
+    // Record the raw depth frames for replaying later, for example with ReplayDetector
+    const TCHAR* pRecordOption = _tcsstr(lpCmdLine, _T("/record "));
+    if (pRecordOption)
+    {
+        // Recording paths are taken as ASCII and end at the next space
+        std::string fileName;
+        for (const TCHAR* pChar = pRecordOption + _tcslen(_T("/record ")); *pChar && *pChar != _T(' '); ++pChar)
+        {
+            fileName += static_cast<char>(*pChar);
+        }
+        application.SetRecordingFileName(fileName);
+    }
+
+    // Share the raw frames with other processes on this machine through shared memory
+    const TCHAR* pShareOption = _tcsstr(lpCmdLine, _T("/share "));
+    if (pShareOption)
+    {
+        // Share names are taken as ASCII and end at the next space
+        std::string name;
+        for (const TCHAR* pChar = pShareOption + _tcslen(_T("/share ")); *pChar && *pChar != _T(' '); ++pChar)
+        {
+            name += static_cast<char>(*pChar);
+        }
+        application.SetSharedFrameRingName(name);
+    }
+
+    // Also publish every sweep event stamped with when its depth frame was taken
+    if (_tcsstr(lpCmdLine, _T("/stamp")))
+    {
+        application.SetStampedSweepEnabled(true);
+    }
+
+    // Detect and publish without a window or any rendering
+    if (_tcsstr(lpCmdLine, _T("/headless")))
+    {
+        return application.RunHeadless(hInstance);
+    }
+
     return application.Run(hInstance, nCmdShow);
 }
 
@@ -39,28 +102,34 @@ CMainWindow::CMainWindow() :
     m_hWndMain(NULL),
     m_hWndStatus(NULL),
     m_hStreamInfoFont(NULL),
-    m_bIsColorPaused(false),
-    m_colorResolution(NUI_IMAGE_RESOLUTION_INVALID),
-    m_bIsDepthPaused(false),
-    m_bIsDepthNearMode(false),
-    m_depthResolution(NUI_IMAGE_RESOLUTION_INVALID),
-    m_bIsSkeletonSeatedMode(false),
-    m_bIsSkeletonDrawColor(false),
-    m_bIsSkeletonDrawDepth(false),
-    m_depthFilterID(IDM_DEPTH_FILTER_NOFILTER),
-    m_colorFilterID(IDM_COLOR_FILTER_NOFILTER),
+    m_bIsHeadless(false),
     m_pColorBitmapBits(NULL),
     m_hColorBitmap(NULL),
     m_pDepthBitmapBits(NULL),
     m_hDepthBitmap(NULL),
     m_hProcessStopEvent(NULL),
     m_hProcessThread(NULL),
-    m_hColorResolutionMutex(NULL),
-    m_hDepthResolutionMutex(NULL),
+    m_spareDepthFrame(-1),
+    m_droppedDepthFrames(0),
+    m_hReconfigureThread(NULL),
     m_hColorBitmapMutex(NULL),
     m_hDepthBitmapMutex(NULL),
     m_hPaintWindowMutex(NULL)
 {
+    m_reconfiguration.hBitmap = NULL;
+
+    for (int i = 0; i < PIPELINE_FRAME_COUNT; ++i)
+    {
+        m_depthFrames[i].hasReconfiguration = false;
+        m_depthFrames[i].reconfiguration.hBitmap = NULL;
+    }
+
+    for (int i = 0; i < PIPELINE_STAGE_COUNT; ++i)
+    {
+        m_pipelineStages[i].hThread = NULL;
+        m_pipelineStages[i].serviceMicroseconds = 0;
+        m_pipelineStages[i].frameCount = 0;
+    }
 }
 
 /// <summary>
@@ -83,16 +152,6 @@ CMainWindow::~CMainWindow()
     }
 
     // Delete created handles and allocated data
-    if (m_hDepthResolutionMutex)
-    {
-        CloseHandle(m_hDepthResolutionMutex);
-    }
-
-    if (m_hColorResolutionMutex)
-    {
-        CloseHandle(m_hColorResolutionMutex);
-    }
-
     if (m_hdc)
     {
         DeleteDC(m_hdc);
@@ -130,10 +189,8 @@ CMainWindow::~CMainWindow()
 /// <returns>WPARAM of final message as int</returns>
 int CMainWindow::Run(HINSTANCE hInstance, int nCmdShow)
 {
+    InitializeRos();
 
-	sprintf_s(rosSrvrIp, "192.168.1.134");
-	nh.initNode(rosSrvrIp, port);
-	nh.advertise(sweep_pub);
     // Create application window
     if (FAILED(CreateMainWindow(hInstance)))
     {
@@ -141,8 +198,6 @@ int CMainWindow::Run(HINSTANCE hInstance, int nCmdShow)
     }
 
     // Create mutexes
-    m_hColorResolutionMutex = CreateMutex(NULL, FALSE, NULL);
-    m_hDepthResolutionMutex = CreateMutex(NULL, FALSE, NULL);
     m_hColorBitmapMutex = CreateMutex(NULL, FALSE, NULL);
     m_hDepthBitmapMutex = CreateMutex(NULL, FALSE, NULL);
     m_hPaintWindowMutex = CreateMutex(NULL, FALSE, NULL);
@@ -154,15 +209,19 @@ int CMainWindow::Run(HINSTANCE hInstance, int nCmdShow)
     CreateStreamInformationFont();
     CreateColorImage();
     CreateDepthImage();
-	CreateDepthImagePrev();
+    CreateDetectionPipeline();
+    StartRecording();
+    StartFrameSharing();
 
     // Perform Kinect initialization
     // If Kinect initialization succeeded, start the event processing thread
     // that will update the screen with depth and color images
     if (SUCCEEDED(CreateFirstConnected()))
     {
-        // Create window processing thread
-        m_hProcessStopEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
+        StartRegistration();
+
+        // Create window processing thread; the stop event stays set so that every pipeline stage sees it
+        m_hProcessStopEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
         m_hProcessThread = CreateThread(NULL, 0, ProcessThread, this, 0, NULL);
 
         NuiSetDeviceStatusCallback( &CMainWindow::StatusProc, this );
@@ -184,12 +243,97 @@ int CMainWindow::Run(HINSTANCE hInstance, int nCmdShow)
         // Process message
         TranslateMessage(&msg);
         DispatchMessage(&msg);
-		nh.spinOnce();
     }
 
     return static_cast<int>(msg.wParam);
 }
 
+/// <summary>
+/// Runs detection and publishing without a window, until the processing thread ends or WM_QUIT is posted
+/// </summary>
+/// <param name="hInstance">handle to the application instance</param>
+/// <returns>0 if the Kinect was started, 1 otherwise</returns>
+int CMainWindow::RunHeadless(HINSTANCE hInstance)
+{
+    m_hInstance = hInstance;
+    m_bIsHeadless = true;
+
+    InitializeRos();
+
+    // Create mutexes
+    m_hColorBitmapMutex = CreateMutex(NULL, FALSE, NULL);
+    m_hDepthBitmapMutex = CreateMutex(NULL, FALSE, NULL);
+    m_hPaintWindowMutex = CreateMutex(NULL, FALSE, NULL);
+
+    // Without a window there is no menu to check and no device context, so only the Mats are created
+    InitSettings(NULL);
+    CreateColorImage();
+    CreateDepthImage();
+    CreateDetectionPipeline();
+    StartRecording();
+    StartFrameSharing();
+
+    if (FAILED(CreateFirstConnected()))
+    {
+        return 1;
+    }
+
+    StartRegistration();
+
+    m_hProcessStopEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+    m_hProcessThread = CreateThread(NULL, 0, ProcessThread, this, 0, NULL);
+    NuiSetDeviceStatusCallback(&CMainWindow::StatusProc, this);
+
+    // The publish stage services ROS; this thread only waits for the processing thread or WM_QUIT
+    bool continueRunning = true;
+    while (continueRunning)
+    {
+        DWORD result = MsgWaitForMultipleObjects(1, &m_hProcessThread, FALSE, INFINITE, QS_ALLINPUT);
+        if (WAIT_OBJECT_0 == result)
+        {
+            break;
+        }
+
+        MSG msg;
+        while (PeekMessage(&msg, NULL, 0, 0, PM_REMOVE))
+        {
+            if (WM_QUIT == msg.message)
+            {
+                continueRunning = false;
+            }
+        }
+    }
+
+    return 0;
+}
+
+/// <summary>
+/// Sets a file to record the raw depth frames to, so that the session can be replayed without a Kinect
+/// </summary>
+/// <param name="fileName">path of the recording file, or empty to not record</param>
+void CMainWindow::SetRecordingFileName(const std::string& fileName)
+{
+    m_recordingFileName = fileName;
+}
+
+/// <summary>
+/// Sets a name to share the raw frames under, so that other processes can read them without copies through a socket
+/// </summary>
+/// <param name="name">base name of the frame rings, or empty to not share</param>
+void CMainWindow::SetSharedFrameRingName(const std::string& name)
+{
+    m_sharedFrameRingName = name;
+}
+
+/// <summary>
+/// Sets whether sweep events are also published with the time their depth frame was taken
+/// </summary>
+/// <param name="isEnabled">true to publish stamped sweep events</param>
+void CMainWindow::SetStampedSweepEnabled(bool isEnabled)
+{
+    m_rosPublisher.SetStampedSweepEnabled(isEnabled);
+}
+
 /// <summary>
 /// Handles window messages, passes most to the class instance to handle
 /// </summary>
@@ -255,25 +399,24 @@ LRESULT CALLBACK CMainWindow::WndProc(HWND hWnd, UINT message, WPARAM wParam, LP
             {
             case IDM_COLOR_PAUSE:
                 {
-                    m_bIsColorPaused = !m_bIsColorPaused;
-                    CheckMenuItem(hMenu, wmID, m_bIsColorPaused ? MF_CHECKED : MF_UNCHECKED);
+                    m_settings.isColorPaused = !m_settings.isColorPaused;
+                    PublishSettings();
+                    CheckMenuItem(hMenu, wmID, m_settings.isColorPaused ? MF_CHECKED : MF_UNCHECKED);
                 }
                 break;
             case IDM_COLOR_RESOLUTION_640x480:
                 {
-                    // Update instance variable for processing thread to see, using mutex for synchronization
-                    WaitForSingleObject(m_hColorResolutionMutex, INFINITE);
-                    m_colorResolution = NUI_IMAGE_RESOLUTION_640x480;
-                    ReleaseMutex(m_hColorResolutionMutex);
+                    // The processing thread reopens the stream when it picks up the new settings
+                    m_settings.colorResolution = NUI_IMAGE_RESOLUTION_640x480;
+                    PublishSettings();
                     CheckMenuRadioItem(hMenu, COLOR_RESOLUTION_FIRST, COLOR_RESOLUTION_LAST, wmID, MF_BYCOMMAND);
                 }
                 break;
             case IDM_COLOR_RESOLUTION_1280x960:
                 {
-                    // Update instance variable for processing thread to see, using mutex for synchronization
-                    WaitForSingleObject(m_hColorResolutionMutex, INFINITE);
-                    m_colorResolution = NUI_IMAGE_RESOLUTION_1280x960;
-                    ReleaseMutex(m_hColorResolutionMutex);
+                    // The processing thread reopens the stream when it picks up the new settings
+                    m_settings.colorResolution = NUI_IMAGE_RESOLUTION_1280x960;
+                    PublishSettings();
                     CheckMenuRadioItem(hMenu, COLOR_RESOLUTION_FIRST, COLOR_RESOLUTION_LAST, wmID, MF_BYCOMMAND);
                 }
                 break;
@@ -283,21 +426,29 @@ LRESULT CALLBACK CMainWindow::WndProc(HWND hWnd, UINT message, WPARAM wParam, LP
             case IDM_COLOR_FILTER_ERODE:
             case IDM_COLOR_FILTER_CANNYEDGE:
                 {
-                    m_colorFilterID = wmID;
-                    m_openCVHelper.SetColorFilter(wmID);
+                    m_settings.colorFilterID = wmID;
+                    PublishSettings();
                     CheckMenuRadioItem(hMenu, COLOR_FILTER_FIRST, COLOR_FILTER_LAST, wmID, MF_BYCOMMAND);
                 }
                 break;
+            case IDM_COLOR_SWEEPFLOW:
+                {
+                    m_settings.isSweepFlowEnabled = !m_settings.isSweepFlowEnabled;
+                    PublishSettings();
+                    CheckMenuItem(hMenu, wmID, m_settings.isSweepFlowEnabled ? MF_CHECKED : MF_UNCHECKED);
+                }
+                break;
             case IDM_DEPTH_PAUSE:
                 {
-                    m_bIsDepthPaused= !m_bIsDepthPaused;
-                    CheckMenuItem(hMenu, wmID, m_bIsDepthPaused ? MF_CHECKED : MF_UNCHECKED);
+                    m_settings.isDepthPaused = !m_settings.isDepthPaused;
+                    PublishSettings();
+                    CheckMenuItem(hMenu, wmID, m_settings.isDepthPaused ? MF_CHECKED : MF_UNCHECKED);
                 }
                 break;
             case IDM_DEPTH_NEARMODE:
                 {
                     // Update depth stream, checking for failures
-                    HRESULT hr = m_frameHelper.SetDepthStreamFlag(NUI_IMAGE_STREAM_FLAG_ENABLE_NEAR_MODE, !m_bIsDepthNearMode);
+                    HRESULT hr = m_frameHelper.SetDepthStreamFlag(NUI_IMAGE_STREAM_FLAG_ENABLE_NEAR_MODE, !m_settings.isDepthNearMode);
                     if (hr == E_NUI_HARDWARE_FEATURE_UNAVAILABLE)
                     {
                         SetStatusMessage(IDS_ERROR_KINECT_NONEARMODE);
@@ -309,25 +460,24 @@ LRESULT CALLBACK CMainWindow::WndProc(HWND hWnd, UINT message, WPARAM wParam, LP
                         break;
                     }
 
-                    m_bIsDepthNearMode = !m_bIsDepthNearMode;
-                    CheckMenuItem(hMenu, wmID, m_bIsDepthNearMode ? MF_CHECKED : MF_UNCHECKED);
+                    m_settings.isDepthNearMode = !m_settings.isDepthNearMode;
+                    PublishSettings();
+                    CheckMenuItem(hMenu, wmID, m_settings.isDepthNearMode ? MF_CHECKED : MF_UNCHECKED);
                 }
                 break;
             case IDM_DEPTH_RESOLUTION_320x240:
                 {
-                    // Update instance variable for processing thread to see, using mutex for synchronization
-                    WaitForSingleObject(m_hDepthResolutionMutex, INFINITE);
-                    m_depthResolution = NUI_IMAGE_RESOLUTION_320x240;
-                    ReleaseMutex(m_hDepthResolutionMutex);
+                    // The processing thread reopens the stream when it picks up the new settings
+                    m_settings.depthResolution = NUI_IMAGE_RESOLUTION_320x240;
+                    PublishSettings();
                     CheckMenuRadioItem(hMenu, DEPTH_RESOLUTION_FIRST, DEPTH_RESOLUTION_LAST, wmID, MF_BYCOMMAND);
                 }
                 break;
             case IDM_DEPTH_RESOLUTION_640x480:
                 {
-                    // Update instance variable for processing thread to see, using mutex for synchronization
-                    WaitForSingleObject(m_hDepthResolutionMutex, INFINITE);
-                    m_depthResolution = NUI_IMAGE_RESOLUTION_640x480;
-                    ReleaseMutex(m_hDepthResolutionMutex);
+                    // The processing thread reopens the stream when it picks up the new settings
+                    m_settings.depthResolution = NUI_IMAGE_RESOLUTION_640x480;
+                    PublishSettings();
                     CheckMenuRadioItem(hMenu, DEPTH_RESOLUTION_FIRST, DEPTH_RESOLUTION_LAST, wmID, MF_BYCOMMAND);
                 }
                 break;
@@ -337,36 +487,49 @@ LRESULT CALLBACK CMainWindow::WndProc(HWND hWnd, UINT message, WPARAM wParam, LP
             case IDM_DEPTH_FILTER_ERODE:
             case IDM_DEPTH_FILTER_CANNYEDGE:
                 {
-                    m_depthFilterID = wmID;
+                    m_settings.depthFilterID = wmID;
+                    PublishSettings();
                     CheckMenuRadioItem(hMenu, DEPTH_FILTER_FIRST, DEPTH_FILTER_LAST, wmID, MF_BYCOMMAND);
-                    m_openCVHelper.SetDepthFilter(wmID);
                 }
                 break;
             case IDM_SKELETON_SEATEDMODE:
                 {
                     // Update skeleton tracking flag, checking for failures
-                    HRESULT hr = m_frameHelper.SetSkeletonTrackingFlag(NUI_SKELETON_TRACKING_FLAG_ENABLE_SEATED_SUPPORT, !m_bIsSkeletonSeatedMode);
+                    HRESULT hr = m_frameHelper.SetSkeletonTrackingFlag(NUI_SKELETON_TRACKING_FLAG_ENABLE_SEATED_SUPPORT, !m_settings.isSkeletonSeatedMode);
                     if (FAILED(hr))
                     {
                         SetStatusMessage(IDS_ERROR_KINECT_SEATEDMODE);
                         break;
                     }
 
-                    m_bIsSkeletonSeatedMode = !m_bIsSkeletonSeatedMode;
-                    CheckMenuItem(hMenu, IDM_SKELETON_SEATEDMODE, m_bIsSkeletonSeatedMode ? MF_CHECKED : MF_UNCHECKED);
+                    m_settings.isSkeletonSeatedMode = !m_settings.isSkeletonSeatedMode;
+                    PublishSettings();
+                    CheckMenuItem(hMenu, IDM_SKELETON_SEATEDMODE, m_settings.isSkeletonSeatedMode ? MF_CHECKED : MF_UNCHECKED);
 
                 }
                 break;
             case IDM_SKELETON_DRAW_COLOR:
                 {
-                    m_bIsSkeletonDrawColor = !m_bIsSkeletonDrawColor;
-                    CheckMenuItem(hMenu, wmID, m_bIsSkeletonDrawColor ? MF_CHECKED : MF_UNCHECKED);
+                    m_settings.isSkeletonDrawColor = !m_settings.isSkeletonDrawColor;
+                    PublishSettings();
+                    CheckMenuItem(hMenu, wmID, m_settings.isSkeletonDrawColor ? MF_CHECKED : MF_UNCHECKED);
                 }
                 break;
             case IDM_SKELETON_DRAW_DEPTH:
                 {
-                    m_bIsSkeletonDrawDepth = !m_bIsSkeletonDrawDepth;
-                    CheckMenuItem(hMenu, wmID, m_bIsSkeletonDrawDepth ? MF_CHECKED : MF_UNCHECKED);
+                    m_settings.isSkeletonDrawDepth = !m_settings.isSkeletonDrawDepth;
+                    PublishSettings();
+                    CheckMenuItem(hMenu, wmID, m_settings.isSkeletonDrawDepth ? MF_CHECKED : MF_UNCHECKED);
+                }
+                break;
+            case IDM_DIAGNOSTICS_SAVE_TRACE:
+                {
+#ifdef ENABLE_TRACING
+                    HRESULT hr = WriteChromeTrace(TRACE_FILE_NAME);
+                    SetStatusMessage(SUCCEEDED(hr) ? IDS_STATUS_TRACE_SAVED : IDS_ERROR_TRACE);
+#else
+                    SetStatusMessage(IDS_ERROR_TRACE_DISABLED);
+#endif
                 }
                 break;
             default:
@@ -374,6 +537,16 @@ LRESULT CALLBACK CMainWindow::WndProc(HWND hWnd, UINT message, WPARAM wParam, LP
             }
             break;
         }
+    case WM_STREAM_SIZE_CHANGED:
+        {
+            ResizeWindow();
+        }
+        break;
+    case WM_STREAM_RESOLUTION_FAILED:
+        {
+            RestoreStreamResolution(wParam != 0, static_cast<NUI_IMAGE_RESOLUTION>(LOWORD(lParam)), static_cast<NUI_IMAGE_RESOLUTION>(HIWORD(lParam)));
+        }
+        break;
     case WM_PAINT:
         {
             PaintWindow();
@@ -434,196 +607,910 @@ DWORD WINAPI CMainWindow::ProcessThread(LPVOID lpParam)
 /// <returns>0</returns>
 DWORD WINAPI CMainWindow::ProcessThread()
 {
+    TRACE_THREAD_NAME("Capture");
 
-    // Store local copies of resolutions to check for changes
-    NUI_IMAGE_RESOLUTION colorResolution = m_colorResolution;
-    NUI_IMAGE_RESOLUTION depthResolution = m_depthResolution;
+    // The thread works from its own snapshot of the settings; InitSettings published the first one
+    // before the thread was started, and the stream resolutions were set from it
+    StreamSettings settings;
+    m_settingsChannel.Acquire(&settings);
+    m_openCVHelper.SetColorFilter(settings.colorFilterID);
 
-    // Initialize array of events to wait for
-    HANDLE hEvents[4] = {m_hProcessStopEvent, NULL, NULL, NULL};
-    int numEvents;
-    if (m_frameHelper.IsInitialized())
+    // Depth frames are analyzed, published and rendered by the pipeline stages; this thread takes them
+    if (FAILED(StartPipeline()))
     {
-        m_frameHelper.GetColorHandle(hEvents + 1);
-        m_frameHelper.GetDepthHandle(hEvents + 2);
-        m_frameHelper.GetSkeletonHandle(hEvents + 3);
-        numEvents = 4;
+        StopPipeline();
+        return 0;
     }
-    else
+
+    // Moving region the sweep direction is measured in, as last found by the analytics stage
+    SweepFlowTarget sweepFlowTarget;
+    sweepFlowTarget.isVisible = false;
+
+    // Resolutions the streams are open at, to check for changes
+    NUI_IMAGE_RESOLUTION colorResolution = settings.colorResolution;
+    NUI_IMAGE_RESOLUTION depthResolution = settings.depthResolution;
+
+    // Events of the streams, NULL if the Kinect is not initialized
+    HANDLE hColorEvent = NULL;
+    HANDLE hDepthEvent = NULL;
+    HANDLE hSkeletonEvent = NULL;
+    if (m_frameHelper.IsInitialized())
     {
-        numEvents = 1;
+        m_frameHelper.GetColorHandle(&hColorEvent);
+        m_frameHelper.GetDepthHandle(&hDepthEvent);
+        m_frameHelper.GetSkeletonHandle(&hSkeletonEvent);
     }
 
     // Main update loop
     bool continueProcessing = true;
     while (continueProcessing)
     {
-        // Use a mutex to check for update to color resolution
-        WaitForSingleObject(m_hColorResolutionMutex, INFINITE);
-        NUI_IMAGE_RESOLUTION newColorResolution = m_colorResolution;
-        ReleaseMutex(m_hColorResolutionMutex);
+        // Swap in a stream that finished reopening; this is the frame boundary for the new resolution
+        if (m_hReconfigureThread && WAIT_OBJECT_0 == WaitForSingleObject(m_hReconfigureThread, 0))
+        {
+            CompleteStreamReconfiguration();
+            NUI_IMAGE_RESOLUTION* pResolution = m_reconfiguration.isColor ? &colorResolution : &depthResolution;
+            if (SUCCEEDED(m_reconfiguration.hr))
+            {
+                *pResolution = m_reconfiguration.resolution;
+            }
+            else
+            {
+                // A stream that could not be reopened keeps the resolution it is open at, and its setting is
+                // put back so that it is not reopened again until the resolution is changed once more
+                NUI_IMAGE_RESOLUTION* pSetting = m_reconfiguration.isColor ? &settings.colorResolution : &settings.depthResolution;
+                *pSetting = *pResolution;
+                if (m_hWndMain)
+                {
+                    PostMessage(m_hWndMain, WM_STREAM_RESOLUTION_FAILED, m_reconfiguration.isColor, MAKELPARAM(*pResolution, m_reconfiguration.resolution));
+                }
+            }
+        }
+
+        // Pick up new settings between frames, so that every frame is processed with one consistent set
+        if (m_settingsChannel.Acquire(&settings))
+        {
+            m_openCVHelper.SetColorFilter(settings.colorFilterID);
+        }
+
+        // Start reopening a stream whose resolution was changed, one stream at a time
+        if (!m_hReconfigureThread && m_frameHelper.IsInitialized())
+        {
+            if (colorResolution != settings.colorResolution)
+            {
+                BeginStreamReconfiguration(true, settings.colorResolution, depthResolution);
+            }
+            else if (depthResolution != settings.depthResolution)
+            {
+                BeginStreamReconfiguration(false, settings.depthResolution, colorResolution);
+            }
+        }
+
+        // A stream that is being reopened is left alone; the other one keeps running
+        bool isColorReconfiguring = m_hReconfigureThread && m_reconfiguration.isColor;
+        bool isDepthReconfiguring = m_hReconfigureThread && !m_reconfiguration.isColor;
+
+        // Rendering is only worth doing when someone can see it; detection runs regardless
+        bool isDisplayVisible = IsDisplayVisible();
+
+        // Skeletons are only taken to be drawn
+        bool isSkeletonUsed = isDisplayVisible && ((settings.isSkeletonDrawDepth && !settings.isDepthPaused) || (settings.isSkeletonDrawColor && !settings.isColorPaused));
+
+        // Wait for the stop event, the streams that are running and the end of a reconfiguration.
+        // The frame events are manual reset, so the event of a stream that is left alone must not be waited on.
+        HANDLE hEvents[5] = {m_hProcessStopEvent};
+        int numEvents = 1;
+        if (m_frameHelper.IsInitialized())
+        {
+            if (!isColorReconfiguring)
+            {
+                hEvents[numEvents++] = hColorEvent;
+            }
+            if (!isDepthReconfiguring)
+            {
+                hEvents[numEvents++] = hDepthEvent;
+            }
+            if (isSkeletonUsed)
+            {
+                hEvents[numEvents++] = hSkeletonEvent;
+            }
+        }
+        if (m_hReconfigureThread)
+        {
+            hEvents[numEvents++] = m_hReconfigureThread;
+        }
+
+        // Wait for any event to be signalled
+        int eventId = WaitForMultipleObjects(numEvents, hEvents, FALSE, 100);
+
+        // No events were signalled in time
+        if (WAIT_TIMEOUT == eventId)
+        {
+            continue;
+        }
+
+        // Stop event was signalled
+        if (WAIT_OBJECT_0 == eventId)
+        {
+            continueProcessing = false;
+            break;
+        }
+
+        // Update image outputs
+        if (m_frameHelper.IsInitialized()) 
+        {
+            // Update skeleton frame
+            NUI_SKELETON_FRAME skeletonFrame;
+            if (isSkeletonUsed && SUCCEEDED(m_frameHelper.UpdateSkeletonFrame())) 
+            {
+                m_frameHelper.GetSkeletonFrame(&skeletonFrame);
+            }
+
+            // Update color frame; it is always taken so that its event is reset, but only converted if used
+            if (!settings.isColorPaused && !isColorReconfiguring && SUCCEEDED(m_frameHelper.UpdateColorFrame()) && (isDisplayVisible || settings.isSweepFlowEnabled || m_colorFrameRing.IsOpen())) 
+            {
+                HRESULT hr = m_frameHelper.GetColorImage(&m_colorMat);
+                if (FAILED(hr))
+                {
+                    continue;
+                }
+
+                // Readers of the ring only see whole frames, so a frame larger than its slots is not shared
+                if (m_colorFrameRing.IsOpen())
+                {
+                    m_colorFrameRing.WriteFrame(&m_colorMat, GetTickCount());
+                }
+
+                // Measure the sweeping stroke before any filter alters the image
+                if (settings.isSweepFlowEnabled)
+                {
+                    m_sweepFlowTargetChannel.Acquire(&sweepFlowTarget);
+                    UpdateSweepFlowRegion(&sweepFlowTarget, colorResolution, depthResolution);
+                    m_sweepFlowEstimator.Update(&m_colorMat, &m_sweepFlow);
+                }
+                else
+                {
+                    m_sweepFlowEstimator.Reset();
+                }
+
+                // Render only when someone can see it
+                if (isDisplayVisible)
+                {
+                    // Filter a copy so that the captured frame stays intact for anything else that reads it
+                    m_colorMat.copyTo(m_colorDisplayMat);
+                    hr = m_openCVHelper.ApplyColorFilter(&m_colorDisplayMat);
+                    if (FAILED(hr))
+                    {
+                        continue;
+                    }
+
+                    // Annotations are recorded at the captured size and rasterized with the bitmap update
+                    m_colorOverlay.Clear(m_colorMat.size());
+
+                    // Draw skeleton onto color stream
+                    if (settings.isSkeletonDrawColor) 
+                    {
+                        hr = m_openCVHelper.DrawSkeletonsInColorImage(&m_colorOverlay, &skeletonFrame, colorResolution, depthResolution);
+                        if (FAILED(hr))
+                        {
+                            continue;
+                        }
+                    }
+
+                    // Draw sweep direction onto color stream
+                    if (settings.isSweepFlowEnabled)
+                    {
+                        m_openCVHelper.DrawSweepFlow(&m_colorOverlay, &m_sweepFlow, m_sweepFlowRegion);
+                    }
+
+                    // Update bitmap for drawing
+                    WaitForSingleObject(m_hColorBitmapMutex, INFINITE);
+                    UpdateBitmap(&m_colorDisplayMat, &m_colorOverlay, &m_hColorBitmap, &m_bmiColor);
+                    ReleaseMutex(m_hColorBitmapMutex);
+
+                    // Notify frame rate tracker that new frame has been rendered
+                    m_colorFrameRateTracker.Tick();
+                }
+            }
+
+            // Hand the depth frame to the pipeline; its stages analyze, publish and render it
+            if (!settings.isDepthPaused && !isDepthReconfiguring && SUCCEEDED(m_frameHelper.UpdateDepthFrame())) 
+            {
+                bool isSkeletonDrawn = isDisplayVisible && settings.isSkeletonDrawDepth;
+                CaptureDepthFrame(&settings, depthResolution, isSkeletonDrawn ? &skeletonFrame : NULL);
+            }
+
+            // Tell the window to paint the new color bitmap
+            if (isDisplayVisible)
+            {
+                WaitForSingleObject(m_hPaintWindowMutex, INFINITE);
+                InvalidateRect(m_hWndMain, NULL, false);
+                ReleaseMutex(m_hPaintWindowMutex);
+            }
+        }
+    }
+
+    // Let a stream that is still being reopened finish, its buffers are no longer needed
+    if (m_hReconfigureThread)
+    {
+        WaitForSingleObject(m_hReconfigureThread, INFINITE);
+        CloseHandle(m_hReconfigureThread);
+        m_hReconfigureThread = NULL;
+
+        if (m_reconfiguration.hBitmap)
+        {
+            DeleteObject(m_reconfiguration.hBitmap);
+            m_reconfiguration.hBitmap = NULL;
+        }
+    }
+
+    // The stop event was set, so the stages are ending too
+    StopPipeline();
+
+    return 0;
+}
+
+/// <summary>
+/// Prepares the buffers and detector for a new stream resolution and starts reopening the stream in
+/// the background; the other stream keeps running meanwhile
+/// </summary>
+/// <param name="isColor">true to change the color stream, false to change the depth stream</param>
+/// <param name="resolution">resolution to change to</param>
+/// <param name="otherResolution">resolution the other stream is open at</param>
+/// <returns>S_OK if the stream is being reopened, an error code otherwise</returns>
+HRESULT CMainWindow::BeginStreamReconfiguration(bool isColor, NUI_IMAGE_RESOLUTION resolution, NUI_IMAGE_RESOLUTION otherResolution)
+{
+    // Fail if another stream is still being reopened
+    if (m_hReconfigureThread)
+    {
+        return E_NOT_VALID_STATE;
+    }
+
+    DWORD width, height;
+    NuiImageResolutionToSize(resolution, width, height);
+    Size size(width, height);
+
+    m_reconfiguration.isColor = isColor;
+    m_reconfiguration.resolution = resolution;
+    m_reconfiguration.otherResolution = otherResolution;
+    m_reconfiguration.hr = E_PENDING;
+    m_reconfiguration.registrationResult = E_PENDING;
+
+    // Allocate everything for the new resolution now, so that swapping it in later takes no time.
+    // The detector is prepared by the analytics stage when the depth buffers reach it.
+    m_reconfiguration.image.create(size, isColor ? m_frameHelper.COLOR_TYPE : m_frameHelper.DEPTH_RGB_TYPE);
+
+    // Without a window there is no bitmap to draw to
+    m_reconfiguration.hBitmap = NULL;
+    if (m_hdc)
+    {
+        HRESULT hr = CreateBitmap(size, &m_reconfiguration.hBitmap, &m_reconfiguration.bmi, NULL,
+            isColor ? IDS_ERROR_BITMAP_COLOR : IDS_ERROR_BITMAP_DEPTH);
+        if (FAILED(hr))
+        {
+            return hr;
+        }
+    }
+
+    m_hReconfigureThread = CreateThread(NULL, 0, ReconfigureThread, this, 0, NULL);
+    if (!m_hReconfigureThread)
+    {
+        if (m_reconfiguration.hBitmap)
+        {
+            DeleteObject(m_reconfiguration.hBitmap);
+            m_reconfiguration.hBitmap = NULL;
+        }
+
+        return E_FAIL;
+    }
+
+    return S_OK;
+}
+
+/// <summary>
+/// Thread that reopens a stream, calls class instance thread processor
+/// </summary>
+/// <param name="lpParam">instance pointer</param>
+/// <returns>0</returns>
+DWORD WINAPI CMainWindow::ReconfigureThread(LPVOID lpParam)
+{
+    // Use class instance thread processor
+    CMainWindow* pThis = reinterpret_cast<CMainWindow*>(lpParam);
+    return pThis->ReconfigureThread();
+}
+
+/// <summary>
+/// Thread that reopens a stream at the resolution of the pending reconfiguration and prepares the
+/// registration table for the new resolutions
+/// </summary>
+/// <returns>0</returns>
+DWORD WINAPI CMainWindow::ReconfigureThread()
+{
+    TRACE_THREAD_NAME("Reconfigure");
+
+    // Reopening a stream blocks for as long as the sensor takes to restart it
+    NUI_IMAGE_RESOLUTION depthResolution, colorResolution;
+    if (m_reconfiguration.isColor)
+    {
+        m_reconfiguration.hr = m_frameHelper.SetColorFrameResolution(m_reconfiguration.resolution);
+        depthResolution = m_reconfiguration.otherResolution;
+        colorResolution = m_reconfiguration.resolution;
+    }
+    else
+    {
+        m_reconfiguration.hr = m_frameHelper.SetDepthFrameResolution(m_reconfiguration.resolution);
+        depthResolution = m_reconfiguration.resolution;
+        colorResolution = m_reconfiguration.otherResolution;
+    }
+
+    // Loading or building the table can take a while and write its cache file, so it is done here rather
+    // than on the processing thread, which keeps using the current table until this one is swapped in
+    if (SUCCEEDED(m_reconfiguration.hr))
+    {
+        m_reconfiguration.registrationResult = m_nextRegistration.Initialize(depthResolution, colorResolution);
+    }
+
+    return 0;
+}
+
+/// <summary>
+/// Swaps in the buffers prepared for the new resolution once the stream has been reopened
+/// </summary>
+void CMainWindow::CompleteStreamReconfiguration()
+{
+    CloseHandle(m_hReconfigureThread);
+    m_hReconfigureThread = NULL;
+
+    if (FAILED(m_reconfiguration.hr))
+    {
+        SetStatusMessage(m_reconfiguration.isColor ? IDS_ERROR_KINECT_COLOR : IDS_ERROR_KINECT_DEPTH);
+    }
+    else
+    {
+        // The old table no longer matches either way; a failed build leaves the registration empty
+        m_registration.Swap(&m_nextRegistration);
+        m_nextRegistration.Reset();
+        if (FAILED(m_reconfiguration.registrationResult))
+        {
+            m_registration.Reset();
+            SetStatusMessage(IDS_ERROR_REGISTRATION);
+        }
+    }
 
-        // Reopen color image stream if necessary
-        if (colorResolution != newColorResolution)
+    if (m_reconfiguration.isColor && FAILED(m_reconfiguration.hr))
+    {
+        // The stream is still open at its old resolution, so its buffers and bitmap stay
+        if (m_reconfiguration.hBitmap)
         {
-            // Stop painting while we change resolution
-            WaitForSingleObject(m_hPaintWindowMutex, INFINITE);
+            DeleteObject(m_reconfiguration.hBitmap);
+        }
+    }
+    else if (m_reconfiguration.isColor)
+    {
+        m_colorMat = m_reconfiguration.image;
 
-            colorResolution = newColorResolution;
+        // The bitmap mutex only guards the handle swap; the old bitmap is freed afterwards
+        WaitForSingleObject(m_hColorBitmapMutex, INFINITE);
+        HBITMAP hOldBitmap = m_hColorBitmap;
+        m_hColorBitmap = m_reconfiguration.hBitmap;
+        m_bmiColor = m_reconfiguration.bmi;
+        ReleaseMutex(m_hColorBitmapMutex);
 
-            HRESULT hr = m_frameHelper.SetColorFrameResolution(colorResolution);
-            if (FAILED(hr))
+        if (hOldBitmap)
+        {
+            DeleteObject(hOldBitmap);
+        }
+
+        // Resize on the window thread rather than waiting for it here
+        if (m_hWndMain)
+        {
+            PostMessage(m_hWndMain, WM_STREAM_SIZE_CHANGED, 0, 0);
+        }
+    }
+    else
+    {
+        // Depth frames of the old resolution may still be in the pipeline, so the buffers follow them
+        // through it and every stage switches over when they reach it. Since no depth frames were taken
+        // while the stream was reopened, the pipeline has drained and a frame is free almost at once.
+        int frame;
+        if (FAILED(m_reconfiguration.hr) || S_OK != TakeFreeFrame(true, &frame))
+        {
+            if (m_reconfiguration.hBitmap)
             {
-                SetStatusMessage(IDS_ERROR_KINECT_COLOR);
+                DeleteObject(m_reconfiguration.hBitmap);
             }
+        }
+        else
+        {
+            LONGLONG startTime = GetMonotonicNanoseconds();
+
+            DepthFrame* pFrame = &m_depthFrames[frame];
+            pFrame->hasReconfiguration = true;
+            pFrame->reconfiguration = m_reconfiguration;
+            CompleteFrame(PIPELINE_STAGE_CAPTURE, frame, startTime);
+        }
+    }
+
+    // The buffers now belong to the stream
+    m_reconfiguration.image.release();
+    m_reconfiguration.hBitmap = NULL;
+}
+
+/// <summary>
+/// Creates the stage queues and starts the stage threads of the depth pipeline
+/// </summary>
+/// <returns>S_OK if successful, an error code otherwise</returns>
+HRESULT CMainWindow::StartPipeline()
+{
+    for (int i = 0; i < PIPELINE_STAGE_COUNT; ++i)
+    {
+        HRESULT hr = m_pipelineStages[i].queue.Initialize(PIPELINE_FRAME_COUNT);
+        if (FAILED(hr))
+        {
+            return hr;
+        }
+    }
+
+    // Every frame starts out free
+    for (int i = 0; i < PIPELINE_FRAME_COUNT; ++i)
+    {
+        m_pipelineStages[PIPELINE_STAGE_CAPTURE].queue.Push(i);
+    }
+
+    // The capture stage is the processing thread itself
+    m_pipelineStages[PIPELINE_STAGE_ANALYTICS].hThread = CreateThread(NULL, 0, AnalyticsThread, this, 0, NULL);
+    m_pipelineStages[PIPELINE_STAGE_PUBLISH].hThread = CreateThread(NULL, 0, PublishThread, this, 0, NULL);
+    m_pipelineStages[PIPELINE_STAGE_RENDER].hThread = CreateThread(NULL, 0, RenderThread, this, 0, NULL);
+
+    for (int i = PIPELINE_STAGE_ANALYTICS; i < PIPELINE_STAGE_COUNT; ++i)
+    {
+        if (!m_pipelineStages[i].hThread)
+        {
+            return E_FAIL;
+        }
+    }
+
+    return S_OK;
+}
+
+/// <summary>
+/// Waits for the stage threads of the depth pipeline to end once the stop event is set
+/// </summary>
+void CMainWindow::StopPipeline()
+{
+    // Make sure the stages are told to stop, also when the pipeline could not be started
+    SetEvent(m_hProcessStopEvent);
+
+    for (int i = 0; i < PIPELINE_STAGE_COUNT; ++i)
+    {
+        if (m_pipelineStages[i].hThread)
+        {
+            WaitForSingleObject(m_pipelineStages[i].hThread, INFINITE);
+            CloseHandle(m_pipelineStages[i].hThread);
+            m_pipelineStages[i].hThread = NULL;
+        }
+    }
+
+    // Depth buffers of a reconfiguration that did not make it through the pipeline
+    for (int i = 0; i < PIPELINE_FRAME_COUNT; ++i)
+    {
+        if (m_depthFrames[i].hasReconfiguration && m_depthFrames[i].reconfiguration.hBitmap)
+        {
+            DeleteObject(m_depthFrames[i].reconfiguration.hBitmap);
+            m_depthFrames[i].reconfiguration.hBitmap = NULL;
+        }
+    }
+}
+
+/// <summary>
+/// Takes a depth frame from the Kinect into a free pipeline frame and hands it to the analytics stage
+/// </summary>
+/// <param name="pSettings">pointer to the settings the frame is rendered with</param>
+/// <param name="depthResolution">resolution the depth stream is open at</param>
+/// <param name="pSkeletonFrame">pointer to skeleton frame to draw onto the depth image, or NULL</param>
+void CMainWindow::CaptureDepthFrame(const StreamSettings* pSettings, NUI_IMAGE_RESOLUTION depthResolution, const NUI_SKELETON_FRAME* pSkeletonFrame)
+{
+    LONGLONG startTime = GetMonotonicNanoseconds();
+
+    // When every frame is still in the pipeline the later stages cannot keep up, and the newest frame is dropped
+    int frame;
+    if (S_OK != TakeFreeFrame(false, &frame))
+    {
+        InterlockedIncrement(&m_droppedDepthFrames);
+        return;
+    }
+
+    DepthFrame* pFrame = &m_depthFrames[frame];
+
+    DWORD width, height;
+    NuiImageResolutionToSize(depthResolution, width, height);
+    pFrame->rawDepth.create(Size(width, height), m_frameHelper.DEPTH_TYPE);
+
+    // Keep the frame for the next depth frame if this one cannot be read
+    if (FAILED(m_frameHelper.GetDepthImage(&pFrame->rawDepth)))
+    {
+        m_spareDepthFrame = frame;
+        return;
+    }
+
+    pFrame->timestamp = GetTickCount();
+
+    // Without a sensor timestamp the age of the frame is counted from now, when it is at least known to exist
+    LONGLONG sensorMilliseconds, arrivalTime;
+    if (SUCCEEDED(m_frameHelper.GetDepthFrameTime(&sensorMilliseconds, &arrivalTime)))
+    {
+        pFrame->captureTime = m_depthSensorClock.ToMonotonic(sensorMilliseconds, arrivalTime);
+    }
+    else
+    {
+        pFrame->captureTime = startTime;
+    }
+
+    if (m_depthFrameRing.IsOpen())
+    {
+        m_depthFrameRing.WriteFrame(&pFrame->rawDepth, pFrame->timestamp);
+    }
+
+    pFrame->settings = *pSettings;
+    pFrame->depthResolution = depthResolution;
+    pFrame->hasSkeletonFrame = (pSkeletonFrame != NULL);
+    if (pSkeletonFrame)
+    {
+        pFrame->skeletonFrame = *pSkeletonFrame;
+    }
+    pFrame->hasReconfiguration = false;
+
+    CompleteFrame(PIPELINE_STAGE_CAPTURE, frame, startTime);
+}
+
+/// <summary>
+/// Takes a free pipeline frame for the capture stage
+/// </summary>
+/// <param name="isWaiting">true to wait until a frame is free, false to return at once</param>
+/// <param name="pFrame">pointer in which to return the index of the frame</param>
+/// <returns>S_OK if a frame was taken, S_FALSE if none is free, E_ABORT if processing is stopping</returns>
+HRESULT CMainWindow::TakeFreeFrame(bool isWaiting, int* pFrame)
+{
+    // A frame that was taken but not filled comes first
+    if (m_spareDepthFrame >= 0)
+    {
+        *pFrame = m_spareDepthFrame;
+        m_spareDepthFrame = -1;
+        return S_OK;
+    }
+
+    return WaitForFrame(PIPELINE_STAGE_CAPTURE, isWaiting ? INFINITE : 0, pFrame);
+}
+
+/// <summary>
+/// Waits for a frame to arrive in the queue of a stage
+/// </summary>
+/// <param name="stage">stage to wait for</param>
+/// <param name="timeout">longest time to wait, in milliseconds</param>
+/// <param name="pFrame">pointer in which to return the index of the frame</param>
+/// <returns>S_OK if a frame arrived, S_FALSE if none arrived in time, E_ABORT if processing is stopping</returns>
+HRESULT CMainWindow::WaitForFrame(PipelineStageID stage, DWORD timeout, int* pFrame)
+{
+    SpscQueue<int>* pQueue = &m_pipelineStages[stage].queue;
+    HANDLE hEvents[2] = {m_hProcessStopEvent, pQueue->GetPushEvent()};
+
+    while (!pQueue->Pop(pFrame))
+    {
+        // The push event may still be set from a frame that was already taken, so the queue is checked again
+        DWORD result = WaitForMultipleObjects(ARRAYSIZE(hEvents), hEvents, FALSE, timeout);
+        if (WAIT_OBJECT_0 == result)
+        {
+            return E_ABORT;
+        }
+        if (WAIT_OBJECT_0 + 1 != result)
+        {
+            return S_FALSE;
+        }
+    }
+
+    return S_OK;
+}
+
+/// <summary>
+/// Records how long a stage took for a frame and hands the frame to the next stage
+/// </summary>
+/// <param name="stage">stage that is done with the frame</param>
+/// <param name="frame">index of the frame</param>
+/// <param name="startTime">monotonic time in nanoseconds when the stage started on the frame</param>
+void CMainWindow::CompleteFrame(PipelineStageID stage, int frame, LONGLONG startTime)
+{
+    LONGLONG nanoseconds = GetMonotonicNanoseconds() - startTime;
+    PipelineStage* pStage = &m_pipelineStages[stage];
+    pStage->latency.Record(nanoseconds);
+
+    // Smooth over the last few frames so that the displayed time does not flicker; only this stage writes it
+    LONG microseconds = static_cast<LONG>(nanoseconds / 1000);
+    LONG smoothed = pStage->serviceMicroseconds + (microseconds - pStage->serviceMicroseconds) / 8;
+    InterlockedExchange(&pStage->serviceMicroseconds, smoothed);
+    InterlockedIncrement(&pStage->frameCount);
+
+    // Every queue can hold all frames, so this cannot fail
+    m_pipelineStages[(stage + 1) % PIPELINE_STAGE_COUNT].queue.Push(frame);
+}
+
+/// <summary>
+/// Thread that runs detection on depth frames, calls class instance thread processor
+/// </summary>
+/// <param name="lpParam">instance pointer</param>
+/// <returns>0</returns>
+DWORD WINAPI CMainWindow::AnalyticsThread(LPVOID lpParam)
+{
+    // Use class instance thread processor
+    CMainWindow* pThis = reinterpret_cast<CMainWindow*>(lpParam);
+    return pThis->AnalyticsThread();
+}
+
+/// <summary>
+/// Thread that runs detection on depth frames and keeps the results with the frame
+/// </summary>
+/// <returns>0</returns>
+DWORD WINAPI CMainWindow::AnalyticsThread()
+{
+    TRACE_THREAD_NAME("Analytics");
+
+    int frame;
+    while (S_OK == WaitForFrame(PIPELINE_STAGE_ANALYTICS, INFINITE, &frame))
+    {
+        LONGLONG startTime = GetMonotonicNanoseconds();
+
+        DepthFrame* pFrame = &m_depthFrames[frame];
+        if (pFrame->hasReconfiguration)
+        {
+            // Plan the detector for the new resolution before its first frame arrives
+            m_engine.Prepare(pFrame->reconfiguration.image.size());
+        }
+        else
+        {
+            // The engine publishes into the frame; the publish stage sends the results on
+            pFrame->results.Clear();
+            m_engine.SetPublisher(&pFrame->results);
+            pFrame->detectionResult = m_engine.ProcessFrame(&pFrame->rawDepth, pFrame->timestamp);
+
+            // The pipeline's buffers are reused for the next frame, so the render stage gets its own copy
+            if (SUCCEEDED(pFrame->detectionResult))
+            {
+                Mat filteredDepth;
+                m_engine.GetPipeline()->GetDepth(&filteredDepth);
+                filteredDepth.copyTo(pFrame->filteredDepth);
+                m_engine.GetPipeline()->GetMotionStats(&pFrame->motionStats);
+
+                if (pFrame->settings.isSweepFlowEnabled)
+                {
+                    PublishSweepFlowTarget(pFrame);
+                }
+            }
+        }
+
+        CompleteFrame(PIPELINE_STAGE_ANALYTICS, frame, startTime);
+    }
+
+    return 0;
+}
+
+/// <summary>
+/// Thread that publishes detection results, calls class instance thread processor
+/// </summary>
+/// <param name="lpParam">instance pointer</param>
+/// <returns>0</returns>
+DWORD WINAPI CMainWindow::PublishThread(LPVOID lpParam)
+{
+    // Use class instance thread processor
+    CMainWindow* pThis = reinterpret_cast<CMainWindow*>(lpParam);
+    return pThis->PublishThread();
+}
 
-            // Start painting again
-            ReleaseMutex(m_hPaintWindowMutex);
+/// <summary>
+/// Thread that publishes the detection results of depth frames to ROS, and services the ROS connection
+/// </summary>
+/// <returns>0</returns>
+DWORD WINAPI CMainWindow::PublishThread()
+{
+    TRACE_THREAD_NAME("Publish");
 
-            ResizeWindow();
-            CreateColorImage();
+    // This is the only thread that touches the ROS connection once the pipeline runs
+    int frame;
+    HRESULT hr;
+    while (SUCCEEDED(hr = WaitForFrame(PIPELINE_STAGE_PUBLISH, ROS_SPIN_INTERVAL, &frame)))
+    {
+        if (S_OK != hr)
+        {
+            m_rosPublisher.Spin();
+            continue;
         }
 
-        // Use a mutex to check for update to depth resolution
-        WaitForSingleObject(m_hDepthResolutionMutex, INFINITE);
-        NUI_IMAGE_RESOLUTION newDepthResolution = m_depthResolution;
-        ReleaseMutex(m_hDepthResolutionMutex);
+        LONGLONG startTime = GetMonotonicNanoseconds();
 
-        // Reopen depth image stream if necessary
-        if (depthResolution != newDepthResolution)
+        DepthFrame* pFrame = &m_depthFrames[frame];
+        if (!pFrame->hasReconfiguration && SUCCEEDED(pFrame->detectionResult))
         {
-            // Stop painting while we change resolution
-            WaitForSingleObject(m_hPaintWindowMutex, INFINITE);
+            m_rosPublisher.SetSourceTime(pFrame->captureTime);
+            pFrame->results.PublishTo(&m_rosPublisher);
+        }
+        m_rosPublisher.Spin();
 
-            depthResolution = newDepthResolution;
+        CompleteFrame(PIPELINE_STAGE_PUBLISH, frame, startTime);
+    }
 
-            HRESULT hr = m_frameHelper.SetDepthFrameResolution(depthResolution);
-            if (FAILED(hr))
-            {
-                SetStatusMessage(IDS_ERROR_KINECT_DEPTH);
-            }
+    return 0;
+}
 
-            // Start painting again
-            ReleaseMutex(m_hPaintWindowMutex);
-            ResizeWindow();
-			CreateDepthImage();            
-			//CreateDepthImagePrev(); 
-        }
+/// <summary>
+/// Thread that renders depth frames, calls class instance thread processor
+/// </summary>
+/// <param name="lpParam">instance pointer</param>
+/// <returns>0</returns>
+DWORD WINAPI CMainWindow::RenderThread(LPVOID lpParam)
+{
+    // Use class instance thread processor
+    CMainWindow* pThis = reinterpret_cast<CMainWindow*>(lpParam);
+    return pThis->RenderThread();
+}
 
-        // Wait for any event to be signalled
-        int eventId = WaitForMultipleObjects(numEvents, hEvents, FALSE, 100);
+/// <summary>
+/// Thread that renders depth frames into the depth bitmap and returns them to the capture stage
+/// </summary>
+/// <returns>0</returns>
+DWORD WINAPI CMainWindow::RenderThread()
+{
+    TRACE_THREAD_NAME("Render");
 
-        // No events were signalled in time
-        if (WAIT_TIMEOUT == eventId)
+    int frame;
+    while (S_OK == WaitForFrame(PIPELINE_STAGE_RENDER, INFINITE, &frame))
+    {
+        LONGLONG startTime = GetMonotonicNanoseconds();
+
+        DepthFrame* pFrame = &m_depthFrames[frame];
+        if (pFrame->hasReconfiguration)
         {
-            continue;
+            SwapDepthBuffers(&pFrame->reconfiguration);
+            pFrame->hasReconfiguration = false;
         }
-
-        // Stop event was signalled
-        if (WAIT_OBJECT_0 == eventId)
+        else if (IsDisplayVisible() && m_pipelineStages[PIPELINE_STAGE_RENDER].queue.GetCount() == 0)
         {
-            continueProcessing = false;
-            break;
+            // A frame is only drawn when no newer one is waiting, so that the display catches up instead of lagging
+            RenderDepthFrame(pFrame);
         }
 
-        // Update image outputs
-        if (m_frameHelper.IsInitialized()) 
-        {
-            // Update skeleton frame
-            NUI_SKELETON_FRAME skeletonFrame;
-            if (((m_bIsSkeletonDrawDepth && !m_bIsDepthPaused) || (m_bIsSkeletonDrawColor && !m_bIsColorPaused))
-                && SUCCEEDED(m_frameHelper.UpdateSkeletonFrame())) 
-            {
-                m_frameHelper.GetSkeletonFrame(&skeletonFrame);
-            }
+        CompleteFrame(PIPELINE_STAGE_RENDER, frame, startTime);
+    }
 
-            // Update color frame
-            if (!m_bIsColorPaused && SUCCEEDED(m_frameHelper.UpdateColorFrame())) 
-            {
-                HRESULT hr = m_frameHelper.GetColorImage(&m_colorMat);
-                if (FAILED(hr))
-                {
-                    continue;
-                }
+    return 0;
+}
 
-                // Apply filter to color stream
-                hr = m_openCVHelper.ApplyColorFilter(&m_colorMat);
-                if (FAILED(hr))
-                {
-                    continue;
-                }
+/// <summary>
+/// Renders a depth frame into the depth bitmap
+/// </summary>
+/// <param name="pFrame">pointer to frame to render</param>
+void CMainWindow::RenderDepthFrame(DepthFrame* pFrame)
+{
+    if (SUCCEEDED(pFrame->detectionResult))
+    {
+        UpdateMotionStatus(&pFrame->motionStats);
+    }
 
-                // Draw skeleton onto color stream
-                if (m_bIsSkeletonDrawColor) 
-                {
-                    hr = m_openCVHelper.DrawSkeletonsInColorImage(&m_colorMat, &skeletonFrame, colorResolution, depthResolution);
-                    if (FAILED(hr))
-                    {
-                        continue;
-                    }
-                }
+    // Show the depth the detection saw, or the raw frame if the pipeline did not run
+    m_depthMat.create(pFrame->rawDepth.size(), m_frameHelper.DEPTH_RGB_TYPE);
+    HRESULT hr = pFrame->detectionResult;
+    if (SUCCEEDED(hr))
+    {
+        hr = m_frameHelper.GetFilteredDepthImageAsArgb(&pFrame->filteredDepth, &pFrame->rawDepth, &m_depthMat);
+    }
+    if (FAILED(hr))
+    {
+        hr = m_frameHelper.GetRawDepthImageAsArgb(&pFrame->rawDepth, &m_depthMat);
+    }
+    if (FAILED(hr))
+    {
+        return;
+    }
 
-                // Update bitmap for drawing
-                WaitForSingleObject(m_hColorBitmapMutex, INFINITE);
-                UpdateBitmap(&m_colorMat, &m_hColorBitmap, &m_bmiColor);
-                ReleaseMutex(m_hColorBitmapMutex);
+    // Apply filter to depth stream
+    m_depthOpenCVHelper.SetDepthFilter(pFrame->settings.depthFilterID);
+    hr = m_depthOpenCVHelper.ApplyDepthFilter(&m_depthMat);
+    if (FAILED(hr))
+    {
+        return;
+    }
 
-                // Notify frame rate tracker that new frame has been rendered
-                m_colorFrameRateTracker.Tick();
-            }
+    // Draw skeleton onto depth stream
+    m_depthOverlay.Clear(m_depthMat.size());
+    if (pFrame->hasSkeletonFrame)
+    {
+        hr = m_depthOpenCVHelper.DrawSkeletonsInDepthImage(&m_depthOverlay, &pFrame->skeletonFrame, pFrame->depthResolution);
+        if (FAILED(hr))
+        {
+            return;
+        }
+    }
 
-            // Update depth frame
-            if (!m_bIsDepthPaused && SUCCEEDED(m_frameHelper.UpdateDepthFrame())) 
-            {
-				HRESULT hr = m_frameHelper.SaveOldDepthImage(&m_depthMat,&m_depthMatPrev);
-                hr = m_frameHelper.GetDepthImageAsArgb(&m_depthMat, &m_depthMatPrev,&m_depthMatDelta1,&m_depthMatDelta2);
+    // Update bitmap for drawing, unless it was already switched to another resolution
+    WaitForSingleObject(m_hDepthBitmapMutex, INFINITE);
+    if (m_depthMat.cols == m_bmiDepth.bmiHeader.biWidth && m_depthMat.rows == -m_bmiDepth.bmiHeader.biHeight)
+    {
+        UpdateBitmap(&m_depthMat, &m_depthOverlay, &m_hDepthBitmap, &m_bmiDepth);
+    }
+    ReleaseMutex(m_hDepthBitmapMutex);
 
+    // Notify frame rate tracker that new frame has been rendered
+    m_depthFrameRateTracker.Tick();
 
-				static TCHAR szRes[15];
+    // Tell the window to paint the new bitmap
+    WaitForSingleObject(m_hPaintWindowMutex, INFINITE);
+    InvalidateRect(m_hWndMain, NULL, false);
+    ReleaseMutex(m_hPaintWindowMutex);
+}
 
-				float_msg.data = (float)((int)hr);
-				if ((int)hr > 1) sweep_pub.publish(&float_msg);
+/// <summary>
+/// Switches the depth bitmap over to the resolution the depth stream was reopened at
+/// </summary>
+/// <param name="pReconfiguration">pointer to the prepared buffers, which are taken over</param>
+void CMainWindow::SwapDepthBuffers(StreamReconfiguration* pReconfiguration)
+{
+    m_depthMat = pReconfiguration->image;
 
-				swprintf(&szRes[0], (wchar_t*)"Median: %d", (int)hr);
-				SendMessageW(m_hWndStatus, SB_SETTEXT, 0, reinterpret_cast<LPARAM>(szRes));
+    // The bitmap mutex only guards the handle swap; the old bitmap is freed afterwards
+    WaitForSingleObject(m_hDepthBitmapMutex, INFINITE);
+    HBITMAP hOldBitmap = m_hDepthBitmap;
+    m_hDepthBitmap = pReconfiguration->hBitmap;
+    m_bmiDepth = pReconfiguration->bmi;
+    ReleaseMutex(m_hDepthBitmapMutex);
 
+    if (hOldBitmap)
+    {
+        DeleteObject(hOldBitmap);
+    }
 
-                // Apply filter to depth stream
-                hr = m_openCVHelper.ApplyDepthFilter(&m_depthMat);
-                if (FAILED(hr))
-                {
-                    continue;
-                }
+    pReconfiguration->image.release();
+    pReconfiguration->hBitmap = NULL;
 
-                // Draw skeleton onto depth stream
-                if (m_bIsSkeletonDrawDepth)
-                {
-                    hr = m_openCVHelper.DrawSkeletonsInDepthImage(&m_depthMat, &skeletonFrame, depthResolution);
-                    if (FAILED(hr))
-                    {
-                        continue;
-                    }
-                }
+    // Resize on the window thread rather than waiting for it here
+    if (m_hWndMain)
+    {
+        PostMessage(m_hWndMain, WM_STREAM_SIZE_CHANGED, 0, 0);
+    }
+}
 
-                // Update bitmap for drawing
-                WaitForSingleObject(m_hDepthBitmapMutex, INFINITE);
-                UpdateBitmap(&m_depthMat, &m_hDepthBitmap, &m_bmiDepth);
-				UpdateBitmap(&m_depthMatPrev, &m_hDepthBitmapPrev, &m_bmiDepth);
-                ReleaseMutex(m_hDepthBitmapMutex);
+/// <summary>
+/// Finds the moving region of the latest analyzed frame and hands it to the capture stage
+/// </summary>
+/// <param name="pFrame">pointer to the analyzed frame</param>
+void CMainWindow::PublishSweepFlowTarget(const DepthFrame* pFrame)
+{
+    SweepFlowTarget target;
+    target.isVisible = false;
+    target.centroidDepth = 0;
+    target.depthSize = pFrame->filteredDepth.size();
+
+    // Follow the longest tracked blob that is visible in the frame: the sweepers stay in view for the whole
+    // stroke, while newer blobs are more often short-lived noise that would make the region jump around
+    const BlobTracker* pBlobTracker = m_engine.GetBlobTracker();
+    const TrackedBlob* pBlobs = pBlobTracker->GetBlobs();
+    const TrackedBlob* pTargetBlob = NULL;
+    for (int i = 0; i < pBlobTracker->GetBlobCount(); ++i)
+    {
+        if (pBlobs[i].missedFrames == 0 && (!pTargetBlob || pBlobs[i].age > pTargetBlob->age))
+        {
+            pTargetBlob = &pBlobs[i];
+        }
+    }
 
-                // Notify frame rate tracker that new frame has been rendered
-                m_depthFrameRateTracker.Tick();
-            }
+    if (pTargetBlob)
+    {
+        target.isVisible = true;
+        target.bounds = pTargetBlob->bounds;
+        target.centroid = pTargetBlob->centroid;
 
-            // Tell the window to paint the new bitmap
-            WaitForSingleObject(m_hPaintWindowMutex, INFINITE);
-            InvalidateRect(m_hWndMain, NULL, false);
-            ReleaseMutex(m_hPaintWindowMutex);
-        }
+        int centroidX = min(target.depthSize.width - 1, max(0, cvRound(target.centroid.x)));
+        int centroidY = min(target.depthSize.height - 1, max(0, cvRound(target.centroid.y)));
+        target.centroidDepth = pFrame->filteredDepth.ptr<USHORT>(centroidY)[centroidX];
     }
-	nh.spinOnce();
 
-    return 0;
+    m_sweepFlowTargetChannel.Publish(&target);
 }
 
 /// <summary>
@@ -741,10 +1628,9 @@ void CMainWindow::PaintWindow()
     HGDIOBJ hOldBitmap = SelectObject(hdcBuffer, hBitmap);
     FillRect(hdcBuffer, &windowRect, GetSysColorBrush(COLOR_WINDOW));
 
-    // Get color stream information text
-    WaitForSingleObject(m_hColorResolutionMutex, INFINITE);
-    wstring colorStreamInfoText = GenerateStreamInformation(m_colorResolution, m_colorFilterID, m_colorFrameRateTracker.CurrentFPS());
-    ReleaseMutex(m_hColorResolutionMutex);
+    // Get color stream information text; the settings belong to this thread
+    wstring colorStreamInfoText = GenerateStreamInformation(m_settings.colorResolution, m_settings.colorFilterID, m_colorFrameRateTracker.CurrentFPS());
+    colorStreamInfoText += _TEXT("\r\n") + GenerateFrameIntervalInformation(&m_colorFrameRateTracker);
 
     // Paint color bitmap
     WaitForSingleObject(m_hColorBitmapMutex, INFINITE);
@@ -756,10 +1642,11 @@ void CMainWindow::PaintWindow()
     GetObject(m_hColorBitmap, sizeof(bmColor), &bmColor);
     DWORD colorBitmapWidth = bmColor.bmWidth;
 
-    // Get depth stream information text
-    WaitForSingleObject(m_hDepthResolutionMutex, INFINITE);
-    wstring depthStreamInfoText = GenerateStreamInformation(m_depthResolution, m_depthFilterID, m_depthFrameRateTracker.CurrentFPS());
-    ReleaseMutex(m_hDepthResolutionMutex);
+    // Get depth stream information text, with how the pipeline stages keep up
+    wstring depthStreamInfoText = GenerateStreamInformation(m_settings.depthResolution, m_settings.depthFilterID, m_depthFrameRateTracker.CurrentFPS());
+    depthStreamInfoText += _TEXT("\r\n") + GenerateFrameIntervalInformation(&m_depthFrameRateTracker);
+    depthStreamInfoText += _TEXT("\r\n") + GeneratePipelineInformation();
+    depthStreamInfoText += _TEXT("\r\n") + GenerateSweepLatencyInformation();
 
     // Paint depth bitmap
     WaitForSingleObject(m_hDepthBitmapMutex, INFINITE);
@@ -802,14 +1689,16 @@ void CMainWindow::PaintWindow()
 /// <param name="hMenu">menu to initialize</param>
 void CMainWindow::InitSettings(HMENU hMenu)
 {
+    // Start from the default settings and hand them to the processing thread before it starts
+    m_settings = StreamSettings();
+    PublishSettings();
+
     // Set default color resolution, checking the appropriate radio buttons
-    m_colorResolution = NUI_IMAGE_RESOLUTION_640x480;
-    m_frameHelper.SetColorFrameResolution(m_colorResolution);
+    m_frameHelper.SetColorFrameResolution(m_settings.colorResolution);
     CheckMenuRadioItem(hMenu, COLOR_RESOLUTION_FIRST, COLOR_RESOLUTION_LAST, IDM_COLOR_RESOLUTION_640x480, MF_BYCOMMAND);
 
     // Set default depth resolution, checking the appropriate radio buttons
-    m_depthResolution = NUI_IMAGE_RESOLUTION_640x480;
-    m_frameHelper.SetDepthFrameResolution(m_depthResolution);
+    m_frameHelper.SetDepthFrameResolution(m_settings.depthResolution);
     CheckMenuRadioItem(hMenu, DEPTH_RESOLUTION_FIRST, DEPTH_RESOLUTION_LAST, IDM_DEPTH_RESOLUTION_640x480, MF_BYCOMMAND);
 
     // Check default filter radio buttons
@@ -908,10 +1797,6 @@ HRESULT CMainWindow::CreateDepthImage()
     {
         DeleteObject(m_hDepthBitmap);
     }
-	if (m_hDepthBitmapPrev)
-	{
-		DeleteObject(m_hDepthBitmapPrev);
-	}
 
     DWORD width, height;
     m_frameHelper.GetDepthFrameSize(&width, &height);
@@ -922,41 +1807,26 @@ HRESULT CMainWindow::CreateDepthImage()
     // Create the bitmap
     WaitForSingleObject(m_hDepthBitmapMutex, INFINITE);
     HRESULT hr = CreateBitmap(size, &m_hDepthBitmap, &m_bmiDepth, m_pDepthBitmapBits, IDS_ERROR_BITMAP_DEPTH);
-	hr = CreateBitmap(size, &m_hDepthBitmapPrev, &m_bmiDepth, m_pDepthBitmapBits, IDS_ERROR_BITMAP_DEPTH);
-
     ReleaseMutex(m_hDepthBitmapMutex);
 
     return hr;
 }
 
-HRESULT CMainWindow::CreateDepthImagePrev()
+/// <summary>
+/// Builds the detection pipeline from its config file, or from the defaults if there is none
+/// </summary>
+/// <returns>S_OK if successful, an error code otherwise</returns>
+HRESULT CMainWindow::CreateDetectionPipeline()
 {
-	DWORD width, height;
-	m_frameHelper.GetDepthFrameSize(&width, &height);
-
-	Size size(width, height);
-	m_depthMatPrev.create(size, m_frameHelper.DEPTH_TYPE);
-	m_depthMatDelta1.create(size, m_frameHelper.DEPTH_TYPE);
-	m_depthMatDelta2.create(size, m_frameHelper.DEPTH_TYPE);
-	return S_OK;
-
-	//if (m_hDepthBitmapPrev)
-	//{
-	//	DeleteObject(m_hDepthBitmapPrev);
-	//}
-
-	//DWORD width, height;
-	//m_frameHelper.GetDepthFrameSize(&width, &height);
-
-	//Size size(width, height);
-	//m_depthMatPrev.create(size, m_frameHelper.DEPTH_RGB_TYPE);
-
-	//// Create the bitmap
-	//WaitForSingleObject(m_hDepthBitmapMutex, INFINITE);
-	//HRESULT hr = CreateBitmap(size, &m_hDepthBitmapPrev, &m_bmiDepth, m_pDepthBitmapBits, IDS_ERROR_BITMAP_DEPTH);
-	//ReleaseMutex(m_hDepthBitmapMutex);
+    // The engine falls back to the default stages rather than running without detection
+    HRESULT hr = m_engine.Initialize(PIPELINE_CONFIG_FILE_NAME);
+    if (S_FALSE == hr)
+    {
+        SetStatusMessage(IDS_ERROR_PIPELINE_CONFIG);
+        hr = S_OK;
+    }
 
-	//return hr;
+    return hr;
 }
 
 /// <summary>
@@ -999,15 +1869,21 @@ HRESULT CMainWindow::CreateBitmap(Size size, HBITMAP* phBitmap, BITMAPINFO* pBmi
 }
 
 /// <summary>
-/// Updates the specified bitmap using the Mat
+/// Composites the overlay onto the Mat and updates the specified bitmap with the result
 /// </summary>
-/// <param name="pImg">pointer to Mat with image data</param>
+/// <param name="pImg">pointer to Mat with display image data, which the overlay is drawn into</param>
+/// <param name="pOverlay">pointer to overlay annotating the image</param>
 /// <param name="phBitmap">pointer to handle of the bitmap to update</param>
 /// <param name="pBmi">pointer to BITMAPINFO for updated bitmap</param>
-void CMainWindow::UpdateBitmap(Mat* pImg, HBITMAP* phBitmap, BITMAPINFO* pBmi)
+void CMainWindow::UpdateBitmap(Mat* pImg, const Overlay* pOverlay, HBITMAP* phBitmap, BITMAPINFO* pBmi)
 {
+    TRACE_SCOPE("UpdateBitmap");
+
     int height = -pBmi->bmiHeader.biHeight;
 
+    // This is the only place overlays are rasterized, so nothing is drawn for frames nobody sees
+    pOverlay->Render(pImg);
+
     // Update bitmap
     SetDIBits(m_hdc, *phBitmap, 0, height, pImg->ptr(), pBmi, DIB_RGB_COLORS);
 }
@@ -1206,11 +2082,270 @@ wstring CMainWindow::GenerateStreamInformation(NUI_IMAGE_RESOLUTION resolution,
 }
 
 /// <summary>
-/// Computes framerate based on the interval between two timings taken with clock()
+/// Converts percentiles of durations into a string
+/// </summary>
+/// <param name="pSummary">pointer to percentiles in nanoseconds</param>
+wstring CMainWindow::LatencyToString(const LatencySummary* pSummary)
+{
+    wostringstream stream;
+    stream.setf(ios::fixed);
+    stream.precision(1);
+    stream << L"p50 " << pSummary->p50 / 1e6 << L", p95 " << pSummary->p95 / 1e6 << L", p99 " << pSummary->p99 / 1e6
+        << L", max " << pSummary->max / 1e6 << L" ms";
+    return stream.str();
+}
+
+/// <summary>
+/// Generates a string with the distribution and jitter of the intervals between frames of a stream
+/// </summary>
+/// <param name="pTracker">pointer to frame rate tracker of the stream</param>
+wstring CMainWindow::GenerateFrameIntervalInformation(const FrameRateTracker* pTracker)
+{
+    LatencySummary summary;
+    pTracker->GetIntervalSummary(&summary);
+
+    wostringstream stream;
+    stream.setf(ios::fixed);
+    stream.precision(1);
+    stream << L"Interval: " << LatencyToString(&summary) << L", jitter " << pTracker->GetJitterMilliseconds() << L" ms";
+    return stream.str();
+}
+
+/// <summary>
+/// Generates a string with how old sweep events are when written to the robot, and how long writing takes
+/// </summary>
+wstring CMainWindow::GenerateSweepLatencyInformation()
+{
+    LatencySummary latency, writeTime;
+    m_rosPublisher.GetSweepLatencySummary(&latency);
+    m_rosPublisher.GetSweepWriteSummary(&writeTime);
+
+    return L"Sweep age: " + LatencyToString(&latency) + L"\r\nSweep write: " + LatencyToString(&writeTime);
+}
+
+/// <summary>
+/// Generates a string with the queue depth and time per frame of every depth pipeline stage
+/// </summary>
+wstring CMainWindow::GeneratePipelineInformation()
+{
+    static const wchar_t* stageNames[PIPELINE_STAGE_COUNT] = {L"Capture", L"Analytics", L"Publish", L"Render"};
+
+    wostringstream stream;
+    stream.setf(ios::fixed);
+    stream.precision(1);
+    for (int i = 0; i < PIPELINE_STAGE_COUNT; ++i)
+    {
+        if (i > 0)
+        {
+            stream << L"\r\n";
+        }
+
+        // The queue of the capture stage holds the free frames rather than waiting ones
+        const PipelineStage& stage = m_pipelineStages[i];
+        LatencySummary summary;
+        stage.latency.GetSummary(&summary);
+        stream << stageNames[i] << L": " << stage.queue.GetCount() << (i == PIPELINE_STAGE_CAPTURE ? L" free, " : L" queued, ")
+            << stage.serviceMicroseconds / 1000.0 << L" ms (" << LatencyToString(&summary) << L")";
+        if (i == PIPELINE_STAGE_CAPTURE)
+        {
+            stream << L", " << m_droppedDepthFrames << L" dropped";
+        }
+    }
+
+    return stream.str();
+}
+
+/// <summary>
+/// Shows where motion was found in a depth frame in the status bar
+/// </summary>
+/// <param name="pStats">pointer to motion statistics of the frame</param>
+void CMainWindow::UpdateMotionStatus(const MotionStats* pStats)
+{
+    static WCHAR szRes[64];
+    if (pStats->count > 0)
+    {
+        swprintf_s(szRes, L"Motion: %d px, median (%d, %d)", pStats->count, pStats->median.x, pStats->median.y);
+    }
+    else
+    {
+        swprintf_s(szRes, L"Motion: none");
+    }
+    SendMessageW(m_hWndStatus, SB_SETTEXT, 0, reinterpret_cast<LPARAM>(szRes));
+}
+
+/// <summary>
+/// Connects to the ROS server and has the detection engine publish to it
+/// </summary>
+void CMainWindow::InitializeRos()
+{
+    m_rosPublisher.Initialize(ROS_SERVER_ADDRESS, ROS_SERVER_PORT);
+}
+
+/// <summary>
+/// Starts recording the raw depth frames if a recording file was set
+/// </summary>
+void CMainWindow::StartRecording()
+{
+    if (m_recordingFileName.empty())
+    {
+        return;
+    }
+
+    // Recording stops by itself if the depth resolution is changed later
+    DWORD width, height;
+    m_frameHelper.GetDepthFrameSize(&width, &height);
+    m_engine.StartRecording(m_recordingFileName, Size(width, height));
+}
+
+/// <summary>
+/// Creates the shared memory frame rings if a share name was set
+/// </summary>
+void CMainWindow::StartFrameSharing()
+{
+    if (m_sharedFrameRingName.empty())
+    {
+        return;
+    }
+
+    // Slots are sized for the largest resolution of each stream, so changing resolution keeps sharing.
+    // Like recording, sharing is best effort: a ring that cannot be created, for example because another
+    // instance uses the name, stays closed and its frames are not written.
+    m_depthFrameRing.Create(m_sharedFrameRingName + "Depth", SHARED_FRAME_RING_SLOT_COUNT, 640 * 480 * sizeof(USHORT));
+    m_colorFrameRing.Create(m_sharedFrameRingName + "Color", SHARED_FRAME_RING_SLOT_COUNT, 1280 * 960 * 4);
+}
+
+/// <summary>
+/// Loads or builds the registration table for the resolutions the streams start at, before any frame is processed
+/// </summary>
+void CMainWindow::StartRegistration()
+{
+    // Without the table the sweep region is scaled from depth to color coordinates instead
+    if (FAILED(m_registration.Initialize(m_settings.depthResolution, m_settings.colorResolution)))
+    {
+        SetStatusMessage(IDS_ERROR_REGISTRATION);
+    }
+}
+
+/// <summary>
+/// Puts the resolution setting of a stream that could not be reopened back to the resolution it is open at,
+/// unless it has been changed again since
+/// </summary>
+/// <param name="isColor">true for the color stream, false for the depth stream</param>
+/// <param name="resolution">resolution the stream is open at</param>
+/// <param name="failedResolution">resolution the stream could not be reopened at</param>
+void CMainWindow::RestoreStreamResolution(bool isColor, NUI_IMAGE_RESOLUTION resolution, NUI_IMAGE_RESOLUTION failedResolution)
+{
+    NUI_IMAGE_RESOLUTION* pSetting = isColor ? &m_settings.colorResolution : &m_settings.depthResolution;
+    if (*pSetting != failedResolution)
+    {
+        return;
+    }
+
+    *pSetting = resolution;
+    PublishSettings();
+
+    HMENU hMenu = GetMenu(m_hWndMain);
+    if (isColor)
+    {
+        int itemID = (NUI_IMAGE_RESOLUTION_1280x960 == resolution) ? IDM_COLOR_RESOLUTION_1280x960 : IDM_COLOR_RESOLUTION_640x480;
+        CheckMenuRadioItem(hMenu, COLOR_RESOLUTION_FIRST, COLOR_RESOLUTION_LAST, itemID, MF_BYCOMMAND);
+    }
+    else
+    {
+        int itemID = (NUI_IMAGE_RESOLUTION_320x240 == resolution) ? IDM_DEPTH_RESOLUTION_320x240 : IDM_DEPTH_RESOLUTION_640x480;
+        CheckMenuRadioItem(hMenu, DEPTH_RESOLUTION_FIRST, DEPTH_RESOLUTION_LAST, itemID, MF_BYCOMMAND);
+    }
+}
+
+/// <summary>
+/// Hands the current stream settings to the processing thread, which applies them before its next frame
+/// </summary>
+void CMainWindow::PublishSettings()
+{
+    // Publishing only fails when a small allocation fails, and then the previous settings stay in effect
+    m_settingsChannel.Publish(&m_settings);
+}
+
+/// <summary>
+/// Gets whether anyone can see the rendered streams, so that visualization can be skipped otherwise
+/// </summary>
+/// <returns>true if there is a window and it is not minimized</returns>
+bool CMainWindow::IsDisplayVisible() const
+{
+    return !m_bIsHeadless && m_hWndMain && !IsIconic(m_hWndMain);
+}
+
+/// <summary>
+/// Points the sweep direction estimator at the moving region found in the latest analyzed depth frame
 /// </summary>
-/// <param name="startClock">starting clock value of interval</param>
-/// <param name="endClock">ending clock value of interval</param>
-double CMainWindow::CalculateFrameRate(clock_t startClock, clock_t endClock)
+/// <param name="pTarget">pointer to the moving region</param>
+/// <param name="colorResolution">resolution of color image stream</param>
+/// <param name="depthResolution">resolution of depth image stream</param>
+void CMainWindow::UpdateSweepFlowRegion(const SweepFlowTarget* pTarget, NUI_IMAGE_RESOLUTION colorResolution, NUI_IMAGE_RESOLUTION depthResolution)
 {
-    return floor(1 / ((endClock - startClock) / static_cast<double>(CLOCKS_PER_SEC) ));
-}
\ No newline at end of file
+    // Without registration depth and color pixels only line up roughly, so the region is grown by this fraction
+    // on every side; with it only the blob's own depth spread needs covering
+    const float unregisteredPadding = 0.25f;
+    const float registeredPadding = 0.1f;
+
+    DWORD colorWidth, colorHeight, depthWidth, depthHeight;
+    NuiImageResolutionToSize(colorResolution, colorWidth, colorHeight);
+    NuiImageResolutionToSize(depthResolution, depthWidth, depthHeight);
+
+    // The table is prepared when the streams start or change resolution; without it the region is scaled
+    // instead. The region comes from a frame analyzed a little earlier, which may still be of the previous
+    // depth resolution.
+    bool isRegistered = m_registration.IsInitialized(depthResolution, colorResolution) &&
+        pTarget->depthSize.width == static_cast<int>(depthWidth) && pTarget->depthSize.height == static_cast<int>(depthHeight);
+
+    if (pTarget->isVisible)
+    {
+        const Rect& bounds = pTarget->bounds;
+        int left, top, right, bottom;
+
+        // Map the padded bounds at the depth of the blob's centroid
+        int centroidDepth = isRegistered ? pTarget->centroidDepth : 0;
+
+        Point topLeft, bottomRight;
+        int padX = static_cast<int>(bounds.width * registeredPadding);
+        int padY = static_cast<int>(bounds.height * registeredPadding);
+        int depthLeft = max(0, bounds.x - padX);
+        int depthTop = max(0, bounds.y - padY);
+        int depthRight = min(static_cast<int>(depthWidth) - 1, bounds.x + bounds.width - 1 + padX);
+        int depthBottom = min(static_cast<int>(depthHeight) - 1, bounds.y + bounds.height - 1 + padY);
+
+        if (centroidDepth > 0 &&
+            SUCCEEDED(m_registration.MapDepthPixel(depthLeft, depthTop, centroidDepth, &topLeft)) &&
+            SUCCEEDED(m_registration.MapDepthPixel(depthRight, depthBottom, centroidDepth, &bottomRight)))
+        {
+            left = max(0, topLeft.x);
+            top = max(0, topLeft.y);
+            right = min(static_cast<int>(colorWidth), bottomRight.x + 1);
+            bottom = min(static_cast<int>(colorHeight), bottomRight.y + 1);
+        }
+        else
+        {
+            float scaleX = static_cast<float>(colorWidth) / pTarget->depthSize.width;
+            float scaleY = static_cast<float>(colorHeight) / pTarget->depthSize.height;
+            padX = static_cast<int>(bounds.width * unregisteredPadding);
+            padY = static_cast<int>(bounds.height * unregisteredPadding);
+
+            left = max(0, static_cast<int>((bounds.x - padX) * scaleX));
+            top = max(0, static_cast<int>((bounds.y - padY) * scaleY));
+            right = min(static_cast<int>(colorWidth), static_cast<int>((bounds.x + bounds.width + padX) * scaleX));
+            bottom = min(static_cast<int>(colorHeight), static_cast<int>((bounds.y + bounds.height + padY) * scaleY));
+        }
+
+        // The blob may map entirely outside the color image
+        if (right > left && bottom > top)
+        {
+            m_sweepFlowRegion = Rect(left, top, right - left, bottom - top);
+            m_sweepFlowEstimator.SetRegionOfInterest(m_sweepFlowRegion);
+            return;
+        }
+    }
+
+    // Nothing is moving, so track over the whole image
+    m_sweepFlowRegion = Rect();
+    m_sweepFlowEstimator.ClearRegionOfInterest();
+}
@@ -19,6 +19,15 @@
 
 #include "OpenCVHelper.h"
 #include "FrameRateTracker.h"
+#include "DetectionEngine.h"
+#include "RosPublisher.h"
+#include "DepthColorRegistration.h"
+#include "StreamSettings.h"
+#include "SnapshotChannel.h"
+#include "SpscQueue.h"
+#include "DetectionResults.h"
+#include "SharedFrameRing.h"
+#include "SensorClock.h"
 
 class CMainWindow
 {
@@ -44,6 +53,114 @@ class CMainWindow
 	static const int BITMAP_VERTICAL_BORDER_PADDING = 10;
 	static const int MENU_BAR_HORIZONTAL_BORDER_PADDING = 5;
 
+    // Detection pipeline config, read from the working directory at startup
+    static const char* PIPELINE_CONFIG_FILE_NAME;
+
+    // Chrome trace written to the working directory from the diagnostics menu
+    static const char* TRACE_FILE_NAME;
+
+    // Posted to the window when a stream changed resolution, so that it resizes on its own thread
+    static const UINT WM_STREAM_SIZE_CHANGED = WM_APP + 1;
+
+    // Posted to the window when a stream could not be reopened, so that its resolution setting is put back
+    static const UINT WM_STREAM_RESOLUTION_FAILED = WM_APP + 2;
+
+    // Depth frames that can be in the processing pipeline at once; every stage queue can hold all of them
+    static const int PIPELINE_FRAME_COUNT = 4;
+
+    // How often the publish stage services the ROS connection when there are no frames, in milliseconds
+    static const DWORD ROS_SPIN_INTERVAL = 10;
+
+    // Frames each shared memory ring holds before the oldest is overwritten
+    static const int SHARED_FRAME_RING_SLOT_COUNT = 8;
+
+    // Types:
+    // Stream resolution change that is prepared while the stream is reopened in the background
+    struct StreamReconfiguration
+    {
+        bool isColor;
+        NUI_IMAGE_RESOLUTION resolution;
+
+        // Resolution the other stream stays at, which the new registration table is built for
+        NUI_IMAGE_RESOLUTION otherResolution;
+
+        // Results of reopening the stream and of preparing the registration table for the new
+        // resolutions, written by the reconfiguration thread before it exits
+        HRESULT hr;
+        HRESULT registrationResult;
+
+        // Buffers for the new resolution, swapped in once the stream is open
+        Mat image;
+        BITMAPINFO bmi;
+        HBITMAP hBitmap;
+    };
+
+    // Stages of the depth pipeline, in the order a frame passes through them. Each runs on its own
+    // thread; the frames a stage has finished go on to the queue of the next, and rendered frames go
+    // back to the queue of the capture stage to be reused.
+    enum PipelineStageID
+    {
+        PIPELINE_STAGE_CAPTURE,
+        PIPELINE_STAGE_ANALYTICS,
+        PIPELINE_STAGE_PUBLISH,
+        PIPELINE_STAGE_RENDER,
+        PIPELINE_STAGE_COUNT
+    };
+
+    // Queue of frames waiting for a stage, and how long the stage takes per frame
+    struct PipelineStage
+    {
+        SpscQueue<int> queue;
+        HANDLE hThread;
+
+        // Smoothed time the stage spends on a frame, and the number of frames it handled
+        volatile LONG serviceMicroseconds;
+        volatile LONG frameCount;
+
+        // Every time the stage spent on a frame
+        LatencyHistogram latency;
+    };
+
+    // Moving region found by the analytics stage, which the sweep direction is measured in
+    struct SweepFlowTarget
+    {
+        bool isVisible;
+        Rect bounds;
+        Point2f centroid;
+
+        // Depth at the centroid in millimeters, 0 if unknown, and the size of the depth frame
+        int centroidDepth;
+        Size depthSize;
+    };
+
+    // Depth frame passed between the pipeline stages by its index; each field is only touched by the
+    // stage that currently holds the frame
+    struct DepthFrame
+    {
+        // Taken by the capture stage
+        Mat rawDepth;
+        DWORD timestamp;
+
+        // Monotonic time the sensor took the frame at, in nanoseconds
+        LONGLONG captureTime;
+
+        StreamSettings settings;
+        NUI_IMAGE_RESOLUTION depthResolution;
+        bool hasSkeletonFrame;
+        NUI_SKELETON_FRAME skeletonFrame;
+
+        // Set instead of a frame when the depth stream was reopened at another resolution;
+        // the stages switch over when it reaches them
+        bool hasReconfiguration;
+        StreamReconfiguration reconfiguration;
+
+        // Results of the analytics stage
+        HRESULT detectionResult;
+        Mat filteredDepth;
+        MotionStats motionStats;
+        DetectionResults results;
+    };
+
 public:
     // Functions:
     /// <summary>
@@ -64,6 +181,31 @@ public:
     /// <returns>WPARAM of final message as int</returns>
     int Run(HINSTANCE hInstance, int nCmdShow);
 
+    /// <summary>
+    /// Runs detection and publishing without a window, until the processing thread ends or WM_QUIT is posted
+    /// </summary>
+    /// <param name="hInstance">handle to the application instance</param>
+    /// <returns>0 if the Kinect was started, 1 otherwise</returns>
+    int RunHeadless(HINSTANCE hInstance);
+
+    /// <summary>
+    /// Sets a file to record the raw depth frames to, so that the session can be replayed without a Kinect
+    /// </summary>
+    /// <param name="fileName">path of the recording file, or empty to not record</param>
+    void SetRecordingFileName(const std::string& fileName);
+
+    /// <summary>
+    /// Sets a name to share the raw frames under, so that other processes can read them without copies through a socket
+    /// </summary>
+    /// <param name="name">base name of the frame rings, or empty to not share</param>
+    void SetSharedFrameRingName(const std::string& name);
+
+    /// <summary>
+    /// Sets whether sweep events are also published with the time their depth frame was taken
+    /// </summary>
+    /// <param name="isEnabled">true to publish stamped sweep events</param>
+    void SetStampedSweepEnabled(bool isEnabled);
+
     /// <summary>
     /// Handles window messages, passes most to the class instance to handle
     /// </summary>
@@ -114,6 +256,136 @@ private:
     /// <returns>0</returns>
     DWORD WINAPI ProcessThread();
 
+    /// <summary>
+    /// Prepares the buffers and detector for a new stream resolution and starts reopening the stream in
+    /// the background; the other stream keeps running meanwhile
+    /// </summary>
+    /// <param name="isColor">true to change the color stream, false to change the depth stream</param>
+    /// <param name="resolution">resolution to change to</param>
+    /// <param name="otherResolution">resolution the other stream is open at</param>
+    /// <returns>S_OK if the stream is being reopened, an error code otherwise</returns>
+    HRESULT BeginStreamReconfiguration(bool isColor, NUI_IMAGE_RESOLUTION resolution, NUI_IMAGE_RESOLUTION otherResolution);
+
+    /// <summary>
+    /// Thread that reopens a stream, calls class instance thread processor
+    /// </summary>
+    /// <param name="lpParam">instance pointer</param>
+    /// <returns>0</returns>
+    static DWORD WINAPI ReconfigureThread(LPVOID lpParam);
+
+    /// <summary>
+    /// Thread that reopens a stream at the resolution of the pending reconfiguration and prepares the
+    /// registration table for the new resolutions
+    /// </summary>
+    /// <returns>0</returns>
+    DWORD WINAPI ReconfigureThread();
+
+    /// <summary>
+    /// Swaps in the buffers prepared for the new resolution once the stream has been reopened
+    /// </summary>
+    void CompleteStreamReconfiguration();
+
+    /// <summary>
+    /// Creates the stage queues and starts the stage threads of the depth pipeline
+    /// </summary>
+    /// <returns>S_OK if successful, an error code otherwise</returns>
+    HRESULT StartPipeline();
+
+    /// <summary>
+    /// Waits for the stage threads of the depth pipeline to end once the stop event is set
+    /// </summary>
+    void StopPipeline();
+
+    /// <summary>
+    /// Takes a depth frame from the Kinect into a free pipeline frame and hands it to the analytics stage
+    /// </summary>
+    /// <param name="pSettings">pointer to the settings the frame is rendered with</param>
+    /// <param name="depthResolution">resolution the depth stream is open at</param>
+    /// <param name="pSkeletonFrame">pointer to skeleton frame to draw onto the depth image, or NULL</param>
+    void CaptureDepthFrame(const StreamSettings* pSettings, NUI_IMAGE_RESOLUTION depthResolution, const NUI_SKELETON_FRAME* pSkeletonFrame);
+
+    /// <summary>
+    /// Takes a free pipeline frame for the capture stage
+    /// </summary>
+    /// <param name="isWaiting">true to wait until a frame is free, false to return at once</param>
+    /// <param name="pFrame">pointer in which to return the index of the frame</param>
+    /// <returns>S_OK if a frame was taken, S_FALSE if none is free, E_ABORT if processing is stopping</returns>
+    HRESULT TakeFreeFrame(bool isWaiting, int* pFrame);
+
+    /// <summary>
+    /// Waits for a frame to arrive in the queue of a stage
+    /// </summary>
+    /// <param name="stage">stage to wait for</param>
+    /// <param name="timeout">longest time to wait, in milliseconds</param>
+    /// <param name="pFrame">pointer in which to return the index of the frame</param>
+    /// <returns>S_OK if a frame arrived, S_FALSE if none arrived in time, E_ABORT if processing is stopping</returns>
+    HRESULT WaitForFrame(PipelineStageID stage, DWORD timeout, int* pFrame);
+
+    /// <summary>
+    /// Records how long a stage took for a frame and hands the frame to the next stage
+    /// </summary>
+    /// <param name="stage">stage that is done with the frame</param>
+    /// <param name="frame">index of the frame</param>
+    /// <param name="startTime">monotonic time in nanoseconds when the stage started on the frame</param>
+    void CompleteFrame(PipelineStageID stage, int frame, LONGLONG startTime);
+
+    /// <summary>
+    /// Thread that runs detection on depth frames, calls class instance thread processor
+    /// </summary>
+    /// <param name="lpParam">instance pointer</param>
+    /// <returns>0</returns>
+    static DWORD WINAPI AnalyticsThread(LPVOID lpParam);
+
+    /// <summary>
+    /// Thread that runs detection on depth frames and keeps the results with the frame
+    /// </summary>
+    /// <returns>0</returns>
+    DWORD WINAPI AnalyticsThread();
+
+    /// <summary>
+    /// Thread that publishes detection results, calls class instance thread processor
+    /// </summary>
+    /// <param name="lpParam">instance pointer</param>
+    /// <returns>0</returns>
+    static DWORD WINAPI PublishThread(LPVOID lpParam);
+
+    /// <summary>
+    /// Thread that publishes the detection results of depth frames to ROS, and services the ROS connection
+    /// </summary>
+    /// <returns>0</returns>
+    DWORD WINAPI PublishThread();
+
+    /// <summary>
+    /// Thread that renders depth frames, calls class instance thread processor
+    /// </summary>
+    /// <param name="lpParam">instance pointer</param>
+    /// <returns>0</returns>
+    static DWORD WINAPI RenderThread(LPVOID lpParam);
+
+    /// <summary>
+    /// Thread that renders depth frames into the depth bitmap and returns them to the capture stage
+    /// </summary>
+    /// <returns>0</returns>
+    DWORD WINAPI RenderThread();
+
+    /// <summary>
+    /// Renders a depth frame into the depth bitmap
+    /// </summary>
+    /// <param name="pFrame">pointer to frame to render</param>
+    void RenderDepthFrame(DepthFrame* pFrame);
+
+    /// <summary>
+    /// Switches the depth bitmap over to the resolution the depth stream was reopened at
+    /// </summary>
+    /// <param name="pReconfiguration">pointer to the prepared buffers, which are taken over</param>
+    void SwapDepthBuffers(StreamReconfiguration* pReconfiguration);
+
+    /// <summary>
+    /// Finds the moving region of the latest analyzed frame and hands it to the capture stage
+    /// </summary>
+    /// <param name="pFrame">pointer to the analyzed frame</param>
+    void PublishSweepFlowTarget(const DepthFrame* pFrame);
+
     /// <summary>
     /// Creates the main and status bar windows
     /// </summary>
@@ -154,7 +426,12 @@ private:
     /// </summary>
     /// <returns>S_OK if successful, E_FAIL otherwise</returns>
     HRESULT CreateDepthImage();
-	HRESULT CreateDepthImagePrev();
+
+    /// <summary>
+    /// Builds the detection pipeline from its config file, or from the defaults if there is none
+    /// </summary>
+    /// <returns>S_OK if successful, an error code otherwise</returns>
+    HRESULT CreateDetectionPipeline();
 
     /// <summary>
     /// Initializes the specified bitmap to the specified size
@@ -168,12 +445,13 @@ private:
     HRESULT CreateBitmap(Size size, HBITMAP* phBitmap, BITMAPINFO* pBmi, void* pBitmapBits, UINT nID);
 
     /// <summary>
-    /// Updates the specified bitmap using the Mat
+    /// Composites the overlay onto the Mat and updates the specified bitmap with the result
     /// </summary>
-    /// <param name="pImg">pointer to Mat with image data</param>
+    /// <param name="pImg">pointer to Mat with display image data, which the overlay is drawn into</param>
+    /// <param name="pOverlay">pointer to overlay annotating the image</param>
     /// <param name="phBitmap">pointer to handle of the bitmap to update</param>
     /// <param name="pBmi">pointer to BITMAPINFO for updated bitmap</param>
-    void UpdateBitmap(Mat* pImg, HBITMAP* phBitmap, BITMAPINFO* pBmi);
+    void UpdateBitmap(Mat* pImg, const Overlay* pOverlay, HBITMAP* phBitmap, BITMAPINFO* pBmi);
 
 	/// <summary>
     /// Paints the given bitmap to the target device context at the given (x,y).
@@ -228,12 +506,81 @@ private:
 	/// <param name="frameRate">actual frame rate of stream after filtering is applied</param>
 	std::wstring GenerateStreamInformation(NUI_IMAGE_RESOLUTION resolution, int filterID, double frameRate);
 
-	/// <summary>
-    /// Computes framerate based on the interval between two timings taken with clock()
+    /// <summary>
+    /// Converts percentiles of durations into a string
+    /// </summary>
+    /// <param name="pSummary">pointer to percentiles in nanoseconds</param>
+    std::wstring LatencyToString(const LatencySummary* pSummary);
+
+    /// <summary>
+    /// Generates a string with the distribution and jitter of the intervals between frames of a stream
     /// </summary>
-    /// <param name="startClock">starting clock value of interval</param>
-	/// <param name="endClock">ending clock value of interval</param>
-	double CalculateFrameRate(clock_t startClock, clock_t endClock);
+    /// <param name="pTracker">pointer to frame rate tracker of the stream</param>
+    std::wstring GenerateFrameIntervalInformation(const FrameRateTracker* pTracker);
+
+    /// <summary>
+    /// Generates a string with how old sweep events are when written to the robot, and how long writing takes
+    /// </summary>
+    std::wstring GenerateSweepLatencyInformation();
+
+    /// <summary>
+    /// Generates a string with the queue depth and time per frame of every depth pipeline stage
+    /// </summary>
+    std::wstring GeneratePipelineInformation();
+
+    /// <summary>
+    /// Shows where motion was found in a depth frame in the status bar
+    /// </summary>
+    /// <param name="pStats">pointer to motion statistics of the frame</param>
+    void UpdateMotionStatus(const MotionStats* pStats);
+
+    /// <summary>
+    /// Connects to the ROS server and has the detection engine publish to it
+    /// </summary>
+    void InitializeRos();
+
+    /// <summary>
+    /// Starts recording the raw depth frames if a recording file was set
+    /// </summary>
+    void StartRecording();
+
+    /// <summary>
+    /// Creates the shared memory frame rings if a share name was set
+    /// </summary>
+    void StartFrameSharing();
+
+    /// <summary>
+    /// Loads or builds the registration table for the resolutions the streams start at, before any frame is processed
+    /// </summary>
+    void StartRegistration();
+
+    /// <summary>
+    /// Hands the current stream settings to the processing thread, which applies them before its next frame
+    /// </summary>
+    void PublishSettings();
+
+    /// <summary>
+    /// Puts the resolution setting of a stream that could not be reopened back to the resolution it is open at,
+    /// unless it has been changed again since
+    /// </summary>
+    /// <param name="isColor">true for the color stream, false for the depth stream</param>
+    /// <param name="resolution">resolution the stream is open at</param>
+    /// <param name="failedResolution">resolution the stream could not be reopened at</param>
+    void RestoreStreamResolution(bool isColor, NUI_IMAGE_RESOLUTION resolution, NUI_IMAGE_RESOLUTION failedResolution);
+
+    /// <summary>
+    /// Gets whether anyone can see the rendered streams, so that visualization can be skipped otherwise
+    /// </summary>
+    /// <returns>true if there is a window and it is not minimized</returns>
+    bool IsDisplayVisible() const;
+
+    /// <summary>
+    /// Points the sweep direction estimator at the moving region found in the latest analyzed depth frame
+    /// </summary>
+    /// <param name="pTarget">pointer to the moving region</param>
+    /// <param name="colorResolution">resolution of color image stream</param>
+    /// <param name="depthResolution">resolution of depth image stream</param>
+    void UpdateSweepFlowRegion(const SweepFlowTarget* pTarget, NUI_IMAGE_RESOLUTION colorResolution, NUI_IMAGE_RESOLUTION depthResolution);
 
     // Variables:
     // Program information
@@ -245,21 +592,31 @@ private:
 
     // Helpers
     Microsoft::KinectBridge::OpenCVFrameHelper m_frameHelper;
+    // The color stream is filtered and drawn on the processing thread, the depth stream by the render stage
     OpenCVHelper m_openCVHelper;
+    OpenCVHelper m_depthOpenCVHelper;
+    SweepFlowEstimator m_sweepFlowEstimator;
+    DetectionEngine m_engine;
+    RosPublisher m_rosPublisher;
+    // Registration table for the current resolutions, only used by the processing thread, and the table the
+    // reconfiguration thread prepares for the next ones. A table that could not be built stays empty and
+    // the sweep region is scaled instead; it is not retried until the resolutions change again.
+    DepthColorRegistration m_registration;
+    DepthColorRegistration m_nextRegistration;
+
+    // Raw frames shared with other processes, written by the capture stage and the processing thread
+    SharedFrameRingWriter m_depthFrameRing;
+    SharedFrameRingWriter m_colorFrameRing;
 
     // App settings
-    bool m_bIsColorPaused;
-    NUI_IMAGE_RESOLUTION m_colorResolution;
-	int m_colorFilterID;
-
-    bool m_bIsDepthPaused;
-    bool m_bIsDepthNearMode;
-    NUI_IMAGE_RESOLUTION m_depthResolution;
-	int m_depthFilterID;
+    bool m_bIsHeadless;
+    std::string m_recordingFileName;
+    std::string m_sharedFrameRingName;
 
-    bool m_bIsSkeletonSeatedMode;
-    bool m_bIsSkeletonDrawColor;
-    bool m_bIsSkeletonDrawDepth;
+    // Stream settings as chosen from the menu, only touched by the window thread, and the channel
+    // that hands snapshots of them to the processing thread
+    StreamSettings m_settings;
+    StreamSettingsChannel m_settingsChannel;
 
 	// Frame rate tracking
 	FrameRateTracker m_colorFrameRateTracker;
@@ -268,9 +625,17 @@ private:
 	// OpenCV matrices
 	Mat m_colorMat;
 	Mat m_depthMat;
-	Mat m_depthMatPrev;
-	Mat m_depthMatDelta1;
-	Mat m_depthMatDelta2;
+
+    // Copy of the color frame that filters and overlays are drawn into, so m_colorMat stays as captured
+    Mat m_colorDisplayMat;
+
+    // Annotations of the latest color and depth frames, only drawn when the bitmaps are updated
+    Overlay m_colorOverlay;
+    Overlay m_depthOverlay;
+
+    // Latest stroke motion measured on the color stream and the color region it was measured in
+    SweepFlow m_sweepFlow;
+    Rect m_sweepFlowRegion;
 
     // Bitmaps
     BITMAPINFO m_bmiColor;
@@ -280,15 +645,26 @@ private:
     BITMAPINFO m_bmiDepth;
     void* m_pDepthBitmapBits;
     HBITMAP m_hDepthBitmap;
-	HBITMAP m_hDepthBitmapPrev;
 
     // Window processing thread handles
     HANDLE m_hProcessStopEvent;
     HANDLE m_hProcessThread;
 
-	// Mutexes that control access to m_colorResolution and m_depthResolution
-    HANDLE m_hColorResolutionMutex;
-    HANDLE m_hDepthResolutionMutex;
+    // Depth pipeline: the frames, the stages they pass through and the frame the capture stage took but did not fill
+    DepthFrame m_depthFrames[PIPELINE_FRAME_COUNT];
+    PipelineStage m_pipelineStages[PIPELINE_STAGE_COUNT];
+    int m_spareDepthFrame;
+    volatile LONG m_droppedDepthFrames;
+
+    // Maps the sensor timestamps of depth frames onto the monotonic clock, only used by the capture stage
+    SensorClock m_depthSensorClock;
+
+    // Moving region found by the analytics stage, handed to the capture stage for the color stream
+    SnapshotChannel<SweepFlowTarget> m_sweepFlowTargetChannel;
+
+    // Resolution change in progress, only valid while the reconfiguration thread handle is set
+    StreamReconfiguration m_reconfiguration;
+    HANDLE m_hReconfigureThread;
 
 	// Mutexes that control access to m_hColorBitmap and m_hDepthBitmap
 	HANDLE m_hColorBitmapMutex;
@@ -0,0 +1,116 @@
+//-----------------------------------------------------------------------------
+// <copyright file="MotionStats.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation. All rights reserved.
+// </copyright>
+//-----------------------------------------------------------------------------
+
+#include "MotionStats.h"
+
+/// <summary>
+/// Finds the median, mean and occupied range of one axis histogram
+/// </summary>
+/// <param name="counts">number of moving pixels at each coordinate</param>
+/// <param name="total">sum of all counts</param>
+/// <param name="pMedian">pointer in which to return the median coordinate</param>
+/// <param name="pMean">pointer in which to return the mean coordinate</param>
+/// <param name="pFirst">pointer in which to return the first occupied coordinate</param>
+/// <param name="pLast">pointer in which to return the last occupied coordinate</param>
+static void ScanHistogram(const std::vector<int>& counts, int total, int* pMedian, float* pMean, int* pFirst, int* pLast)
+{
+    int half = (total + 1) / 2;
+    int cumulative = 0;
+    double weightedSum = 0.0;
+
+    *pMedian = -1;
+    *pFirst = -1;
+    *pLast = -1;
+
+    for (int i = 0; i < static_cast<int>(counts.size()); ++i)
+    {
+        int count = counts[i];
+        if (count == 0)
+        {
+            continue;
+        }
+
+        if (*pFirst < 0)
+        {
+            *pFirst = i;
+        }
+        *pLast = i;
+
+        cumulative += count;
+        weightedSum += static_cast<double>(i) * count;
+        if (*pMedian < 0 && cumulative >= half)
+        {
+            *pMedian = i;
+        }
+    }
+
+    *pMean = static_cast<float>(weightedSum / total);
+}
+
+/// <summary>
+/// Derives the motion statistics from per-column and per-row counts of moving pixels
+/// </summary>
+/// <param name="columnCounts">number of moving pixels in each column</param>
+/// <param name="rowCounts">number of moving pixels in each row</param>
+/// <param name="pStats">pointer in which to return the statistics</param>
+/// <returns>S_OK if successful, an error code otherwise</returns>
+HRESULT ComputeMotionStats(const std::vector<int>& columnCounts, const std::vector<int>& rowCounts, MotionStats* pStats)
+{
+    // Fail if pointer is invalid
+    if (!pStats)
+    {
+        return E_POINTER;
+    }
+
+    // Both histograms count the same pixels, so either gives the total
+    int total = 0;
+    for (size_t y = 0; y < rowCounts.size(); ++y)
+    {
+        total += rowCounts[y];
+    }
+
+    pStats->count = total;
+    pStats->meanChange = 0.0f;
+    if (total == 0)
+    {
+        pStats->median = Point(0, 0);
+        pStats->centroid = Point2f(0.0f, 0.0f);
+        pStats->extent = Rect();
+        return S_OK;
+    }
+
+    int firstX, lastX, firstY, lastY;
+    ScanHistogram(columnCounts, total, &pStats->median.x, &pStats->centroid.x, &firstX, &lastX);
+    ScanHistogram(rowCounts, total, &pStats->median.y, &pStats->centroid.y, &firstY, &lastY);
+    pStats->extent = Rect(firstX, firstY, lastX - firstX + 1, lastY - firstY + 1);
+
+    return S_OK;
+}
+
+/// <summary>
+/// Measures the mean depth change over the extent of the moving pixels, in constant time whatever its size
+/// </summary>
+/// <param name="pDifference">pointer to summed-area table of the depth change the moving pixels were found in</param>
+/// <param name="pStats">pointer to statistics whose extent is set, in which to return the mean change</param>
+/// <returns>S_OK if successful, E_NOT_VALID_STATE if the table is not valid, an error code otherwise</returns>
+HRESULT ComputeMotionChange(const IntegralImage* pDifference, MotionStats* pStats)
+{
+    // Fail if either pointer is invalid
+    if (!pDifference || !pStats)
+    {
+        return E_POINTER;
+    }
+
+    // Fail if the table was not computed for the current difference
+    if (!pDifference->IsValid())
+    {
+        return E_NOT_VALID_STATE;
+    }
+
+    pStats->meanChange = (pStats->count > 0) ? static_cast<float>(pDifference->GetMean(pStats->extent)) : 0.0f;
+
+    return S_OK;
+}
@@ -0,0 +1,58 @@
+//-----------------------------------------------------------------------------
+// <copyright file="MotionStats.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation. All rights reserved.
+// </copyright>
+//-----------------------------------------------------------------------------
+
+#pragma once
+
+#include "Platform.h"
+#include <vector>
+
+// Suppress warnings that come from compiling OpenCV code since we have no control over it
+#pragma warning(push)
+#pragma warning(disable : 6294 6031)
+#include <opencv2/core/core.hpp>
+#pragma warning(pop)
+
+#include "IntegralImage.h"
+
+using namespace cv;
+
+/// <summary>
+/// Where the moving pixels of a depth frame are, in depth pixel coordinates
+/// </summary>
+struct MotionStats
+{
+    // Number of moving pixels; the other fields are only meaningful when this is not 0
+    int count;
+
+    // Per-axis median of the moving pixels
+    Point median;
+
+    // Mean position of the moving pixels
+    Point2f centroid;
+
+    // Bounding box of the moving pixels
+    Rect extent;
+
+    // Mean depth change in millimeters over the extent, moving or not
+    float meanChange;
+};
+
+/// <summary>
+/// Derives the motion statistics from per-column and per-row counts of moving pixels
+/// </summary>
+/// <param name="columnCounts">number of moving pixels in each column</param>
+/// <param name="rowCounts">number of moving pixels in each row</param>
+/// <param name="pStats">pointer in which to return the statistics</param>
+/// <returns>S_OK if successful, an error code otherwise</returns>
+HRESULT ComputeMotionStats(const std::vector<int>& columnCounts, const std::vector<int>& rowCounts, MotionStats* pStats);
+
+/// <summary>
+/// Measures the mean depth change over the extent of the moving pixels, in constant time whatever its size
+/// </summary>
+/// <param name="pDifference">pointer to summed-area table of the depth change the moving pixels were found in</param>
+/// <param name="pStats">pointer to statistics whose extent is set, in which to return the mean change</param>
+/// <returns>S_OK if successful, E_NOT_VALID_STATE if the table is not valid, an error code otherwise</returns>
+HRESULT ComputeMotionChange(const IntegralImage* pDifference, MotionStats* pStats);
@@ -5,6 +5,8 @@
 //-----------------------------------------------------------------------------
 
 #include "OpenCVFrameHelper.h"
+#include "FrameConversion.h"
+#include "Trace.h"
 
 using namespace Microsoft::KinectBridge;
 
@@ -16,31 +18,15 @@ using namespace Microsoft::KinectBridge;
 /// <returns>S_OK if successful, an error code otherwise</returns>
 HRESULT OpenCVFrameHelper::GetColorData(Mat* pImage) const
 {
+    TRACE_SCOPE("GetColorData");
+
     // Check if image is valid
     if (m_colorBufferPitch == 0)
     {
         return E_NUI_FRAME_NO_DATA;
     }
 
-    DWORD colorHeight, colorWidth;
-    NuiImageResolutionToSize(m_colorResolution, colorWidth, colorHeight);
-
-    // Copy image information into Mat
-    for (UINT y = 0; y < colorHeight; ++y)
-    {
-        // Get row pointer for color Mat
-        Vec4b* pColorRow = pImage->ptr<Vec4b>(y);
-
-        for (UINT x = 0; x < colorWidth; ++x)
-        {
-            pColorRow[x] = Vec4b(m_pColorBuffer[y * m_colorBufferPitch + x * 4 + 0],
-                m_pColorBuffer[y * m_colorBufferPitch + x * 4 + 1],
-                m_pColorBuffer[y * m_colorBufferPitch + x * 4 + 2],
-                m_pColorBuffer[y * m_colorBufferPitch + x * 4 + 3]);
-        }
-    }
-
-    return S_OK;
+    return ConvertColorFrame(m_pColorBuffer, m_colorBufferPitch, pImage);
 }
 
 /// <summary>
@@ -51,30 +37,15 @@ HRESULT OpenCVFrameHelper::GetColorData(Mat* pImage) const
 /// <returns>S_OK if successful, an error code otherwise</returns>
 HRESULT OpenCVFrameHelper::GetDepthData(Mat* pImage) const
 {
+    TRACE_SCOPE("GetDepthData");
+
     // Check if image is valid
-    if (m_colorBufferPitch == 0)
+    if (m_depthBufferPitch == 0)
     {
         return E_NUI_FRAME_NO_DATA;
     }
 
-    DWORD depthHeight, depthWidth;
-    NuiImageResolutionToSize(m_depthResolution, depthWidth, depthHeight);
-
-    // Copy image information into Mat
-    USHORT* pBufferRun = reinterpret_cast<USHORT*>(m_pDepthBuffer);
-
-    for (UINT y = 0; y < depthHeight; ++y)
-    {
-        // Get row pointer for depth Mat
-        USHORT* pDepthRow = pImage->ptr<USHORT>(y);
-
-        for (UINT x = 0; x < depthWidth; ++x)
-        {
-            pDepthRow[x] = pBufferRun[y * depthWidth + x];
-        }
-    }
-
-    return S_OK;
+    return ConvertDepthFrame(m_pDepthBuffer, m_depthBufferPitch, pImage);
 }
 
 /// <summary>
@@ -83,70 +54,47 @@ HRESULT OpenCVFrameHelper::GetDepthData(Mat* pImage) const
 /// </summary>
 /// <param name="pImage">pointer in which to return the OpenCV image matrix</param>
 /// <returns>S_OK if successful, an error code otherwise</returns>
-HRESULT OpenCVFrameHelper::GetDepthDataAsArgb(Mat* pImage, Mat* pPrevImage, Mat* pDelta1Image, Mat* pDelta2Image)
+HRESULT OpenCVFrameHelper::GetDepthDataAsArgb(Mat* pImage) const
 {
-    DWORD depthWidth, depthHeight;
-    NuiImageResolutionToSize(m_depthResolution, depthWidth, depthHeight);
-
-    // Get the depth image
-    Mat depthImage;
-    depthImage.create(depthHeight, depthWidth, DEPTH_TYPE);
-    HRESULT hr = GetDepthData(&depthImage);
-    if (!SUCCEEDED(hr)) {
-        return hr;
-    }
+    TRACE_SCOPE("GetDepthDataAsArgb");
 
-	Mat deltaDeltaImage;
-	
-	// after receiving frames 1th and 2nd we calculate this image
-	if (frameCount % 2 == 0)
-	{
-		*pDelta1Image = depthImage - *pPrevImage;
-	}
-	// after receiving frames 3rd and 4th we calculate this image
-	if (frameCount % 4 == 0)
-	{
-		*pDelta2Image = depthImage - *pPrevImage;
-		frameCount = 0;
-	}
-	deltaDeltaImage = *pDelta2Image - *pDelta1Image;
-
-	int x_median = 0;
-	int counter = 1;
-	for (UINT y = 0; y < depthHeight; ++y)
+    // Check if image is valid
+    if (m_depthBufferPitch == 0)
     {
-        // Get row pointers for Mats
-        const USHORT* pDepthRow = deltaDeltaImage.ptr<USHORT>(y); // from the sensor
-        Vec4b* pDepthRgbRow = pImage->ptr<Vec4b>(y); // buffer in the program we are populating
-
-        for (UINT x = 0; x < depthWidth; ++x)
-        {
-            USHORT raw_depth = pDepthRow[x];
-            // If depth value is valid, convert and copy it
-            if (raw_depth != 65535)
-            {
-                UINT8 redPixel, greenPixel, bluePixel;
-                DepthShortToRgb(raw_depth, &redPixel, &greenPixel, &bluePixel);
-				if (redPixel + greenPixel + bluePixel < 127*3){
-					counter++;
-				}
-				pDepthRgbRow[x] = Vec4b(redPixel, greenPixel, bluePixel, 1);
-            }
-            else
-            {
-                pDepthRgbRow[x] = 0;
-            }
-        }
+        return E_NUI_FRAME_NO_DATA;
     }
-	x_median = counter;
-	pPrevImage = &(depthImage.clone());
-	
 
-	//pImage->at<Vec4b>(Point(x_median, 100)) = Vec4b(255, 0, 0, 1);
+    // Colorize straight from the frame buffer rather than through an intermediate depth Mat
+    return ConvertDepthFrameToArgb(m_pDepthBuffer, m_depthBufferPitch, pImage);
+}
+
+/// <summary>
+/// Colorizes the given depth plane in millimeters, taking the player index from the raw frame it was filtered from.
+/// Only the given Mats are read, so this can run on another thread than the one taking the frames.
+/// </summary>
+/// <param name="pDepth">pointer to 16-bit depth in millimeters</param>
+/// <param name="pRawDepth">pointer to the raw 16-bit depth frame, of the same size</param>
+/// <param name="pImage">pointer in which to return the OpenCV image matrix, of the same size</param>
+/// <returns>S_OK if successful, an error code otherwise</returns>
+HRESULT OpenCVFrameHelper::GetFilteredDepthImageAsArgb(const Mat* pDepth, const Mat* pRawDepth, Mat* pImage) const
+{
+    TRACE_SCOPE("GetFilteredDepthImageAsArgb");
+
+    return ColorizeFilteredDepth(pDepth, pRawDepth, pImage);
+}
 
+/// <summary>
+/// Colorizes a raw depth frame that was taken earlier.
+/// Only the given Mats are read, so this can run on another thread than the one taking the frames.
+/// </summary>
+/// <param name="pRawDepth">pointer to the raw 16-bit depth frame</param>
+/// <param name="pImage">pointer in which to return the OpenCV image matrix, of the same size</param>
+/// <returns>S_OK if successful, an error code otherwise</returns>
+HRESULT OpenCVFrameHelper::GetRawDepthImageAsArgb(const Mat* pRawDepth, Mat* pImage) const
+{
+    TRACE_SCOPE("GetRawDepthImageAsArgb");
 
-	frameCount++;
-    return (HRESULT)x_median;
+    return ColorizeRawDepth(pRawDepth, pImage);
 }
 
 /// <summary>
@@ -168,9 +116,3 @@ HRESULT OpenCVFrameHelper::VerifySize(const Mat* pImage, NUI_IMAGE_RESOLUTION re
 
     return S_OK;
 }
-
-// i hope you've already allocated memory for these two Mat*.
-HRESULT OpenCVFrameHelper::SaveOldDepthImage(Mat* pSourceImage, Mat* pDestImage) const
-{
-	return S_OK;
-}
@@ -22,7 +22,7 @@ namespace Microsoft {
             /// <summary>
             /// Constructor
             /// </summary>
-			OpenCVFrameHelper() : KinectHelper<Mat>()  { frameCount = 1; }
+            OpenCVFrameHelper() : KinectHelper<Mat>() {}
 
             /// <summary>
             /// Destructor
@@ -34,9 +34,26 @@ namespace Microsoft {
             static const int COLOR_TYPE = CV_8UC4;
             static const int DEPTH_TYPE = CV_16U;
             static const int DEPTH_RGB_TYPE = CV_8UC4;
-			// TODO figure out why the hell this had to be public - this makes no sense
-			// as its "twin" GetDepthData is protected and this works fine from MainWindow.cpp
-			HRESULT SaveOldDepthImage(Mat* pOldImage, Mat* pNewImage) const;
+
+            /// <summary>
+            /// Colorizes the given depth plane in millimeters, taking the player index from the raw frame it was filtered from.
+            /// Only the given Mats are read, so this can run on another thread than the one taking the frames.
+            /// </summary>
+            /// <param name="pDepth">pointer to 16-bit depth in millimeters</param>
+            /// <param name="pRawDepth">pointer to the raw 16-bit depth frame, of the same size</param>
+            /// <param name="pImage">pointer in which to return the OpenCV image matrix, of the same size</param>
+            /// <returns>S_OK if successful, an error code otherwise</returns>
+            HRESULT GetFilteredDepthImageAsArgb(const Mat* pDepth, const Mat* pRawDepth, Mat* pImage) const;
+
+            /// <summary>
+            /// Colorizes a raw depth frame that was taken earlier.
+            /// Only the given Mats are read, so this can run on another thread than the one taking the frames.
+            /// </summary>
+            /// <param name="pRawDepth">pointer to the raw 16-bit depth frame</param>
+            /// <param name="pImage">pointer in which to return the OpenCV image matrix, of the same size</param>
+            /// <returns>S_OK if successful, an error code otherwise</returns>
+            HRESULT GetRawDepthImageAsArgb(const Mat* pRawDepth, Mat* pImage) const;
+
         protected:
             // Functions:
             /// <summary>
@@ -59,7 +76,7 @@ namespace Microsoft {
             /// </summary>
             /// <param name="pImage">pointer in which to return the OpenCV image matrix</param>
             /// <returns>S_OK if successful, an error code otherwise</returns>
-			HRESULT GetDepthDataAsArgb(Mat* pImage, Mat* pImagePrev, Mat* pDelta1Image, Mat* pDelta2Image) override;
+            HRESULT GetDepthDataAsArgb(Mat* pImage) const override;
 
             /// <summary>
             /// Verify image is of the given resolution
@@ -68,10 +85,6 @@ namespace Microsoft {
             /// <param name="resolution">resolution of image</param>
             /// <returns>S_OK if image matches given width and height, an error code otherwise</returns>
             HRESULT VerifySize(const Mat* pImage, NUI_IMAGE_RESOLUTION resolution) const override;
-
-		public:
-			int frameCount;
-
         };
     }
 }
\ No newline at end of file
@@ -5,6 +5,7 @@
 //-----------------------------------------------------------------------------
 
 #include "OpenCVHelper.h"
+#include "Trace.h"
 
 using namespace cv;
 
@@ -23,7 +24,9 @@ const Scalar OpenCVHelper::SKELETON_COLORS[NUI_SKELETON_COUNT] =
 /// </summary>
 OpenCVHelper::OpenCVHelper() :
 m_depthFilterID(-1),
-m_colorFilterID(-1)
+m_colorFilterID(-1),
+m_colorChainFilterID(-1),
+m_depthChainFilterID(-1)
 {
 }
 
@@ -52,6 +55,8 @@ void OpenCVHelper::SetDepthFilter(int filterID)
 /// <returns>S_OK if successful, an error code otherwise
 HRESULT OpenCVHelper::ApplyColorFilter(Mat* pImg)
 {
+    TRACE_SCOPE("ApplyColorFilter");
+
     // Fail if pointer is invalid
     if (!pImg) 
     {
@@ -64,42 +69,15 @@ HRESULT OpenCVHelper::ApplyColorFilter(Mat* pImg)
         return E_INVALIDARG;
     }
 
-    // Apply an effect based on the active filter
-    switch(m_colorFilterID)
+    // The chain is only rebuilt when a different filter was selected since the last frame
+    int filterID = m_colorFilterID;
+    if (filterID != m_colorChainFilterID)
     {
-    case IDM_COLOR_FILTER_GAUSSIANBLUR:
-        {
-            GaussianBlur(*pImg, *pImg, Size(7,7), 0);
-        }
-        break;
-    case IDM_COLOR_FILTER_DILATE:
-        {
-            dilate(*pImg, *pImg, Mat());
-        }
-        break;
-    case IDM_COLOR_FILTER_ERODE:
-        {
-            erode(*pImg, *pImg, Mat());
-        }
-        break;
-    case IDM_COLOR_FILTER_CANNYEDGE:
-        {
-            const double minThreshold = 30.0;
-            const double maxThreshold = 50.0;
-
-            // Convert image to grayscale for edge detection
-            cvtColor(*pImg, *pImg, CV_RGBA2GRAY);
-            // Remove noise
-            blur(*pImg, *pImg, Size(3,3));
-            // Find edges in image
-            Canny(*pImg, *pImg, minThreshold, maxThreshold);
-            // Convert back to color for output
-            cvtColor(*pImg, *pImg, CV_GRAY2RGBA);
-        }
-        break;
+        BuildFilterChain(filterID, &m_colorFilterChain);
+        m_colorChainFilterID = filterID;
     }
 
-    return S_OK;
+    return m_colorFilterChain.Apply(pImg);
 }
 
 /// <summary>
@@ -109,6 +87,8 @@ HRESULT OpenCVHelper::ApplyColorFilter(Mat* pImg)
 /// <returns>S_OK if successful, an error code otherwise</returns>
 HRESULT OpenCVHelper::ApplyDepthFilter(Mat* pImg)
 {
+    TRACE_SCOPE("ApplyDepthFilter");
+
     // Fail if pointer is invalid
     if (!pImg) 
     {
@@ -121,260 +101,246 @@ HRESULT OpenCVHelper::ApplyDepthFilter(Mat* pImg)
         return E_INVALIDARG;
     }
 
-    // Apply an effect based on the active filter
-    switch(m_depthFilterID)
+    // The chain is only rebuilt when a different filter was selected since the last frame
+    int filterID = m_depthFilterID;
+    if (filterID != m_depthChainFilterID)
+    {
+        BuildFilterChain(filterID, &m_depthFilterChain);
+        m_depthChainFilterID = filterID;
+    }
+
+    return m_depthFilterChain.Apply(pImg);
+}
+
+/// <summary>
+/// Fills the given chain with the steps of the filter corresponding to the given resource ID
+/// </summary>
+/// <param name="filterID">resource ID of color or depth filter</param>
+/// <param name="pChain">pointer to chain to fill</param>
+void OpenCVHelper::BuildFilterChain(int filterID, FilterChain* pChain)
+{
+    bool isColor = (filterID >= IDM_COLOR_FILTER_NOFILTER && filterID <= IDM_COLOR_FILTER_CANNYEDGE);
+
+    switch(filterID)
     {
+    case IDM_COLOR_FILTER_GAUSSIANBLUR:
     case IDM_DEPTH_FILTER_GAUSSIANBLUR:
-        {
-            GaussianBlur(*pImg, *pImg, Size(5,5), 0);
-        }
+        pChain->Build(FILTER_MODE_GAUSSIAN_BLUR, isColor);
         break;
+    case IDM_COLOR_FILTER_DILATE:
     case IDM_DEPTH_FILTER_DILATE:
-        {
-            dilate(*pImg, *pImg, Mat());
-        }
+        pChain->Build(FILTER_MODE_DILATE, isColor);
         break;
+    case IDM_COLOR_FILTER_ERODE:
     case IDM_DEPTH_FILTER_ERODE:
-        {
-            erode(*pImg, *pImg, Mat());
-        }
+        pChain->Build(FILTER_MODE_ERODE, isColor);
         break;
+    case IDM_COLOR_FILTER_CANNYEDGE:
     case IDM_DEPTH_FILTER_CANNYEDGE:
-        {
-            const double minThreshold = 5.0;
-            const double maxThreshold = 20.0;
-
-            // Convert image to grayscale for edge detection
-            cvtColor(*pImg, *pImg, CV_RGBA2GRAY);
-            // Remove noise
-            blur(*pImg, *pImg, Size(3,3));
-            // Find edges in image
-            Canny(*pImg, *pImg, minThreshold, maxThreshold);
-            // Convert back to color for output
-            cvtColor(*pImg, *pImg, CV_GRAY2RGBA);
-        }
+        pChain->Build(FILTER_MODE_CANNY_EDGE, isColor);
+        break;
+    default:
+        pChain->Build(FILTER_MODE_NONE, isColor);
         break;
     }
-
-    return S_OK;
 }
 
 /// <summary>
-/// Draws the skeletons from the skeleton frame in the given color image Mat
+/// Draws the skeletons from the skeleton frame in the given color image overlay
 /// </summary>
-/// <param name="pImg">pointer to color image Mat in which to draw the skeletons</param>
+/// <param name="pOverlay">pointer to color image overlay in which to draw the skeletons</param>
 /// <param name="pSkeletons">pointer to skeleton frame to draw</param>
 /// <param name="colorRes">resolution of color image stream</param>
 /// <param name="depthRes">resolution of depth image stream</param>
 /// <returns>S_OK if successful, an error code otherwise</returns>
-HRESULT OpenCVHelper::DrawSkeletonsInColorImage(Mat* pImg, NUI_SKELETON_FRAME* pSkeletons, 
+HRESULT OpenCVHelper::DrawSkeletonsInColorImage(Overlay* pOverlay, NUI_SKELETON_FRAME* pSkeletons, 
                                                 NUI_IMAGE_RESOLUTION colorResolution, NUI_IMAGE_RESOLUTION depthResolution)
 {
-    return DrawSkeletons(pImg, pSkeletons, colorResolution, depthResolution);
+    return DrawSkeletons(pOverlay, pSkeletons, colorResolution, depthResolution);
 }
 
 /// <summary>
-/// Draws the skeletons from the skeleton frame in the given depth image Mat
+/// Draws the skeletons from the skeleton frame in the given depth image overlay
 /// </summary>
-/// <param name="pImg">pointer to depth image Mat in which to draw the skeletons</param>
+/// <param name="pOverlay">pointer to depth image overlay in which to draw the skeletons</param>
 /// <param name="pSkeletons">pointer to skeleton frame to draw</param>
 /// <param name="depthRes">resolution of depth image stream</param>
 /// <returns>S_OK if successful, an error code otherwise</returns>
-HRESULT OpenCVHelper::DrawSkeletonsInDepthImage(Mat* pImg, NUI_SKELETON_FRAME* pSkeletons, 
+HRESULT OpenCVHelper::DrawSkeletonsInDepthImage(Overlay* pOverlay, NUI_SKELETON_FRAME* pSkeletons, 
                                                 NUI_IMAGE_RESOLUTION depthResolution)
 {
-    return DrawSkeletons(pImg, pSkeletons, NUI_IMAGE_RESOLUTION_INVALID, depthResolution);
+    return DrawSkeletons(pOverlay, pSkeletons, NUI_IMAGE_RESOLUTION_INVALID, depthResolution);
 }
 
 /// <summary>
-/// Draws the skeletons from the skeleton frame in the given Mat
+/// Draws an arrow showing the direction and speed of the sweeping stroke in the given color image overlay
 /// </summary>
-/// <param name="pImg">pointer to Mat in which to draw the skeletons</param>
-/// <param name="pSkeletons">pointer to skeleton frame to draw</param>
-/// <param name="colorRes">resolution of color image stream, or NUI_IMAGE_RESOLUTION_INVALID for a depth image</param>
-/// <param name="depthRes">resolution of depth image stream</param>
+/// <param name="pOverlay">pointer to color image overlay in which to draw the arrow</param>
+/// <param name="pFlow">pointer to stroke motion to draw</param>
+/// <param name="region">region the motion was measured in, or an empty Rect for the whole image</param>
 /// <returns>S_OK if successful, an error code otherwise</returns>
-HRESULT OpenCVHelper::DrawSkeletons(Mat* pImg, NUI_SKELETON_FRAME* pSkeletons, NUI_IMAGE_RESOLUTION colorResolution, 
-                                    NUI_IMAGE_RESOLUTION depthResolution)
+HRESULT OpenCVHelper::DrawSweepFlow(Overlay* pOverlay, const SweepFlow* pFlow, Rect region)
 {
+    // The arrow shows how far the stroke travels in a quarter of a second
+    const float arrowSeconds = 0.25f;
+    const int maxArrowLength = 150;
+    const Scalar arrowColor(0, 255, 255);
+
     // Fail if either pointer is invalid
-    if (!pImg || !pSkeletons) 
+    if (!pOverlay || !pFlow)
     {
         return E_POINTER;
     }
 
-    // Fail if Mat contains no data or has insufficient channels or if depth resolution is invalid
-    if (pImg->empty() || pImg->channels() < 3 || depthResolution == NUI_IMAGE_RESOLUTION_INVALID)
+    // Fail if overlay has no image size
+    if (pOverlay->GetSize().area() == 0)
     {
         return E_INVALIDARG;
     }
 
-    // Draw each tracked skeleton
-    for (int i=0; i < NUI_SKELETON_COUNT; ++i)
+    if (region.area() == 0)
     {
-        NUI_SKELETON_TRACKING_STATE trackingState = pSkeletons->SkeletonData[i].eTrackingState;
-        if (trackingState == NUI_SKELETON_TRACKED)
-        {
-            // Draw entire skeleton
-            NUI_SKELETON_DATA *pSkel = &(pSkeletons->SkeletonData[i]);
-            DrawSkeleton(pImg, pSkel, SKELETON_COLORS[i], colorResolution, depthResolution);
-        } 
-        else if (trackingState == NUI_SKELETON_POSITION_INFERRED) 
-        {
-            // Draw a filled circle at the skeleton's inferred position
-            LONG x, y;
-            GetCoordinatesForSkeletonPoint(pSkeletons->SkeletonData[i].Position, &x, &y, colorResolution, depthResolution);
-            circle(*pImg, Point(x, y), 7, SKELETON_COLORS[i], CV_FILLED);
-        }
+        region = Rect(0, 0, pOverlay->GetSize().width, pOverlay->GetSize().height);
+    }
+
+    // Outline the region the motion was measured in
+    pOverlay->AddRectangle(region, arrowColor, 1);
+
+    if (!pFlow->isValid)
+    {
+        return S_OK;
+    }
+
+    // Draw the arrow from the center of the region, scaled by speed
+    int length = min(maxArrowLength, static_cast<int>(pFlow->speed * arrowSeconds));
+    Point start(region.x + region.width / 2, region.y + region.height / 2);
+    Point end(start.x + static_cast<int>(length * cos(pFlow->direction)), start.y + static_cast<int>(length * sin(pFlow->direction)));
+    pOverlay->AddLine(start, end, arrowColor, 3);
+
+    // Arrow head
+    const double headAngle = CV_PI / 6;
+    const double headLength = 12.0;
+    for (int side = -1; side <= 1; side += 2)
+    {
+        double angle = pFlow->direction + CV_PI + side * headAngle;
+        Point head(end.x + static_cast<int>(headLength * cos(angle)), end.y + static_cast<int>(headLength * sin(angle)));
+        pOverlay->AddLine(end, head, arrowColor, 3);
     }
 
     return S_OK;
 }
 
 /// <summary>
-/// Draws the specified skeleton in the given Mat
+/// Draws the skeletons from the skeleton frame in the given overlay
 /// </summary>
-/// <param name="pImg">pointer to Mat in which to draw the skeleton</param>
-/// <param name="pSkel">pointer to skeleton to draw</param>
-/// <param name="color">color to draw skeleton</param>
+/// <param name="pOverlay">pointer to overlay in which to draw the skeletons</param>
+/// <param name="pSkeletons">pointer to skeleton frame to draw</param>
 /// <param name="colorRes">resolution of color image stream, or NUI_IMAGE_RESOLUTION_INVALID for a depth image</param>
 /// <param name="depthRes">resolution of depth image stream</param>
 /// <returns>S_OK if successful, an error code otherwise</returns>
-void OpenCVHelper::DrawSkeleton(Mat* pImg, NUI_SKELETON_DATA* pSkel, Scalar color, NUI_IMAGE_RESOLUTION colorResolution,
-                                NUI_IMAGE_RESOLUTION depthResolution)
+HRESULT OpenCVHelper::DrawSkeletons(Overlay* pOverlay, NUI_SKELETON_FRAME* pSkeletons, NUI_IMAGE_RESOLUTION colorResolution, 
+                                    NUI_IMAGE_RESOLUTION depthResolution)
 {
-    // Convert joint positions into the coordinates for this resolution and view
-    Point jointPositions[NUI_SKELETON_POSITION_COUNT];
+    // Fail if either pointer is invalid
+    if (!pOverlay || !pSkeletons) 
+    {
+        return E_POINTER;
+    }
 
-    for (int j = 0; j < NUI_SKELETON_POSITION_COUNT; ++j)
+    // Fail if overlay has no image size or if depth resolution is invalid
+    if (pOverlay->GetSize().area() == 0 || depthResolution == NUI_IMAGE_RESOLUTION_INVALID)
     {
-        LONG x, y;
-        GetCoordinatesForSkeletonPoint(pSkel->SkeletonPositions[j], &x, &y, colorResolution, depthResolution);
-        jointPositions[j] = Point(x, y);
+        return E_INVALIDARG;
     }
 
-    // Draw torso
-    DrawBone(pImg, pSkel, NUI_SKELETON_POSITION_HEAD, NUI_SKELETON_POSITION_SHOULDER_CENTER, jointPositions, color);
-    DrawBone(pImg, pSkel, NUI_SKELETON_POSITION_SHOULDER_CENTER, NUI_SKELETON_POSITION_SHOULDER_LEFT, jointPositions, color);
-    DrawBone(pImg, pSkel, NUI_SKELETON_POSITION_SHOULDER_CENTER, NUI_SKELETON_POSITION_SHOULDER_RIGHT, jointPositions, color);
-    DrawBone(pImg, pSkel, NUI_SKELETON_POSITION_SHOULDER_CENTER, NUI_SKELETON_POSITION_SPINE, jointPositions, color);
-    DrawBone(pImg, pSkel, NUI_SKELETON_POSITION_SPINE, NUI_SKELETON_POSITION_HIP_CENTER, jointPositions, color);
-    DrawBone(pImg, pSkel, NUI_SKELETON_POSITION_HIP_CENTER, NUI_SKELETON_POSITION_HIP_LEFT, jointPositions, color);
-    DrawBone(pImg, pSkel, NUI_SKELETON_POSITION_HIP_CENTER, NUI_SKELETON_POSITION_HIP_RIGHT, jointPositions, color);
-
-    // Draw left arm
-    DrawBone(pImg, pSkel, NUI_SKELETON_POSITION_SHOULDER_LEFT, NUI_SKELETON_POSITION_ELBOW_LEFT, jointPositions, color);
-    DrawBone(pImg, pSkel, NUI_SKELETON_POSITION_ELBOW_LEFT, NUI_SKELETON_POSITION_WRIST_LEFT, jointPositions, color);
-    DrawBone(pImg, pSkel, NUI_SKELETON_POSITION_WRIST_LEFT, NUI_SKELETON_POSITION_HAND_LEFT, jointPositions, color);
-
-    // Draw right arm
-    DrawBone(pImg, pSkel, NUI_SKELETON_POSITION_SHOULDER_RIGHT, NUI_SKELETON_POSITION_ELBOW_RIGHT, jointPositions, color);
-    DrawBone(pImg, pSkel, NUI_SKELETON_POSITION_ELBOW_RIGHT, NUI_SKELETON_POSITION_WRIST_RIGHT, jointPositions, color);
-    DrawBone(pImg, pSkel, NUI_SKELETON_POSITION_WRIST_RIGHT, NUI_SKELETON_POSITION_HAND_RIGHT, jointPositions, color);
-
-    // Draw left leg
-    DrawBone(pImg, pSkel, NUI_SKELETON_POSITION_HIP_LEFT, NUI_SKELETON_POSITION_KNEE_LEFT, jointPositions, color);
-    DrawBone(pImg, pSkel, NUI_SKELETON_POSITION_KNEE_LEFT, NUI_SKELETON_POSITION_ANKLE_LEFT, jointPositions, color);
-    DrawBone(pImg, pSkel, NUI_SKELETON_POSITION_ANKLE_LEFT, NUI_SKELETON_POSITION_FOOT_LEFT, jointPositions, color);
-
-    // Draw right leg
-    DrawBone(pImg, pSkel, NUI_SKELETON_POSITION_HIP_RIGHT, NUI_SKELETON_POSITION_KNEE_RIGHT, jointPositions, color);
-    DrawBone(pImg, pSkel, NUI_SKELETON_POSITION_KNEE_RIGHT, NUI_SKELETON_POSITION_ANKLE_RIGHT, jointPositions, color);
-    DrawBone(pImg, pSkel, NUI_SKELETON_POSITION_ANKLE_RIGHT, NUI_SKELETON_POSITION_FOOT_RIGHT, jointPositions, color);
-
-    // Draw joints on top of bones
-    for (int j = 0; j < NUI_SKELETON_POSITION_COUNT; ++j)
+    // The overlay reads tracking states in place, so they must have the SDK's size and values
+    static_assert(NUI_SKELETON_POSITION_COUNT == SKELETON_JOINT_COUNT, "joint count must match the Kinect SDK");
+    static_assert(sizeof(NUI_SKELETON_POSITION_TRACKING_STATE) == sizeof(SkeletonJointState), "joint states must match the Kinect SDK");
+    static_assert(NUI_SKELETON_POSITION_NOT_TRACKED == SKELETON_JOINT_NOT_TRACKED && NUI_SKELETON_POSITION_INFERRED == SKELETON_JOINT_INFERRED &&
+        NUI_SKELETON_POSITION_TRACKED == SKELETON_JOINT_TRACKED, "joint states must match the Kinect SDK");
+
+    // Gather the joints of tracked skeletons and the positions of the others so they are projected in one batch
+    SkeletonPoint points[NUI_SKELETON_COUNT * NUI_SKELETON_POSITION_COUNT];
+    int firstPoint[NUI_SKELETON_COUNT];
+    int count = 0;
+    for (int i = 0; i < NUI_SKELETON_COUNT; ++i)
     {
-        // Draw a colored circle with a black border for tracked joints
-        if (pSkel->eSkeletonPositionTrackingState[j] == NUI_SKELETON_POSITION_TRACKED) 
+        const NUI_SKELETON_DATA& skeleton = pSkeletons->SkeletonData[i];
+        firstPoint[i] = count;
+
+        if (skeleton.eTrackingState == NUI_SKELETON_TRACKED)
         {
-            circle(*pImg, jointPositions[j], 5, color, CV_FILLED);
-            circle(*pImg, jointPositions[j], 6, Scalar(0, 0, 0), 1);
-        } 
-        // Draw a white, unfilled circle for inferred joints
-        else if (pSkel->eSkeletonPositionTrackingState[j] == NUI_SKELETON_POSITION_INFERRED) 
+            memcpy(points + count, skeleton.SkeletonPositions, sizeof(skeleton.SkeletonPositions));
+            count += NUI_SKELETON_POSITION_COUNT;
+        }
+        else if (skeleton.eTrackingState == NUI_SKELETON_POSITION_ONLY)
         {
-            circle(*pImg, jointPositions[j], 4, Scalar(255,255,255), 2);
+            memcpy(points + count, &skeleton.Position, sizeof(skeleton.Position));
+            ++count;
         }
     }
-}
 
-/// <summary>
-/// Draws the bone between the two joints of the skeleton in the given Mat
-/// </summary>
-/// <param name="pImg">pointer to Mat in which to draw the skeletons</param>
-/// <param name="pSkel">pointer to skeleton containing bone to draw</param>
-/// <param name="joint0">first joint of bone to draw</param>
-/// <param name="joint1">second joint of bone to draw</param>
-/// <param name="jointPositions">pixel coordinate of the skeleton's joints</param>
-/// <param name="color">color to use</param>
-void OpenCVHelper::DrawBone(Mat* pImg, NUI_SKELETON_DATA* pSkel, NUI_SKELETON_POSITION_INDEX joint0, 
-                            NUI_SKELETON_POSITION_INDEX joint1, Point jointPositions[NUI_SKELETON_POSITION_COUNT], Scalar color)
-{
-    NUI_SKELETON_POSITION_TRACKING_STATE joint0state = pSkel->eSkeletonPositionTrackingState[joint0];
-    NUI_SKELETON_POSITION_TRACKING_STATE joint1state = pSkel->eSkeletonPositionTrackingState[joint1];
-
-    // Don't draw unless at least one joint is tracked
-    if (joint0state == NUI_SKELETON_POSITION_NOT_TRACKED || joint1state == NUI_SKELETON_POSITION_NOT_TRACKED) 
+    int xs[NUI_SKELETON_COUNT * NUI_SKELETON_POSITION_COUNT];
+    int ys[NUI_SKELETON_COUNT * NUI_SKELETON_POSITION_COUNT];
+    HRESULT hr = ProjectSkeletonPoints(points, count, colorResolution, depthResolution, xs, ys);
+    if (FAILED(hr))
     {
-        return;
+        return hr;
     }
 
-    if (joint0state == NUI_SKELETON_POSITION_INFERRED && joint1state == NUI_SKELETON_POSITION_INFERRED) 
+    // Draw each tracked skeleton
+    for (int i = 0; i < NUI_SKELETON_COUNT; ++i)
     {
-        return;
+        NUI_SKELETON_TRACKING_STATE trackingState = pSkeletons->SkeletonData[i].eTrackingState;
+        if (trackingState == NUI_SKELETON_TRACKED)
+        {
+            // Draw entire skeleton
+            Point jointPositions[NUI_SKELETON_POSITION_COUNT];
+            for (int j = 0; j < NUI_SKELETON_POSITION_COUNT; ++j)
+            {
+                jointPositions[j] = Point(xs[firstPoint[i] + j], ys[firstPoint[i] + j]);
+            }
+
+            const SkeletonJointState* pStates =
+                reinterpret_cast<const SkeletonJointState*>(pSkeletons->SkeletonData[i].eSkeletonPositionTrackingState);
+            pOverlay->AddSkeleton(jointPositions, pStates, SKELETON_COLORS[i]);
+        } 
+        else if (trackingState == NUI_SKELETON_POSITION_ONLY) 
+        {
+            // Draw a filled circle at the skeleton's inferred position
+            pOverlay->AddCircle(Point(xs[firstPoint[i]], ys[firstPoint[i]]), 7, SKELETON_COLORS[i], CV_FILLED);
+        }
     }
 
-    // If both joints are tracked, draw a colored line
-    if (joint0state == NUI_SKELETON_POSITION_TRACKED && joint1state == NUI_SKELETON_POSITION_TRACKED) 
-    {
-        line(*pImg, jointPositions[joint0], jointPositions[joint1], color, 2);
-    } 
-    // If only one joint is tracked, draw a thinner white line
-    else 
-    {
-        line(*pImg, jointPositions[joint0], jointPositions[joint1], Scalar(255,255,255), 1);
-    }
+    return S_OK;
 }
 
 /// <summary>
-/// Converts a point in skeleton space to coordinates in color or depth space
+/// Converts points in skeleton space to coordinates in color or depth space, all in one batch
 /// </summary>
-/// <param name="point">point to convert</param>
-/// <param name="pX">pointer to LONG in which to return x-coordinate</param>
-/// <param name="pY">pointer to LONG in which to return y-coorindate</param>
+/// <param name="pPoints">pointer to points to convert</param>
+/// <param name="count">number of points</param>
 /// <param name="colorRes">resolution of color image stream, or NUI_IMAGE_RESOLUTION_INVALID for conversions to depth space</param>
 /// <param name="depthRes">resolution of depth image stream</param>
-/// <returns>S_OK if successful, an error code otherwise</param>
-HRESULT OpenCVHelper::GetCoordinatesForSkeletonPoint(Vector4 point, LONG* pX, LONG* pY, 
-                                                     NUI_IMAGE_RESOLUTION colorResolution, NUI_IMAGE_RESOLUTION depthResolution)
+/// <param name="pX">pointer to count values in which to return the x-coordinates</param>
+/// <param name="pY">pointer to count values in which to return the y-coordinates</param>
+/// <returns>S_OK if successful, an error code otherwise</returns>
+HRESULT OpenCVHelper::ProjectSkeletonPoints(const SkeletonPoint* pPoints, int count, NUI_IMAGE_RESOLUTION colorResolution,
+                                           NUI_IMAGE_RESOLUTION depthResolution, int* pX, int* pY) const
 {
-    // Fail if either pointer is invalid
-    if (!pX || !pY) 
-    {
-        return E_POINTER;
-    }
+    // The projector reads joints in place, so they must be laid out exactly like Vector4
+    static_assert(sizeof(SkeletonPoint) == sizeof(Vector4), "SkeletonPoint must match Vector4");
 
-    // Convert the point from skeleton space to depth space
-    LONG depthX, depthY;
-    USHORT depth;
-    NuiTransformSkeletonToDepthImage(point, &depthX, &depthY, &depth, depthResolution);
+    DWORD width, height;
 
-    // If the color resolution is invalid, return these coordinates
-    if (colorResolution == NUI_IMAGE_RESOLUTION_INVALID) 
-    {
-        *pX = depthX;
-        *pY = depthY;
-    } 
-    // Otherwise, convert the point from depth space to color space
-    else 
+    // If the color resolution is invalid, project into depth space
+    if (colorResolution == NUI_IMAGE_RESOLUTION_INVALID)
     {
-        HRESULT hr = NuiImageGetColorPixelCoordinatesFromDepthPixelAtResolution(colorResolution, depthResolution, NULL, depthX, depthY, depth, pX, pY);
-        if (FAILED(hr))
-        {
-            return hr;
-        }
+        NuiImageResolutionToSize(depthResolution, width, height);
+        return m_skeletonProjector.ProjectToDepth(pPoints, count, width, height, pX, pY);
     }
 
-    return S_OK;
-}
\ No newline at end of file
+    // Otherwise project straight into color space rather than through a depth pixel
+    NuiImageResolutionToSize(colorResolution, width, height);
+    return m_skeletonProjector.ProjectToColor(pPoints, count, width, height, pX, pY);
+}
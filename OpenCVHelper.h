@@ -19,6 +19,10 @@
 #pragma warning(pop)
 
 #include "OpenCVFrameHelper.h"
+#include "SweepFlowEstimator.h"
+#include "FilterChain.h"
+#include "SkeletonProjector.h"
+#include "Overlay.h"
 
 using namespace cv;
 
@@ -61,77 +65,79 @@ public:
     HRESULT ApplyDepthFilter(Mat* pImg);
 
     /// <summary>
-    /// Draws the skeletons from the skeleton frame in the given color image Mat
+    /// Draws the skeletons from the skeleton frame in the given color image overlay
     /// </summary>
-    /// <param name="pImg">pointer to color image Mat in which to draw the skeletons</param>
+    /// <param name="pOverlay">pointer to color image overlay in which to draw the skeletons</param>
     /// <param name="pSkeletons">pointer to skeleton frame to draw</param>
     /// <param name="colorRes">resolution of color image stream</param>
     /// <param name="depthRes">resolution of depth image stream</param>
     /// <returns>S_OK if successful, an error code otherwise</returns>
-    HRESULT DrawSkeletonsInColorImage(Mat* pImg, NUI_SKELETON_FRAME* pSkeletons, 
+    HRESULT DrawSkeletonsInColorImage(Overlay* pOverlay, NUI_SKELETON_FRAME* pSkeletons, 
         NUI_IMAGE_RESOLUTION colorResolution, NUI_IMAGE_RESOLUTION depthResolution);
 
     /// <summary>
-    /// Draws the skeletons from the skeleton frame in the given depth image Mat
+    /// Draws the skeletons from the skeleton frame in the given depth image overlay
     /// </summary>
-    /// <param name="pImg">pointer to depth image Mat in which to draw the skeletons</param>
+    /// <param name="pOverlay">pointer to depth image overlay in which to draw the skeletons</param>
     /// <param name="pSkeletons">pointer to skeleton frame to draw</param>
     /// <param name="depthRes">resolution of depth image stream</param>
     /// <returns>S_OK if successful, an error code otherwise</returns>
-    HRESULT DrawSkeletonsInDepthImage(Mat* pImg, NUI_SKELETON_FRAME* pSkeletons, 
+    HRESULT DrawSkeletonsInDepthImage(Overlay* pOverlay, NUI_SKELETON_FRAME* pSkeletons, 
         NUI_IMAGE_RESOLUTION depthResolution);
 
+    /// <summary>
+    /// Draws an arrow showing the direction and speed of the sweeping stroke in the given color image overlay
+    /// </summary>
+    /// <param name="pOverlay">pointer to color image overlay in which to draw the arrow</param>
+    /// <param name="pFlow">pointer to stroke motion to draw</param>
+    /// <param name="region">region the motion was measured in, or an empty Rect for the whole image</param>
+    /// <returns>S_OK if successful, an error code otherwise</returns>
+    HRESULT DrawSweepFlow(Overlay* pOverlay, const SweepFlow* pFlow, Rect region);
+
 private:
     // Functions:
     /// <summary>
-    /// Draws the skeletons from the skeleton frame in the given Mat
+    /// Fills the given chain with the steps of the filter corresponding to the given resource ID
     /// </summary>
-    /// <param name="pImg">pointer to Mat in which to draw the skeletons</param>
-    /// <param name="pSkeletons">pointer to skeleton frame to draw</param>
-    /// <param name="colorRes">resolution of color image stream, or NUI_IMAGE_RESOLUTION_INVALID for a depth image</param>
-    /// <param name="depthRes">resolution of depth image stream</param>
-    /// <returns>S_OK if successful, an error code otherwise</returns>
-    HRESULT DrawSkeletons(Mat* pImg, NUI_SKELETON_FRAME* skeletons, NUI_IMAGE_RESOLUTION colorResolution, 
-        NUI_IMAGE_RESOLUTION depthResolution);
+    /// <param name="filterID">resource ID of color or depth filter</param>
+    /// <param name="pChain">pointer to chain to fill</param>
+    void BuildFilterChain(int filterID, FilterChain* pChain);
 
     /// <summary>
-    /// Draws the specified skeleton in the given Mat
+    /// Draws the skeletons from the skeleton frame in the given overlay
     /// </summary>
-    /// <param name="pImg">pointer to Mat in which to draw the skeleton</param>
-    /// <param name="pSkel">pointer to skeleton to draw</param>
-    /// <param name="color">color to draw skeleton</param>
+    /// <param name="pOverlay">pointer to overlay in which to draw the skeletons</param>
+    /// <param name="pSkeletons">pointer to skeleton frame to draw</param>
     /// <param name="colorRes">resolution of color image stream, or NUI_IMAGE_RESOLUTION_INVALID for a depth image</param>
     /// <param name="depthRes">resolution of depth image stream</param>
     /// <returns>S_OK if successful, an error code otherwise</returns>
-    void DrawSkeleton(Mat* pImg, NUI_SKELETON_DATA* pSkel, Scalar color, NUI_IMAGE_RESOLUTION colorResolution, 
+    HRESULT DrawSkeletons(Overlay* pOverlay, NUI_SKELETON_FRAME* skeletons, NUI_IMAGE_RESOLUTION colorResolution, 
         NUI_IMAGE_RESOLUTION depthResolution);
 
     /// <summary>
-    /// Draws the bone between the two joints of the skeleton in the given Mat
-    /// </summary>
-    /// <param name="pImg">pointer to Mat in which to draw the skeletons</param>
-    /// <param name="pSkel">pointer to skeleton containing bone to draw</param>
-    /// <param name="joint0">first joint of bone to draw</param>
-    /// <param name="joint1">second joint of bone to draw</param>
-    /// <param name="jointPositions">pixel coordinate of the skeleton's joints</param>
-    /// <param name="color">color to use</param>
-    void DrawBone(Mat* pImg, NUI_SKELETON_DATA* pSkel, NUI_SKELETON_POSITION_INDEX joint0, 
-        NUI_SKELETON_POSITION_INDEX joint1, Point jointPositions[NUI_SKELETON_POSITION_COUNT], Scalar color);
-
-    /// <summary>
-    /// Converts a point in skeleton space to coordinates in color or depth space
+    /// Converts points in skeleton space to coordinates in color or depth space, all in one batch
     /// </summary>
-    /// <param name="point">point to convert</param>
-    /// <param name="pX">pointer to LONG in which to return x-coordinate</param>
-    /// <param name="pY">pointer to LONG in which to return y-coorindate</param>
+    /// <param name="pPoints">pointer to points to convert</param>
+    /// <param name="count">number of points</param>
     /// <param name="colorRes">resolution of color image stream, or NUI_IMAGE_RESOLUTION_INVALID for conversions to depth space</param>
     /// <param name="depthRes">resolution of depth image stream</param>
-    /// <returns>S_OK if successful, an error code otherwise</param>
-    HRESULT GetCoordinatesForSkeletonPoint(Vector4 point, LONG* pX, LONG* pY, NUI_IMAGE_RESOLUTION colorResolution, 
-        NUI_IMAGE_RESOLUTION depthResolution);
+    /// <param name="pX">pointer to count values in which to return the x-coordinates</param>
+    /// <param name="pY">pointer to count values in which to return the y-coordinates</param>
+    /// <returns>S_OK if successful, an error code otherwise</returns>
+    HRESULT ProjectSkeletonPoints(const SkeletonPoint* pPoints, int count, NUI_IMAGE_RESOLUTION colorResolution,
+        NUI_IMAGE_RESOLUTION depthResolution, int* pX, int* pY) const;
 
     // Variables:
     // Resource IDs of the active filters
     int m_colorFilterID;
     int m_depthFilterID;
+
+    // Filter chains and the resource IDs they were built for; each owns its scratch buffers
+    FilterChain m_colorFilterChain;
+    FilterChain m_depthFilterChain;
+    int m_colorChainFilterID;
+    int m_depthChainFilterID;
+
+    // Projects skeleton joints into the images without a call into the Kinect SDK per joint
+    SkeletonProjector m_skeletonProjector;
 };
\ No newline at end of file
@@ -0,0 +1,278 @@
+//-----------------------------------------------------------------------------
+// <copyright file="Overlay.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation. All rights reserved.
+// </copyright>
+//-----------------------------------------------------------------------------
+
+#include "Overlay.h"
+#include <string.h>
+
+using namespace cv;
+
+// Joint indices in the Kinect SDK's order
+enum SkeletonJoint
+{
+    JOINT_HIP_CENTER,
+    JOINT_SPINE,
+    JOINT_SHOULDER_CENTER,
+    JOINT_HEAD,
+    JOINT_SHOULDER_LEFT,
+    JOINT_ELBOW_LEFT,
+    JOINT_WRIST_LEFT,
+    JOINT_HAND_LEFT,
+    JOINT_SHOULDER_RIGHT,
+    JOINT_ELBOW_RIGHT,
+    JOINT_WRIST_RIGHT,
+    JOINT_HAND_RIGHT,
+    JOINT_HIP_LEFT,
+    JOINT_KNEE_LEFT,
+    JOINT_ANKLE_LEFT,
+    JOINT_FOOT_LEFT,
+    JOINT_HIP_RIGHT,
+    JOINT_KNEE_RIGHT,
+    JOINT_ANKLE_RIGHT,
+    JOINT_FOOT_RIGHT
+};
+
+// Joints joined by each bone: torso, left arm, right arm, left leg, right leg
+static const int SKELETON_BONES[][2] =
+{
+    {JOINT_HEAD, JOINT_SHOULDER_CENTER},
+    {JOINT_SHOULDER_CENTER, JOINT_SHOULDER_LEFT},
+    {JOINT_SHOULDER_CENTER, JOINT_SHOULDER_RIGHT},
+    {JOINT_SHOULDER_CENTER, JOINT_SPINE},
+    {JOINT_SPINE, JOINT_HIP_CENTER},
+    {JOINT_HIP_CENTER, JOINT_HIP_LEFT},
+    {JOINT_HIP_CENTER, JOINT_HIP_RIGHT},
+    {JOINT_SHOULDER_LEFT, JOINT_ELBOW_LEFT},
+    {JOINT_ELBOW_LEFT, JOINT_WRIST_LEFT},
+    {JOINT_WRIST_LEFT, JOINT_HAND_LEFT},
+    {JOINT_SHOULDER_RIGHT, JOINT_ELBOW_RIGHT},
+    {JOINT_ELBOW_RIGHT, JOINT_WRIST_RIGHT},
+    {JOINT_WRIST_RIGHT, JOINT_HAND_RIGHT},
+    {JOINT_HIP_LEFT, JOINT_KNEE_LEFT},
+    {JOINT_KNEE_LEFT, JOINT_ANKLE_LEFT},
+    {JOINT_ANKLE_LEFT, JOINT_FOOT_LEFT},
+    {JOINT_HIP_RIGHT, JOINT_KNEE_RIGHT},
+    {JOINT_KNEE_RIGHT, JOINT_ANKLE_RIGHT},
+    {JOINT_ANKLE_RIGHT, JOINT_FOOT_RIGHT}
+};
+
+/// <summary>
+/// Constructor
+/// </summary>
+Overlay::Overlay()
+{
+    // Enough for every skeleton and the sweep arrow, so a frame's shapes do not allocate
+    m_shapes.reserve(256);
+    m_text.reserve(256);
+}
+
+/// <summary>
+/// Removes all shapes and sets the size of the image the following shapes annotate
+/// </summary>
+/// <param name="size">size in pixels of the annotated image</param>
+void Overlay::Clear(Size size)
+{
+    m_size = size;
+    m_shapes.clear();
+    m_text.clear();
+}
+
+/// <summary>
+/// Gets the size of the image the shapes annotate
+/// </summary>
+/// <returns>size in pixels</returns>
+Size Overlay::GetSize() const
+{
+    return m_size;
+}
+
+/// <summary>
+/// Gets whether there is nothing to draw
+/// </summary>
+/// <returns>true if there are no shapes</returns>
+bool Overlay::IsEmpty() const
+{
+    return m_shapes.empty();
+}
+
+/// <summary>
+/// Adds a line segment
+/// </summary>
+/// <param name="p0">first end point</param>
+/// <param name="p1">second end point</param>
+/// <param name="color">color of line</param>
+/// <param name="thickness">thickness of line in pixels</param>
+void Overlay::AddLine(Point p0, Point p1, Scalar color, int thickness)
+{
+    OverlayShape shape = {OVERLAY_LINE, p0, p1, 0, 0.0, color, thickness, -1};
+    m_shapes.push_back(shape);
+}
+
+/// <summary>
+/// Adds a circle
+/// </summary>
+/// <param name="center">center of circle</param>
+/// <param name="radius">radius of circle in pixels</param>
+/// <param name="color">color of circle</param>
+/// <param name="thickness">thickness of outline in pixels, or CV_FILLED</param>
+void Overlay::AddCircle(Point center, int radius, Scalar color, int thickness)
+{
+    OverlayShape shape = {OVERLAY_CIRCLE, center, center, radius, 0.0, color, thickness, -1};
+    m_shapes.push_back(shape);
+}
+
+/// <summary>
+/// Adds an axis-aligned rectangle
+/// </summary>
+/// <param name="rect">rectangle to outline</param>
+/// <param name="color">color of rectangle</param>
+/// <param name="thickness">thickness of outline in pixels, or CV_FILLED</param>
+void Overlay::AddRectangle(Rect rect, Scalar color, int thickness)
+{
+    // Same corners as OpenCV's rectangle(Mat, Rect, ...)
+    Point p1(rect.x + rect.width - 1, rect.y + rect.height - 1);
+    OverlayShape shape = {OVERLAY_RECTANGLE, Point(rect.x, rect.y), p1, 0, 0.0, color, thickness, -1};
+    m_shapes.push_back(shape);
+}
+
+/// <summary>
+/// Adds a line of text
+/// </summary>
+/// <param name="origin">bottom-left corner of text</param>
+/// <param name="text">text to draw; it is copied</param>
+/// <param name="scale">scale relative to the font's base size</param>
+/// <param name="color">color of text</param>
+/// <param name="thickness">thickness of strokes in pixels</param>
+void Overlay::AddText(Point origin, const char* text, double scale, Scalar color, int thickness)
+{
+    if (!text)
+    {
+        return;
+    }
+
+    OverlayShape shape = {OVERLAY_TEXT, origin, origin, 0, scale, color, thickness, static_cast<int>(m_text.size())};
+    m_text.insert(m_text.end(), text, text + strlen(text) + 1);
+    m_shapes.push_back(shape);
+}
+
+/// <summary>
+/// Adds the bones and joints of a skeleton; bones between two tracked joints get the skeleton's color,
+/// bones to an inferred joint a thin white line, and bones to a joint that is not tracked are left out
+/// </summary>
+/// <param name="pJoints">pointer to SKELETON_JOINT_COUNT pixel coordinates of the joints</param>
+/// <param name="pStates">pointer to SKELETON_JOINT_COUNT tracking states of the joints</param>
+/// <param name="color">color of skeleton</param>
+void Overlay::AddSkeleton(const Point* pJoints, const SkeletonJointState* pStates, Scalar color)
+{
+    if (!pJoints || !pStates)
+    {
+        return;
+    }
+
+    for (size_t i = 0; i < sizeof(SKELETON_BONES) / sizeof(SKELETON_BONES[0]); ++i)
+    {
+        int joint0 = SKELETON_BONES[i][0];
+        int joint1 = SKELETON_BONES[i][1];
+
+        // Don't draw unless at least one joint is tracked
+        if (pStates[joint0] == SKELETON_JOINT_NOT_TRACKED || pStates[joint1] == SKELETON_JOINT_NOT_TRACKED)
+        {
+            continue;
+        }
+
+        if (pStates[joint0] == SKELETON_JOINT_INFERRED && pStates[joint1] == SKELETON_JOINT_INFERRED)
+        {
+            continue;
+        }
+
+        // If both joints are tracked, draw a colored line, otherwise a thinner white line
+        if (pStates[joint0] == SKELETON_JOINT_TRACKED && pStates[joint1] == SKELETON_JOINT_TRACKED)
+        {
+            AddLine(pJoints[joint0], pJoints[joint1], color, 2);
+        }
+        else
+        {
+            AddLine(pJoints[joint0], pJoints[joint1], Scalar(255, 255, 255), 1);
+        }
+    }
+
+    // Draw joints on top of bones
+    for (int j = 0; j < SKELETON_JOINT_COUNT; ++j)
+    {
+        // Draw a colored circle with a black border for tracked joints
+        if (pStates[j] == SKELETON_JOINT_TRACKED)
+        {
+            AddCircle(pJoints[j], 5, color, CV_FILLED);
+            AddCircle(pJoints[j], 6, Scalar(0, 0, 0), 1);
+        }
+        // Draw a white, unfilled circle for inferred joints
+        else if (pStates[j] == SKELETON_JOINT_INFERRED)
+        {
+            AddCircle(pJoints[j], 4, Scalar(255, 255, 255), 2);
+        }
+    }
+}
+
+/// <summary>
+/// Rasterizes the shapes into the given image, scaling them if it is not the annotated size
+/// </summary>
+/// <param name="pImg">pointer to image Mat in which to draw</param>
+/// <returns>S_OK if successful, an error code otherwise</returns>
+HRESULT Overlay::Render(Mat* pImg) const
+{
+    // Fail if pointer is invalid
+    if (!pImg)
+    {
+        return E_POINTER;
+    }
+
+    // Fail if Mat contains no data
+    if (pImg->empty())
+    {
+        return E_INVALIDARG;
+    }
+
+    if (m_shapes.empty() || m_size.area() == 0)
+    {
+        return S_OK;
+    }
+
+    // Shapes are recorded at the annotated size; a display image of another size gets them scaled
+    bool isScaled = (pImg->size() != m_size);
+    double scaleX = static_cast<double>(pImg->cols) / m_size.width;
+    double scaleY = static_cast<double>(pImg->rows) / m_size.height;
+
+    for (size_t i = 0; i < m_shapes.size(); ++i)
+    {
+        const OverlayShape& shape = m_shapes[i];
+        Point p0 = shape.p0;
+        Point p1 = shape.p1;
+        int radius = shape.radius;
+        if (isScaled)
+        {
+            p0 = Point(cvRound(p0.x * scaleX), cvRound(p0.y * scaleY));
+            p1 = Point(cvRound(p1.x * scaleX), cvRound(p1.y * scaleY));
+            radius = cvRound(radius * scaleX);
+        }
+
+        switch (shape.type)
+        {
+        case OVERLAY_LINE:
+            line(*pImg, p0, p1, shape.color, shape.thickness);
+            break;
+        case OVERLAY_CIRCLE:
+            circle(*pImg, p0, radius, shape.color, shape.thickness);
+            break;
+        case OVERLAY_RECTANGLE:
+            rectangle(*pImg, p0, p1, shape.color, shape.thickness);
+            break;
+        case OVERLAY_TEXT:
+            putText(*pImg, &m_text[shape.textOffset], p0, FONT_HERSHEY_SIMPLEX, shape.scale, shape.color, shape.thickness);
+            break;
+        }
+    }
+
+    return S_OK;
+}
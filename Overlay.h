@@ -0,0 +1,164 @@
+//-----------------------------------------------------------------------------
+// <copyright file="Overlay.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation. All rights reserved.
+// </copyright>
+//-----------------------------------------------------------------------------
+
+#pragma once
+
+#include "Platform.h"
+#include <vector>
+
+// Suppress warnings that come from compiling OpenCV code since we have no control over it
+#pragma warning(push)
+#pragma warning(disable : 6294 6031)
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#pragma warning(pop)
+
+using namespace cv;
+
+/// <summary>
+/// Kinds of shape an overlay can hold
+/// </summary>
+enum OverlayShapeType
+{
+    OVERLAY_LINE,
+    OVERLAY_CIRCLE,
+    OVERLAY_RECTANGLE,
+    OVERLAY_TEXT
+};
+
+// Joints of a skeleton, in the order of the Kinect SDK's NUI_SKELETON_POSITION_INDEX
+static const int SKELETON_JOINT_COUNT = 20;
+
+/// <summary>
+/// How well a skeleton joint is known, with the values of the Kinect SDK's NUI_SKELETON_POSITION_TRACKING_STATE
+/// </summary>
+enum SkeletonJointState
+{
+    SKELETON_JOINT_NOT_TRACKED,
+    SKELETON_JOINT_INFERRED,
+    SKELETON_JOINT_TRACKED
+};
+
+/// <summary>
+/// One shape of an overlay, in the pixel coordinates of the image it annotates
+/// </summary>
+struct OverlayShape
+{
+    OverlayShapeType type;
+
+    // Line end points, rectangle corners, circle center or text origin in p0
+    Point p0;
+    Point p1;
+
+    // Circle radius in pixels
+    int radius;
+
+    // Text scale relative to the font's base size
+    double scale;
+
+    Scalar color;
+
+    // Line thickness in pixels, or CV_FILLED for filled circles and rectangles
+    int thickness;
+
+    // Offset of the shape's text in the overlay's text buffer
+    int textOffset;
+};
+
+/// <summary>
+/// Annotations recorded as shapes and only rasterized when an image is about to be shown, so that the
+/// frames the annotations describe are never drawn on
+/// </summary>
+class Overlay
+{
+public:
+    // Functions:
+    /// <summary>
+    /// Constructor
+    /// </summary>
+    Overlay();
+
+    /// <summary>
+    /// Removes all shapes and sets the size of the image the following shapes annotate
+    /// </summary>
+    /// <param name="size">size in pixels of the annotated image</param>
+    void Clear(Size size);
+
+    /// <summary>
+    /// Gets the size of the image the shapes annotate
+    /// </summary>
+    /// <returns>size in pixels</returns>
+    Size GetSize() const;
+
+    /// <summary>
+    /// Gets whether there is nothing to draw
+    /// </summary>
+    /// <returns>true if there are no shapes</returns>
+    bool IsEmpty() const;
+
+    /// <summary>
+    /// Adds a line segment
+    /// </summary>
+    /// <param name="p0">first end point</param>
+    /// <param name="p1">second end point</param>
+    /// <param name="color">color of line</param>
+    /// <param name="thickness">thickness of line in pixels</param>
+    void AddLine(Point p0, Point p1, Scalar color, int thickness);
+
+    /// <summary>
+    /// Adds a circle
+    /// </summary>
+    /// <param name="center">center of circle</param>
+    /// <param name="radius">radius of circle in pixels</param>
+    /// <param name="color">color of circle</param>
+    /// <param name="thickness">thickness of outline in pixels, or CV_FILLED</param>
+    void AddCircle(Point center, int radius, Scalar color, int thickness);
+
+    /// <summary>
+    /// Adds an axis-aligned rectangle
+    /// </summary>
+    /// <param name="rect">rectangle to outline</param>
+    /// <param name="color">color of rectangle</param>
+    /// <param name="thickness">thickness of outline in pixels, or CV_FILLED</param>
+    void AddRectangle(Rect rect, Scalar color, int thickness);
+
+    /// <summary>
+    /// Adds a line of text
+    /// </summary>
+    /// <param name="origin">bottom-left corner of text</param>
+    /// <param name="text">text to draw; it is copied</param>
+    /// <param name="scale">scale relative to the font's base size</param>
+    /// <param name="color">color of text</param>
+    /// <param name="thickness">thickness of strokes in pixels</param>
+    void AddText(Point origin, const char* text, double scale, Scalar color, int thickness);
+
+    /// <summary>
+    /// Adds the bones and joints of a skeleton; bones between two tracked joints get the skeleton's color,
+    /// bones to an inferred joint a thin white line, and bones to a joint that is not tracked are left out
+    /// </summary>
+    /// <param name="pJoints">pointer to SKELETON_JOINT_COUNT pixel coordinates of the joints</param>
+    /// <param name="pStates">pointer to SKELETON_JOINT_COUNT tracking states of the joints</param>
+    /// <param name="color">color of skeleton</param>
+    void AddSkeleton(const Point* pJoints, const SkeletonJointState* pStates, Scalar color);
+
+    /// <summary>
+    /// Rasterizes the shapes into the given image, scaling them if it is not the annotated size
+    /// </summary>
+    /// <param name="pImg">pointer to image Mat in which to draw</param>
+    /// <returns>S_OK if successful, an error code otherwise</returns>
+    HRESULT Render(Mat* pImg) const;
+
+private:
+    // Variables:
+    // Size of the annotated image
+    Size m_size;
+
+    // Shapes in drawing order; both buffers keep their capacity from frame to frame
+    std::vector<OverlayShape> m_shapes;
+
+    // Null-terminated text of all text shapes
+    std::vector<char> m_text;
+};
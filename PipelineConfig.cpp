@@ -0,0 +1,207 @@
+//-----------------------------------------------------------------------------
+// <copyright file="PipelineConfig.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation. All rights reserved.
+// </copyright>
+//-----------------------------------------------------------------------------
+
+#include "PipelineConfig.h"
+#include <ctype.h>
+#include <stdlib.h>
+#include <fstream>
+
+/// <summary>
+/// Removes leading and trailing white space
+/// </summary>
+/// <param name="text">text to trim</param>
+/// <returns>trimmed text</returns>
+static std::string Trim(const std::string& text)
+{
+    size_t first = text.find_first_not_of(" \t\r\n");
+    if (first == std::string::npos)
+    {
+        return std::string();
+    }
+
+    size_t last = text.find_last_not_of(" \t\r\n");
+    return text.substr(first, last - first + 1);
+}
+
+/// <summary>
+/// Constructor
+/// </summary>
+PipelineConfig::PipelineConfig()
+{
+}
+
+/// <summary>
+/// Reads the settings from the given file, replacing any read before
+/// </summary>
+/// <param name="path">path of the file to read</param>
+/// <returns>S_OK if the file was read, S_FALSE if it does not exist and the defaults apply</returns>
+HRESULT PipelineConfig::Load(const char* path)
+{
+    // Fail if pointer is invalid
+    if (!path)
+    {
+        return E_POINTER;
+    }
+
+    m_values.clear();
+
+    std::ifstream file(path);
+    if (!file.is_open())
+    {
+        return S_FALSE;
+    }
+
+    std::string section;
+    std::string line;
+    while (std::getline(file, line))
+    {
+        size_t comment = line.find_first_of(";#");
+        if (comment != std::string::npos)
+        {
+            line.erase(comment);
+        }
+
+        line = Trim(line);
+        if (line.empty())
+        {
+            continue;
+        }
+
+        if (line[0] == '[')
+        {
+            size_t end = line.find(']');
+            section = Trim(line.substr(1, end == std::string::npos ? std::string::npos : end - 1));
+            continue;
+        }
+
+        // Lines without '=' are ignored rather than failing the whole file
+        size_t equals = line.find('=');
+        if (equals == std::string::npos)
+        {
+            continue;
+        }
+
+        m_values[MakeKey(section, Trim(line.substr(0, equals)))] = Trim(line.substr(equals + 1));
+    }
+
+    return S_OK;
+}
+
+/// <summary>
+/// Sets a value as if it had been read from the file
+/// </summary>
+/// <param name="section">section name</param>
+/// <param name="key">key name</param>
+/// <param name="value">value to store</param>
+void PipelineConfig::SetString(const char* section, const char* key, const char* value)
+{
+    m_values[MakeKey(section, key)] = value;
+}
+
+/// <summary>
+/// Gets a value as a string
+/// </summary>
+/// <param name="section">section name</param>
+/// <param name="key">key name</param>
+/// <param name="defaultValue">value to return if the key is not set</param>
+/// <returns>value of the key, or defaultValue</returns>
+std::string PipelineConfig::GetString(const char* section, const char* key, const char* defaultValue) const
+{
+    std::map<std::string, std::string>::const_iterator it = m_values.find(MakeKey(section, key));
+    if (it == m_values.end())
+    {
+        return defaultValue;
+    }
+
+    return it->second;
+}
+
+/// <summary>
+/// Gets a value as an integer
+/// </summary>
+/// <param name="section">section name</param>
+/// <param name="key">key name</param>
+/// <param name="defaultValue">value to return if the key is not set or is not a number</param>
+/// <returns>value of the key, or defaultValue</returns>
+int PipelineConfig::GetInt(const char* section, const char* key, int defaultValue) const
+{
+    std::string value = GetString(section, key, "");
+    char* pEnd = NULL;
+    long result = strtol(value.c_str(), &pEnd, 10);
+    if (value.empty() || *pEnd != '\0')
+    {
+        return defaultValue;
+    }
+
+    return static_cast<int>(result);
+}
+
+/// <summary>
+/// Gets a value as a floating point number
+/// </summary>
+/// <param name="section">section name</param>
+/// <param name="key">key name</param>
+/// <param name="defaultValue">value to return if the key is not set or is not a number</param>
+/// <returns>value of the key, or defaultValue</returns>
+float PipelineConfig::GetFloat(const char* section, const char* key, float defaultValue) const
+{
+    std::string value = GetString(section, key, "");
+    char* pEnd = NULL;
+    double result = strtod(value.c_str(), &pEnd);
+    if (value.empty() || *pEnd != '\0')
+    {
+        return defaultValue;
+    }
+
+    return static_cast<float>(result);
+}
+
+/// <summary>
+/// Gets a comma separated value as a list of trimmed, non-empty items
+/// </summary>
+/// <param name="section">section name</param>
+/// <param name="key">key name</param>
+/// <param name="defaultValue">value to split if the key is not set</param>
+/// <param name="pItems">pointer in which to return the items</param>
+void PipelineConfig::GetList(const char* section, const char* key, const char* defaultValue, std::vector<std::string>* pItems) const
+{
+    pItems->clear();
+
+    std::string value = GetString(section, key, defaultValue);
+    size_t start = 0;
+    while (start <= value.size())
+    {
+        size_t end = value.find(',', start);
+        if (end == std::string::npos)
+        {
+            end = value.size();
+        }
+
+        std::string item = Trim(value.substr(start, end - start));
+        if (!item.empty())
+        {
+            pItems->push_back(item);
+        }
+        start = end + 1;
+    }
+}
+
+/// <summary>
+/// Builds the lookup key of a setting
+/// </summary>
+/// <param name="section">section name</param>
+/// <param name="key">key name</param>
+/// <returns>lower case "section.key"</returns>
+std::string PipelineConfig::MakeKey(const std::string& section, const std::string& key)
+{
+    std::string result = section + "." + key;
+    for (size_t i = 0; i < result.size(); ++i)
+    {
+        result[i] = static_cast<char>(tolower(static_cast<unsigned char>(result[i])));
+    }
+
+    return result;
+}
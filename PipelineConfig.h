@@ -0,0 +1,91 @@
+//-----------------------------------------------------------------------------
+// <copyright file="PipelineConfig.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation. All rights reserved.
+// </copyright>
+//-----------------------------------------------------------------------------
+
+#pragma once
+
+#include "Platform.h"
+#include <map>
+#include <string>
+#include <vector>
+
+/// <summary>
+/// Settings read from an INI style file of [section] headers and key = value lines.
+/// Section and key names are case insensitive, and ';' or '#' starts a comment.
+/// </summary>
+class PipelineConfig
+{
+public:
+    // Functions:
+    /// <summary>
+    /// Constructor
+    /// </summary>
+    PipelineConfig();
+
+    /// <summary>
+    /// Reads the settings from the given file, replacing any read before
+    /// </summary>
+    /// <param name="path">path of the file to read</param>
+    /// <returns>S_OK if the file was read, S_FALSE if it does not exist and the defaults apply</returns>
+    HRESULT Load(const char* path);
+
+    /// <summary>
+    /// Sets a value as if it had been read from the file
+    /// </summary>
+    /// <param name="section">section name</param>
+    /// <param name="key">key name</param>
+    /// <param name="value">value to store</param>
+    void SetString(const char* section, const char* key, const char* value);
+
+    /// <summary>
+    /// Gets a value as a string
+    /// </summary>
+    /// <param name="section">section name</param>
+    /// <param name="key">key name</param>
+    /// <param name="defaultValue">value to return if the key is not set</param>
+    /// <returns>value of the key, or defaultValue</returns>
+    std::string GetString(const char* section, const char* key, const char* defaultValue) const;
+
+    /// <summary>
+    /// Gets a value as an integer
+    /// </summary>
+    /// <param name="section">section name</param>
+    /// <param name="key">key name</param>
+    /// <param name="defaultValue">value to return if the key is not set or is not a number</param>
+    /// <returns>value of the key, or defaultValue</returns>
+    int GetInt(const char* section, const char* key, int defaultValue) const;
+
+    /// <summary>
+    /// Gets a value as a floating point number
+    /// </summary>
+    /// <param name="section">section name</param>
+    /// <param name="key">key name</param>
+    /// <param name="defaultValue">value to return if the key is not set or is not a number</param>
+    /// <returns>value of the key, or defaultValue</returns>
+    float GetFloat(const char* section, const char* key, float defaultValue) const;
+
+    /// <summary>
+    /// Gets a comma separated value as a list of trimmed, non-empty items
+    /// </summary>
+    /// <param name="section">section name</param>
+    /// <param name="key">key name</param>
+    /// <param name="defaultValue">value to split if the key is not set</param>
+    /// <param name="pItems">pointer in which to return the items</param>
+    void GetList(const char* section, const char* key, const char* defaultValue, std::vector<std::string>* pItems) const;
+
+private:
+    // Functions:
+    /// <summary>
+    /// Builds the lookup key of a setting
+    /// </summary>
+    /// <param name="section">section name</param>
+    /// <param name="key">key name</param>
+    /// <returns>lower case "section.key"</returns>
+    static std::string MakeKey(const std::string& section, const std::string& key);
+
+    // Variables:
+    // Settings by lower case "section.key"
+    std::map<std::string, std::string> m_values;
+};
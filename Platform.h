@@ -0,0 +1,123 @@
+//-----------------------------------------------------------------------------
+// <copyright file="Platform.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation. All rights reserved.
+// </copyright>
+//-----------------------------------------------------------------------------
+
+#pragma once
+
+// Code that does not depend on the Kinect SDK includes this instead of windows.h,
+// so that it can also be built on other platforms, for example to replay recordings.
+
+#ifdef _WIN32
+
+#include <windows.h>
+
+#else
+
+#include <errno.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <algorithm>
+
+typedef int32_t HRESULT;
+typedef uint8_t BYTE;
+typedef uint8_t UINT8;
+typedef uint16_t USHORT;
+typedef uint32_t UINT;
+typedef uint32_t DWORD;
+typedef int32_t LONG;
+typedef uint32_t ULONG;
+typedef int64_t LONGLONG;
+
+#define S_OK                        ((HRESULT)0L)
+#define S_FALSE                     ((HRESULT)1L)
+#define E_FAIL                      ((HRESULT)0x80004005L)
+#define E_POINTER                   ((HRESULT)0x80004003L)
+#define E_INVALIDARG                ((HRESULT)0x80070057L)
+#define E_OUTOFMEMORY               ((HRESULT)0x8007000EL)
+#define E_NOT_VALID_STATE           ((HRESULT)0x8007139FL)
+#define E_NOTIMPL                   ((HRESULT)0x80004001L)
+
+// Kinect SDK values used by code that only handles recorded frames
+#define E_NUI_FRAME_NO_DATA         ((HRESULT)0x83010001L)
+#define NUI_IMAGE_PLAYER_INDEX_SHIFT    3
+#define NUI_IMAGE_PLAYER_INDEX_MASK     ((1 << NUI_IMAGE_PLAYER_INDEX_SHIFT) - 1)
+
+typedef enum _NUI_IMAGE_RESOLUTION
+{
+    NUI_IMAGE_RESOLUTION_INVALID = -1,
+    NUI_IMAGE_RESOLUTION_80x60 = 0,
+    NUI_IMAGE_RESOLUTION_320x240,
+    NUI_IMAGE_RESOLUTION_640x480,
+    NUI_IMAGE_RESOLUTION_1280x960
+} NUI_IMAGE_RESOLUTION;
+
+inline void NuiImageResolutionToSize(NUI_IMAGE_RESOLUTION resolution, DWORD& width, DWORD& height)
+{
+    switch (resolution)
+    {
+    case NUI_IMAGE_RESOLUTION_80x60:
+        width = 80;
+        height = 60;
+        break;
+    case NUI_IMAGE_RESOLUTION_320x240:
+        width = 320;
+        height = 240;
+        break;
+    case NUI_IMAGE_RESOLUTION_640x480:
+        width = 640;
+        height = 480;
+        break;
+    case NUI_IMAGE_RESOLUTION_1280x960:
+        width = 1280;
+        height = 960;
+        break;
+    default:
+        width = 0;
+        height = 0;
+        break;
+    }
+}
+
+#define SUCCEEDED(hr)               (((HRESULT)(hr)) >= 0)
+#define FAILED(hr)                  (((HRESULT)(hr)) < 0)
+
+#define UNREFERENCED_PARAMETER(p)   (void)(p)
+#define CALLBACK
+
+// Full fence, for data shared with other threads or processes without a lock
+#define MemoryBarrier()             __sync_synchronize()
+
+// Interlocked operations, which are full fences like their Windows counterparts
+#define InterlockedIncrement(p)                         __sync_add_and_fetch((p), 1)
+#define InterlockedExchange(p, value)                   __atomic_exchange_n((p), (value), __ATOMIC_SEQ_CST)
+#define InterlockedCompareExchangePointer(p, value, compare) __sync_val_compare_and_swap((p), (compare), (value))
+#define InterlockedExchangeAdd64(p, value)              __sync_fetch_and_add((p), (value))
+#define InterlockedCompareExchange64(p, value, compare) __sync_val_compare_and_swap((p), (compare), (value))
+
+// windows.h defines these as macros
+using std::min;
+using std::max;
+
+// Secure CRT functions of the Microsoft C runtime
+template <size_t size>
+inline int sprintf_s(char (&buffer)[size], const char* format, ...)
+{
+    va_list arguments;
+    va_start(arguments, format);
+    int length = vsnprintf(buffer, size, format, arguments);
+    va_end(arguments);
+    return length;
+}
+
+// Reports why the file could not be opened
+typedef int errno_t;
+inline errno_t fopen_s(FILE** ppFile, const char* path, const char* mode)
+{
+    *ppFile = fopen(path, mode);
+    return *ppFile ? 0 : errno;
+}
+
+#endif
@@ -0,0 +1,318 @@
+//-----------------------------------------------------------------------------
+// <copyright file="PointCloud.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation. All rights reserved.
+// </copyright>
+//-----------------------------------------------------------------------------
+
+#include "PointCloud.h"
+
+// SSE2 is always available on x64 and on the x86 targets the Kinect SDK supports
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define POINT_CLOUD_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+using namespace cv;
+
+// Depth is given in millimeters and points are in meters
+static const float METERS_PER_MILLIMETER = 0.001f;
+
+/// <summary>
+/// Constructor, starting from the nominal Kinect depth calibration
+/// </summary>
+PointCloud::PointCloud() :
+    m_step(1),
+    m_count(0)
+{
+    CameraIntrinsics depth = {SkeletonProjector::NOMINAL_DEPTH_FOCAL_LENGTH, SkeletonProjector::NOMINAL_DEPTH_FOCAL_LENGTH,
+        160.0f, 120.0f, 320, 240};
+    m_intrinsics = depth;
+}
+
+/// <summary>
+/// Sets the depth camera intrinsics the rays are computed from
+/// </summary>
+/// <param name="intrinsics">intrinsics at their reference resolution</param>
+/// <returns>S_OK if successful, E_INVALIDARG if the resolution is empty</returns>
+HRESULT PointCloud::SetIntrinsics(const CameraIntrinsics& intrinsics)
+{
+    if (intrinsics.width <= 0 || intrinsics.height <= 0)
+    {
+        return E_INVALIDARG;
+    }
+
+    m_intrinsics = intrinsics;
+
+    // Recompute the rays if a resolution was already planned
+    return (m_size.area() > 0) ? Plan(m_size, m_step) : S_OK;
+}
+
+/// <summary>
+/// Computes the ray of every sampled pixel and sizes the point buffers for the given depth resolution
+/// </summary>
+/// <param name="size">size of the depth frames</param>
+/// <param name="step">distance in pixels between sampled rows and columns, 1 for every pixel</param>
+/// <returns>S_OK if successful, an error code otherwise</returns>
+HRESULT PointCloud::Plan(Size size, int step)
+{
+    // Fail if there is nothing to sample
+    if (size.width <= 0 || size.height <= 0 || step < 1)
+    {
+        return E_INVALIDARG;
+    }
+
+    m_size = size;
+    m_step = step;
+
+    // Inverse of the projection in SkeletonProjector, where column c covers [c, c + 1)
+    float fx = m_intrinsics.fx * size.width / m_intrinsics.width;
+    float fy = m_intrinsics.fy * size.height / m_intrinsics.height;
+    float cx = m_intrinsics.cx * size.width / m_intrinsics.width;
+    float cy = m_intrinsics.cy * size.height / m_intrinsics.height;
+
+    int columns = (size.width + step - 1) / step;
+    int rows = (size.height + step - 1) / step;
+
+    m_rayX.resize(columns);
+    for (int i = 0; i < columns; ++i)
+    {
+        m_rayX[i] = (i * step - cx) / fx * METERS_PER_MILLIMETER;
+    }
+
+    m_rayY.resize(rows);
+    for (int i = 0; i < rows; ++i)
+    {
+        m_rayY[i] = (cy - i * step) / fy * METERS_PER_MILLIMETER;
+    }
+
+    // Every sampled pixel may become a point
+    size_t capacity = static_cast<size_t>(columns) * rows;
+    m_x.resize(capacity);
+    m_y.resize(capacity);
+    m_z.resize(capacity);
+    m_count = 0;
+
+    return S_OK;
+}
+
+/// <summary>
+/// Removes all points
+/// </summary>
+void PointCloud::Clear()
+{
+    m_count = 0;
+}
+
+/// <summary>
+/// Makes room for at least the given number of points added with AddPoint
+/// </summary>
+/// <param name="capacity">number of points</param>
+void PointCloud::Reserve(int capacity)
+{
+    if (capacity > static_cast<int>(m_x.size()))
+    {
+        m_x.resize(capacity);
+        m_y.resize(capacity);
+        m_z.resize(capacity);
+    }
+}
+
+/// <summary>
+/// Appends a point if there is room
+/// </summary>
+/// <param name="x">x coordinate in meters</param>
+/// <param name="y">y coordinate in meters</param>
+/// <param name="z">z coordinate in meters</param>
+/// <returns>true if the point was added, false if the cloud is full</returns>
+bool PointCloud::AddPoint(float x, float y, float z)
+{
+    if (m_count >= static_cast<int>(m_x.size()))
+    {
+        return false;
+    }
+
+    m_x[m_count] = x;
+    m_y[m_count] = y;
+    m_z[m_count] = z;
+    ++m_count;
+
+    return true;
+}
+
+/// <summary>
+/// Replaces the points with those of the given depth frame. Pixels with unknown depth, depth beyond
+/// maxDepth or a zero mask value are left out.
+/// </summary>
+/// <param name="pDepth">pointer to 16-bit depth Mat in millimeters, of the planned size</param>
+/// <param name="pMask">pointer to 8-bit mask Mat of the same size, non-zero where points are wanted, or NULL for all</param>
+/// <param name="maxDepth">farthest depth to keep, in millimeters</param>
+/// <returns>S_OK if successful, an error code otherwise</returns>
+HRESULT PointCloud::Generate(const Mat* pDepth, const Mat* pMask, int maxDepth)
+{
+    // Fail if pointer is invalid
+    if (!pDepth)
+    {
+        return E_POINTER;
+    }
+
+    // Fail if the depth does not match the planned resolution
+    if (pDepth->size() != m_size || pDepth->type() != CV_16UC1)
+    {
+        return E_INVALIDARG;
+    }
+
+    // Fail if the mask does not match the depth
+    if (pMask && (pMask->size() != m_size || pMask->type() != CV_8UC1))
+    {
+        return E_INVALIDARG;
+    }
+
+    m_count = 0;
+    for (int i = 0; i < static_cast<int>(m_rayY.size()); ++i)
+    {
+        int y = i * m_step;
+        GenerateRow(pDepth->ptr<USHORT>(y), pMask ? pMask->ptr<BYTE>(y) : NULL, m_rayY[i], maxDepth);
+    }
+
+    return S_OK;
+}
+
+/// <summary>
+/// Gets the number of points
+/// </summary>
+/// <returns>number of valid entries in each coordinate array</returns>
+int PointCloud::GetCount() const
+{
+    return m_count;
+}
+
+/// <summary>
+/// Gets the x coordinates of the points
+/// </summary>
+/// <returns>pointer to GetCount() values in meters</returns>
+const float* PointCloud::GetX() const
+{
+    return m_x.empty() ? NULL : &m_x[0];
+}
+
+/// <summary>
+/// Gets the y coordinates of the points
+/// </summary>
+/// <returns>pointer to GetCount() values in meters</returns>
+const float* PointCloud::GetY() const
+{
+    return m_y.empty() ? NULL : &m_y[0];
+}
+
+/// <summary>
+/// Gets the z coordinates of the points
+/// </summary>
+/// <returns>pointer to GetCount() values in meters</returns>
+const float* PointCloud::GetZ() const
+{
+    return m_z.empty() ? NULL : &m_z[0];
+}
+
+/// <summary>
+/// Appends the points of one sampled row
+/// </summary>
+/// <param name="pDepthRow">pointer to the depth row</param>
+/// <param name="pMaskRow">pointer to the mask row, or NULL for all</param>
+/// <param name="rayY">y component of the rays of this row</param>
+/// <param name="maxDepth">farthest depth to keep, in millimeters</param>
+void PointCloud::GenerateRow(const USHORT* pDepthRow, const BYTE* pMaskRow, float rayY, int maxDepth)
+{
+    const int columns = static_cast<int>(m_rayX.size());
+    const int step = m_step;
+    float* pX = &m_x[0];
+    float* pY = &m_y[0];
+    float* pZ = &m_z[0];
+    int count = m_count;
+    int i = 0;
+
+#ifdef POINT_CLOUD_USE_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i limit = _mm_set1_epi32(maxDepth);
+    const __m128 rayY4 = _mm_set1_ps(rayY);
+    const __m128 scale = _mm_set1_ps(METERS_PER_MILLIMETER);
+
+    for (; i + 4 <= columns; i += 4)
+    {
+        int x = i * step;
+        __m128i depth;
+        __m128i keep;
+        if (step == 1)
+        {
+            depth = _mm_unpacklo_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(pDepthRow + x)), zero);
+        }
+        else
+        {
+            depth = _mm_setr_epi32(pDepthRow[x], pDepthRow[x + step], pDepthRow[x + 2 * step], pDepthRow[x + 3 * step]);
+        }
+
+        // Known and within range; depth is at most 65535, so the signed compare is safe
+        keep = _mm_andnot_si128(_mm_cmpeq_epi32(depth, zero), _mm_xor_si128(_mm_cmpgt_epi32(depth, limit), _mm_set1_epi32(-1)));
+        if (pMaskRow)
+        {
+            __m128i mask = _mm_setr_epi32(pMaskRow[x], pMaskRow[x + step], pMaskRow[x + 2 * step], pMaskRow[x + 3 * step]);
+            keep = _mm_andnot_si128(_mm_cmpeq_epi32(mask, zero), keep);
+        }
+
+        int keepBits = _mm_movemask_ps(_mm_castsi128_ps(keep));
+        if (keepBits == 0)
+        {
+            continue;
+        }
+
+        // One multiply per axis: the ray already holds the unit conversion
+        __m128 depthF = _mm_cvtepi32_ps(depth);
+        __m128 px = _mm_mul_ps(_mm_loadu_ps(&m_rayX[i]), depthF);
+        __m128 py = _mm_mul_ps(rayY4, depthF);
+        __m128 pz = _mm_mul_ps(scale, depthF);
+
+        if (keepBits == 0xF)
+        {
+            _mm_storeu_ps(pX + count, px);
+            _mm_storeu_ps(pY + count, py);
+            _mm_storeu_ps(pZ + count, pz);
+            count += 4;
+        }
+        else
+        {
+            // Compact the kept lanes
+            float lanesX[4], lanesY[4], lanesZ[4];
+            _mm_storeu_ps(lanesX, px);
+            _mm_storeu_ps(lanesY, py);
+            _mm_storeu_ps(lanesZ, pz);
+            for (int lane = 0; lane < 4; ++lane)
+            {
+                if (keepBits & (1 << lane))
+                {
+                    pX[count] = lanesX[lane];
+                    pY[count] = lanesY[lane];
+                    pZ[count] = lanesZ[lane];
+                    ++count;
+                }
+            }
+        }
+    }
+#endif
+
+    for (; i < columns; ++i)
+    {
+        int x = i * step;
+        int depth = pDepthRow[x];
+        if (depth == 0 || depth > maxDepth || (pMaskRow && !pMaskRow[x]))
+        {
+            continue;
+        }
+
+        float depthF = static_cast<float>(depth);
+        pX[count] = m_rayX[i] * depthF;
+        pY[count] = rayY * depthF;
+        pZ[count] = METERS_PER_MILLIMETER * depthF;
+        ++count;
+    }
+
+    m_count = count;
+}
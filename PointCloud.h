@@ -0,0 +1,132 @@
+//-----------------------------------------------------------------------------
+// <copyright file="PointCloud.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation. All rights reserved.
+// </copyright>
+//-----------------------------------------------------------------------------
+
+#pragma once
+
+#include "Platform.h"
+#include <vector>
+
+// Suppress warnings that come from compiling OpenCV code since we have no control over it
+#pragma warning(push)
+#pragma warning(disable : 6294 6031)
+#include <opencv2/core/core.hpp>
+#pragma warning(pop)
+
+#include "SkeletonProjector.h"
+
+using namespace cv;
+
+/// <summary>
+/// Points of a depth frame in skeleton space, in meters (x right, y up, z away from the sensor).
+/// The coordinates are stored as three separate arrays that keep their capacity from frame to frame.
+/// </summary>
+class PointCloud
+{
+public:
+    // Functions:
+    /// <summary>
+    /// Constructor, starting from the nominal Kinect depth calibration
+    /// </summary>
+    PointCloud();
+
+    /// <summary>
+    /// Sets the depth camera intrinsics the rays are computed from
+    /// </summary>
+    /// <param name="intrinsics">intrinsics at their reference resolution</param>
+    /// <returns>S_OK if successful, E_INVALIDARG if the resolution is empty</returns>
+    HRESULT SetIntrinsics(const CameraIntrinsics& intrinsics);
+
+    /// <summary>
+    /// Computes the ray of every sampled pixel and sizes the point buffers for the given depth resolution
+    /// </summary>
+    /// <param name="size">size of the depth frames</param>
+    /// <param name="step">distance in pixels between sampled rows and columns, 1 for every pixel</param>
+    /// <returns>S_OK if successful, an error code otherwise</returns>
+    HRESULT Plan(Size size, int step);
+
+    /// <summary>
+    /// Removes all points
+    /// </summary>
+    void Clear();
+
+    /// <summary>
+    /// Makes room for at least the given number of points added with AddPoint
+    /// </summary>
+    /// <param name="capacity">number of points</param>
+    void Reserve(int capacity);
+
+    /// <summary>
+    /// Appends a point if there is room
+    /// </summary>
+    /// <param name="x">x coordinate in meters</param>
+    /// <param name="y">y coordinate in meters</param>
+    /// <param name="z">z coordinate in meters</param>
+    /// <returns>true if the point was added, false if the cloud is full</returns>
+    bool AddPoint(float x, float y, float z);
+
+    /// <summary>
+    /// Replaces the points with those of the given depth frame. Pixels with unknown depth, depth beyond
+    /// maxDepth or a zero mask value are left out.
+    /// </summary>
+    /// <param name="pDepth">pointer to 16-bit depth Mat in millimeters, of the planned size</param>
+    /// <param name="pMask">pointer to 8-bit mask Mat of the same size, non-zero where points are wanted, or NULL for all</param>
+    /// <param name="maxDepth">farthest depth to keep, in millimeters</param>
+    /// <returns>S_OK if successful, an error code otherwise</returns>
+    HRESULT Generate(const Mat* pDepth, const Mat* pMask, int maxDepth);
+
+    /// <summary>
+    /// Gets the number of points
+    /// </summary>
+    /// <returns>number of valid entries in each coordinate array</returns>
+    int GetCount() const;
+
+    /// <summary>
+    /// Gets the x coordinates of the points
+    /// </summary>
+    /// <returns>pointer to GetCount() values in meters</returns>
+    const float* GetX() const;
+
+    /// <summary>
+    /// Gets the y coordinates of the points
+    /// </summary>
+    /// <returns>pointer to GetCount() values in meters</returns>
+    const float* GetY() const;
+
+    /// <summary>
+    /// Gets the z coordinates of the points
+    /// </summary>
+    /// <returns>pointer to GetCount() values in meters</returns>
+    const float* GetZ() const;
+
+private:
+    // Functions:
+    /// <summary>
+    /// Appends the points of one sampled row
+    /// </summary>
+    /// <param name="pDepthRow">pointer to the depth row</param>
+    /// <param name="pMaskRow">pointer to the mask row, or NULL for all</param>
+    /// <param name="rayY">y component of the rays of this row</param>
+    /// <param name="maxDepth">farthest depth to keep, in millimeters</param>
+    void GenerateRow(const USHORT* pDepthRow, const BYTE* pMaskRow, float rayY, int maxDepth);
+
+    // Variables:
+    CameraIntrinsics m_intrinsics;
+
+    // Size and sampling step the rays were computed for
+    Size m_size;
+    int m_step;
+
+    // Rays through the sampled columns and rows, for a depth of one millimeter. The pinhole model
+    // separates, so a point costs one multiply per axis.
+    std::vector<float> m_rayX;
+    std::vector<float> m_rayY;
+
+    // Point coordinates in meters
+    std::vector<float> m_x;
+    std::vector<float> m_y;
+    std::vector<float> m_z;
+    int m_count;
+};
@@ -0,0 +1,161 @@
+//-----------------------------------------------------------------------------
+// <copyright file="PointCloudMessage.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation. All rights reserved.
+// </copyright>
+//-----------------------------------------------------------------------------
+
+#include "PointCloudMessage.h"
+
+// Each point is x, y and z as float32
+static const int POINT_STEP = 3 * sizeof(float);
+
+/// <summary>
+/// Writes a 32-bit value in little-endian order
+/// </summary>
+/// <param name="outbuffer">buffer to write to</param>
+/// <param name="value">value to write</param>
+/// <returns>number of bytes written</returns>
+static int WriteUInt32(unsigned char* outbuffer, uint32_t value)
+{
+    outbuffer[0] = static_cast<unsigned char>(value & 0xFF);
+    outbuffer[1] = static_cast<unsigned char>((value >> 8) & 0xFF);
+    outbuffer[2] = static_cast<unsigned char>((value >> 16) & 0xFF);
+    outbuffer[3] = static_cast<unsigned char>((value >> 24) & 0xFF);
+    return 4;
+}
+
+/// <summary>
+/// Constructor
+/// </summary>
+PointCloudMessage::PointCloudMessage() :
+    m_pCloud(NULL),
+    m_stride(1),
+    m_pointCount(0)
+{
+    static char* fieldNames[3] = {"x", "y", "z"};
+    for (int i = 0; i < 3; ++i)
+    {
+        m_fields[i].name = fieldNames[i];
+        m_fields[i].offset = i * sizeof(float);
+        m_fields[i].datatype = sensor_msgs::PointField::FLOAT32;
+        m_fields[i].count = 1;
+    }
+
+    header.seq = 0;
+    header.frame_id = "kinect_depth";
+    height = 1;
+    width = 0;
+    fields_length = 3;
+    fields = m_fields;
+    is_bigendian = false;
+    point_step = POINT_STEP;
+    row_step = 0;
+    data_length = 0;
+    data = NULL;
+    is_dense = true;
+}
+
+/// <summary>
+/// Sets the cloud to send, thinning it evenly if needed so the serialized message fits in maxLength bytes.
+/// The cloud is read when the message is published, so it must not change in between.
+/// </summary>
+/// <param name="pCloud">pointer to cloud to send, or NULL for none</param>
+/// <param name="maxLength">largest serialized message in bytes</param>
+void PointCloudMessage::SetCloud(const PointCloud* pCloud, int maxLength)
+{
+    m_pCloud = pCloud;
+    m_stride = 1;
+    m_pointCount = 0;
+
+    int count = pCloud ? pCloud->GetCount() : 0;
+    int maxPoints = max(0, (maxLength - GetFixedLength()) / POINT_STEP);
+    if (count > 0 && maxPoints > 0)
+    {
+        m_stride = (count + maxPoints - 1) / maxPoints;
+        m_pointCount = (count + m_stride - 1) / m_stride;
+    }
+
+    width = m_pointCount;
+    row_step = m_pointCount * POINT_STEP;
+}
+
+/// <summary>
+/// Gets the number of points that will be sent
+/// </summary>
+/// <returns>number of points</returns>
+int PointCloudMessage::GetPointCount() const
+{
+    return m_pointCount;
+}
+
+/// <summary>
+/// Writes the message in ROS wire format
+/// </summary>
+/// <param name="outbuffer">buffer to write to</param>
+/// <returns>number of bytes written</returns>
+int PointCloudMessage::serialize(unsigned char* outbuffer) const
+{
+    int offset = header.serialize(outbuffer);
+    offset += WriteUInt32(outbuffer + offset, height);
+    offset += WriteUInt32(outbuffer + offset, width);
+    offset += WriteUInt32(outbuffer + offset, fields_length);
+    for (int i = 0; i < fields_length; ++i)
+    {
+        offset += fields[i].serialize(outbuffer + offset);
+    }
+    outbuffer[offset++] = is_bigendian ? 1 : 0;
+    offset += WriteUInt32(outbuffer + offset, point_step);
+    offset += WriteUInt32(outbuffer + offset, row_step);
+    offset += WriteUInt32(outbuffer + offset, m_pointCount * POINT_STEP);
+
+    // Interleave the coordinate arrays directly into the output; x86 floats are already little-endian
+    if (m_pointCount > 0)
+    {
+        const float* pX = m_pCloud->GetX();
+        const float* pY = m_pCloud->GetY();
+        const float* pZ = m_pCloud->GetZ();
+        unsigned char* pOut = outbuffer + offset;
+        for (int i = 0, source = 0; i < m_pointCount; ++i, source += m_stride)
+        {
+            memcpy(pOut, pX + source, sizeof(float));
+            memcpy(pOut + 4, pY + source, sizeof(float));
+            memcpy(pOut + 8, pZ + source, sizeof(float));
+            pOut += POINT_STEP;
+        }
+        offset += m_pointCount * POINT_STEP;
+    }
+
+    outbuffer[offset++] = is_dense ? 1 : 0;
+    return offset;
+}
+
+/// <summary>
+/// Gets the number of bytes serialize will write, so the node handle can refuse a message that does not fit
+/// </summary>
+/// <returns>length in bytes</returns>
+int PointCloudMessage::serializedLength() const
+{
+    return GetFixedLength() + m_pointCount * POINT_STEP;
+}
+
+/// <summary>
+/// Gets the serialized length of everything but the point data
+/// </summary>
+/// <returns>length in bytes</returns>
+int PointCloudMessage::GetFixedLength() const
+{
+    // Header: seq, stamp and the length-prefixed frame id, sized as the generated Header writes them
+    int length = sizeof(header.seq) + sizeof(header.stamp.sec) + sizeof(header.stamp.nsec) + 4 + static_cast<int>(strlen(header.frame_id));
+
+    // Height, width and the field count
+    length += 3 * 4;
+
+    // Each field: length-prefixed name, offset, datatype and count
+    for (int i = 0; i < fields_length; ++i)
+    {
+        length += 4 + static_cast<int>(strlen(fields[i].name)) + 4 + 1 + 4;
+    }
+
+    // is_bigendian, point_step, row_step, data length and is_dense
+    return length + 1 + 4 + 4 + 4 + 1;
+}
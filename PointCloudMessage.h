@@ -0,0 +1,69 @@
+//-----------------------------------------------------------------------------
+// <copyright file="PointCloudMessage.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation. All rights reserved.
+// </copyright>
+//-----------------------------------------------------------------------------
+
+#pragma once
+
+#include <sensor_msgs/PointCloud2.h>
+#include "PointCloud.h"
+
+/// <summary>
+/// sensor_msgs/PointCloud2 that serializes a PointCloud straight from its coordinate arrays into the
+/// node handle's output buffer, as unorganized float32 x, y, z points.
+/// The generated rosserial message stores array lengths in 8 bits, so serialization is replaced here
+/// with one that writes the full 32-bit lengths of the ROS wire format.
+/// </summary>
+class PointCloudMessage : public sensor_msgs::PointCloud2
+{
+public:
+    // Functions:
+    /// <summary>
+    /// Constructor
+    /// </summary>
+    PointCloudMessage();
+
+    /// <summary>
+    /// Sets the cloud to send, thinning it evenly if needed so the serialized message fits in maxLength bytes.
+    /// The cloud is read when the message is published, so it must not change in between.
+    /// </summary>
+    /// <param name="pCloud">pointer to cloud to send, or NULL for none</param>
+    /// <param name="maxLength">largest serialized message in bytes</param>
+    void SetCloud(const PointCloud* pCloud, int maxLength);
+
+    /// <summary>
+    /// Gets the number of points that will be sent
+    /// </summary>
+    /// <returns>number of points</returns>
+    int GetPointCount() const;
+
+    /// <summary>
+    /// Writes the message in ROS wire format
+    /// </summary>
+    /// <param name="outbuffer">buffer to write to</param>
+    /// <returns>number of bytes written</returns>
+    virtual int serialize(unsigned char* outbuffer) const;
+
+    /// <summary>
+    /// Gets the number of bytes serialize will write, so the node handle can refuse a message that does not fit
+    /// </summary>
+    /// <returns>length in bytes</returns>
+    virtual int serializedLength() const;
+
+private:
+    // Functions:
+    /// <summary>
+    /// Gets the serialized length of everything but the point data
+    /// </summary>
+    /// <returns>length in bytes</returns>
+    int GetFixedLength() const;
+
+    // Variables:
+    sensor_msgs::PointField m_fields[3];
+
+    // Cloud to send and the distance between sent points
+    const PointCloud* m_pCloud;
+    int m_stride;
+    int m_pointCount;
+};
@@ -0,0 +1,157 @@
+//-----------------------------------------------------------------------------
+// <copyright file="ReplayDetector.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation. All rights reserved.
+// </copyright>
+//-----------------------------------------------------------------------------
+
+// Command line entry point that runs the detection engine on a depth recording, without a
+// window, a Kinect or a ROS connection. It is not part of the Windows project, which has its
+// own entry point; build it together with the portable sources, for example on Linux:
+//
+//   g++ -O2 ReplayDetector.cpp DetectionEngine.cpp DepthRecording.cpp DepthCodec.cpp TextPublisher.cpp
+//       DetectionPipeline.cpp DetectionStages.cpp DepthFilters.cpp IntegralImage.cpp MotionStats.cpp
+//       PipelineConfig.cpp PointCloud.cpp VoxelGrid.cpp SkeletonProjector.cpp BlobTracker.cpp
+//       SweepEventDetector.cpp LatencyHistogram.cpp Trace.cpp -lopencv_core -lopencv_imgproc
+//
+// Add -DENABLE_TRACING to record the hot path for the --trace option.
+//
+// Record a session with the /record option of the application first.
+
+#include "Platform.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+#include "DepthRecording.h"
+#include "DetectionEngine.h"
+#include "TextPublisher.h"
+#include "Trace.h"
+
+// Pipeline config used unless another one is given
+static const char* DEFAULT_CONFIG_FILE_NAME = "DetectionPipeline.ini";
+
+/// <summary>
+/// Prints the command line options
+/// </summary>
+/// <param name="program">name the program was run as</param>
+static void PrintUsage(const char* program)
+{
+    fprintf(stderr,
+        "Usage: %s <recording> [--config <file>] [--frames <count>] [--loop] [--quiet] [--trace <file>]\n"
+        "  --config   detection pipeline config, %s by default\n"
+        "  --frames   stop after this many frames\n"
+        "  --loop     start over at the end of the recording, use with --frames\n"
+        "  --quiet    only print the timing summary, not the published results\n"
+        "  --trace    write a Chrome trace of the run, if built with ENABLE_TRACING\n",
+        program, DEFAULT_CONFIG_FILE_NAME);
+}
+
+/// <summary>
+/// Entry point
+/// </summary>
+/// <param name="argc">number of arguments</param>
+/// <param name="argv">arguments</param>
+/// <returns>0 if the recording was processed, 1 otherwise</returns>
+int main(int argc, char* argv[])
+{
+    const char* recordingFileName = NULL;
+    const char* configFileName = DEFAULT_CONFIG_FILE_NAME;
+    int maxFrames = 0;
+    bool isLooping = false;
+    bool isQuiet = false;
+    const char* traceFileName = NULL;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--config") == 0 && i + 1 < argc)
+        {
+            configFileName = argv[++i];
+        }
+        else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+        {
+            maxFrames = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--loop") == 0)
+        {
+            isLooping = true;
+        }
+        else if (strcmp(argv[i], "--quiet") == 0)
+        {
+            isQuiet = true;
+        }
+        else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc)
+        {
+            traceFileName = argv[++i];
+        }
+        else if (argv[i][0] != '-' && !recordingFileName)
+        {
+            recordingFileName = argv[i];
+        }
+        else
+        {
+            PrintUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    // A looping recording without a frame limit would never end
+    if (!recordingFileName || (isLooping && maxFrames <= 0))
+    {
+        PrintUsage(argv[0]);
+        return 1;
+    }
+
+    DepthRecordingReader reader;
+    if (FAILED(reader.Open(recordingFileName, isLooping)))
+    {
+        fprintf(stderr, "Cannot read depth recording %s\n", recordingFileName);
+        return 1;
+    }
+
+    DetectionEngine engine;
+    HRESULT hr = engine.Initialize(configFileName);
+    if (FAILED(hr))
+    {
+        fprintf(stderr, "Cannot build the detection pipeline\n");
+        return 1;
+    }
+    if (hr == S_FALSE)
+    {
+        fprintf(stderr, "Cannot use %s, running the default pipeline\n", configFileName);
+    }
+
+    TextPublisher publisher(isQuiet ? NULL : stdout);
+    engine.SetPublisher(&publisher);
+
+    DetectionRunStats stats;
+    hr = engine.Run(&reader, maxFrames, &stats);
+    if (FAILED(hr))
+    {
+        fprintf(stderr, "Reading the recording failed after %d frames\n", stats.frameCount);
+        return 1;
+    }
+
+    Size size = reader.GetFrameSize();
+    double processMilliseconds = (stats.frameCount > 0) ? 1000.0 * stats.processSeconds / stats.frameCount : 0.0;
+    double framesPerSecond = (stats.processSeconds > 0.0) ? stats.frameCount / stats.processSeconds : 0.0;
+    fprintf(stderr, "%d frames of %dx%d, %d processed, %d sweep events\n",
+        stats.frameCount, size.width, size.height, stats.processedCount, publisher.GetSweepEventCount());
+    fprintf(stderr, "detection %.3f ms/frame (%.1f fps), %.2f s total including reading\n",
+        processMilliseconds, framesPerSecond, stats.totalSeconds);
+
+    if (traceFileName)
+    {
+#ifdef ENABLE_TRACING
+        if (FAILED(WriteChromeTrace(traceFileName)))
+        {
+            fprintf(stderr, "Cannot write trace %s\n", traceFileName);
+            return 1;
+        }
+#else
+        fprintf(stderr, "Tracing is not enabled in this build, %s not written\n", traceFileName);
+#endif
+    }
+
+    return 0;
+}
@@ -0,0 +1,245 @@
+//-----------------------------------------------------------------------------
+// <copyright file="RosPublisher.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation. All rights reserved.
+// </copyright>
+//-----------------------------------------------------------------------------
+
+#include "RosPublisher.h"
+#include <ros.h>
+#include <std_msgs/Float32.h>
+#include <std_msgs/Float32MultiArray.h>
+#include <geometry_msgs/Vector3Stamped.h>
+#include "PointCloudMessage.h"
+#include "Trace.h"
+
+// Point clouds need a far larger output buffer than the default 512 bytes; the rosserial
+// packet header limits a message to 16-bit length
+static const int ROS_OUTPUT_SIZE = 32768;
+
+// rosserial keeps pointers to the publishers and messages, so there is one set for the process
+ros::NodeHandle_<WindowsSocket, 25, 25, 512, ROS_OUTPUT_SIZE> nh;
+std_msgs::Float32 float_msg;
+ros::Publisher sweep_pub("sweep", &float_msg);
+std_msgs::Float32MultiArray blob_msg;
+ros::Publisher blob_pub("sweep_blobs", &blob_msg);
+std_msgs::Float32MultiArray position_msg;
+ros::Publisher position_pub("sweep_position", &position_msg);
+PointCloudMessage cloud_msg;
+ros::Publisher cloud_pub("sweep_cloud", &cloud_msg);
+geometry_msgs::Vector3Stamped stamped_msg;
+ros::Publisher stamped_pub("sweep_stamped", &stamped_msg);
+char rosSrvrIp[20];
+char rosSrvrPort[8];
+
+/// <summary>
+/// Constructor
+/// </summary>
+RosPublisher::RosPublisher() :
+    m_isStampedSweepEnabled(false),
+    m_sourceTime(0)
+{
+}
+
+/// <summary>
+/// Gets the ROS time some time before another
+/// </summary>
+/// <param name="time">ROS time to count back from</param>
+/// <param name="nanoseconds">time to go back in nanoseconds, at least 0</param>
+/// <returns>earlier ROS time</returns>
+static ros::Time SubtractNanoseconds(ros::Time time, LONGLONG nanoseconds)
+{
+    // ros::Time keeps unsigned fields, so a second is borrowed by hand rather than through a negative Duration
+    unsigned long seconds = static_cast<unsigned long>(nanoseconds / 1000000000);
+    unsigned long remainder = static_cast<unsigned long>(nanoseconds % 1000000000);
+    if (time.nsec < remainder)
+    {
+        time.sec -= 1;
+        time.nsec += 1000000000;
+    }
+
+    time.sec -= seconds;
+    time.nsec -= remainder;
+    return time;
+}
+
+/// <summary>
+/// Connects to the ROS server and advertises the published topics
+/// </summary>
+/// <param name="serverAddress">IP address of the ROS server</param>
+/// <param name="port">port of the rosserial server</param>
+void RosPublisher::Initialize(const std::string& serverAddress, const std::string& port)
+{
+    strncpy_s(rosSrvrIp, serverAddress.c_str(), _TRUNCATE);
+    strncpy_s(rosSrvrPort, port.c_str(), _TRUNCATE);
+
+    nh.initNode(rosSrvrIp, rosSrvrPort);
+    nh.advertise(sweep_pub);
+    nh.advertise(blob_pub);
+    nh.advertise(position_pub);
+    nh.advertise(cloud_pub);
+    if (m_isStampedSweepEnabled)
+    {
+        stamped_msg.header.frame_id = "kinect_depth";
+        nh.advertise(stamped_pub);
+    }
+}
+
+/// <summary>
+/// Sets whether sweep events are also published on the sweep_stamped topic, as a
+/// geometry_msgs/Vector3Stamped whose stamp is the ROS time the depth frame was taken at
+/// and whose x is the intensity; must be called before Initialize
+/// </summary>
+/// <param name="isEnabled">true to publish stamped sweep events</param>
+void RosPublisher::SetStampedSweepEnabled(bool isEnabled)
+{
+    m_isStampedSweepEnabled = isEnabled;
+}
+
+/// <summary>
+/// Sets when the depth frame whose results are published next was taken by the sensor
+/// </summary>
+/// <param name="captureTime">monotonic time in nanoseconds, or 0 if not known</param>
+void RosPublisher::SetSourceTime(LONGLONG captureTime)
+{
+    m_sourceTime = captureTime;
+}
+
+/// <summary>
+/// Gets the distribution of the age of sweep events once written to the socket, from when
+/// the sensor took their depth frame through detection and serialization
+/// </summary>
+/// <param name="pSummary">pointer in which to return the percentiles in nanoseconds</param>
+void RosPublisher::GetSweepLatencySummary(LatencySummary* pSummary) const
+{
+    m_sweepLatency.GetSummary(pSummary);
+}
+
+/// <summary>
+/// Gets the distribution of the time taken to serialize a sweep event and write it to the socket
+/// </summary>
+/// <param name="pSummary">pointer in which to return the percentiles in nanoseconds</param>
+void RosPublisher::GetSweepWriteSummary(LatencySummary* pSummary) const
+{
+    m_sweepWriteTime.GetSummary(pSummary);
+}
+
+/// <summary>
+/// Services the ROS connection; must be called regularly
+/// </summary>
+void RosPublisher::Spin()
+{
+    TRACE_SCOPE("nh.spinOnce");
+    nh.spinOnce();
+}
+
+/// <summary>
+/// Publishes a change in sweeping state as its intensity, 0 when sweeping stopped
+/// </summary>
+/// <param name="pEvent">pointer to the detected event</param>
+void RosPublisher::PublishSweepEvent(const SweepEvent* pEvent)
+{
+    float_msg.data = pEvent->intensity;
+
+    // Publishing serializes the message and writes it to the socket before it returns
+    LONGLONG publishTime = GetMonotonicNanoseconds();
+    {
+        TRACE_SCOPE("sweep_pub.publish");
+        sweep_pub.publish(&float_msg);
+    }
+    LONGLONG writtenTime = GetMonotonicNanoseconds();
+
+    m_sweepWriteTime.Record(writtenTime - publishTime);
+    if (m_sourceTime != 0)
+    {
+        m_sweepLatency.Record(writtenTime - m_sourceTime);
+    }
+
+    if (m_isStampedSweepEnabled)
+    {
+        // The stamp is ROS time now less the age of the frame, so the robot can tell the age on its own clock
+        LONGLONG age = (m_sourceTime != 0) ? writtenTime - m_sourceTime : 0;
+        stamped_msg.header.seq++;
+        stamped_msg.header.stamp = SubtractNanoseconds(nh.now(), age);
+        stamped_msg.vector.x = pEvent->intensity;
+
+        TRACE_SCOPE("stamped_pub.publish");
+        stamped_pub.publish(&stamped_msg);
+    }
+}
+
+/// <summary>
+/// Publishes where the moving pixels of the latest depth frame are
+/// </summary>
+/// <param name="pStats">pointer to motion statistics of the frame</param>
+void RosPublisher::PublishSweepPosition(const MotionStats* pStats)
+{
+    m_positionData[0] = static_cast<float>(pStats->median.x);
+    m_positionData[1] = static_cast<float>(pStats->median.y);
+    m_positionData[2] = pStats->centroid.x;
+    m_positionData[3] = pStats->centroid.y;
+
+    position_msg.data = m_positionData;
+    position_msg.data_length = PUBLISHED_POSITION_FIELDS;
+
+    TRACE_SCOPE("position_pub.publish");
+    position_pub.publish(&position_msg);
+}
+
+/// <summary>
+/// Publishes the id, centroid and area of the blobs seen in the latest depth frame
+/// </summary>
+/// <param name="pBlobs">pointer to the tracked blobs, including those missed in the latest frame</param>
+/// <param name="count">number of tracked blobs</param>
+void RosPublisher::PublishBlobs(const TrackedBlob* pBlobs, int count)
+{
+    // Blobs are kept in the order they were first seen, so the longest tracked ones are published first
+    int publishedCount = 0;
+    for (int i = 0; i < count && publishedCount < MAX_PUBLISHED_BLOBS; ++i)
+    {
+        // Skip blobs that were not seen in this frame
+        if (pBlobs[i].missedFrames > 0)
+        {
+            continue;
+        }
+
+        float* pEntry = m_blobData + publishedCount * PUBLISHED_BLOB_FIELDS;
+        pEntry[0] = static_cast<float>(pBlobs[i].id);
+        pEntry[1] = pBlobs[i].centroid.x;
+        pEntry[2] = pBlobs[i].centroid.y;
+        pEntry[3] = static_cast<float>(pBlobs[i].area);
+        ++publishedCount;
+    }
+
+    if (publishedCount == 0)
+    {
+        return;
+    }
+
+    blob_msg.data = m_blobData;
+    blob_msg.data_length = static_cast<uint8_t>(publishedCount * PUBLISHED_BLOB_FIELDS);
+
+    TRACE_SCOPE("blob_pub.publish");
+    blob_pub.publish(&blob_msg);
+}
+
+/// <summary>
+/// Publishes the points of the latest depth frame, if the point cloud stage produced any
+/// </summary>
+/// <param name="pCloud">pointer to point cloud of the frame</param>
+void RosPublisher::PublishPointCloud(const PointCloud* pCloud)
+{
+    if (pCloud->GetCount() == 0)
+    {
+        return;
+    }
+
+    // Leave room for the rosserial packet header and checksum; larger clouds are thinned evenly
+    const int packetOverhead = 8;
+
+    cloud_msg.header.seq++;
+    cloud_msg.header.stamp = nh.now();
+    cloud_msg.SetCloud(pCloud, ROS_OUTPUT_SIZE - packetOverhead);
+
+    TRACE_SCOPE("cloud_pub.publish");
+    cloud_pub.publish(&cloud_msg);
+}
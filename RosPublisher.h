@@ -0,0 +1,111 @@
+//-----------------------------------------------------------------------------
+// <copyright file="RosPublisher.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation. All rights reserved.
+// </copyright>
+//-----------------------------------------------------------------------------
+
+#pragma once
+
+#include <windows.h>
+#include <string>
+
+#include "DetectionPublisher.h"
+#include "LatencyHistogram.h"
+
+/// <summary>
+/// Publishes detection results to the robot over rosserial
+/// </summary>
+class RosPublisher : public DetectionPublisher
+{
+    // Constants:
+    // Maximum number of blobs published per depth frame, and values published per blob (id, x, y, area)
+    static const int MAX_PUBLISHED_BLOBS = 8;
+    static const int PUBLISHED_BLOB_FIELDS = 4;
+
+    // Values published for the sweep position (median x, median y, centroid x, centroid y)
+    static const int PUBLISHED_POSITION_FIELDS = 4;
+
+public:
+    // Functions:
+    /// <summary>
+    /// Constructor
+    /// </summary>
+    RosPublisher();
+
+    /// <summary>
+    /// Connects to the ROS server and advertises the published topics
+    /// </summary>
+    /// <param name="serverAddress">IP address of the ROS server</param>
+    /// <param name="port">port of the rosserial server</param>
+    void Initialize(const std::string& serverAddress, const std::string& port);
+
+    /// <summary>
+    /// Sets whether sweep events are also published on the sweep_stamped topic, as a
+    /// geometry_msgs/Vector3Stamped whose stamp is the ROS time the depth frame was taken at
+    /// and whose x is the intensity; must be called before Initialize
+    /// </summary>
+    /// <param name="isEnabled">true to publish stamped sweep events</param>
+    void SetStampedSweepEnabled(bool isEnabled);
+
+    /// <summary>
+    /// Sets when the depth frame whose results are published next was taken by the sensor
+    /// </summary>
+    /// <param name="captureTime">monotonic time in nanoseconds, or 0 if not known</param>
+    void SetSourceTime(LONGLONG captureTime);
+
+    /// <summary>
+    /// Gets the distribution of the age of sweep events once written to the socket, from when
+    /// the sensor took their depth frame through detection and serialization
+    /// </summary>
+    /// <param name="pSummary">pointer in which to return the percentiles in nanoseconds</param>
+    void GetSweepLatencySummary(LatencySummary* pSummary) const;
+
+    /// <summary>
+    /// Gets the distribution of the time taken to serialize a sweep event and write it to the socket
+    /// </summary>
+    /// <param name="pSummary">pointer in which to return the percentiles in nanoseconds</param>
+    void GetSweepWriteSummary(LatencySummary* pSummary) const;
+
+    /// <summary>
+    /// Services the ROS connection; must be called regularly
+    /// </summary>
+    void Spin();
+
+    /// <summary>
+    /// Publishes a change in sweeping state as its intensity, 0 when sweeping stopped
+    /// </summary>
+    /// <param name="pEvent">pointer to the detected event</param>
+    virtual void PublishSweepEvent(const SweepEvent* pEvent);
+
+    /// <summary>
+    /// Publishes where the moving pixels of the latest depth frame are
+    /// </summary>
+    /// <param name="pStats">pointer to motion statistics of the frame</param>
+    virtual void PublishSweepPosition(const MotionStats* pStats);
+
+    /// <summary>
+    /// Publishes the id, centroid and area of the blobs seen in the latest depth frame
+    /// </summary>
+    /// <param name="pBlobs">pointer to the tracked blobs, including those missed in the latest frame</param>
+    /// <param name="count">number of tracked blobs</param>
+    virtual void PublishBlobs(const TrackedBlob* pBlobs, int count);
+
+    /// <summary>
+    /// Publishes the points of the latest depth frame, if the point cloud stage produced any
+    /// </summary>
+    /// <param name="pCloud">pointer to point cloud of the frame</param>
+    virtual void PublishPointCloud(const PointCloud* pCloud);
+
+private:
+    // Variables:
+    // Buffers the published arrays point into; they must stay valid until the message is serialized
+    float m_blobData[MAX_PUBLISHED_BLOBS * PUBLISHED_BLOB_FIELDS];
+    float m_positionData[PUBLISHED_POSITION_FIELDS];
+
+    bool m_isStampedSweepEnabled;
+    LONGLONG m_sourceTime;
+
+    // Written by the publishing thread, read by the window
+    LatencyHistogram m_sweepLatency;
+    LatencyHistogram m_sweepWriteTime;
+};
@@ -0,0 +1,52 @@
+//-----------------------------------------------------------------------------
+// <copyright file="SensorClock.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation. All rights reserved.
+// </copyright>
+//-----------------------------------------------------------------------------
+
+#include "SensorClock.h"
+
+/// <summary>
+/// Constructor
+/// </summary>
+SensorClock::SensorClock() :
+    m_hasOffset(false),
+    m_offset(0),
+    m_lastSensorTime(0)
+{
+}
+
+/// <summary>
+/// Forgets the offset, for example when the sensor was restarted
+/// </summary>
+void SensorClock::Reset()
+{
+    m_hasOffset = false;
+}
+
+/// <summary>
+/// Maps the timestamp of a frame onto the monotonic clock, and refines the offset with its arrival
+/// </summary>
+/// <param name="sensorMilliseconds">timestamp the sensor gave the frame in milliseconds</param>
+/// <param name="arrivalTime">monotonic time in nanoseconds at which the frame arrived</param>
+/// <returns>monotonic time in nanoseconds at which the sensor took the frame</returns>
+LONGLONG SensorClock::ToMonotonic(LONGLONG sensorMilliseconds, LONGLONG arrivalTime)
+{
+    LONGLONG sensorTime = sensorMilliseconds * 1000000;
+    LONGLONG offset = arrivalTime - sensorTime;
+
+    // A sensor clock that went back was restarted, and the old offset no longer holds
+    if (!m_hasOffset || sensorTime < m_lastSensorTime)
+    {
+        m_offset = offset;
+        m_hasOffset = true;
+    }
+    else
+    {
+        LONGLONG driftedOffset = m_offset + (sensorTime - m_lastSensorTime) * MAX_DRIFT_PPM / 1000000;
+        m_offset = (offset < driftedOffset) ? offset : driftedOffset;
+    }
+
+    m_lastSensorTime = sensorTime;
+    return sensorTime + m_offset;
+}
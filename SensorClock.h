@@ -0,0 +1,50 @@
+//-----------------------------------------------------------------------------
+// <copyright file="SensorClock.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation. All rights reserved.
+// </copyright>
+//-----------------------------------------------------------------------------
+
+#pragma once
+
+#include "Platform.h"
+
+/// <summary>
+/// Maps the timestamps a sensor puts on its frames onto the monotonic clock of this machine, so that
+/// the age of a frame can be measured from when the sensor took it rather than from when it arrived.
+/// The offset between the clocks is the smallest seen between a frame's timestamp and its arrival,
+/// which is the frame that waited least on the way; a mapped time is therefore never later than the
+/// arrival, and is early by the transfer time of that fastest frame. The offset may rise by as much as
+/// the clocks can drift apart, so that it follows a sensor clock that runs slow.
+/// </summary>
+class SensorClock
+{
+    // Constants:
+    // Largest rate at which the sensor clock is assumed to drift from the monotonic clock, in parts per million
+    static const LONGLONG MAX_DRIFT_PPM = 100;
+
+public:
+    // Functions:
+    /// <summary>
+    /// Constructor
+    /// </summary>
+    SensorClock();
+
+    /// <summary>
+    /// Forgets the offset, for example when the sensor was restarted
+    /// </summary>
+    void Reset();
+
+    /// <summary>
+    /// Maps the timestamp of a frame onto the monotonic clock, and refines the offset with its arrival
+    /// </summary>
+    /// <param name="sensorMilliseconds">timestamp the sensor gave the frame in milliseconds</param>
+    /// <param name="arrivalTime">monotonic time in nanoseconds at which the frame arrived</param>
+    /// <returns>monotonic time in nanoseconds at which the sensor took the frame</returns>
+    LONGLONG ToMonotonic(LONGLONG sensorMilliseconds, LONGLONG arrivalTime);
+
+private:
+    // Variables:
+    bool m_hasOffset;
+    LONGLONG m_offset;
+    LONGLONG m_lastSensorTime;
+};
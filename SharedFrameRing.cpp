@@ -0,0 +1,604 @@
+//-----------------------------------------------------------------------------
+// <copyright file="SharedFrameRing.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation. All rights reserved.
+// </copyright>
+//-----------------------------------------------------------------------------
+
+#include "SharedFrameRing.h"
+#include <string.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+// Identifies the memory as a frame ring, and the version of its layout
+static const DWORD SHARED_FRAME_RING_MAGIC = 0x474E524B; // "KRNG"
+static const DWORD SHARED_FRAME_RING_VERSION = 1;
+
+// Slots and pixel data start on cache lines, so that readers of one slot do not share a line with the writer of the next
+static const size_t SHARED_FRAME_RING_ALIGNMENT = 64;
+
+/// <summary>
+/// Rounds a size up to the alignment of the ring
+/// </summary>
+/// <param name="size">size in bytes</param>
+/// <returns>aligned size in bytes</returns>
+static size_t AlignSize(size_t size)
+{
+    return (size + SHARED_FRAME_RING_ALIGNMENT - 1) & ~(SHARED_FRAME_RING_ALIGNMENT - 1);
+}
+
+/// <summary>
+/// Checks that a frame description read from shared memory is usable and keeps its pixels inside a slot
+/// </summary>
+/// <param name="info">description of the frame</param>
+/// <param name="slotDataSize">bytes of pixel data a slot can hold</param>
+/// <returns>true if the frame can be read</returns>
+static bool IsFrameInfoValid(const SharedFrameInfo& info, DWORD slotDataSize)
+{
+    // A negative size or a type OpenCV does not know would have it compute the row size from garbage
+    if (info.size.width < 0 || info.size.height < 0 || info.type < 0 || info.type > CV_MAT_TYPE_MASK ||
+        CV_MAT_DEPTH(info.type) > CV_64F)
+    {
+        return false;
+    }
+
+    // Each row must fit in its step and all rows in the slot; dividing rather than multiplying cannot overflow
+    if (static_cast<size_t>(info.size.width) > info.step / CV_ELEM_SIZE(info.type))
+    {
+        return false;
+    }
+
+    return info.size.height == 0 || info.step <= slotDataSize / static_cast<size_t>(info.size.height);
+}
+
+/// <summary>
+/// Constructor
+/// </summary>
+SharedMemoryRegion::SharedMemoryRegion() :
+    m_pData(NULL),
+    m_size(0)
+#ifdef _WIN32
+    , m_hMapping(NULL)
+#else
+    , m_isCreator(false)
+#endif
+{
+}
+
+/// <summary>
+/// Destructor
+/// </summary>
+SharedMemoryRegion::~SharedMemoryRegion()
+{
+    Close();
+}
+
+/// <summary>
+/// Creates a region that no other process has created yet, and maps it for writing
+/// </summary>
+/// <param name="name">name other processes open the region by</param>
+/// <param name="size">size of the region in bytes</param>
+/// <returns>S_OK if successful, E_NOT_VALID_STATE if the name is taken, an error code otherwise</returns>
+HRESULT SharedMemoryRegion::Create(const std::string& name, size_t size)
+{
+    // Fail if a region is already mapped
+    if (m_pData)
+    {
+        return E_NOT_VALID_STATE;
+    }
+
+    // Fail if name or size is empty
+    if (name.empty() || size == 0)
+    {
+        return E_INVALIDARG;
+    }
+
+#ifdef _WIN32
+    ULONGLONG mappingSize = size;
+    m_hMapping = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE,
+        static_cast<DWORD>(mappingSize >> 32), static_cast<DWORD>(mappingSize), name.c_str());
+    if (!m_hMapping)
+    {
+        return E_FAIL;
+    }
+
+    // Two writers of one ring would corrupt it
+    if (GetLastError() == ERROR_ALREADY_EXISTS)
+    {
+        CloseHandle(m_hMapping);
+        m_hMapping = NULL;
+        return E_NOT_VALID_STATE;
+    }
+
+    m_pData = static_cast<BYTE*>(MapViewOfFile(m_hMapping, FILE_MAP_WRITE, 0, 0, size));
+    if (!m_pData)
+    {
+        CloseHandle(m_hMapping);
+        m_hMapping = NULL;
+        return E_FAIL;
+    }
+#else
+    // POSIX names are a single path component starting with a slash
+    std::string posixName = (name[0] == '/') ? name : "/" + name;
+    int fd = shm_open(posixName.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+    if (fd < 0)
+    {
+        return E_NOT_VALID_STATE;
+    }
+
+    if (ftruncate(fd, static_cast<off_t>(size)) != 0)
+    {
+        close(fd);
+        shm_unlink(posixName.c_str());
+        return E_FAIL;
+    }
+
+    void* pData = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (pData == MAP_FAILED)
+    {
+        shm_unlink(posixName.c_str());
+        return E_FAIL;
+    }
+
+    m_pData = static_cast<BYTE*>(pData);
+    m_name = posixName;
+    m_isCreator = true;
+#endif
+
+    m_size = size;
+    return S_OK;
+}
+
+/// <summary>
+/// Maps a region that another process created for reading
+/// </summary>
+/// <param name="name">name the region was created with</param>
+/// <returns>S_OK if successful, an error code otherwise</returns>
+HRESULT SharedMemoryRegion::Open(const std::string& name)
+{
+    // Fail if a region is already mapped
+    if (m_pData)
+    {
+        return E_NOT_VALID_STATE;
+    }
+
+    // Fail if name is empty
+    if (name.empty())
+    {
+        return E_INVALIDARG;
+    }
+
+#ifdef _WIN32
+    m_hMapping = OpenFileMappingA(FILE_MAP_READ, FALSE, name.c_str());
+    if (!m_hMapping)
+    {
+        return E_FAIL;
+    }
+
+    m_pData = static_cast<BYTE*>(MapViewOfFile(m_hMapping, FILE_MAP_READ, 0, 0, 0));
+    if (!m_pData)
+    {
+        CloseHandle(m_hMapping);
+        m_hMapping = NULL;
+        return E_FAIL;
+    }
+
+    // The view covers the whole mapping, rounded up to pages
+    MEMORY_BASIC_INFORMATION info;
+    VirtualQuery(m_pData, &info, sizeof(info));
+    m_size = info.RegionSize;
+#else
+    std::string posixName = (name[0] == '/') ? name : "/" + name;
+    int fd = shm_open(posixName.c_str(), O_RDONLY, 0);
+    if (fd < 0)
+    {
+        return E_FAIL;
+    }
+
+    struct stat status;
+    if (fstat(fd, &status) != 0 || status.st_size <= 0)
+    {
+        close(fd);
+        return E_FAIL;
+    }
+
+    void* pData = mmap(NULL, static_cast<size_t>(status.st_size), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (pData == MAP_FAILED)
+    {
+        return E_FAIL;
+    }
+
+    m_pData = static_cast<BYTE*>(pData);
+    m_size = static_cast<size_t>(status.st_size);
+    m_isCreator = false;
+#endif
+
+    return S_OK;
+}
+
+/// <summary>
+/// Unmaps the region, and removes its name if it was created here
+/// </summary>
+void SharedMemoryRegion::Close()
+{
+    if (!m_pData)
+    {
+        return;
+    }
+
+#ifdef _WIN32
+    // The mapping goes away with its last handle, so readers keep it alive
+    UnmapViewOfFile(m_pData);
+    CloseHandle(m_hMapping);
+    m_hMapping = NULL;
+#else
+    munmap(m_pData, m_size);
+    if (m_isCreator)
+    {
+        shm_unlink(m_name.c_str());
+    }
+    m_name.clear();
+    m_isCreator = false;
+#endif
+
+    m_pData = NULL;
+    m_size = 0;
+}
+
+/// <summary>
+/// Gets the mapped memory
+/// </summary>
+/// <returns>pointer to the start of the region, or NULL if none is mapped</returns>
+BYTE* SharedMemoryRegion::GetData() const
+{
+    return m_pData;
+}
+
+/// <summary>
+/// Gets the size of the mapped memory
+/// </summary>
+/// <returns>size in bytes</returns>
+size_t SharedMemoryRegion::GetSize() const
+{
+    return m_size;
+}
+
+/// <summary>
+/// Constructor
+/// </summary>
+SharedFrameRingWriter::SharedFrameRingWriter() :
+    m_pHeader(NULL)
+{
+}
+
+/// <summary>
+/// Creates the ring in shared memory
+/// </summary>
+/// <param name="name">name readers open the ring by</param>
+/// <param name="slotCount">number of frames the ring holds before the oldest is overwritten</param>
+/// <param name="slotDataSize">largest frame in bytes</param>
+/// <returns>S_OK if successful, an error code otherwise</returns>
+HRESULT SharedFrameRingWriter::Create(const std::string& name, int slotCount, size_t slotDataSize)
+{
+    // Fail if the ring would be empty
+    if (slotCount <= 0 || slotDataSize == 0)
+    {
+        return E_INVALIDARG;
+    }
+
+    size_t slotStride = AlignSize(sizeof(SharedFrameSlotHeader)) + AlignSize(slotDataSize);
+    size_t size = AlignSize(sizeof(SharedFrameRingHeader)) + slotCount * slotStride;
+    HRESULT hr = m_region.Create(name, size);
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+
+    BYTE* pData = m_region.GetData();
+    memset(pData, 0, size);
+
+    m_pHeader = reinterpret_cast<SharedFrameRingHeader*>(pData);
+    m_pHeader->version = SHARED_FRAME_RING_VERSION;
+    m_pHeader->slotCount = static_cast<DWORD>(slotCount);
+    m_pHeader->slotDataSize = static_cast<DWORD>(slotDataSize);
+    m_pHeader->slotStride = static_cast<DWORD>(slotStride);
+    m_pHeader->frameCount = 0;
+
+    // Readers check the magic last, so they never see a ring that is half set up
+    MemoryBarrier();
+    m_pHeader->magic = SHARED_FRAME_RING_MAGIC;
+
+    return S_OK;
+}
+
+/// <summary>
+/// Writes a frame into the oldest slot
+/// </summary>
+/// <param name="pImage">pointer to the frame, at most as large as the slots</param>
+/// <param name="timestamp">capture time of the frame in milliseconds</param>
+/// <returns>S_OK if successful, an error code otherwise</returns>
+HRESULT SharedFrameRingWriter::WriteFrame(const Mat* pImage, DWORD timestamp)
+{
+    // Fail if pointer is invalid
+    if (!pImage)
+    {
+        return E_POINTER;
+    }
+
+    // Fail if no ring was created
+    if (!m_pHeader)
+    {
+        return E_NOT_VALID_STATE;
+    }
+
+    // Fail if the frame does not fit in a slot
+    size_t rowSize = pImage->cols * pImage->elemSize();
+    if (pImage->empty() || rowSize * pImage->rows > m_pHeader->slotDataSize)
+    {
+        return E_INVALIDARG;
+    }
+
+    LONG frameNumber = m_pHeader->frameCount;
+    BYTE* pSlotData = reinterpret_cast<BYTE*>(m_pHeader) + AlignSize(sizeof(SharedFrameRingHeader)) +
+        (frameNumber % m_pHeader->slotCount) * m_pHeader->slotStride;
+    SharedFrameSlotHeader* pSlot = reinterpret_cast<SharedFrameSlotHeader*>(pSlotData);
+    BYTE* pPixels = pSlotData + AlignSize(sizeof(SharedFrameSlotHeader));
+
+    // An odd sequence tells readers the slot is changing
+    LONG sequence = pSlot->sequence;
+    pSlot->sequence = sequence + 1;
+    MemoryBarrier();
+
+    pSlot->frameNumber = frameNumber;
+    pSlot->timestamp = timestamp;
+    pSlot->width = pImage->cols;
+    pSlot->height = pImage->rows;
+    pSlot->type = pImage->type();
+    pSlot->step = static_cast<DWORD>(rowSize);
+
+    if (pImage->isContinuous())
+    {
+        memcpy(pPixels, pImage->ptr(), rowSize * pImage->rows);
+    }
+    else
+    {
+        for (int y = 0; y < pImage->rows; ++y)
+        {
+            memcpy(pPixels + y * rowSize, pImage->ptr(y), rowSize);
+        }
+    }
+
+    MemoryBarrier();
+    pSlot->sequence = sequence + 2;
+
+    // Announce the frame only once its slot is consistent again
+    MemoryBarrier();
+    m_pHeader->frameCount = frameNumber + 1;
+
+    return S_OK;
+}
+
+/// <summary>
+/// Removes the ring; readers that have it open keep their mapping until they close it
+/// </summary>
+void SharedFrameRingWriter::Close()
+{
+    m_region.Close();
+    m_pHeader = NULL;
+}
+
+/// <summary>
+/// Gets whether a ring was created
+/// </summary>
+/// <returns>true if frames can be written</returns>
+bool SharedFrameRingWriter::IsOpen() const
+{
+    return m_pHeader != NULL;
+}
+
+/// <summary>
+/// Constructor
+/// </summary>
+SharedFrameRingReader::SharedFrameRingReader() :
+    m_pHeader(NULL)
+{
+}
+
+/// <summary>
+/// Opens a ring that another process created
+/// </summary>
+/// <param name="name">name the ring was created with</param>
+/// <returns>S_OK if successful, E_INVALIDARG if the memory is not a frame ring, an error code otherwise</returns>
+HRESULT SharedFrameRingReader::Open(const std::string& name)
+{
+    HRESULT hr = m_region.Open(name);
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+
+    // Fail if the memory is too small to be, or does not describe, a ring of this version
+    const SharedFrameRingHeader* pHeader = reinterpret_cast<const SharedFrameRingHeader*>(m_region.GetData());
+    if (m_region.GetSize() < sizeof(SharedFrameRingHeader) || pHeader->magic != SHARED_FRAME_RING_MAGIC)
+    {
+        m_region.Close();
+        return E_INVALIDARG;
+    }
+
+    MemoryBarrier();
+    size_t size = AlignSize(sizeof(SharedFrameRingHeader)) + static_cast<size_t>(pHeader->slotCount) * pHeader->slotStride;
+    if (pHeader->version != SHARED_FRAME_RING_VERSION || pHeader->slotCount == 0 || size > m_region.GetSize() ||
+        pHeader->slotStride < AlignSize(sizeof(SharedFrameSlotHeader)) + pHeader->slotDataSize)
+    {
+        m_region.Close();
+        return E_INVALIDARG;
+    }
+
+    m_pHeader = pHeader;
+    return S_OK;
+}
+
+/// <summary>
+/// Closes the ring
+/// </summary>
+void SharedFrameRingReader::Close()
+{
+    m_region.Close();
+    m_pHeader = NULL;
+}
+
+/// <summary>
+/// Gets the number of frames written so far
+/// </summary>
+/// <returns>number of frames; the latest is one less</returns>
+LONG SharedFrameRingReader::GetFrameCount() const
+{
+    if (!m_pHeader)
+    {
+        return 0;
+    }
+
+    LONG frameCount = m_pHeader->frameCount;
+    MemoryBarrier();
+    return frameCount;
+}
+
+/// <summary>
+/// Starts reading a frame in place
+/// </summary>
+/// <param name="frameNumber">number of the frame to read</param>
+/// <param name="pView">pointer in which to return the frame</param>
+/// <returns>S_OK if the frame is in the ring, S_FALSE if it is being written, was overwritten or has an impossible size or type, an error code otherwise</returns>
+HRESULT SharedFrameRingReader::BeginRead(LONG frameNumber, SharedFrameView* pView) const
+{
+    // Fail if pointer is invalid
+    if (!pView)
+    {
+        return E_POINTER;
+    }
+
+    // Fail if no ring is open
+    if (!m_pHeader)
+    {
+        return E_NOT_VALID_STATE;
+    }
+
+    // Fail if the frame number is negative
+    if (frameNumber < 0)
+    {
+        return E_INVALIDARG;
+    }
+
+    const SharedFrameSlotHeader* pSlot = GetSlot(frameNumber);
+    LONG sequence = pSlot->sequence;
+    MemoryBarrier();
+
+    // The slot is being written, or holds another frame
+    if ((sequence & 1) != 0 || pSlot->frameNumber != frameNumber || frameNumber >= m_pHeader->frameCount)
+    {
+        return S_FALSE;
+    }
+
+    pView->info.frameNumber = frameNumber;
+    pView->info.timestamp = pSlot->timestamp;
+    pView->info.size = Size(pSlot->width, pSlot->height);
+    pView->info.type = pSlot->type;
+    pView->info.step = pSlot->step;
+    pView->pData = reinterpret_cast<const BYTE*>(pSlot) + AlignSize(sizeof(SharedFrameSlotHeader));
+    pView->sequence = sequence;
+
+    // The header may have been torn by the writer starting on the slot; only once the sequence shows it
+    // was not is it checked, so that no size or type of another frame takes the caller outside the slot
+    MemoryBarrier();
+    if (pSlot->sequence != sequence || !IsFrameInfoValid(pView->info, m_pHeader->slotDataSize))
+    {
+        return S_FALSE;
+    }
+
+    return S_OK;
+}
+
+/// <summary>
+/// Finishes reading a frame in place
+/// </summary>
+/// <param name="pView">pointer to the frame returned by BeginRead</param>
+/// <returns>true if the frame stayed intact while it was read, false if whatever was read must be discarded</returns>
+bool SharedFrameRingReader::EndRead(const SharedFrameView* pView) const
+{
+    if (!pView || !m_pHeader)
+    {
+        return false;
+    }
+
+    MemoryBarrier();
+    return GetSlot(pView->info.frameNumber)->sequence == pView->sequence;
+}
+
+/// <summary>
+/// Copies the latest frame
+/// </summary>
+/// <param name="pImage">pointer in which to return the frame</param>
+/// <param name="pInfo">pointer in which to return the description of the frame, or NULL</param>
+/// <returns>S_OK if successful, S_FALSE if no frame could be read intact, an error code otherwise</returns>
+HRESULT SharedFrameRingReader::ReadLatestFrame(Mat* pImage, SharedFrameInfo* pInfo) const
+{
+    // Fail if pointer is invalid
+    if (!pImage)
+    {
+        return E_POINTER;
+    }
+
+    // Fail if no ring is open
+    if (!m_pHeader)
+    {
+        return E_NOT_VALID_STATE;
+    }
+
+    for (int attempt = 0; attempt < MAX_READ_ATTEMPTS; ++attempt)
+    {
+        LONG frameCount = GetFrameCount();
+        if (frameCount == 0)
+        {
+            return S_FALSE;
+        }
+
+        SharedFrameView view;
+        HRESULT hr = BeginRead(frameCount - 1, &view);
+        if (hr != S_OK)
+        {
+            continue;
+        }
+
+        // A frame that changes underneath the copy is simply read again
+        Mat shared(view.info.size, view.info.type, const_cast<BYTE*>(view.pData), view.info.step);
+        shared.copyTo(*pImage);
+        if (EndRead(&view))
+        {
+            if (pInfo)
+            {
+                *pInfo = view.info;
+            }
+            return S_OK;
+        }
+    }
+
+    return S_FALSE;
+}
+
+/// <summary>
+/// Gets the slot a frame is written to
+/// </summary>
+/// <param name="frameNumber">number of the frame</param>
+/// <returns>pointer to the slot header</returns>
+const SharedFrameSlotHeader* SharedFrameRingReader::GetSlot(LONG frameNumber) const
+{
+    const BYTE* pSlotData = reinterpret_cast<const BYTE*>(m_pHeader) + AlignSize(sizeof(SharedFrameRingHeader)) +
+        (frameNumber % m_pHeader->slotCount) * m_pHeader->slotStride;
+    return reinterpret_cast<const SharedFrameSlotHeader*>(pSlotData);
+}
@@ -0,0 +1,268 @@
+//-----------------------------------------------------------------------------
+// <copyright file="SharedFrameRing.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation. All rights reserved.
+// </copyright>
+//-----------------------------------------------------------------------------
+
+#pragma once
+
+#include "Platform.h"
+#include <stddef.h>
+#include <string>
+
+// Suppress warnings that come from compiling OpenCV code since we have no control over it
+#pragma warning(push)
+#pragma warning(disable : 6294 6031)
+#include <opencv2/core/core.hpp>
+#pragma warning(pop)
+
+using namespace cv;
+
+/// <summary>
+/// Layout of the start of a frame ring, followed by its slots
+/// </summary>
+struct SharedFrameRingHeader
+{
+    DWORD magic;
+    DWORD version;
+    DWORD slotCount;
+
+    // Bytes of pixel data a slot can hold, and bytes from one slot to the next
+    DWORD slotDataSize;
+    DWORD slotStride;
+
+    // Number of frames written so far; the latest is frame frameCount - 1, in slot (frameCount - 1) % slotCount
+    volatile LONG frameCount;
+};
+
+/// <summary>
+/// Layout of the start of a slot, followed by its pixel data
+/// </summary>
+struct SharedFrameSlotHeader
+{
+    // Even while the slot is consistent, odd while the writer is changing it
+    volatile LONG sequence;
+
+    LONG frameNumber;
+    DWORD timestamp;
+    int width;
+    int height;
+    int type;
+    DWORD step;
+};
+
+/// <summary>
+/// Describes a frame in a frame ring
+/// </summary>
+struct SharedFrameInfo
+{
+    // Number of the frame since the ring was created
+    LONG frameNumber;
+
+    // Capture time of the frame in milliseconds
+    DWORD timestamp;
+
+    // Size, OpenCV type and bytes per row of the pixel data
+    Size size;
+    int type;
+    size_t step;
+};
+
+/// <summary>
+/// Frame that a reader is looking at in place, in the shared memory
+/// </summary>
+struct SharedFrameView
+{
+    SharedFrameInfo info;
+    const BYTE* pData;
+
+    // Slot sequence when the read began, to check that the frame was not overwritten meanwhile
+    LONG sequence;
+};
+
+/// <summary>
+/// Named block of memory that other processes on the machine can map: a file mapping on Windows,
+/// POSIX shared memory elsewhere
+/// </summary>
+class SharedMemoryRegion
+{
+public:
+    // Functions:
+    /// <summary>
+    /// Constructor
+    /// </summary>
+    SharedMemoryRegion();
+
+    /// <summary>
+    /// Destructor
+    /// </summary>
+    ~SharedMemoryRegion();
+
+    /// <summary>
+    /// Creates a region that no other process has created yet, and maps it for writing
+    /// </summary>
+    /// <param name="name">name other processes open the region by</param>
+    /// <param name="size">size of the region in bytes</param>
+    /// <returns>S_OK if successful, E_NOT_VALID_STATE if the name is taken, an error code otherwise</returns>
+    HRESULT Create(const std::string& name, size_t size);
+
+    /// <summary>
+    /// Maps a region that another process created for reading
+    /// </summary>
+    /// <param name="name">name the region was created with</param>
+    /// <returns>S_OK if successful, an error code otherwise</returns>
+    HRESULT Open(const std::string& name);
+
+    /// <summary>
+    /// Unmaps the region, and removes its name if it was created here
+    /// </summary>
+    void Close();
+
+    /// <summary>
+    /// Gets the mapped memory
+    /// </summary>
+    /// <returns>pointer to the start of the region, or NULL if none is mapped</returns>
+    BYTE* GetData() const;
+
+    /// <summary>
+    /// Gets the size of the mapped memory
+    /// </summary>
+    /// <returns>size in bytes</returns>
+    size_t GetSize() const;
+
+private:
+    // Functions:
+    // The mapping is owned by the region, so it cannot be copied
+    SharedMemoryRegion(const SharedMemoryRegion&);
+    SharedMemoryRegion& operator=(const SharedMemoryRegion&);
+
+    // Variables:
+    BYTE* m_pData;
+    size_t m_size;
+#ifdef _WIN32
+    HANDLE m_hMapping;
+#else
+    std::string m_name;
+    bool m_isCreator;
+#endif
+};
+
+/// <summary>
+/// Writes frames into a ring in shared memory, so that other processes can read them at full rate
+/// without opening the sensor. Each slot is guarded by a sequence number that is odd while it is
+/// written; readers check it before and after reading, so the one writer never waits for them.
+/// </summary>
+class SharedFrameRingWriter
+{
+public:
+    // Functions:
+    /// <summary>
+    /// Constructor
+    /// </summary>
+    SharedFrameRingWriter();
+
+    /// <summary>
+    /// Creates the ring in shared memory
+    /// </summary>
+    /// <param name="name">name readers open the ring by</param>
+    /// <param name="slotCount">number of frames the ring holds before the oldest is overwritten</param>
+    /// <param name="slotDataSize">largest frame in bytes</param>
+    /// <returns>S_OK if successful, an error code otherwise</returns>
+    HRESULT Create(const std::string& name, int slotCount, size_t slotDataSize);
+
+    /// <summary>
+    /// Writes a frame into the oldest slot
+    /// </summary>
+    /// <param name="pImage">pointer to the frame, at most as large as the slots</param>
+    /// <param name="timestamp">capture time of the frame in milliseconds</param>
+    /// <returns>S_OK if successful, an error code otherwise</returns>
+    HRESULT WriteFrame(const Mat* pImage, DWORD timestamp);
+
+    /// <summary>
+    /// Removes the ring; readers that have it open keep their mapping until they close it
+    /// </summary>
+    void Close();
+
+    /// <summary>
+    /// Gets whether a ring was created
+    /// </summary>
+    /// <returns>true if frames can be written</returns>
+    bool IsOpen() const;
+
+private:
+    // Variables:
+    SharedMemoryRegion m_region;
+    SharedFrameRingHeader* m_pHeader;
+};
+
+/// <summary>
+/// Reads the frames of a ring that another process writes. Frames are read in place: a view
+/// points into the shared memory, and is only known to be intact once EndRead confirms it.
+/// </summary>
+class SharedFrameRingReader
+{
+    // Constants:
+    // Times ReadLatestFrame tries again when the writer overwrote the frame while it was copied
+    static const int MAX_READ_ATTEMPTS = 4;
+
+public:
+    // Functions:
+    /// <summary>
+    /// Constructor
+    /// </summary>
+    SharedFrameRingReader();
+
+    /// <summary>
+    /// Opens a ring that another process created
+    /// </summary>
+    /// <param name="name">name the ring was created with</param>
+    /// <returns>S_OK if successful, E_INVALIDARG if the memory is not a frame ring, an error code otherwise</returns>
+    HRESULT Open(const std::string& name);
+
+    /// <summary>
+    /// Closes the ring
+    /// </summary>
+    void Close();
+
+    /// <summary>
+    /// Gets the number of frames written so far
+    /// </summary>
+    /// <returns>number of frames; the latest is one less</returns>
+    LONG GetFrameCount() const;
+
+    /// <summary>
+    /// Starts reading a frame in place
+    /// </summary>
+    /// <param name="frameNumber">number of the frame to read</param>
+    /// <param name="pView">pointer in which to return the frame</param>
+    /// <returns>S_OK if the frame is in the ring, S_FALSE if it is being written, was overwritten or has an impossible size or type, an error code otherwise</returns>
+    HRESULT BeginRead(LONG frameNumber, SharedFrameView* pView) const;
+
+    /// <summary>
+    /// Finishes reading a frame in place
+    /// </summary>
+    /// <param name="pView">pointer to the frame returned by BeginRead</param>
+    /// <returns>true if the frame stayed intact while it was read, false if whatever was read must be discarded</returns>
+    bool EndRead(const SharedFrameView* pView) const;
+
+    /// <summary>
+    /// Copies the latest frame
+    /// </summary>
+    /// <param name="pImage">pointer in which to return the frame</param>
+    /// <param name="pInfo">pointer in which to return the description of the frame, or NULL</param>
+    /// <returns>S_OK if successful, S_FALSE if no frame could be read intact, an error code otherwise</returns>
+    HRESULT ReadLatestFrame(Mat* pImage, SharedFrameInfo* pInfo) const;
+
+private:
+    // Functions:
+    /// <summary>
+    /// Gets the slot a frame is written to
+    /// </summary>
+    /// <param name="frameNumber">number of the frame</param>
+    /// <returns>pointer to the slot header</returns>
+    const SharedFrameSlotHeader* GetSlot(LONG frameNumber) const;
+
+    // Variables:
+    SharedMemoryRegion m_region;
+    const SharedFrameRingHeader* m_pHeader;
+};
@@ -0,0 +1,144 @@
+//-----------------------------------------------------------------------------
+// <copyright file="SkeletonProjectionBenchmark.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation. All rights reserved.
+// </copyright>
+//-----------------------------------------------------------------------------
+
+#include "SkeletonProjectionBenchmark.h"
+#include "OpenCVHelper.h"
+#include "SkeletonProjector.h"
+#include <fstream>
+#include <math.h>
+
+using namespace cv;
+
+// Runs that size the scratch buffers and warm the caches before timing starts
+static const int WARMUP_ITERATIONS = 5;
+
+// Timed runs of each projection at each resolution
+static const int TIMED_ITERATIONS = 100;
+
+static const NUI_IMAGE_RESOLUTION COLOR_RESOLUTIONS[] = {NUI_IMAGE_RESOLUTION_640x480, NUI_IMAGE_RESOLUTION_1280x960};
+static const NUI_IMAGE_RESOLUTION DEPTH_RESOLUTIONS[] = {NUI_IMAGE_RESOLUTION_320x240, NUI_IMAGE_RESOLUTION_640x480};
+
+// Points per projection run: every joint of every skeleton in a frame
+static const int PROJECTION_POINTS = NUI_SKELETON_COUNT * NUI_SKELETON_POSITION_COUNT;
+
+/// <summary>
+/// Times both projections into one image and appends a line to the report
+/// </summary>
+/// <param name="report">stream receiving the CSV line</param>
+/// <param name="pPoints">pointer to PROJECTION_POINTS skeleton points</param>
+/// <param name="colorResolution">resolution of color image, or NUI_IMAGE_RESOLUTION_INVALID to project into depth</param>
+/// <param name="depthResolution">resolution of depth image</param>
+static void TimeProjection(std::ofstream& report, const Vector4* pPoints, NUI_IMAGE_RESOLUTION colorResolution,
+                           NUI_IMAGE_RESOLUTION depthResolution)
+{
+    SkeletonProjector projector;
+    bool isColor = (colorResolution != NUI_IMAGE_RESOLUTION_INVALID);
+    DWORD width, height;
+    NuiImageResolutionToSize(isColor ? colorResolution : depthResolution, width, height);
+
+    LONG sdkX[PROJECTION_POINTS], sdkY[PROJECTION_POINTS];
+    int batchX[PROJECTION_POINTS], batchY[PROJECTION_POINTS];
+    double sdkSeconds = 0.0;
+    double batchSeconds = 0.0;
+
+    for (int i = 0; i < WARMUP_ITERATIONS + TIMED_ITERATIONS; ++i)
+    {
+        // The per-joint path the skeleton drawing used before
+        int64 start = getTickCount();
+        for (int p = 0; p < PROJECTION_POINTS; ++p)
+        {
+            LONG depthX, depthY;
+            USHORT depth;
+            NuiTransformSkeletonToDepthImage(pPoints[p], &depthX, &depthY, &depth, depthResolution);
+            sdkX[p] = depthX;
+            sdkY[p] = depthY;
+            if (isColor)
+            {
+                NuiImageGetColorPixelCoordinatesFromDepthPixelAtResolution(colorResolution, depthResolution, NULL,
+                    depthX, depthY, depth, &sdkX[p], &sdkY[p]);
+            }
+        }
+        int64 middle = getTickCount();
+
+        const SkeletonPoint* pSkeletonPoints = reinterpret_cast<const SkeletonPoint*>(pPoints);
+        if (isColor)
+        {
+            projector.ProjectToColor(pSkeletonPoints, PROJECTION_POINTS, width, height, batchX, batchY);
+        }
+        else
+        {
+            projector.ProjectToDepth(pSkeletonPoints, PROJECTION_POINTS, width, height, batchX, batchY);
+        }
+        int64 end = getTickCount();
+
+        if (i >= WARMUP_ITERATIONS)
+        {
+            sdkSeconds += static_cast<double>(middle - start) / getTickFrequency();
+            batchSeconds += static_cast<double>(end - middle) / getTickFrequency();
+        }
+    }
+
+    double totalError = 0.0;
+    double maxError = 0.0;
+    for (int p = 0; p < PROJECTION_POINTS; ++p)
+    {
+        double dx = static_cast<double>(batchX[p] - sdkX[p]);
+        double dy = static_cast<double>(batchY[p] - sdkY[p]);
+        double error = sqrt(dx * dx + dy * dy);
+        totalError += error;
+        maxError = max(maxError, error);
+    }
+
+    report << (isColor ? "color" : "depth") << ',' << width << 'x' << height << ','
+        << 1e6 * sdkSeconds / TIMED_ITERATIONS << ',' << 1e6 * batchSeconds / TIMED_ITERATIONS << ','
+        << totalError / PROJECTION_POINTS << ',' << maxError << '\n';
+}
+
+/// <summary>
+/// Times the batched skeleton projection against the Kinect SDK's per-joint conversion, measures how far
+/// apart their results are, and writes both as CSV
+/// </summary>
+/// <param name="outputPath">path of the CSV file to write</param>
+/// <returns>S_OK if successful, an error code otherwise</returns>
+HRESULT RunSkeletonProjectionBenchmark(const char* outputPath)
+{
+    // Fail if pointer is invalid
+    if (!outputPath)
+    {
+        return E_POINTER;
+    }
+
+    std::ofstream report(outputPath);
+    if (!report.is_open())
+    {
+        return E_FAIL;
+    }
+
+    // Joints spread over the field of view at the distances players stand at
+    Vector4 points[PROJECTION_POINTS];
+    RNG rng(0x5eed);
+    for (int p = 0; p < PROJECTION_POINTS; ++p)
+    {
+        points[p].z = rng.uniform(0.8f, 4.0f);
+        points[p].x = rng.uniform(-0.5f, 0.5f) * points[p].z;
+        points[p].y = rng.uniform(-0.4f, 0.4f) * points[p].z;
+        points[p].w = 1.0f;
+    }
+
+    report << "target,resolution,sdk_us,batch_us,mean_error_px,max_error_px\n";
+
+    for (size_t d = 0; d < _countof(DEPTH_RESOLUTIONS); ++d)
+    {
+        TimeProjection(report, points, NUI_IMAGE_RESOLUTION_INVALID, DEPTH_RESOLUTIONS[d]);
+    }
+
+    for (size_t c = 0; c < _countof(COLOR_RESOLUTIONS); ++c)
+    {
+        TimeProjection(report, points, COLOR_RESOLUTIONS[c], NUI_IMAGE_RESOLUTION_640x480);
+    }
+
+    return report.good() ? S_OK : E_FAIL;
+}
@@ -0,0 +1,17 @@
+//-----------------------------------------------------------------------------
+// <copyright file="SkeletonProjectionBenchmark.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation. All rights reserved.
+// </copyright>
+//-----------------------------------------------------------------------------
+
+#pragma once
+
+#include <windows.h>
+
+/// <summary>
+/// Times the batched skeleton projection against the Kinect SDK's per-joint conversion, measures how far
+/// apart their results are, and writes both as CSV
+/// </summary>
+/// <param name="outputPath">path of the CSV file to write</param>
+/// <returns>S_OK if successful, an error code otherwise</returns>
+HRESULT RunSkeletonProjectionBenchmark(const char* outputPath);
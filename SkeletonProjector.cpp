@@ -0,0 +1,239 @@
+//-----------------------------------------------------------------------------
+// <copyright file="SkeletonProjector.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation. All rights reserved.
+// </copyright>
+//-----------------------------------------------------------------------------
+
+#include "SkeletonProjector.h"
+#include <float.h>
+#include <string.h>
+
+// SSE2 is always available on x64 and on the x86 targets the Kinect SDK supports
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define SKELETON_PROJECTOR_USE_SSE2
+#include <emmintrin.h>
+#endif
+
+const float SkeletonProjector::NOMINAL_DEPTH_FOCAL_LENGTH = 285.63f;
+const float SkeletonProjector::NOMINAL_COLOR_FOCAL_LENGTH = 531.15f;
+
+// Skeleton space is the depth camera's, so depth projection needs no pose
+static const float IDENTITY_ROTATION[9] = {1.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f};
+static const float ZERO_TRANSLATION[3] = {0.0f, 0.0f, 0.0f};
+
+// The color camera sits about 2.5 cm to the side of the depth camera. The factory calibration
+// of each sensor differs slightly, so callers that need better than a few pixels should set their own.
+static const float NOMINAL_COLOR_TRANSLATION[3] = {-0.025f, 0.0f, 0.0f};
+
+/// <summary>
+/// Constructor, starting from the nominal Kinect calibration
+/// </summary>
+SkeletonProjector::SkeletonProjector()
+{
+    CameraIntrinsics depth = {NOMINAL_DEPTH_FOCAL_LENGTH, NOMINAL_DEPTH_FOCAL_LENGTH, 160.0f, 120.0f, 320, 240};
+    CameraIntrinsics color = {NOMINAL_COLOR_FOCAL_LENGTH, NOMINAL_COLOR_FOCAL_LENGTH, 320.0f, 240.0f, 640, 480};
+    m_depthIntrinsics = depth;
+    m_colorIntrinsics = color;
+    SetColorExtrinsics(IDENTITY_ROTATION, NOMINAL_COLOR_TRANSLATION);
+}
+
+/// <summary>
+/// Sets the depth camera intrinsics
+/// </summary>
+/// <param name="intrinsics">intrinsics at their reference resolution</param>
+/// <returns>S_OK if successful, E_INVALIDARG if the resolution is empty</returns>
+HRESULT SkeletonProjector::SetDepthIntrinsics(const CameraIntrinsics& intrinsics)
+{
+    if (intrinsics.width <= 0 || intrinsics.height <= 0)
+    {
+        return E_INVALIDARG;
+    }
+
+    m_depthIntrinsics = intrinsics;
+    return S_OK;
+}
+
+/// <summary>
+/// Sets the color camera intrinsics
+/// </summary>
+/// <param name="intrinsics">intrinsics at their reference resolution</param>
+/// <returns>S_OK if successful, E_INVALIDARG if the resolution is empty</returns>
+HRESULT SkeletonProjector::SetColorIntrinsics(const CameraIntrinsics& intrinsics)
+{
+    if (intrinsics.width <= 0 || intrinsics.height <= 0)
+    {
+        return E_INVALIDARG;
+    }
+
+    m_colorIntrinsics = intrinsics;
+    return S_OK;
+}
+
+/// <summary>
+/// Sets the pose of the color camera relative to skeleton space
+/// </summary>
+/// <param name="rotation">row-major 3x3 rotation from skeleton to color camera axes</param>
+/// <param name="translation">position of skeleton space origin in color camera axes, in meters</param>
+void SkeletonProjector::SetColorExtrinsics(const float rotation[9], const float translation[3])
+{
+    memcpy(m_colorRotation, rotation, sizeof(m_colorRotation));
+    memcpy(m_colorTranslation, translation, sizeof(m_colorTranslation));
+}
+
+/// <summary>
+/// Projects skeleton points into a depth image of the given size. Points at or behind the camera map to (0, 0).
+/// </summary>
+/// <param name="pPoints">pointer to points to project</param>
+/// <param name="count">number of points</param>
+/// <param name="width">width of depth image</param>
+/// <param name="height">height of depth image</param>
+/// <param name="pX">pointer to count values in which to return the columns</param>
+/// <param name="pY">pointer to count values in which to return the rows</param>
+/// <returns>S_OK if successful, an error code otherwise</returns>
+HRESULT SkeletonProjector::ProjectToDepth(const SkeletonPoint* pPoints, int count, int width, int height, int* pX, int* pY) const
+{
+    // Fail if any pointer is invalid
+    if (!pPoints || !pX || !pY)
+    {
+        return E_POINTER;
+    }
+
+    // Fail if there is no image to project into
+    if (count < 0 || width <= 0 || height <= 0)
+    {
+        return E_INVALIDARG;
+    }
+
+    Projection projection;
+    MakeProjection(m_depthIntrinsics, IDENTITY_ROTATION, ZERO_TRANSLATION, width, height, &projection);
+    Project(projection, pPoints, count, pX, pY);
+
+    return S_OK;
+}
+
+/// <summary>
+/// Projects skeleton points into a color image of the given size. Points at or behind the camera map to (0, 0).
+/// </summary>
+/// <param name="pPoints">pointer to points to project</param>
+/// <param name="count">number of points</param>
+/// <param name="width">width of color image</param>
+/// <param name="height">height of color image</param>
+/// <param name="pX">pointer to count values in which to return the columns</param>
+/// <param name="pY">pointer to count values in which to return the rows</param>
+/// <returns>S_OK if successful, an error code otherwise</returns>
+HRESULT SkeletonProjector::ProjectToColor(const SkeletonPoint* pPoints, int count, int width, int height, int* pX, int* pY) const
+{
+    // Fail if any pointer is invalid
+    if (!pPoints || !pX || !pY)
+    {
+        return E_POINTER;
+    }
+
+    // Fail if there is no image to project into
+    if (count < 0 || width <= 0 || height <= 0)
+    {
+        return E_INVALIDARG;
+    }
+
+    Projection projection;
+    MakeProjection(m_colorIntrinsics, m_colorRotation, m_colorTranslation, width, height, &projection);
+    Project(projection, pPoints, count, pX, pY);
+
+    return S_OK;
+}
+
+/// <summary>
+/// Scales the intrinsics to the given resolution and combines them with a pose
+/// </summary>
+/// <param name="intrinsics">intrinsics at their reference resolution</param>
+/// <param name="rotation">row-major 3x3 rotation</param>
+/// <param name="translation">translation in meters</param>
+/// <param name="width">target width</param>
+/// <param name="height">target height</param>
+/// <param name="pProjection">pointer in which to return the projection</param>
+void SkeletonProjector::MakeProjection(const CameraIntrinsics& intrinsics, const float rotation[9], const float translation[3],
+    int width, int height, Projection* pProjection)
+{
+    float scaleX = static_cast<float>(width) / intrinsics.width;
+    float scaleY = static_cast<float>(height) / intrinsics.height;
+
+    memcpy(pProjection->rotation, rotation, sizeof(pProjection->rotation));
+    memcpy(pProjection->translation, translation, sizeof(pProjection->translation));
+    pProjection->fx = intrinsics.fx * scaleX;
+    pProjection->fy = intrinsics.fy * scaleY;
+    pProjection->cx = intrinsics.cx * scaleX;
+    pProjection->cy = intrinsics.cy * scaleY;
+}
+
+/// <summary>
+/// Projects the points with the given projection
+/// </summary>
+/// <param name="projection">projection to apply</param>
+/// <param name="pPoints">pointer to points to project</param>
+/// <param name="count">number of points</param>
+/// <param name="pX">pointer to count values in which to return the columns</param>
+/// <param name="pY">pointer to count values in which to return the rows</param>
+void SkeletonProjector::Project(const Projection& projection, const SkeletonPoint* pPoints, int count, int* pX, int* pY)
+{
+    const float* r = projection.rotation;
+    const float* t = projection.translation;
+    int i = 0;
+
+#ifdef SKELETON_PROJECTOR_USE_SSE2
+    const __m128 r0 = _mm_set1_ps(r[0]), r1 = _mm_set1_ps(r[1]), r2 = _mm_set1_ps(r[2]);
+    const __m128 r3 = _mm_set1_ps(r[3]), r4 = _mm_set1_ps(r[4]), r5 = _mm_set1_ps(r[5]);
+    const __m128 r6 = _mm_set1_ps(r[6]), r7 = _mm_set1_ps(r[7]), r8 = _mm_set1_ps(r[8]);
+    const __m128 t0 = _mm_set1_ps(t[0]), t1 = _mm_set1_ps(t[1]), t2 = _mm_set1_ps(t[2]);
+    const __m128 fx = _mm_set1_ps(projection.fx), fy = _mm_set1_ps(projection.fy);
+    const __m128 cx = _mm_set1_ps(projection.cx), cy = _mm_set1_ps(projection.cy);
+    const __m128 half = _mm_set1_ps(0.5f);
+    const __m128 epsilon = _mm_set1_ps(FLT_EPSILON);
+
+    for (; i + 4 <= count; i += 4)
+    {
+        // Points are stored x, y, z, w; transposing four of them gives one register per coordinate
+        __m128 x = _mm_loadu_ps(&pPoints[i].x);
+        __m128 y = _mm_loadu_ps(&pPoints[i + 1].x);
+        __m128 z = _mm_loadu_ps(&pPoints[i + 2].x);
+        __m128 w = _mm_loadu_ps(&pPoints[i + 3].x);
+        _MM_TRANSPOSE4_PS(x, y, z, w);
+
+        __m128 cameraX = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(r0, x), _mm_mul_ps(r1, y)), _mm_mul_ps(r2, z)), t0);
+        __m128 cameraY = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(r3, x), _mm_mul_ps(r4, y)), _mm_mul_ps(r5, z)), t1);
+        __m128 cameraZ = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(r6, x), _mm_mul_ps(r7, y)), _mm_mul_ps(r8, z)), t2);
+
+        // Points at or behind the camera are masked to (0, 0) rather than branched around
+        __m128 isInFront = _mm_cmpgt_ps(cameraZ, epsilon);
+        __m128 u = _mm_add_ps(_mm_add_ps(cx, _mm_mul_ps(fx, _mm_div_ps(cameraX, cameraZ))), half);
+        __m128 v = _mm_add_ps(_mm_sub_ps(cy, _mm_mul_ps(fy, _mm_div_ps(cameraY, cameraZ))), half);
+        u = _mm_and_ps(u, isInFront);
+        v = _mm_and_ps(v, isInFront);
+
+        // Truncate like the Kinect SDK does
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(pX + i), _mm_cvttps_epi32(u));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(pY + i), _mm_cvttps_epi32(v));
+    }
+#endif
+
+    for (; i < count; ++i)
+    {
+        float x = pPoints[i].x;
+        float y = pPoints[i].y;
+        float z = pPoints[i].z;
+
+        float cameraX = r[0] * x + r[1] * y + r[2] * z + t[0];
+        float cameraY = r[3] * x + r[4] * y + r[5] * z + t[1];
+        float cameraZ = r[6] * x + r[7] * y + r[8] * z + t[2];
+
+        if (cameraZ > FLT_EPSILON)
+        {
+            pX[i] = static_cast<int>(projection.cx + projection.fx * (cameraX / cameraZ) + 0.5f);
+            pY[i] = static_cast<int>(projection.cy - projection.fy * (cameraY / cameraZ) + 0.5f);
+        }
+        else
+        {
+            pX[i] = 0;
+            pY[i] = 0;
+        }
+    }
+}
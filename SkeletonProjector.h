@@ -0,0 +1,144 @@
+//-----------------------------------------------------------------------------
+// <copyright file="SkeletonProjector.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation. All rights reserved.
+// </copyright>
+//-----------------------------------------------------------------------------
+
+#pragma once
+
+#include "Platform.h"
+
+/// <summary>
+/// Point in skeleton space, in meters; laid out like the Kinect SDK's Vector4 so joint arrays can be passed as they are
+/// </summary>
+struct SkeletonPoint
+{
+    float x;
+    float y;
+    float z;
+    float w;
+};
+
+/// <summary>
+/// Pinhole intrinsics of a camera at a reference resolution
+/// </summary>
+struct CameraIntrinsics
+{
+    // Focal lengths in pixels
+    float fx;
+    float fy;
+
+    // Principal point in pixels
+    float cx;
+    float cy;
+
+    // Resolution the values above are given for
+    int width;
+    int height;
+};
+
+/// <summary>
+/// Projects skeleton joints into depth or color image coordinates without the Kinect SDK.
+/// A whole skeleton frame is projected in one call, four points at a time where SSE2 is available.
+/// </summary>
+class SkeletonProjector
+{
+public:
+    // Constants:
+    // Nominal focal lengths the Kinect SDK uses, at 320x240 depth and 640x480 color
+    static const float NOMINAL_DEPTH_FOCAL_LENGTH;
+    static const float NOMINAL_COLOR_FOCAL_LENGTH;
+
+    // Functions:
+    /// <summary>
+    /// Constructor, starting from the nominal Kinect calibration
+    /// </summary>
+    SkeletonProjector();
+
+    /// <summary>
+    /// Sets the depth camera intrinsics
+    /// </summary>
+    /// <param name="intrinsics">intrinsics at their reference resolution</param>
+    /// <returns>S_OK if successful, E_INVALIDARG if the resolution is empty</returns>
+    HRESULT SetDepthIntrinsics(const CameraIntrinsics& intrinsics);
+
+    /// <summary>
+    /// Sets the color camera intrinsics
+    /// </summary>
+    /// <param name="intrinsics">intrinsics at their reference resolution</param>
+    /// <returns>S_OK if successful, E_INVALIDARG if the resolution is empty</returns>
+    HRESULT SetColorIntrinsics(const CameraIntrinsics& intrinsics);
+
+    /// <summary>
+    /// Sets the pose of the color camera relative to skeleton space
+    /// </summary>
+    /// <param name="rotation">row-major 3x3 rotation from skeleton to color camera axes</param>
+    /// <param name="translation">position of skeleton space origin in color camera axes, in meters</param>
+    void SetColorExtrinsics(const float rotation[9], const float translation[3]);
+
+    /// <summary>
+    /// Projects skeleton points into a depth image of the given size. Points at or behind the camera map to (0, 0).
+    /// </summary>
+    /// <param name="pPoints">pointer to points to project</param>
+    /// <param name="count">number of points</param>
+    /// <param name="width">width of depth image</param>
+    /// <param name="height">height of depth image</param>
+    /// <param name="pX">pointer to count values in which to return the columns</param>
+    /// <param name="pY">pointer to count values in which to return the rows</param>
+    /// <returns>S_OK if successful, an error code otherwise</returns>
+    HRESULT ProjectToDepth(const SkeletonPoint* pPoints, int count, int width, int height, int* pX, int* pY) const;
+
+    /// <summary>
+    /// Projects skeleton points into a color image of the given size. Points at or behind the camera map to (0, 0).
+    /// </summary>
+    /// <param name="pPoints">pointer to points to project</param>
+    /// <param name="count">number of points</param>
+    /// <param name="width">width of color image</param>
+    /// <param name="height">height of color image</param>
+    /// <param name="pX">pointer to count values in which to return the columns</param>
+    /// <param name="pY">pointer to count values in which to return the rows</param>
+    /// <returns>S_OK if successful, an error code otherwise</returns>
+    HRESULT ProjectToColor(const SkeletonPoint* pPoints, int count, int width, int height, int* pX, int* pY) const;
+
+private:
+    // Types:
+    // Camera pose and intrinsics scaled to the target resolution
+    struct Projection
+    {
+        float rotation[9];
+        float translation[3];
+        float fx;
+        float fy;
+        float cx;
+        float cy;
+    };
+
+    // Functions:
+    /// <summary>
+    /// Scales the intrinsics to the given resolution and combines them with a pose
+    /// </summary>
+    /// <param name="intrinsics">intrinsics at their reference resolution</param>
+    /// <param name="rotation">row-major 3x3 rotation</param>
+    /// <param name="translation">translation in meters</param>
+    /// <param name="width">target width</param>
+    /// <param name="height">target height</param>
+    /// <param name="pProjection">pointer in which to return the projection</param>
+    static void MakeProjection(const CameraIntrinsics& intrinsics, const float rotation[9], const float translation[3],
+        int width, int height, Projection* pProjection);
+
+    /// <summary>
+    /// Projects the points with the given projection
+    /// </summary>
+    /// <param name="projection">projection to apply</param>
+    /// <param name="pPoints">pointer to points to project</param>
+    /// <param name="count">number of points</param>
+    /// <param name="pX">pointer to count values in which to return the columns</param>
+    /// <param name="pY">pointer to count values in which to return the rows</param>
+    static void Project(const Projection& projection, const SkeletonPoint* pPoints, int count, int* pX, int* pY);
+
+    // Variables:
+    CameraIntrinsics m_depthIntrinsics;
+    CameraIntrinsics m_colorIntrinsics;
+    float m_colorRotation[9];
+    float m_colorTranslation[3];
+};
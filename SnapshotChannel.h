@@ -0,0 +1,129 @@
+//-----------------------------------------------------------------------------
+// <copyright file="SnapshotChannel.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation. All rights reserved.
+// </copyright>
+//-----------------------------------------------------------------------------
+
+#pragma once
+
+#include <windows.h>
+#include <new>
+
+/// <summary>
+/// Hands snapshots of a value from one thread to another without locking, for values where only
+/// the latest one matters. Publishing swaps a new snapshot in with one interlocked exchange; the
+/// reading thread swaps it out again and from then on owns it, so a snapshot is never freed
+/// while it is being read.
+/// </summary>
+template <typename T>
+class SnapshotChannel
+{
+public:
+    // Functions:
+    /// <summary>
+    /// Constructor
+    /// </summary>
+    SnapshotChannel();
+
+    /// <summary>
+    /// Destructor
+    /// </summary>
+    ~SnapshotChannel();
+
+    /// <summary>
+    /// Publishes a snapshot of the value, replacing any snapshot that has not been taken yet
+    /// </summary>
+    /// <param name="pValue">pointer to value to copy</param>
+    /// <returns>S_OK if successful, an error code otherwise</returns>
+    HRESULT Publish(const T* pValue);
+
+    /// <summary>
+    /// Takes the latest published snapshot, if there is one that has not been taken yet
+    /// </summary>
+    /// <param name="pValue">pointer in which to return the value; left unchanged if there is no new snapshot</param>
+    /// <returns>true if a new value was returned</returns>
+    bool Acquire(T* pValue);
+
+private:
+    // Functions:
+    // The pending snapshot is owned by the channel, so it cannot be copied
+    SnapshotChannel(const SnapshotChannel&);
+    SnapshotChannel& operator=(const SnapshotChannel&);
+
+    // Variables:
+    // Snapshot published but not taken yet, or NULL
+    T* volatile m_pPending;
+};
+
+/// <summary>
+/// Constructor
+/// </summary>
+template <typename T>
+SnapshotChannel<T>::SnapshotChannel() :
+    m_pPending(NULL)
+{
+}
+
+/// <summary>
+/// Destructor
+/// </summary>
+template <typename T>
+SnapshotChannel<T>::~SnapshotChannel()
+{
+    delete m_pPending;
+}
+
+/// <summary>
+/// Publishes a snapshot of the value, replacing any snapshot that has not been taken yet
+/// </summary>
+/// <param name="pValue">pointer to value to copy</param>
+/// <returns>S_OK if successful, an error code otherwise</returns>
+template <typename T>
+HRESULT SnapshotChannel<T>::Publish(const T* pValue)
+{
+    // Fail if pointer is invalid
+    if (!pValue)
+    {
+        return E_POINTER;
+    }
+
+    T* pSnapshot = new (std::nothrow) T(*pValue);
+    if (!pSnapshot)
+    {
+        return E_OUTOFMEMORY;
+    }
+
+    // A snapshot that was swapped back out was never seen by the reading thread
+    T* pSuperseded = reinterpret_cast<T*>(
+        InterlockedExchangePointer(reinterpret_cast<PVOID volatile*>(&m_pPending), pSnapshot));
+    delete pSuperseded;
+
+    return S_OK;
+}
+
+/// <summary>
+/// Takes the latest published snapshot, if there is one that has not been taken yet
+/// </summary>
+/// <param name="pValue">pointer in which to return the value; left unchanged if there is no new snapshot</param>
+/// <returns>true if a new value was returned</returns>
+template <typename T>
+bool SnapshotChannel<T>::Acquire(T* pValue)
+{
+    // Nothing was published since the last call; this is the common case and costs one plain read
+    if (!m_pPending)
+    {
+        return false;
+    }
+
+    T* pSnapshot = reinterpret_cast<T*>(
+        InterlockedExchangePointer(reinterpret_cast<PVOID volatile*>(&m_pPending), NULL));
+    if (!pSnapshot)
+    {
+        return false;
+    }
+
+    *pValue = *pSnapshot;
+    delete pSnapshot;
+
+    return true;
+}
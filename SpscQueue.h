@@ -0,0 +1,245 @@
+//-----------------------------------------------------------------------------
+// <copyright file="SpscQueue.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation. All rights reserved.
+// </copyright>
+//-----------------------------------------------------------------------------
+
+#pragma once
+
+#include "Platform.h"
+#include <new>
+
+/// <summary>
+/// Bounded queue between exactly one producer thread and one consumer thread, without locks.
+/// The producer only writes the tail and the consumer only writes the head, so each index has
+/// a single writer; an item is written before the tail that publishes it, and read before the
+/// head that frees its cell. On Windows an auto-reset event is set on every push so that an idle
+/// consumer can wait for work instead of polling.
+/// </summary>
+template <typename T>
+class SpscQueue
+{
+    // Constants:
+    // Assumed cache line size, so that the producer and consumer indices do not share a line
+    static const int CACHE_LINE_SIZE = 64;
+
+public:
+    // Functions:
+    /// <summary>
+    /// Constructor
+    /// </summary>
+    SpscQueue();
+
+    /// <summary>
+    /// Destructor
+    /// </summary>
+    ~SpscQueue();
+
+    /// <summary>
+    /// Allocates the cells and the push event; must be called before either thread uses the queue
+    /// </summary>
+    /// <param name="capacity">number of items the queue can hold, rounded up to a power of two</param>
+    /// <returns>S_OK if successful, an error code otherwise</returns>
+    HRESULT Initialize(UINT capacity);
+
+    /// <summary>
+    /// Adds an item at the tail; only called by the producer
+    /// </summary>
+    /// <param name="item">item to add</param>
+    /// <returns>true if added, false if the queue is full</returns>
+    bool Push(const T& item);
+
+    /// <summary>
+    /// Removes the item at the head; only called by the consumer
+    /// </summary>
+    /// <param name="pItem">pointer in which to return the item</param>
+    /// <returns>true if an item was removed, false if the queue is empty</returns>
+    bool Pop(T* pItem);
+
+    /// <summary>
+    /// Gets the number of queued items; exact only when called by the producer or the consumer
+    /// </summary>
+    /// <returns>number of items</returns>
+    LONG GetCount() const;
+
+#ifdef _WIN32
+    /// <summary>
+    /// Gets the event that is set whenever an item is pushed
+    /// </summary>
+    /// <returns>handle of auto-reset event</returns>
+    HANDLE GetPushEvent() const;
+#endif
+
+private:
+    // Functions:
+    // The cells and event are owned by the queue, so it cannot be copied
+    SpscQueue(const SpscQueue&);
+    SpscQueue& operator=(const SpscQueue&);
+
+    // Variables:
+    T* m_pItems;
+    LONG m_mask;
+#ifdef _WIN32
+    HANDLE m_hPushEvent;
+#endif
+
+    // Free running counts of pushed and popped items; the cell is the count masked by the capacity.
+    // Volatile accesses have acquire and release semantics with the Microsoft compiler.
+    char m_headPadding[CACHE_LINE_SIZE];
+    volatile LONG m_head;
+    char m_tailPadding[CACHE_LINE_SIZE];
+    volatile LONG m_tail;
+};
+
+/// <summary>
+/// Constructor
+/// </summary>
+template <typename T>
+SpscQueue<T>::SpscQueue() :
+    m_pItems(NULL),
+    m_mask(0),
+#ifdef _WIN32
+    m_hPushEvent(NULL),
+#endif
+    m_head(0),
+    m_tail(0)
+{
+}
+
+/// <summary>
+/// Destructor
+/// </summary>
+template <typename T>
+SpscQueue<T>::~SpscQueue()
+{
+    delete [] m_pItems;
+
+#ifdef _WIN32
+    if (m_hPushEvent)
+    {
+        CloseHandle(m_hPushEvent);
+    }
+#endif
+}
+
+/// <summary>
+/// Allocates the cells and the push event; must be called before either thread uses the queue
+/// </summary>
+/// <param name="capacity">number of items the queue can hold, rounded up to a power of two</param>
+/// <returns>S_OK if successful, an error code otherwise</returns>
+template <typename T>
+HRESULT SpscQueue<T>::Initialize(UINT capacity)
+{
+    // Fail if capacity is out of range
+    if (capacity == 0 || capacity > 0x10000)
+    {
+        return E_INVALIDARG;
+    }
+
+    // Fail if already initialized
+    if (m_pItems)
+    {
+        return E_NOT_VALID_STATE;
+    }
+
+    UINT size = 1;
+    while (size < capacity)
+    {
+        size <<= 1;
+    }
+
+    m_pItems = new (std::nothrow) T[size];
+    if (!m_pItems)
+    {
+        return E_OUTOFMEMORY;
+    }
+
+#ifdef _WIN32
+    m_hPushEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
+    if (!m_hPushEvent)
+    {
+        delete [] m_pItems;
+        m_pItems = NULL;
+        return E_FAIL;
+    }
+#endif
+
+    m_mask = static_cast<LONG>(size - 1);
+    m_head = 0;
+    m_tail = 0;
+
+    return S_OK;
+}
+
+/// <summary>
+/// Adds an item at the tail; only called by the producer
+/// </summary>
+/// <param name="item">item to add</param>
+/// <returns>true if added, false if the queue is full</returns>
+template <typename T>
+bool SpscQueue<T>::Push(const T& item)
+{
+    LONG tail = m_tail;
+    if (static_cast<ULONG>(tail - m_head) > static_cast<ULONG>(m_mask))
+    {
+        return false;
+    }
+
+    // The consumer has finished reading the cell before it is overwritten
+    MemoryBarrier();
+    m_pItems[tail & m_mask] = item;
+
+    // The item is in place before the consumer can see the new tail
+    InterlockedExchange(&m_tail, tail + 1);
+#ifdef _WIN32
+    SetEvent(m_hPushEvent);
+#endif
+
+    return true;
+}
+
+/// <summary>
+/// Removes the item at the head; only called by the consumer
+/// </summary>
+/// <param name="pItem">pointer in which to return the item</param>
+/// <returns>true if an item was removed, false if the queue is empty</returns>
+template <typename T>
+bool SpscQueue<T>::Pop(T* pItem)
+{
+    LONG head = m_head;
+    if (head == m_tail)
+    {
+        return false;
+    }
+
+    // The item is read only after the tail that published it
+    MemoryBarrier();
+    *pItem = m_pItems[head & m_mask];
+
+    // The item is read before the producer can reuse its cell
+    InterlockedExchange(&m_head, head + 1);
+
+    return true;
+}
+
+/// <summary>
+/// Gets the number of queued items; exact only when called by the producer or the consumer
+/// </summary>
+/// <returns>number of items</returns>
+template <typename T>
+LONG SpscQueue<T>::GetCount() const
+{
+    return m_tail - m_head;
+}
+
+#ifdef _WIN32
+/// <summary>
+/// Gets the event that is set whenever an item is pushed
+/// </summary>
+/// <returns>handle of auto-reset event</returns>
+template <typename T>
+HANDLE SpscQueue<T>::GetPushEvent() const
+{
+    return m_hPushEvent;
+}
+#endif
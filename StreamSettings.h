@@ -0,0 +1,58 @@
+//-----------------------------------------------------------------------------
+// <copyright file="StreamSettings.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation. All rights reserved.
+// </copyright>
+//-----------------------------------------------------------------------------
+
+#pragma once
+
+#include <windows.h>
+#include <NuiApi.h>
+
+#include "resource.h"
+#include "SnapshotChannel.h"
+
+/// <summary>
+/// Stream settings chosen from the menu. The processing thread works from its own copy,
+/// which is only replaced as a whole between frames.
+/// </summary>
+struct StreamSettings
+{
+    /// <summary>
+    /// Constructor, sets the settings the application starts with
+    /// </summary>
+    StreamSettings() :
+        isColorPaused(false),
+        colorResolution(NUI_IMAGE_RESOLUTION_640x480),
+        colorFilterID(IDM_COLOR_FILTER_NOFILTER),
+        isSweepFlowEnabled(false),
+        isDepthPaused(false),
+        isDepthNearMode(false),
+        depthResolution(NUI_IMAGE_RESOLUTION_640x480),
+        depthFilterID(IDM_DEPTH_FILTER_NOFILTER),
+        isSkeletonSeatedMode(false),
+        isSkeletonDrawColor(false),
+        isSkeletonDrawDepth(false)
+    {
+    }
+
+    // Color stream
+    bool isColorPaused;
+    NUI_IMAGE_RESOLUTION colorResolution;
+    int colorFilterID;
+    bool isSweepFlowEnabled;
+
+    // Depth stream
+    bool isDepthPaused;
+    bool isDepthNearMode;
+    NUI_IMAGE_RESOLUTION depthResolution;
+    int depthFilterID;
+
+    // Skeleton stream
+    bool isSkeletonSeatedMode;
+    bool isSkeletonDrawColor;
+    bool isSkeletonDrawDepth;
+};
+
+// Hands snapshots of the stream settings from the window thread to the processing thread
+typedef SnapshotChannel<StreamSettings> StreamSettingsChannel;
@@ -0,0 +1,151 @@
+//-----------------------------------------------------------------------------
+// <copyright file="SweepEventDetector.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation. All rights reserved.
+// </copyright>
+//-----------------------------------------------------------------------------
+
+#include "SweepEventDetector.h"
+
+/// <summary>
+/// Constructor
+/// </summary>
+SweepEventDetector::SweepEventDetector() :
+    m_enterThreshold(150.0f),
+    m_exitThreshold(50.0f),
+    m_enterMilliseconds(200),
+    m_exitMilliseconds(500),
+    m_intensityStep(0.5f),
+    m_minEventInterval(250)
+{
+    Reset();
+}
+
+/// <summary>
+/// Sets the activity levels that start and stop a sweep
+/// </summary>
+/// <param name="enterThreshold">activity above which sweeping may start</param>
+/// <param name="exitThreshold">activity below which sweeping may stop, should be lower than enterThreshold</param>
+void SweepEventDetector::SetThresholds(float enterThreshold, float exitThreshold)
+{
+    m_enterThreshold = enterThreshold;
+    m_exitThreshold = exitThreshold;
+}
+
+/// <summary>
+/// Sets how long the activity must stay past a threshold before the state changes
+/// </summary>
+/// <param name="enterMilliseconds">time above the enter threshold before a sweep starts</param>
+/// <param name="exitMilliseconds">time below the exit threshold before a sweep stops</param>
+void SweepEventDetector::SetMinDurations(DWORD enterMilliseconds, DWORD exitMilliseconds)
+{
+    m_enterMilliseconds = enterMilliseconds;
+    m_exitMilliseconds = exitMilliseconds;
+}
+
+/// <summary>
+/// Sets how much the intensity must change, and how often at most, for an intensity event to be reported
+/// </summary>
+/// <param name="relativeStep">fractional change from the last reported intensity</param>
+/// <param name="minIntervalMilliseconds">minimum time between two reported events</param>
+void SweepEventDetector::SetIntensityStep(float relativeStep, DWORD minIntervalMilliseconds)
+{
+    m_intensityStep = relativeStep;
+    m_minEventInterval = minIntervalMilliseconds;
+}
+
+/// <summary>
+/// Feeds the activity measured in a new frame to the state machine
+/// </summary>
+/// <param name="activity">activity measured in the frame</param>
+/// <param name="timestamp">time of the frame in milliseconds</param>
+/// <param name="pEvent">pointer in which to return the event, if any</param>
+/// <returns>true if an event was produced</returns>
+bool SweepEventDetector::Update(float activity, DWORD timestamp, SweepEvent* pEvent)
+{
+    // Weight of the newest frame in the smoothed intensity
+    const float smoothing = 0.3f;
+
+    if (!pEvent)
+    {
+        return false;
+    }
+
+    pEvent->type = SWEEP_EVENT_NONE;
+    pEvent->intensity = 0.0f;
+
+    m_intensity += smoothing * (activity - m_intensity);
+
+    // The state only changes once the activity has stayed on the other side of its threshold long enough.
+    // Unsigned subtraction keeps the durations correct when the millisecond counter wraps.
+    bool isCrossing = m_isSweeping ? (activity < m_exitThreshold) : (activity > m_enterThreshold);
+    if (!isCrossing)
+    {
+        m_isCrossing = false;
+    }
+    else if (!m_isCrossing)
+    {
+        m_isCrossing = true;
+        m_crossingStart = timestamp;
+    }
+
+    DWORD requiredMilliseconds = m_isSweeping ? m_exitMilliseconds : m_enterMilliseconds;
+    if (m_isCrossing && timestamp - m_crossingStart >= requiredMilliseconds)
+    {
+        m_isSweeping = !m_isSweeping;
+        m_isCrossing = false;
+
+        // Start reporting from the activity that triggered the sweep rather than the idle average
+        if (m_isSweeping)
+        {
+            m_intensity = activity;
+        }
+
+        pEvent->type = m_isSweeping ? SWEEP_EVENT_START : SWEEP_EVENT_STOP;
+        pEvent->intensity = m_isSweeping ? m_intensity : 0.0f;
+    }
+    else if (m_isSweeping && timestamp - m_lastEventTime >= m_minEventInterval)
+    {
+        float change = m_intensity - m_reportedIntensity;
+        if (change < 0.0f)
+        {
+            change = -change;
+        }
+
+        if (change > m_intensityStep * m_reportedIntensity)
+        {
+            pEvent->type = SWEEP_EVENT_INTENSITY;
+            pEvent->intensity = m_intensity;
+        }
+    }
+
+    if (pEvent->type == SWEEP_EVENT_NONE)
+    {
+        return false;
+    }
+
+    m_reportedIntensity = pEvent->intensity;
+    m_lastEventTime = timestamp;
+    return true;
+}
+
+/// <summary>
+/// Returns to the idle state without reporting an event
+/// </summary>
+void SweepEventDetector::Reset()
+{
+    m_isSweeping = false;
+    m_isCrossing = false;
+    m_crossingStart = 0;
+    m_intensity = 0.0f;
+    m_reportedIntensity = 0.0f;
+    m_lastEventTime = 0;
+}
+
+/// <summary>
+/// Gets whether a sweep is in progress
+/// </summary>
+/// <returns>true between a start and a stop event</returns>
+bool SweepEventDetector::IsSweeping() const
+{
+    return m_isSweeping;
+}
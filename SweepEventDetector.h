@@ -0,0 +1,104 @@
+//-----------------------------------------------------------------------------
+// <copyright file="SweepEventDetector.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation. All rights reserved.
+// </copyright>
+//-----------------------------------------------------------------------------
+
+#pragma once
+
+#include "Platform.h"
+
+/// <summary>
+/// Kind of change reported by the sweep event detector
+/// </summary>
+enum SweepEventType
+{
+    SWEEP_EVENT_NONE,
+    SWEEP_EVENT_START,
+    SWEEP_EVENT_STOP,
+    SWEEP_EVENT_INTENSITY
+};
+
+/// <summary>
+/// Change in sweeping state detected in one frame
+/// </summary>
+struct SweepEvent
+{
+    SweepEventType type;
+
+    // Smoothed activity at the time of the event, 0 for a stop event
+    float intensity;
+};
+
+class SweepEventDetector
+{
+public:
+    // Functions:
+    /// <summary>
+    /// Constructor
+    /// </summary>
+    SweepEventDetector();
+
+    /// <summary>
+    /// Sets the activity levels that start and stop a sweep
+    /// </summary>
+    /// <param name="enterThreshold">activity above which sweeping may start</param>
+    /// <param name="exitThreshold">activity below which sweeping may stop, should be lower than enterThreshold</param>
+    void SetThresholds(float enterThreshold, float exitThreshold);
+
+    /// <summary>
+    /// Sets how long the activity must stay past a threshold before the state changes
+    /// </summary>
+    /// <param name="enterMilliseconds">time above the enter threshold before a sweep starts</param>
+    /// <param name="exitMilliseconds">time below the exit threshold before a sweep stops</param>
+    void SetMinDurations(DWORD enterMilliseconds, DWORD exitMilliseconds);
+
+    /// <summary>
+    /// Sets how much the intensity must change, and how often at most, for an intensity event to be reported
+    /// </summary>
+    /// <param name="relativeStep">fractional change from the last reported intensity</param>
+    /// <param name="minIntervalMilliseconds">minimum time between two reported events</param>
+    void SetIntensityStep(float relativeStep, DWORD minIntervalMilliseconds);
+
+    /// <summary>
+    /// Feeds the activity measured in a new frame to the state machine
+    /// </summary>
+    /// <param name="activity">activity measured in the frame</param>
+    /// <param name="timestamp">time of the frame in milliseconds</param>
+    /// <param name="pEvent">pointer in which to return the event, if any</param>
+    /// <returns>true if an event was produced</returns>
+    bool Update(float activity, DWORD timestamp, SweepEvent* pEvent);
+
+    /// <summary>
+    /// Returns to the idle state without reporting an event
+    /// </summary>
+    void Reset();
+
+    /// <summary>
+    /// Gets whether a sweep is in progress
+    /// </summary>
+    /// <returns>true between a start and a stop event</returns>
+    bool IsSweeping() const;
+
+private:
+    // Variables:
+    // Hysteresis parameters
+    float m_enterThreshold;
+    float m_exitThreshold;
+    DWORD m_enterMilliseconds;
+    DWORD m_exitMilliseconds;
+    float m_intensityStep;
+    DWORD m_minEventInterval;
+
+    // Current state and the time the activity last crossed the threshold that would change it
+    bool m_isSweeping;
+    bool m_isCrossing;
+    DWORD m_crossingStart;
+
+    // Exponentially smoothed activity
+    float m_intensity;
+
+    // Intensity and time of the last reported event
+    float m_reportedIntensity;
+    DWORD m_lastEventTime;
+};
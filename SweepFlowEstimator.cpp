@@ -0,0 +1,271 @@
+//-----------------------------------------------------------------------------
+// <copyright file="SweepFlowEstimator.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation. All rights reserved.
+// </copyright>
+//-----------------------------------------------------------------------------
+
+#include "SweepFlowEstimator.h"
+#include <math.h>
+
+using namespace cv;
+
+/// <summary>
+/// Constructor
+/// </summary>
+SweepFlowEstimator::SweepFlowEstimator() :
+    m_currentImage(0),
+    m_isFeatureMaskDirty(true),
+    m_scale(1.0f),
+    m_framesSinceDetection(0),
+    m_previousTicks(0)
+{
+    m_previousPoints.reserve(MAX_FEATURES);
+    m_currentPoints.reserve(MAX_FEATURES);
+    m_status.reserve(MAX_FEATURES);
+    m_error.reserve(MAX_FEATURES);
+}
+
+/// <summary>
+/// Restricts feature tracking to the given region of the color image
+/// </summary>
+/// <param name="roi">region in full resolution color pixel coordinates</param>
+void SweepFlowEstimator::SetRegionOfInterest(Rect roi)
+{
+    if (roi.x != m_roi.x || roi.y != m_roi.y || roi.width != m_roi.width || roi.height != m_roi.height)
+    {
+        m_roi = roi;
+        m_isFeatureMaskDirty = true;
+    }
+}
+
+/// <summary>
+/// Tracks features over the whole color image
+/// </summary>
+void SweepFlowEstimator::ClearRegionOfInterest()
+{
+    SetRegionOfInterest(Rect());
+}
+
+/// <summary>
+/// Forgets the tracked features and the previous frame
+/// </summary>
+void SweepFlowEstimator::Reset()
+{
+    m_previousPoints.clear();
+    m_currentPoints.clear();
+    m_framesSinceDetection = 0;
+    m_previousTicks = 0;
+    m_isFeatureMaskDirty = true;
+}
+
+/// <summary>
+/// Tracks the features into the given color frame and measures the dominant stroke direction and speed
+/// </summary>
+/// <param name="pImg">pointer to RGBA color image Mat</param>
+/// <param name="pFlow">pointer in which to return the measured motion</param>
+/// <returns>S_OK if successful, an error code otherwise</returns>
+HRESULT SweepFlowEstimator::Update(const Mat* pImg, SweepFlow* pFlow)
+{
+    // Fail if either pointer is invalid
+    if (!pImg || !pFlow)
+    {
+        return E_POINTER;
+    }
+
+    // Fail if Mat contains no data or is not a color image
+    if (pImg->empty() || pImg->channels() != 4)
+    {
+        return E_INVALIDARG;
+    }
+
+    pFlow->isValid = false;
+    pFlow->direction = 0.0f;
+    pFlow->speed = 0.0f;
+    pFlow->trackedFeatures = 0;
+
+    // Track on a small grayscale copy; 640x480 and 1280x960 both shrink by a whole factor
+    int factor = max(1, pImg->cols / TRACKING_WIDTH);
+    Size trackingSize(pImg->cols / factor, pImg->rows / factor);
+
+    // Start over if the color resolution changed since the previous frame
+    Mat& previousImage = m_trackingImages[1 - m_currentImage];
+    Mat& currentImage = m_trackingImages[m_currentImage];
+    if (previousImage.size() != trackingSize)
+    {
+        Reset();
+    }
+    m_scale = static_cast<float>(factor);
+
+    // Both conversions write into buffers that keep their size from frame to frame
+    cvtColor(*pImg, m_gray, CV_RGBA2GRAY);
+    if (factor == 1)
+    {
+        m_gray.copyTo(currentImage);
+    }
+    else
+    {
+        resize(m_gray, currentImage, trackingSize, 0, 0, INTER_AREA);
+    }
+
+    int64 ticks = getTickCount();
+
+    // Track the previous frame's features into this frame
+    m_currentPoints.clear();
+    if (!m_previousPoints.empty())
+    {
+        calcOpticalFlowPyrLK(previousImage, currentImage, m_previousPoints, m_currentPoints, m_status, m_error,
+            Size(15, 15), 2, TermCriteria(TermCriteria::COUNT | TermCriteria::EPS, 10, 0.03));
+
+        double elapsedSeconds = static_cast<double>(ticks - m_previousTicks) / getTickFrequency();
+        MeasureFlow(elapsedSeconds, pFlow);
+
+        // Keep the features that were found again and are still inside the region of interest
+        Rect trackingRoi(m_roi.x / factor, m_roi.y / factor, m_roi.width / factor, m_roi.height / factor);
+        size_t kept = 0;
+        for (size_t i = 0; i < m_currentPoints.size(); ++i)
+        {
+            if (m_status[i] && (m_roi.area() == 0 || trackingRoi.contains(m_currentPoints[i])))
+            {
+                m_currentPoints[kept++] = m_currentPoints[i];
+            }
+        }
+        m_currentPoints.resize(kept);
+    }
+
+    pFlow->trackedFeatures = static_cast<int>(m_currentPoints.size());
+
+    // Replace the features periodically, or as soon as too many have been lost
+    if (++m_framesSinceDetection >= REDETECT_INTERVAL || static_cast<int>(m_currentPoints.size()) < MAX_FEATURES / 2)
+    {
+        DetectFeatures();
+    }
+
+    // This frame becomes the previous one; swapping keeps both buffers allocated
+    m_previousPoints.swap(m_currentPoints);
+    m_currentImage = 1 - m_currentImage;
+    m_previousTicks = ticks;
+
+    return S_OK;
+}
+
+/// <summary>
+/// Detects new corner features inside the region of interest of the current tracking image
+/// </summary>
+void SweepFlowEstimator::DetectFeatures()
+{
+    const Mat& currentImage = m_trackingImages[m_currentImage];
+    int factor = static_cast<int>(m_scale);
+
+    m_framesSinceDetection = 0;
+    m_currentPoints.clear();
+
+    // Rebuild the detection mask only when the region of interest or resolution changed
+    if (m_isFeatureMaskDirty)
+    {
+        if (m_roi.area() > 0)
+        {
+            Rect trackingRoi(m_roi.x / factor, m_roi.y / factor, m_roi.width / factor, m_roi.height / factor);
+            trackingRoi = trackingRoi & Rect(0, 0, currentImage.cols, currentImage.rows);
+
+            m_featureMask.create(currentImage.size(), CV_8UC1);
+            m_featureMask.setTo(Scalar(0));
+            if (trackingRoi.area() > 0)
+            {
+                m_featureMask(trackingRoi).setTo(Scalar(255));
+            }
+        }
+        else
+        {
+            m_featureMask.release();
+        }
+
+        m_isFeatureMaskDirty = false;
+    }
+
+    const double qualityLevel = 0.01;
+    const double minDistance = 5.0;
+    goodFeaturesToTrack(currentImage, m_currentPoints, MAX_FEATURES, qualityLevel, minDistance, m_featureMask);
+}
+
+/// <summary>
+/// Finds the dominant direction and speed of the tracked feature displacements
+/// </summary>
+/// <param name="elapsedSeconds">time since the previous frame in seconds</param>
+/// <param name="pFlow">pointer in which to return the measured motion</param>
+void SweepFlowEstimator::MeasureFlow(double elapsedSeconds, SweepFlow* pFlow)
+{
+    // Displacements smaller than this, in tracking pixels, are treated as noise
+    const float minDisplacement = 0.5f;
+
+    // Fewest moving features needed to report a direction
+    const int minMovingFeatures = 3;
+
+    if (elapsedSeconds <= 0.0)
+    {
+        return;
+    }
+
+    // Histogram of displacement angles weighted by displacement length
+    float binWeights[DIRECTION_BINS] = {0.0f};
+    float binSumX[DIRECTION_BINS] = {0.0f};
+    float binSumY[DIRECTION_BINS] = {0.0f};
+    int binCounts[DIRECTION_BINS] = {0};
+
+    for (size_t i = 0; i < m_currentPoints.size(); ++i)
+    {
+        if (!m_status[i])
+        {
+            continue;
+        }
+
+        float dx = m_currentPoints[i].x - m_previousPoints[i].x;
+        float dy = m_currentPoints[i].y - m_previousPoints[i].y;
+        float length = sqrtf(dx * dx + dy * dy);
+        if (length < minDisplacement)
+        {
+            continue;
+        }
+
+        float angle = atan2f(dy, dx);
+        int bin = static_cast<int>((angle + CV_PI) * DIRECTION_BINS / (2.0 * CV_PI)) % DIRECTION_BINS;
+        binWeights[bin] += length;
+        binSumX[bin] += dx;
+        binSumY[bin] += dy;
+        binCounts[bin]++;
+    }
+
+    // The stroke direction is the heaviest bin together with its two neighbours
+    int bestBin = 0;
+    float bestWeight = 0.0f;
+    for (int b = 0; b < DIRECTION_BINS; ++b)
+    {
+        float weight = binWeights[(b + DIRECTION_BINS - 1) % DIRECTION_BINS] + binWeights[b] + binWeights[(b + 1) % DIRECTION_BINS];
+        if (weight > bestWeight)
+        {
+            bestWeight = weight;
+            bestBin = b;
+        }
+    }
+
+    float sumX = 0.0f;
+    float sumY = 0.0f;
+    float sumLength = 0.0f;
+    int count = 0;
+    for (int offset = -1; offset <= 1; ++offset)
+    {
+        int b = (bestBin + offset + DIRECTION_BINS) % DIRECTION_BINS;
+        sumX += binSumX[b];
+        sumY += binSumY[b];
+        sumLength += binWeights[b];
+        count += binCounts[b];
+    }
+
+    if (count < minMovingFeatures)
+    {
+        return;
+    }
+
+    pFlow->isValid = true;
+    pFlow->direction = atan2f(sumY, sumX);
+    pFlow->speed = static_cast<float>((sumLength / count) * m_scale / elapsedSeconds);
+}
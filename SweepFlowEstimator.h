@@ -0,0 +1,127 @@
+//-----------------------------------------------------------------------------
+// <copyright file="SweepFlowEstimator.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation. All rights reserved.
+// </copyright>
+//-----------------------------------------------------------------------------
+
+#pragma once
+
+#include <windows.h>
+#include <vector>
+
+// Suppress warnings that come from compiling OpenCV code since we have no control over it
+#pragma warning(push)
+#pragma warning(disable : 6294 6031)
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#include <opencv2/video/tracking.hpp>
+#pragma warning(pop)
+
+using namespace cv;
+
+/// <summary>
+/// Dominant stroke motion measured in one color frame
+/// </summary>
+struct SweepFlow
+{
+    // Whether enough features moved to measure a direction
+    bool isValid;
+
+    // Direction of the stroke in radians, in image coordinates (0 points right, PI/2 points down)
+    float direction;
+
+    // Speed of the stroke in full resolution color pixels per second
+    float speed;
+
+    // Number of features that were tracked into this frame
+    int trackedFeatures;
+};
+
+class SweepFlowEstimator
+{
+    // Constants:
+    // Maximum number of corner features tracked at once
+    static const int MAX_FEATURES = 48;
+
+    // Width of the grayscale image the features are tracked on
+    static const int TRACKING_WIDTH = 320;
+
+    // Number of frames after which features are detected again even if enough are still tracked
+    static const int REDETECT_INTERVAL = 15;
+
+    // Number of angle bins used to find the dominant direction
+    static const int DIRECTION_BINS = 8;
+
+public:
+    // Functions:
+    /// <summary>
+    /// Constructor
+    /// </summary>
+    SweepFlowEstimator();
+
+    /// <summary>
+    /// Restricts feature tracking to the given region of the color image
+    /// </summary>
+    /// <param name="roi">region in full resolution color pixel coordinates</param>
+    void SetRegionOfInterest(Rect roi);
+
+    /// <summary>
+    /// Tracks features over the whole color image
+    /// </summary>
+    void ClearRegionOfInterest();
+
+    /// <summary>
+    /// Forgets the tracked features and the previous frame
+    /// </summary>
+    void Reset();
+
+    /// <summary>
+    /// Tracks the features into the given color frame and measures the dominant stroke direction and speed
+    /// </summary>
+    /// <param name="pImg">pointer to RGBA color image Mat</param>
+    /// <param name="pFlow">pointer in which to return the measured motion</param>
+    /// <returns>S_OK if successful, an error code otherwise</returns>
+    HRESULT Update(const Mat* pImg, SweepFlow* pFlow);
+
+private:
+    // Functions:
+    /// <summary>
+    /// Detects new corner features inside the region of interest of the current tracking image
+    /// </summary>
+    void DetectFeatures();
+
+    /// <summary>
+    /// Finds the dominant direction and speed of the tracked feature displacements
+    /// </summary>
+    /// <param name="elapsedSeconds">time since the previous frame in seconds</param>
+    /// <param name="pFlow">pointer in which to return the measured motion</param>
+    void MeasureFlow(double elapsedSeconds, SweepFlow* pFlow);
+
+    // Variables:
+    // Grayscale copy of the color frame and the downscaled images tracked on; all reused every frame
+    Mat m_gray;
+    Mat m_trackingImages[2];
+    int m_currentImage;
+
+    // Mask limiting feature detection to the region of interest, at tracking resolution
+    Mat m_featureMask;
+
+    // Region of interest in full resolution color pixels, empty for the whole image
+    Rect m_roi;
+    bool m_isFeatureMaskDirty;
+
+    // Scale from tracking image pixels to full resolution color pixels
+    float m_scale;
+
+    // Feature positions in the previous and current frame
+    std::vector<Point2f> m_previousPoints;
+    std::vector<Point2f> m_currentPoints;
+    std::vector<uchar> m_status;
+    std::vector<float> m_error;
+
+    // Frames since features were last detected
+    int m_framesSinceDetection;
+
+    // Tick count of the previous frame, or 0 if there is none
+    int64 m_previousTicks;
+};
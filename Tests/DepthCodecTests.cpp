@@ -0,0 +1,226 @@
+//-----------------------------------------------------------------------------
+// <copyright file="DepthCodecTests.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation. All rights reserved.
+// </copyright>
+//-----------------------------------------------------------------------------
+
+#include "Test.h"
+#include <algorithm>
+#include <string.h>
+#include <vector>
+
+#include "DepthCodec.h"
+
+// Bits of a raw depth pixel below the depth, which hold the player index
+static const int PLAYER_INDEX_BITS = 3;
+
+/// <summary>
+/// Fills a raw depth frame like a scene of a floor and a player: noisy depth that falls from the bottom
+/// row to the top, the player's pixels nearer and with their index, and scattered unknown pixels
+/// </summary>
+/// <param name="pFrame">pointer to the CV_16U Mat to fill</param>
+/// <param name="noise">largest depth noise in millimeters</param>
+/// <param name="unknownChance">one in how many pixels is unknown</param>
+static void FillScene(Mat* pFrame, int noise, int unknownChance)
+{
+    RNG rng(0x5eed);
+    Rect player(pFrame->cols / 3, pFrame->rows / 4, pFrame->cols / 6 + 1, pFrame->rows / 2 + 1);
+    for (int y = 0; y < pFrame->rows; ++y)
+    {
+        USHORT* pRow = pFrame->ptr<USHORT>(y);
+        for (int x = 0; x < pFrame->cols; ++x)
+        {
+            int depth = 4000 - 3200 * y / pFrame->rows + rng.uniform(-noise, noise + 1);
+            int playerIndex = 0;
+            if (player.contains(Point(x, y)))
+            {
+                depth = 2000 + rng.uniform(-noise, noise + 1);
+                playerIndex = 1;
+            }
+            bool isUnknown = (rng.uniform(0, unknownChance) == 0);
+            pRow[x] = isUnknown ? 0 : static_cast<USHORT>((depth << PLAYER_INDEX_BITS) | playerIndex);
+        }
+    }
+}
+
+/// <summary>
+/// Fills a raw depth frame with a random walk of depths broken by runs of unknown pixels of random length,
+/// like the shadows beside objects, so that runs cover whole groups of eight pixels at any alignment
+/// </summary>
+/// <param name="pFrame">pointer to the CV_16U Mat to fill</param>
+/// <param name="pRng">pointer to random number generator</param>
+static void FillShadows(Mat* pFrame, RNG* pRng)
+{
+    int depth = pRng->uniform(500, 4000);
+    int unknownLeft = 0;
+    for (int y = 0; y < pFrame->rows; ++y)
+    {
+        USHORT* pRow = pFrame->ptr<USHORT>(y);
+        for (int x = 0; x < pFrame->cols; ++x)
+        {
+            if (unknownLeft == 0 && pRng->uniform(0, 8) == 0)
+            {
+                unknownLeft = pRng->uniform(1, 40);
+            }
+
+            if (unknownLeft > 0)
+            {
+                pRow[x] = 0;
+                --unknownLeft;
+            }
+            else
+            {
+                depth = std::min(std::max(depth + pRng->uniform(-20, 21), 400), 8000);
+                pRow[x] = static_cast<USHORT>((depth << PLAYER_INDEX_BITS) | pRng->uniform(0, 2));
+            }
+        }
+    }
+}
+
+/// <summary>
+/// Checks that two 16-bit images are equal
+/// </summary>
+/// <param name="a">first image</param>
+/// <param name="b">second image</param>
+/// <returns>true if the images have the same size and pixels</returns>
+static bool ImagesEqual(const Mat& a, const Mat& b)
+{
+    if (a.size() != b.size() || a.type() != b.type())
+    {
+        return false;
+    }
+
+    for (int y = 0; y < a.rows; ++y)
+    {
+        if (memcmp(a.ptr(y), b.ptr(y), a.cols * sizeof(USHORT)) != 0)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/// <summary>
+/// Encodes a frame, decodes it again and checks that the frame comes back unchanged
+/// </summary>
+/// <param name="pEncoder">pointer to encoder to use</param>
+/// <param name="pDecoder">pointer to decoder to use</param>
+/// <param name="frame">raw depth frame</param>
+/// <param name="pEncoded">pointer in which to return the encoded frame</param>
+/// <returns>true if the decoded frame equals the frame</returns>
+static bool RoundTrip(DepthEncoder* pEncoder, DepthDecoder* pDecoder, const Mat& frame, std::vector<BYTE>* pEncoded)
+{
+    const BYTE* pData = NULL;
+    size_t length = 0;
+    if (FAILED(pEncoder->Encode(&frame, &pData, &length)) || length > DepthEncoder::GetMaxEncodedLength(frame.size()))
+    {
+        return false;
+    }
+    pEncoded->assign(pData, pData + length);
+
+    Mat decoded;
+    return SUCCEEDED(pDecoder->Decode(&(*pEncoded)[0], pEncoded->size(), &decoded)) && ImagesEqual(decoded, frame);
+}
+
+/// <summary>
+/// Runs the tests of the depth codec
+/// </summary>
+void RunDepthCodecTests()
+{
+    DepthEncoder encoder;
+    DepthDecoder decoder;
+    std::vector<BYTE> encoded;
+    const BYTE* pData = NULL;
+    size_t length = 0;
+
+    Mat wrongType(4, 4, CV_8U, Scalar(1));
+    TEST_CHECK(encoder.Encode(NULL, &pData, &length) == E_POINTER);
+    TEST_CHECK(encoder.Encode(&wrongType, &pData, &length) == E_INVALIDARG);
+
+    // A scene at the sensor's resolution, then with less noise, which compresses at least 3 to 1
+    Mat scene(480, 640, CV_16U);
+    FillScene(&scene, 10, 20);
+    TEST_CHECK(RoundTrip(&encoder, &decoder, scene, &encoded));
+    FillScene(&scene, 3, 100);
+    TEST_CHECK(RoundTrip(&encoder, &decoder, scene, &encoded));
+    TEST_CHECK(encoded.size() * 3 < scene.total() * sizeof(USHORT));
+
+    // Sizes that leave pixels after the last whole group of eight, and frames of one pixel
+    int sizes[][2] = { { 1, 1 }, { 3, 2 }, { 9, 1 }, { 13, 5 }, { 31, 17 } };
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i)
+    {
+        Mat frame(sizes[i][1], sizes[i][0], CV_16U);
+        FillScene(&frame, 10, 3);
+        TEST_CHECK(RoundTrip(&encoder, &decoder, frame, &encoded));
+    }
+
+    // Frames of one or few symbols: every pixel unknown, every pixel the same, and a lone unknown pixel at
+    // either end of the frame and between known ones
+    Mat frame(5, 11, CV_16U, Scalar(0));
+    TEST_CHECK(RoundTrip(&encoder, &decoder, frame, &encoded));
+    frame.setTo(Scalar(1234));
+    TEST_CHECK(RoundTrip(&encoder, &decoder, frame, &encoded));
+    frame.ptr<USHORT>(0)[0] = 0;
+    frame.ptr<USHORT>(2)[5] = 0;
+    frame.ptr<USHORT>(4)[10] = 0;
+    TEST_CHECK(RoundTrip(&encoder, &decoder, frame, &encoded));
+
+    // A whole group of eight unknown pixels, after which the difference is from the last known pixel
+    // before the group
+    USHORT shadowPixels[] = { 102, 101, 101, 100, 100, 0, 100, 104, 0, 0, 0, 0, 0, 0, 0, 0, 104, 0, 0, 0, 0, 0, 0, 0, 0, 0, 99 };
+    for (int count = 17; count <= 27; count += 10)
+    {
+        Mat shadow(1, count, CV_16U, shadowPixels);
+        TEST_CHECK(RoundTrip(&encoder, &decoder, shadow, &encoded));
+    }
+
+    // Random frames with runs of unknown pixels of every length
+    RNG rng(0xfade);
+    int shadowFailures = 0;
+    for (int i = 0; i < 500; ++i)
+    {
+        Mat randomFrame(rng.uniform(1, 24), rng.uniform(1, 96), CV_16U);
+        FillShadows(&randomFrame, &rng);
+        shadowFailures += RoundTrip(&encoder, &decoder, randomFrame, &encoded) ? 0 : 1;
+    }
+    TEST_CHECK(shadowFailures == 0);
+
+    // Differences too large for a symbol of their own, down to the largest step of the 16-bit range,
+    // and every player index
+    for (int y = 0; y < frame.rows; ++y)
+    {
+        for (int x = 0; x < frame.cols; ++x)
+        {
+            frame.ptr<USHORT>(y)[x] = static_cast<USHORT>(((x + y) % 2 == 0) ? (x + 1) : (0xFFF8 | (y % 8)));
+        }
+    }
+    TEST_CHECK(RoundTrip(&encoder, &decoder, frame, &encoded));
+
+    // A region of a larger frame, whose rows are not contiguous, decoded into a region of another
+    Mat region = scene(Rect(100, 50, 64, 48));
+    TEST_CHECK(RoundTrip(&encoder, &decoder, region, &encoded));
+    Mat decoded(100, 100, CV_16U);
+    Mat decodedRegion = decoded(Rect(10, 10, 64, 48));
+    TEST_CHECK(SUCCEEDED(decoder.Decode(&encoded[0], encoded.size(), &decodedRegion)));
+    TEST_CHECK(ImagesEqual(decodedRegion, region));
+
+    // Data that is not a whole encoded frame is refused
+    TEST_CHECK(decoder.Decode(NULL, 0, &decoded) == E_POINTER);
+    TEST_CHECK(decoder.Decode(&encoded[0], 8, &decoded) == E_INVALIDARG);
+    TEST_CHECK(decoder.Decode(&encoded[0], encoded.size() - 1, &decoded) == E_INVALIDARG);
+
+    std::vector<BYTE> corrupt(encoded);
+    memset(&corrupt[0], 0, 4);
+    TEST_CHECK(decoder.Decode(&corrupt[0], corrupt.size(), &decoded) == E_INVALIDARG);
+    corrupt = encoded;
+    memset(&corrupt[8], 0x11, 128);
+    TEST_CHECK(decoder.Decode(&corrupt[0], corrupt.size(), &decoded) == E_INVALIDARG);
+
+    // A run of unknown pixels longer than the frame it is decoded into
+    Mat unknown(4, 4, CV_16U, Scalar(0));
+    TEST_CHECK(RoundTrip(&encoder, &decoder, unknown, &encoded));
+    corrupt = encoded;
+    corrupt[0] = 2;
+    corrupt[4] = 2;
+    TEST_CHECK(decoder.Decode(&corrupt[0], corrupt.size(), &decoded) == E_INVALIDARG);
+}
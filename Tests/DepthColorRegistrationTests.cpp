@@ -0,0 +1,137 @@
+//-----------------------------------------------------------------------------
+// <copyright file="DepthColorRegistrationTests.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation. All rights reserved.
+// </copyright>
+//-----------------------------------------------------------------------------
+
+#include "Test.h"
+#include <stdio.h>
+#include <string.h>
+#include <fstream>
+#include <vector>
+
+#include "DepthColorRegistration.h"
+
+// Cache file Initialize looks for at the depth and color resolutions of the test
+static const char* CACHE_PATH = "Registration_80x60_640x480.lut";
+static const Size DEPTH_SIZE(80, 60);
+static const Size COLOR_SIZE(640, 480);
+
+/// <summary>
+/// Writes a cache file of a made-up table in which the color image is 8 times the depth image and nearer
+/// buckets lie farther right, so that depth pixels of different depths land on the same color pixel
+/// and pixels near the sides land outside the color image
+/// </summary>
+/// <returns>true if the file was written</returns>
+static bool WriteCache()
+{
+    std::ofstream file(CACHE_PATH, std::ios::binary);
+    const char magic[4] = {'K', 'R', 'E', 'G'};
+    int header[8] = {1, DEPTH_SIZE.width, DEPTH_SIZE.height, COLOR_SIZE.width, COLOR_SIZE.height,
+        DepthColorRegistration::DEPTH_BUCKETS, DepthColorRegistration::MIN_DEPTH, DepthColorRegistration::MAX_DEPTH};
+    file.write(magic, sizeof(magic));
+    file.write(reinterpret_cast<const char*>(header), sizeof(header));
+
+    std::vector<short> table;
+    for (int y = 0; y < DEPTH_SIZE.height; ++y)
+    {
+        for (int x = 0; x < DEPTH_SIZE.width; ++x)
+        {
+            for (int bucket = 0; bucket < DepthColorRegistration::DEPTH_BUCKETS; ++bucket)
+            {
+                table.push_back(static_cast<short>(8 * x - 20 + 6 * bucket));
+                table.push_back(static_cast<short>(8 * y - 8));
+            }
+        }
+    }
+    file.write(reinterpret_cast<const char*>(&table[0]), table.size() * sizeof(short));
+
+    return file.good();
+}
+
+/// <summary>
+/// Runs the tests of the full-frame alignments, checked against the mapping of single pixels
+/// </summary>
+void RunDepthColorRegistrationTests()
+{
+    DepthColorRegistration registration;
+    Mat depth(DEPTH_SIZE, CV_16UC1);
+    Mat color(COLOR_SIZE, CV_8UC4);
+    Mat aligned;
+
+    // Nothing can be aligned before there is a table
+    TEST_CHECK(registration.AlignDepthToColor(&depth, &aligned) == E_NOT_VALID_STATE);
+    TEST_CHECK(registration.AlignColorToDepth(&depth, &color, &aligned) == E_NOT_VALID_STATE);
+
+    TEST_CHECK(WriteCache());
+    TEST_CHECK(SUCCEEDED(registration.Initialize(NUI_IMAGE_RESOLUTION_80x60, NUI_IMAGE_RESOLUTION_640x480)));
+    Point mapped;
+    TEST_CHECK(SUCCEEDED(registration.MapDepthPixel(10, 10, DepthColorRegistration::MAX_DEPTH, &mapped)));
+    TEST_CHECK(mapped == Point(60, 72));
+
+    // Random depth with unknown pixels, and a color image whose every pixel differs from its neighbors
+    RNG rng(0xa119);
+    for (int y = 0; y < DEPTH_SIZE.height; ++y)
+    {
+        for (int x = 0; x < DEPTH_SIZE.width; ++x)
+        {
+            depth.ptr<USHORT>(y)[x] = (rng.uniform(0, 10) == 0) ? 0 : static_cast<USHORT>(rng.uniform(300, 9000));
+        }
+    }
+    for (int y = 0; y < COLOR_SIZE.height; ++y)
+    {
+        for (int x = 0; x < COLOR_SIZE.width; ++x)
+        {
+            color.ptr<Vec4b>(y)[x] = Vec4b(static_cast<uchar>(x), static_cast<uchar>(y), static_cast<uchar>(x >> 8), 255);
+        }
+    }
+
+    // The nearest depth that maps onto each color pixel, and the color each depth pixel maps onto
+    Mat expectedDepth(COLOR_SIZE, CV_16UC1, Scalar(0));
+    Mat expectedColor(DEPTH_SIZE, CV_8UC4, Scalar(0, 0, 0, 0));
+    int collisionCount = 0;
+    for (int y = 0; y < DEPTH_SIZE.height; ++y)
+    {
+        for (int x = 0; x < DEPTH_SIZE.width; ++x)
+        {
+            USHORT pixelDepth = depth.ptr<USHORT>(y)[x];
+            if (pixelDepth == 0 || FAILED(registration.MapDepthPixel(x, y, pixelDepth, &mapped)) ||
+                mapped.x < 0 || mapped.y < 0 || mapped.x >= COLOR_SIZE.width || mapped.y >= COLOR_SIZE.height)
+            {
+                continue;
+            }
+
+            USHORT& nearest = expectedDepth.ptr<USHORT>(mapped.y)[mapped.x];
+            collisionCount += (nearest != 0) ? 1 : 0;
+            nearest = (nearest == 0 || pixelDepth < nearest) ? pixelDepth : nearest;
+            expectedColor.ptr<Vec4b>(y)[x] = color.ptr<Vec4b>(mapped.y)[mapped.x];
+        }
+    }
+    TEST_CHECK(collisionCount > 0);
+
+    TEST_CHECK(SUCCEEDED(registration.AlignDepthToColor(&depth, &aligned)));
+    TEST_CHECK(aligned.size() == COLOR_SIZE && aligned.type() == CV_16UC1);
+    int depthMismatchCount = 0;
+    for (int y = 0; y < COLOR_SIZE.height; ++y)
+    {
+        depthMismatchCount += (memcmp(aligned.ptr(y), expectedDepth.ptr(y), COLOR_SIZE.width * sizeof(USHORT)) == 0) ? 0 : 1;
+    }
+    TEST_CHECK(depthMismatchCount == 0);
+
+    TEST_CHECK(SUCCEEDED(registration.AlignColorToDepth(&depth, &color, &aligned)));
+    TEST_CHECK(aligned.size() == DEPTH_SIZE && aligned.type() == CV_8UC4);
+    int colorMismatchCount = 0;
+    for (int y = 0; y < DEPTH_SIZE.height; ++y)
+    {
+        colorMismatchCount += (memcmp(aligned.ptr(y), expectedColor.ptr(y), DEPTH_SIZE.width * sizeof(Vec4b)) == 0) ? 0 : 1;
+    }
+    TEST_CHECK(colorMismatchCount == 0);
+
+    // Images that do not match the table are refused
+    Mat smallDepth(DEPTH_SIZE.height / 2, DEPTH_SIZE.width / 2, CV_16UC1, Scalar(1000));
+    TEST_CHECK(registration.AlignDepthToColor(&smallDepth, &aligned) == E_INVALIDARG);
+    TEST_CHECK(registration.AlignColorToDepth(&depth, &depth, &aligned) == E_INVALIDARG);
+    TEST_CHECK(registration.AlignDepthToColor(NULL, &aligned) == E_POINTER);
+
+    remove(CACHE_PATH);
+}
@@ -0,0 +1,201 @@
+//-----------------------------------------------------------------------------
+// <copyright file="DetectionStagesTests.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation. All rights reserved.
+// </copyright>
+//-----------------------------------------------------------------------------
+
+#include "Test.h"
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "DepthFilters.h"
+#include "DetectionStages.h"
+
+// Size of the test frames; small, since every pixel of a frame is treated alike
+static const Size FRAME_SIZE(8, 4);
+
+// Frames fed to each stage, enough for the history ring to wrap around several times
+static const int FRAME_COUNT = 40;
+
+/// <summary>
+/// Depth of every pixel in frame t: quadratic in t, so first and second order differences are both known
+/// </summary>
+/// <param name="t">index of the frame</param>
+/// <returns>depth in millimeters</returns>
+static int DepthAt(int t)
+{
+    return 1000 + 3 * t * t;
+}
+
+/// <summary>
+/// Feeds a temporal difference stage frames of DepthAt depth and checks the change it measures
+/// </summary>
+/// <param name="order">order of the difference</param>
+/// <param name="interval">frames between the differenced frames</param>
+static void CheckTemporalDiff(int order, int interval)
+{
+    char value[16];
+    PipelineConfig config;
+    sprintf(value, "%d", order);
+    config.SetString("TemporalDiff", "Order", value);
+    sprintf(value, "%d", interval);
+    config.SetString("TemporalDiff", "Interval", value);
+
+    TemporalDiffStage stage;
+    TEST_CHECK(SUCCEEDED(stage.Configure(&config)));
+
+    DetectionFrame frame;
+    frame.depth.create(FRAME_SIZE, CV_16UC1);
+    frame.difference.create(FRAME_SIZE, CV_16UC1);
+    TEST_CHECK(SUCCEEDED(stage.Plan(FRAME_SIZE, &frame)));
+
+    // Frames needed before the oldest differenced frame exists
+    int historyLength = order * interval + 1;
+
+    for (int t = 0; t < FRAME_COUNT; ++t)
+    {
+        frame.depth.setTo(Scalar(DepthAt(t)));
+
+        // A pixel with unknown depth now, and one with unknown depth only in an older frame
+        frame.depth.ptr<USHORT>(0)[0] = 0;
+        if (t % (2 * interval) == 0)
+        {
+            frame.depth.ptr<USHORT>(1)[1] = 0;
+        }
+
+        frame.difference.setTo(Scalar(USHRT_MAX));
+        TEST_CHECK(SUCCEEDED(stage.Process(&frame)));
+
+        int expected = 0;
+        if (t + 1 >= historyLength)
+        {
+            int k = interval;
+            expected = (order == 1) ? DepthAt(t) - DepthAt(t - k) : DepthAt(t) - 2 * DepthAt(t - k) + DepthAt(t - 2 * k);
+            expected = (expected < 0) ? -expected : expected;
+        }
+
+        TEST_CHECK(frame.difference.ptr<USHORT>(0)[0] == 0);
+        TEST_CHECK(frame.difference.ptr<USHORT>(1)[1] == 0 || t % interval != 0);
+        TEST_CHECK(frame.difference.ptr<USHORT>(FRAME_SIZE.height - 1)[FRAME_SIZE.width - 1] == expected);
+    }
+}
+
+/// <summary>
+/// Runs the tests of the detection stages
+/// </summary>
+void RunTemporalDiffStageTests()
+{
+    // Order = 1 keeps a history of Interval + 1 frames, shorter than two intervals back
+    CheckTemporalDiff(1, 1);
+    CheckTemporalDiff(1, 2);
+    CheckTemporalDiff(1, 5);
+    CheckTemporalDiff(2, 1);
+    CheckTemporalDiff(2, 2);
+    CheckTemporalDiff(2, 8);
+
+    // Settings that would need more history than the stage keeps are refused
+    PipelineConfig config;
+    TemporalDiffStage stage;
+    config.SetString("TemporalDiff", "Order", "3");
+    TEST_CHECK(stage.Configure(&config) == E_INVALIDARG);
+    config.SetString("TemporalDiff", "Order", "1");
+    config.SetString("TemporalDiff", "Interval", "9");
+    TEST_CHECK(stage.Configure(&config) == E_INVALIDARG);
+}
+
+/// <summary>
+/// Fills gaps one run at a time, the way FillDepthGaps is specified
+/// </summary>
+/// <param name="pDepth">pointer to 16-bit depth Mat to fill in place</param>
+/// <param name="maxGap">longest run in pixels that is filled</param>
+static void FillGapsByRuns(Mat* pDepth, int maxGap)
+{
+    for (int y = 0; y < pDepth->rows; ++y)
+    {
+        USHORT* pRow = pDepth->ptr<USHORT>(y);
+        int x = 0;
+        while (x < pDepth->cols)
+        {
+            int start = x;
+            while (x < pDepth->cols && pRow[x] == 0)
+            {
+                ++x;
+            }
+
+            if (start > 0 && x < pDepth->cols && x > start && x - start <= maxGap)
+            {
+                USHORT fill = (pRow[start - 1] > pRow[x]) ? pRow[start - 1] : pRow[x];
+                for (int i = start; i < x; ++i)
+                {
+                    pRow[i] = fill;
+                }
+            }
+            x = (x == start) ? x + 1 : x;
+        }
+    }
+}
+
+/// <summary>
+/// Runs the tests of the depth gap filling and of the hole fill stage
+/// </summary>
+void RunHoleFillStageTests()
+{
+    // Rows with and without pixels after the last group of eight, gaps of every length up to past a
+    // group and depths across the whole 16-bit range
+    RNG rng(0x9a95);
+    int mismatchCount = 0;
+    for (int i = 0; i < 400; ++i)
+    {
+        Mat depth(rng.uniform(1, 4), rng.uniform(1, 70), CV_16UC1);
+        for (int y = 0; y < depth.rows; ++y)
+        {
+            int unknownLeft = 0;
+            for (int x = 0; x < depth.cols; ++x)
+            {
+                if (unknownLeft == 0 && rng.uniform(0, 4) == 0)
+                {
+                    unknownLeft = rng.uniform(1, 20);
+                }
+                depth.ptr<USHORT>(y)[x] = (unknownLeft > 0) ? 0 : static_cast<USHORT>(rng.uniform(1, USHRT_MAX + 1));
+                unknownLeft = (unknownLeft > 0) ? unknownLeft - 1 : 0;
+            }
+        }
+
+        int maxGap = rng.uniform(0, 20);
+        Mat expected = depth.clone();
+        FillGapsByRuns(&expected, maxGap);
+        TEST_CHECK(SUCCEEDED(FillDepthGaps(&depth, maxGap)));
+        for (int y = 0; y < depth.rows; ++y)
+        {
+            mismatchCount += (memcmp(depth.ptr(y), expected.ptr(y), depth.cols * sizeof(USHORT)) == 0) ? 0 : 1;
+        }
+    }
+    TEST_CHECK(mismatchCount == 0);
+
+    Mat depth(1, 8, CV_16UC1, Scalar(0));
+    TEST_CHECK(FillDepthGaps(NULL, 8) == E_POINTER);
+    TEST_CHECK(FillDepthGaps(&depth, -1) == E_INVALIDARG);
+    TEST_CHECK(FillDepthGaps(&depth, SHRT_MAX) == E_INVALIDARG);
+
+    // A filled gap reaches the later stages but not the running depth, so the next reading of the pixel is
+    // taken as it is rather than smoothed with a depth that was never measured
+    PipelineConfig config;
+    config.SetString("HoleFill", "MaxAge", "0");
+    HoleFillStage stage;
+    TEST_CHECK(SUCCEEDED(stage.Configure(&config)));
+
+    DetectionFrame frame;
+    TEST_CHECK(SUCCEEDED(stage.Plan(FRAME_SIZE, &frame)));
+    frame.depth.create(FRAME_SIZE, CV_16UC1);
+    frame.depth.setTo(Scalar(1000));
+    frame.depth.ptr<USHORT>(1)[3] = 0;
+    TEST_CHECK(SUCCEEDED(stage.Process(&frame)));
+    TEST_CHECK(frame.depth.ptr<USHORT>(1)[3] == 1000);
+
+    frame.depth.setTo(Scalar(1000));
+    frame.depth.ptr<USHORT>(1)[3] = 1020;
+    TEST_CHECK(SUCCEEDED(stage.Process(&frame)));
+    TEST_CHECK(frame.depth.ptr<USHORT>(1)[3] == 1020);
+    TEST_CHECK(frame.depth.ptr<USHORT>(0)[0] == 1000);
+}
@@ -0,0 +1,220 @@
+//-----------------------------------------------------------------------------
+// <copyright file="IntegralImageTests.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation. All rights reserved.
+// </copyright>
+//-----------------------------------------------------------------------------
+
+#include "Test.h"
+#include <limits.h>
+#include <math.h>
+
+#include "DetectionStages.h"
+#include "IntegralImage.h"
+
+// Odd sized image, so that boxes are clipped differently at each border
+static const Size IMAGE_SIZE(23, 17);
+
+/// <summary>
+/// Fills a 16-bit image with values spread over the whole range
+/// </summary>
+/// <param name="pImage">pointer to the CV_16UC1 Mat to fill</param>
+static void FillImage(Mat* pImage)
+{
+    RNG rng(0x5eed);
+    for (int y = 0; y < pImage->rows; ++y)
+    {
+        USHORT* pRow = pImage->ptr<USHORT>(y);
+        for (int x = 0; x < pImage->cols; ++x)
+        {
+            pRow[x] = static_cast<USHORT>(rng.uniform(0, USHRT_MAX + 1));
+        }
+    }
+}
+
+/// <summary>
+/// Sums a rectangle of an image pixel by pixel
+/// </summary>
+/// <param name="image">CV_16UC1 image</param>
+/// <param name="region">rectangle inside the image</param>
+/// <returns>sum of the pixels</returns>
+static double SumPixels(const Mat& image, Rect region)
+{
+    double sum = 0.0;
+    for (int y = region.y; y < region.y + region.height; ++y)
+    {
+        for (int x = region.x; x < region.x + region.width; ++x)
+        {
+            sum += image.ptr<USHORT>(y)[x];
+        }
+    }
+    return sum;
+}
+
+/// <summary>
+/// Box filters an image pixel by pixel, clipping the box to the image as IntegralImage::BoxFilter does
+/// </summary>
+/// <param name="image">CV_16UC1 image</param>
+/// <param name="radius">half width of the box</param>
+/// <param name="pDst">pointer in which to return the filtered image</param>
+static void BoxFilterPixels(const Mat& image, int radius, Mat* pDst)
+{
+    pDst->create(image.size(), CV_16UC1);
+    for (int y = 0; y < image.rows; ++y)
+    {
+        for (int x = 0; x < image.cols; ++x)
+        {
+            Rect box(x - radius, y - radius, 2 * radius + 1, 2 * radius + 1);
+            box = box & Rect(0, 0, image.cols, image.rows);
+            pDst->ptr<USHORT>(y)[x] = saturate_cast<USHORT>(SumPixels(image, box) / box.area());
+        }
+    }
+}
+
+/// <summary>
+/// Checks that two 16-bit images are equal
+/// </summary>
+/// <param name="a">first image</param>
+/// <param name="b">second image</param>
+/// <returns>true if the images have the same size and pixels</returns>
+static bool ImagesEqual(const Mat& a, const Mat& b)
+{
+    if (a.size() != b.size() || a.type() != b.type())
+    {
+        return false;
+    }
+
+    for (int y = 0; y < a.rows; ++y)
+    {
+        for (int x = 0; x < a.cols; ++x)
+        {
+            if (a.ptr<USHORT>(y)[x] != b.ptr<USHORT>(y)[x])
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/// <summary>
+/// Runs the temporal difference, smoothing and statistics stages on one frame, with a table of an older
+/// difference left in the frame, and checks that the change over the extent is measured on the smoothed difference
+/// </summary>
+/// <param name="image">CV_16UC1 image of which the frame's table is computed before the stages run</param>
+static void CheckMotionChange(const Mat& image)
+{
+    PipelineConfig config;
+    config.SetString("TemporalDiff", "Order", "1");
+    config.SetString("TemporalDiff", "Interval", "1");
+    config.SetString("Smooth", "Radius", "3");
+
+    TemporalDiffStage temporalDiff;
+    SmoothStage smooth;
+    StatisticsStage statistics;
+    DetectionFrame frame;
+    frame.depth.create(IMAGE_SIZE, CV_16UC1);
+    frame.difference.create(IMAGE_SIZE, CV_16UC1);
+    frame.mask.create(IMAGE_SIZE, CV_8UC1);
+    frame.columnCounts.assign(IMAGE_SIZE.width, 0);
+    frame.rowCounts.assign(IMAGE_SIZE.height, 0);
+    TEST_CHECK(SUCCEEDED(temporalDiff.Configure(&config)) && SUCCEEDED(temporalDiff.Plan(IMAGE_SIZE, &frame)));
+    TEST_CHECK(SUCCEEDED(smooth.Configure(&config)) && SUCCEEDED(smooth.Plan(IMAGE_SIZE, &frame)));
+
+    // Depth that moves 300 mm closer inside a block between two frames
+    Rect block(4, 3, 9, 6);
+    frame.depth.setTo(Scalar(2000));
+    TEST_CHECK(SUCCEEDED(temporalDiff.Process(&frame)));
+    frame.depth(block).setTo(Scalar(1700));
+
+    // Stale table of another image, which every stage that rewrites the difference must invalidate
+    image.copyTo(frame.difference);
+    TEST_CHECK(SUCCEEDED(frame.differenceIntegral.Compute(&frame.difference)));
+    TEST_CHECK(SUCCEEDED(temporalDiff.Process(&frame)));
+    TEST_CHECK(!frame.differenceIntegral.IsValid());
+    TEST_CHECK(SUCCEEDED(smooth.Process(&frame)));
+    TEST_CHECK(!frame.differenceIntegral.IsValid());
+
+    // The mask covers the block and one pixel outside it, so the extent also covers pixels that did not move
+    frame.mask.setTo(Scalar(0));
+    frame.mask(block).setTo(Scalar(255));
+    frame.mask.ptr<BYTE>(15)[20] = 255;
+    TEST_CHECK(SUCCEEDED(statistics.Process(&frame)));
+
+    Rect extent(4, 3, 17, 13);
+    TEST_CHECK(frame.stats.count == block.area() + 1);
+    TEST_CHECK(frame.stats.extent == extent);
+    TEST_CHECK(frame.differenceIntegral.IsValid());
+    TEST_CHECK(fabs(frame.stats.meanChange - SumPixels(frame.difference, extent) / extent.area()) < 0.01);
+
+    // No motion gives no change, and a table that is out of date is refused
+    MotionStats stats = frame.stats;
+    stats.count = 0;
+    TEST_CHECK(SUCCEEDED(ComputeMotionChange(&frame.differenceIntegral, &stats)) && stats.meanChange == 0.0f);
+    frame.differenceIntegral.Invalidate();
+    TEST_CHECK(ComputeMotionChange(&frame.differenceIntegral, &stats) == E_NOT_VALID_STATE);
+    TEST_CHECK(ComputeMotionChange(NULL, &stats) == E_POINTER);
+}
+
+/// <summary>
+/// Runs the tests of the summed-area table and the stages built on it
+/// </summary>
+void RunIntegralImageTests()
+{
+    Mat image(IMAGE_SIZE, CV_16UC1);
+    FillImage(&image);
+
+    IntegralImage integral;
+    TEST_CHECK(!integral.IsValid());
+    TEST_CHECK(integral.GetSum(Rect(0, 0, 4, 4)) == 0.0);
+    TEST_CHECK(SUCCEEDED(integral.Compute(&image)));
+    TEST_CHECK(integral.IsValid());
+    TEST_CHECK(integral.GetSize() == IMAGE_SIZE);
+
+    // Region sums, including rectangles clipped by the border and rectangles outside the image
+    TEST_CHECK(integral.GetSum(Rect(0, 0, IMAGE_SIZE.width, IMAGE_SIZE.height)) == SumPixels(image, Rect(0, 0, IMAGE_SIZE.width, IMAGE_SIZE.height)));
+    TEST_CHECK(integral.GetSum(Rect(3, 5, 7, 2)) == SumPixels(image, Rect(3, 5, 7, 2)));
+    TEST_CHECK(integral.GetSum(Rect(-4, -4, 6, 6)) == SumPixels(image, Rect(0, 0, 2, 2)));
+    TEST_CHECK(integral.GetSum(Rect(IMAGE_SIZE.width, 0, 5, 5)) == 0.0);
+    TEST_CHECK(fabs(integral.GetMean(Rect(3, 5, 7, 2)) - SumPixels(image, Rect(3, 5, 7, 2)) / 14) < 1e-9);
+
+    Mat filtered, expected;
+    for (int radius = 0; radius <= 12; radius += 3)
+    {
+        TEST_CHECK(SUCCEEDED(integral.BoxFilter(radius, &filtered)));
+        BoxFilterPixels(image, radius, &expected);
+        TEST_CHECK(ImagesEqual(filtered, expected));
+    }
+
+    // Every smoothing pass filters the result of the previous one, not the difference it started from
+    PipelineConfig config;
+    config.SetString("Smooth", "Radius", "2");
+    config.SetString("Smooth", "Passes", "3");
+
+    SmoothStage stage;
+    DetectionFrame frame;
+    TEST_CHECK(SUCCEEDED(stage.Configure(&config)));
+    TEST_CHECK(SUCCEEDED(stage.Plan(IMAGE_SIZE, &frame)));
+
+    for (int repeat = 0; repeat < 2; ++repeat)
+    {
+        // The second time the first pass shares a table an earlier stage computed
+        image.copyTo(frame.difference);
+        if (repeat == 1)
+        {
+            TEST_CHECK(SUCCEEDED(frame.differenceIntegral.Compute(&frame.difference)));
+        }
+        TEST_CHECK(SUCCEEDED(stage.Process(&frame)));
+        TEST_CHECK(!frame.differenceIntegral.IsValid());
+
+        Mat pass;
+        image.copyTo(expected);
+        for (int i = 0; i < 3; ++i)
+        {
+            BoxFilterPixels(expected, 2, &pass);
+            pass.copyTo(expected);
+        }
+        TEST_CHECK(ImagesEqual(frame.difference, expected));
+    }
+
+    CheckMotionChange(image);
+}
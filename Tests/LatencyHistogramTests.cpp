@@ -0,0 +1,85 @@
+//-----------------------------------------------------------------------------
+// <copyright file="LatencyHistogramTests.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation. All rights reserved.
+// </copyright>
+//-----------------------------------------------------------------------------
+
+#include "Test.h"
+#include <math.h>
+
+#include "LatencyHistogram.h"
+
+/// <summary>
+/// Checks that a percentile is within the precision of the histogram of the duration it stands for
+/// </summary>
+/// <param name="percentile">percentile from a summary</param>
+/// <param name="nanoseconds">duration recorded</param>
+/// <returns>true if the percentile is less than 1/16 of the duration away from it</returns>
+static bool IsNear(double percentile, double nanoseconds)
+{
+    return fabs(percentile - nanoseconds) < nanoseconds / 16;
+}
+
+/// <summary>
+/// Runs the tests of the latency histogram
+/// </summary>
+void RunLatencyHistogramTests()
+{
+    LatencySummary summary;
+
+    // Nothing recorded
+    LatencyHistogram empty;
+    empty.GetSummary(&summary);
+    TEST_CHECK(summary.count == 0 && summary.mean == 0.0 && summary.p50 == 0.0 && summary.p99 == 0.0 && summary.max == 0.0);
+
+    // Durations below 16 ns each have a bucket of their own, so their percentiles are exact; negative
+    // durations count as 0
+    LatencyHistogram exact;
+    exact.Record(-5);
+    for (int i = 1; i < 16; ++i)
+    {
+        exact.Record(i);
+    }
+    exact.GetSummary(&summary);
+    TEST_CHECK(summary.count == 16);
+    TEST_CHECK(summary.mean == 7.5);
+    TEST_CHECK(summary.p50 == 7.0 && summary.p95 == 15.0 && summary.p99 == 15.0 && summary.max == 15.0);
+
+    // Longer durations land in buckets 1/16 of their power of two wide and stand for the middle of the
+    // bucket; powers of two start a bucket, so a percentile of one is within half a bucket above it
+    LatencyHistogram scaled;
+    for (int i = 0; i < 90; ++i)
+    {
+        scaled.Record(1 << 20);
+    }
+    for (int i = 0; i < 9; ++i)
+    {
+        scaled.Record(1 << 24);
+    }
+    scaled.Record(1000);
+    scaled.GetSummary(&summary);
+    TEST_CHECK(summary.count == 100);
+    TEST_CHECK(summary.mean == (90.0 * (1 << 20) + 9.0 * (1 << 24) + 1000.0) / 100);
+    TEST_CHECK(IsNear(summary.p50, 1 << 20) && summary.p50 > (1 << 20));
+    TEST_CHECK(IsNear(summary.p95, 1 << 24) && IsNear(summary.p99, 1 << 24));
+
+    // A bucket never reports more than the longest duration recorded, although its middle is above it
+    TEST_CHECK(summary.max == (1 << 24) && summary.p99 == summary.max);
+
+    LatencyHistogram single;
+    single.Record(1000);
+    single.GetSummary(&summary);
+    TEST_CHECK(summary.p50 == 1000.0 && summary.p99 == 1000.0);
+
+    // Durations past 2^40 ns are counted in the last bucket, but their maximum is kept
+    LatencyHistogram overflow;
+    overflow.Record(1LL << 45);
+    overflow.GetSummary(&summary);
+    TEST_CHECK(summary.count == 1 && summary.max == static_cast<double>(1LL << 45));
+    TEST_CHECK(summary.p50 < static_cast<double>(1LL << 41) && summary.p50 >= static_cast<double>(1LL << 40) * 15 / 16);
+
+    // The clock does not go back
+    LONGLONG first = GetMonotonicNanoseconds();
+    LONGLONG second = GetMonotonicNanoseconds();
+    TEST_CHECK(first > 0 && second >= first);
+}
@@ -0,0 +1,126 @@
+//-----------------------------------------------------------------------------
+// <copyright file="RosFramingTests.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation. All rights reserved.
+// </copyright>
+//-----------------------------------------------------------------------------
+
+#include "Test.h"
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#include <ros/node_handle.h>
+#include "PointCloudMessage.h"
+
+// Output buffer of the tested node handle; small, so a cloud of a few hundred points overflows it
+static const int TEST_OUTPUT_SIZE = 1024;
+
+// Topic id above 255, so both id bytes of the packet header are used
+static const int TEST_TOPIC_ID = 300;
+
+/// <summary>
+/// Stand-in for the socket the node handle writes to, keeping every packet
+/// </summary>
+class RecordingHardware
+{
+public:
+    void init() {}
+    int read() { return -1; }
+    unsigned long time() { return 0; }
+
+    void write(unsigned char* data, int length)
+    {
+        packets.push_back(std::vector<unsigned char>(data, data + length));
+    }
+
+    std::vector<std::vector<unsigned char> > packets;
+};
+
+/// <summary>
+/// Node handle that publishes on topic ids without the negotiation with rosserial_python
+/// </summary>
+class TestNodeHandle : public ros::NodeHandle_<RecordingHardware, 2, 2, 64, TEST_OUTPUT_SIZE>
+{
+public:
+    TestNodeHandle()
+    {
+        configured_ = true;
+    }
+};
+
+/// <summary>
+/// Checks that a packet is framed as rosserial_python expects: length and topic id in little-endian
+/// order, each followed by a matching checksum
+/// </summary>
+/// <param name="packet">bytes written by the node handle</param>
+/// <param name="topicId">topic the packet should be for</param>
+/// <returns>length of the message in the packet, or -1 if the framing is wrong</returns>
+static int CheckFraming(const std::vector<unsigned char>& packet, int topicId)
+{
+    if (packet.size() < 8 || packet[0] != 0xff)
+    {
+        return -1;
+    }
+
+    int length = packet[2] | (packet[3] << 8);
+    int id = packet[5] | (packet[6] << 8);
+    if (static_cast<int>(packet.size()) != length + 8 || id != topicId || (packet[2] + packet[3] + packet[4]) % 256 != 255)
+    {
+        return -1;
+    }
+
+    int checksum = 0;
+    for (size_t i = 5; i < packet.size(); ++i)
+    {
+        checksum += packet[i];
+    }
+    return (checksum % 256 == 255) ? length : -1;
+}
+
+/// <summary>
+/// Runs the tests of the rosserial packet framing of published messages
+/// </summary>
+void RunRosFramingTests()
+{
+    PointCloud cloud;
+    cloud.Reserve(500);
+    for (int i = 0; i < 500; ++i)
+    {
+        cloud.AddPoint(0.001f * i, -0.002f * i, 1.0f + 0.003f * i);
+    }
+
+    // A cloud thinned to fit is sent whole, with a length above 255 in both length bytes
+    TestNodeHandle nh;
+    PointCloudMessage message;
+    message.SetCloud(&cloud, TEST_OUTPUT_SIZE - 8);
+    TEST_CHECK(message.GetPointCount() > 0 && message.GetPointCount() < 500);
+    TEST_CHECK(message.serializedLength() > 255 && message.serializedLength() <= TEST_OUTPUT_SIZE - 8);
+
+    int written = nh.publish(TEST_TOPIC_ID, &message);
+    RecordingHardware* pHardware = nh.getHardware();
+    TEST_CHECK(written == message.serializedLength() + 8);
+    TEST_CHECK(pHardware->packets.size() == 1);
+    if (pHardware->packets.size() == 1)
+    {
+        TEST_CHECK(CheckFraming(pHardware->packets[0], TEST_TOPIC_ID) == message.serializedLength());
+
+        // The points follow the fixed fields in the order they were added, every stride-th one
+        const std::vector<unsigned char>& packet = pHardware->packets[0];
+        int stride = (500 + message.GetPointCount() - 1) / message.GetPointCount();
+        int dataOffset = 7 + message.serializedLength() - 1 - message.GetPointCount() * 12;
+        float point[3];
+        memcpy(point, &packet[dataOffset + 12], sizeof(point));
+        TEST_CHECK(point[0] == 0.001f * stride && point[1] == -0.002f * stride && point[2] == 1.0f + 0.003f * stride);
+    }
+
+    // A cloud that does not fit is dropped before it is written, and only the error log is sent
+    pHardware->packets.clear();
+    message.SetCloud(&cloud, 4 * TEST_OUTPUT_SIZE);
+    TEST_CHECK(message.serializedLength() > TEST_OUTPUT_SIZE - 8);
+    TEST_CHECK(nh.publish(TEST_TOPIC_ID, &message) == -1);
+    TEST_CHECK(pHardware->packets.size() == 1);
+    if (pHardware->packets.size() == 1)
+    {
+        TEST_CHECK(CheckFraming(pHardware->packets[0], rosserial_msgs::TopicInfo::ID_LOG) > 0);
+    }
+}
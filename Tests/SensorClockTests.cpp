@@ -0,0 +1,65 @@
+//-----------------------------------------------------------------------------
+// <copyright file="SensorClockTests.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation. All rights reserved.
+// </copyright>
+//-----------------------------------------------------------------------------
+
+#include "Test.h"
+
+#include "SensorClock.h"
+
+// Monotonic time of the sensor's clock 0 in the tests, and the least time a frame takes to arrive
+static const LONGLONG SENSOR_EPOCH = 5000000000LL;
+static const LONGLONG TRANSFER_TIME = 2000000;
+
+// Nanoseconds per millisecond of sensor time
+static const LONGLONG NANOSECONDS_PER_MILLISECOND = 1000000;
+
+/// <summary>
+/// Runs the tests of the mapping of sensor timestamps onto the monotonic clock
+/// </summary>
+void RunSensorClockTests()
+{
+    SensorClock clock;
+
+    // The first frame maps to its arrival
+    TEST_CHECK(clock.ToMonotonic(1000, SENSOR_EPOCH + 1000 * NANOSECONDS_PER_MILLISECOND + 3 * TRANSFER_TIME) ==
+        SENSOR_EPOCH + 1000 * NANOSECONDS_PER_MILLISECOND + 3 * TRANSFER_TIME);
+
+    // A faster frame lowers the offset, and a frame that waited longer maps to when it was taken, but for
+    // the 100 ppm of the 33 ms since that the clocks may have drifted apart
+    TEST_CHECK(clock.ToMonotonic(1033, SENSOR_EPOCH + 1033 * NANOSECONDS_PER_MILLISECOND + TRANSFER_TIME) ==
+        SENSOR_EPOCH + 1033 * NANOSECONDS_PER_MILLISECOND + TRANSFER_TIME);
+    TEST_CHECK(clock.ToMonotonic(1066, SENSOR_EPOCH + 1066 * NANOSECONDS_PER_MILLISECOND + 5 * TRANSFER_TIME) ==
+        SENSOR_EPOCH + 1066 * NANOSECONDS_PER_MILLISECOND + TRANSFER_TIME + 33 * NANOSECONDS_PER_MILLISECOND / 10000);
+
+    // A sensor clock that runs 50 ppm slow is followed, since the offset may rise by up to 100 ppm
+    LONGLONG drift = 0;
+    for (LONGLONG second = 2; second <= 10; ++second)
+    {
+        drift += 50000;
+        LONGLONG taken = SENSOR_EPOCH + second * 1000 * NANOSECONDS_PER_MILLISECOND + drift;
+        TEST_CHECK(clock.ToMonotonic(second * 1000, taken + TRANSFER_TIME) == taken + TRANSFER_TIME);
+    }
+
+    // One that runs 300 ppm slow is followed at 100 ppm, so frames map early but never after their arrival
+    LONGLONG sensorTime = 10000;
+    LONGLONG arrival = 0;
+    LONGLONG mapped = 0;
+    for (int second = 0; second < 10; ++second)
+    {
+        sensorTime += 1000;
+        drift += 300000;
+        arrival = SENSOR_EPOCH + sensorTime * NANOSECONDS_PER_MILLISECOND + drift + TRANSFER_TIME;
+        mapped = clock.ToMonotonic(sensorTime, arrival);
+        TEST_CHECK(mapped <= arrival);
+    }
+    TEST_CHECK(mapped == arrival - 10 * 200000);
+
+    // A sensor clock that went back was restarted, and so was one the clock was reset for
+    TEST_CHECK(clock.ToMonotonic(10, arrival + 40 * NANOSECONDS_PER_MILLISECOND) == arrival + 40 * NANOSECONDS_PER_MILLISECOND);
+    TEST_CHECK(clock.ToMonotonic(43, arrival + 73 * NANOSECONDS_PER_MILLISECOND - TRANSFER_TIME) ==
+        arrival + 73 * NANOSECONDS_PER_MILLISECOND - TRANSFER_TIME);
+    clock.Reset();
+    TEST_CHECK(clock.ToMonotonic(76, arrival + 500 * NANOSECONDS_PER_MILLISECOND) == arrival + 500 * NANOSECONDS_PER_MILLISECOND);
+}
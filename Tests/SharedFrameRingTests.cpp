@@ -0,0 +1,194 @@
+//-----------------------------------------------------------------------------
+// <copyright file="SharedFrameRingTests.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation. All rights reserved.
+// </copyright>
+//-----------------------------------------------------------------------------
+
+#include "Test.h"
+#include <string.h>
+
+#include "SharedFrameRing.h"
+
+// Names of the rings the tests create; they are removed again before the tests return
+static const char* WRITTEN_RING_NAME = "KinectBridgeTestRing";
+static const char* CRAFTED_RING_NAME = "KinectBridgeTestCraftedRing";
+
+// Layout of a version 1 ring, as SharedFrameRingWriter lays it out, for rings the tests craft by hand
+static const DWORD RING_MAGIC = 0x474E524B;
+static const DWORD RING_VERSION = 1;
+static const size_t RING_HEADER_SIZE = 64;
+static const size_t SLOT_HEADER_SIZE = 64;
+static const DWORD CRAFTED_SLOT_DATA_SIZE = 64;
+
+/// <summary>
+/// Checks that two images have the same size, type and pixels
+/// </summary>
+/// <param name="a">first image</param>
+/// <param name="b">second image</param>
+/// <returns>true if the images are equal</returns>
+static bool ImagesEqual(const Mat& a, const Mat& b)
+{
+    if (a.size() != b.size() || a.type() != b.type())
+    {
+        return false;
+    }
+
+    size_t rowSize = a.cols * a.elemSize();
+    for (int y = 0; y < a.rows; ++y)
+    {
+        if (memcmp(a.ptr(y), b.ptr(y), rowSize) != 0)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/// <summary>
+/// Writes frames with SharedFrameRingWriter and reads them back
+/// </summary>
+static void CheckWrittenRing()
+{
+    SharedFrameRingWriter writer;
+    TEST_CHECK(SUCCEEDED(writer.Create(WRITTEN_RING_NAME, 2, 8 * 6 * sizeof(USHORT))));
+
+    SharedFrameRingReader reader;
+    TEST_CHECK(SUCCEEDED(reader.Open(WRITTEN_RING_NAME)));
+
+    Mat image;
+    SharedFrameInfo info;
+    TEST_CHECK(reader.ReadLatestFrame(&image, &info) == S_FALSE);
+
+    // Frames are read back whole, also when written from a region of a larger image
+    Mat frame(Size(10, 8), CV_16UC1);
+    for (int y = 0; y < frame.rows; ++y)
+    {
+        for (int x = 0; x < frame.cols; ++x)
+        {
+            frame.ptr<USHORT>(y)[x] = static_cast<USHORT>(1000 + 10 * y + x);
+        }
+    }
+
+    for (int i = 0; i < 3; ++i)
+    {
+        Mat region = frame(Rect(i, i, 8, 6));
+        TEST_CHECK(SUCCEEDED(writer.WriteFrame(&region, 100 + i)));
+        TEST_CHECK(reader.ReadLatestFrame(&image, &info) == S_OK);
+        TEST_CHECK(ImagesEqual(image, region));
+        TEST_CHECK(info.frameNumber == i && info.timestamp == static_cast<DWORD>(100 + i));
+    }
+
+    // Frames that were overwritten or are not written yet cannot be read
+    SharedFrameView view;
+    TEST_CHECK(reader.GetFrameCount() == 3);
+    TEST_CHECK(reader.BeginRead(0, &view) == S_FALSE);
+    TEST_CHECK(reader.BeginRead(3, &view) == S_FALSE);
+    TEST_CHECK(reader.BeginRead(1, &view) == S_OK && reader.EndRead(&view));
+
+    // Frames larger than a slot are refused
+    TEST_CHECK(writer.WriteFrame(&frame, 200) == E_INVALIDARG);
+
+    reader.Close();
+    writer.Close();
+}
+
+/// <summary>
+/// Reads the latest frame of a ring whose slot header was filled in by hand
+/// </summary>
+/// <param name="reader">reader that has the ring open</param>
+/// <returns>result of reading the latest frame</returns>
+static HRESULT ReadCraftedFrame(const SharedFrameRingReader& reader)
+{
+    Mat image;
+    return reader.ReadLatestFrame(&image, NULL);
+}
+
+/// <summary>
+/// Crafts a ring by hand and checks that slot headers the writer could not have written are refused
+/// </summary>
+static void CheckCraftedRing()
+{
+    SharedMemoryRegion region;
+    DWORD slotStride = static_cast<DWORD>(SLOT_HEADER_SIZE + CRAFTED_SLOT_DATA_SIZE);
+    TEST_CHECK(SUCCEEDED(region.Create(CRAFTED_RING_NAME, RING_HEADER_SIZE + 2 * slotStride)));
+    if (!region.GetData())
+    {
+        return;
+    }
+
+    SharedFrameRingHeader* pHeader = reinterpret_cast<SharedFrameRingHeader*>(region.GetData());
+    pHeader->magic = RING_MAGIC;
+    pHeader->version = RING_VERSION;
+    pHeader->slotCount = 2;
+    pHeader->slotDataSize = CRAFTED_SLOT_DATA_SIZE;
+    pHeader->slotStride = slotStride;
+    pHeader->frameCount = 1;
+
+    // Frame 0 in slot 0: 4 x 2 pixels of 16 bits
+    SharedFrameSlotHeader* pSlot = reinterpret_cast<SharedFrameSlotHeader*>(region.GetData() + RING_HEADER_SIZE);
+    SharedFrameSlotHeader validSlot;
+    validSlot.sequence = 2;
+    validSlot.frameNumber = 0;
+    validSlot.timestamp = 0;
+    validSlot.width = 4;
+    validSlot.height = 2;
+    validSlot.type = CV_16UC1;
+    validSlot.step = 4 * sizeof(USHORT);
+    *pSlot = validSlot;
+
+    SharedFrameRingReader reader;
+    TEST_CHECK(SUCCEEDED(reader.Open(CRAFTED_RING_NAME)));
+    TEST_CHECK(ReadCraftedFrame(reader) == S_OK);
+
+    // Negative sizes
+    pSlot->width = -1;
+    TEST_CHECK(ReadCraftedFrame(reader) == S_FALSE);
+    *pSlot = validSlot;
+    pSlot->height = -1;
+    TEST_CHECK(ReadCraftedFrame(reader) == S_FALSE);
+
+    // Types OpenCV does not know: a user depth, and bits beyond the channel count
+    *pSlot = validSlot;
+    pSlot->type = CV_MAKETYPE(7, 1);
+    TEST_CHECK(ReadCraftedFrame(reader) == S_FALSE);
+    pSlot->type = 5000;
+    TEST_CHECK(ReadCraftedFrame(reader) == S_FALSE);
+    pSlot->type = -1;
+    TEST_CHECK(ReadCraftedFrame(reader) == S_FALSE);
+
+    // Rows wider than their step, and rows that together overrun the slot, also when the product overflows
+    *pSlot = validSlot;
+    pSlot->width = 5;
+    TEST_CHECK(ReadCraftedFrame(reader) == S_FALSE);
+    *pSlot = validSlot;
+    pSlot->height = CRAFTED_SLOT_DATA_SIZE / validSlot.step + 1;
+    TEST_CHECK(ReadCraftedFrame(reader) == S_FALSE);
+    *pSlot = validSlot;
+    pSlot->step = 0x80000000;
+    TEST_CHECK(ReadCraftedFrame(reader) == S_FALSE);
+
+    // A slot being written, or holding another frame
+    *pSlot = validSlot;
+    pSlot->sequence = 3;
+    TEST_CHECK(ReadCraftedFrame(reader) == S_FALSE);
+    *pSlot = validSlot;
+    pSlot->frameNumber = 2;
+    TEST_CHECK(ReadCraftedFrame(reader) == S_FALSE);
+
+    // The largest frame the slot can hold is still read
+    *pSlot = validSlot;
+    pSlot->height = CRAFTED_SLOT_DATA_SIZE / validSlot.step;
+    TEST_CHECK(ReadCraftedFrame(reader) == S_OK);
+
+    reader.Close();
+    region.Close();
+}
+
+/// <summary>
+/// Runs the tests of the shared memory frame ring
+/// </summary>
+void RunSharedFrameRingTests()
+{
+    CheckWrittenRing();
+    CheckCraftedRing();
+}
@@ -0,0 +1,110 @@
+//-----------------------------------------------------------------------------
+// <copyright file="SpscQueueTests.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation. All rights reserved.
+// </copyright>
+//-----------------------------------------------------------------------------
+
+#include "Test.h"
+#include <thread>
+
+#include "SpscQueue.h"
+
+// Items passed from the producer thread to the consumer thread, many times the capacity of the queue
+static const int THREADED_ITEM_COUNT = 200000;
+static const UINT THREADED_CAPACITY = 16;
+
+/// <summary>
+/// Pushes the numbers from 0 up, retrying while the queue is full
+/// </summary>
+/// <param name="pQueue">pointer to the queue, of which this thread is the producer</param>
+static void ProduceNumbers(SpscQueue<int>* pQueue)
+{
+    for (int i = 0; i < THREADED_ITEM_COUNT; )
+    {
+        if (pQueue->Push(i))
+        {
+            ++i;
+        }
+        else
+        {
+            std::this_thread::yield();
+        }
+    }
+}
+
+/// <summary>
+/// Checks the queue on one thread: its capacity, and that items come out in the order they went in
+/// </summary>
+static void CheckSingleThread()
+{
+    SpscQueue<int> queue;
+    int item = -1;
+    TEST_CHECK(queue.Initialize(0) == E_INVALIDARG);
+    TEST_CHECK(queue.Initialize(0x10001) == E_INVALIDARG);
+    TEST_CHECK(SUCCEEDED(queue.Initialize(3)));
+    TEST_CHECK(queue.Initialize(4) == E_NOT_VALID_STATE);
+    TEST_CHECK(!queue.Pop(&item) && item == -1);
+
+    // The capacity is rounded up to a power of two
+    for (int i = 0; i < 4; ++i)
+    {
+        TEST_CHECK(queue.Push(i));
+    }
+    TEST_CHECK(!queue.Push(4));
+    TEST_CHECK(queue.GetCount() == 4);
+
+    // Items are read in order while the indices go round the cells many times
+    int expected = 0;
+    for (int next = 4; next < 1000; ++next)
+    {
+        TEST_CHECK(queue.Pop(&item) && item == expected);
+        ++expected;
+        TEST_CHECK(queue.Push(next));
+    }
+    while (queue.Pop(&item))
+    {
+        TEST_CHECK(item == expected);
+        ++expected;
+    }
+    TEST_CHECK(expected == 1000 && queue.GetCount() == 0);
+}
+
+/// <summary>
+/// Checks that every item a producer thread pushes reaches a consumer thread once and in order
+/// </summary>
+static void CheckTwoThreads()
+{
+    SpscQueue<int> queue;
+    TEST_CHECK(SUCCEEDED(queue.Initialize(THREADED_CAPACITY)));
+
+    std::thread producer(ProduceNumbers, &queue);
+
+    int expected = 0;
+    int outOfOrderCount = 0;
+    while (expected < THREADED_ITEM_COUNT)
+    {
+        int item;
+        if (queue.Pop(&item))
+        {
+            outOfOrderCount += (item != expected) ? 1 : 0;
+            ++expected;
+        }
+        else
+        {
+            std::this_thread::yield();
+        }
+    }
+
+    producer.join();
+    TEST_CHECK(outOfOrderCount == 0);
+    TEST_CHECK(queue.GetCount() == 0);
+}
+
+/// <summary>
+/// Runs the tests of the single producer, single consumer queue
+/// </summary>
+void RunSpscQueueTests()
+{
+    CheckSingleThread();
+    CheckTwoThreads();
+}
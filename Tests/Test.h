@@ -0,0 +1,32 @@
+//-----------------------------------------------------------------------------
+// <copyright file="Test.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation. All rights reserved.
+// </copyright>
+//-----------------------------------------------------------------------------
+
+#pragma once
+
+/// <summary>
+/// Counts a check and, if it failed, prints where it was made
+/// </summary>
+/// <param name="passed">whether the checked condition holds</param>
+/// <param name="file">source file of the check</param>
+/// <param name="line">line of the check</param>
+/// <param name="expression">text of the checked condition</param>
+void RecordCheck(bool passed, const char* file, int line, const char* expression);
+
+// Checks a condition; a failed check is reported and the test carries on, so one run lists every failure
+#define TEST_CHECK(expression) RecordCheck((expression) ? true : false, __FILE__, __LINE__, #expression)
+
+// Test groups, one per tested component, run in turn by the test runner
+void RunTemporalDiffStageTests();
+void RunHoleFillStageTests();
+void RunIntegralImageTests();
+void RunRosFramingTests();
+void RunVoxelGridTests();
+void RunSharedFrameRingTests();
+void RunDepthCodecTests();
+void RunLatencyHistogramTests();
+void RunSensorClockTests();
+void RunSpscQueueTests();
+void RunDepthColorRegistrationTests();
@@ -0,0 +1,66 @@
+//-----------------------------------------------------------------------------
+// <copyright file="TestRunner.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation. All rights reserved.
+// </copyright>
+//-----------------------------------------------------------------------------
+
+// Command line entry point that runs the behaviour tests of the portable components. Like
+// ReplayDetector it is not part of the Windows project and needs neither a Kinect nor the Kinect
+// SDK; build it from the repository root together with the sources under test, for example on Linux:
+//
+//   g++ -O2 -pthread -I. -Iros_lib Tests/TestRunner.cpp Tests/DepthCodecTests.cpp Tests/DepthColorRegistrationTests.cpp
+//       Tests/DetectionStagesTests.cpp Tests/IntegralImageTests.cpp Tests/LatencyHistogramTests.cpp
+//       Tests/RosFramingTests.cpp Tests/SensorClockTests.cpp Tests/SharedFrameRingTests.cpp Tests/SpscQueueTests.cpp
+//       Tests/VoxelGridTests.cpp DepthCodec.cpp DepthColorRegistration.cpp DetectionStages.cpp DetectionPipeline.cpp
+//       DepthFilters.cpp IntegralImage.cpp LatencyHistogram.cpp MotionStats.cpp PipelineConfig.cpp PointCloud.cpp
+//       PointCloudMessage.cpp SensorClock.cpp SharedFrameRing.cpp SkeletonProjector.cpp VoxelGrid.cpp
+//       -lopencv_core -lopencv_imgproc
+//
+// It prints every failed check and exits with 1 if there was one.
+
+#include <stdio.h>
+
+#include "Test.h"
+
+// Checks made so far and how many of them failed
+static int s_checkCount = 0;
+static int s_failureCount = 0;
+
+/// <summary>
+/// Counts a check and, if it failed, prints where it was made
+/// </summary>
+/// <param name="passed">whether the checked condition holds</param>
+/// <param name="file">source file of the check</param>
+/// <param name="line">line of the check</param>
+/// <param name="expression">text of the checked condition</param>
+void RecordCheck(bool passed, const char* file, int line, const char* expression)
+{
+    ++s_checkCount;
+    if (!passed)
+    {
+        ++s_failureCount;
+        fprintf(stderr, "%s(%d): check failed: %s\n", file, line, expression);
+    }
+}
+
+/// <summary>
+/// Entry point
+/// </summary>
+/// <returns>0 if every check passed, 1 otherwise</returns>
+int main()
+{
+    RunTemporalDiffStageTests();
+    RunHoleFillStageTests();
+    RunIntegralImageTests();
+    RunRosFramingTests();
+    RunVoxelGridTests();
+    RunSharedFrameRingTests();
+    RunDepthCodecTests();
+    RunLatencyHistogramTests();
+    RunSensorClockTests();
+    RunSpscQueueTests();
+    RunDepthColorRegistrationTests();
+
+    fprintf(stderr, "%d checks, %d failed\n", s_checkCount, s_failureCount);
+    return (s_failureCount == 0) ? 0 : 1;
+}
@@ -0,0 +1,125 @@
+//-----------------------------------------------------------------------------
+// <copyright file="VoxelGridTests.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation. All rights reserved.
+// </copyright>
+//-----------------------------------------------------------------------------
+
+#include "Test.h"
+#include <math.h>
+
+#include "VoxelGrid.h"
+
+// Points of a scan of 80 x 60 samples, one every 2.5 cm, centered on the optical axis 2 m away
+static const int SCAN_COLUMNS = 80;
+static const int SCAN_ROWS = 60;
+static const float SCAN_SPACING = 0.025f;
+static const float SCAN_DEPTH = 2.0f;
+
+/// <summary>
+/// Fills a cloud with a flat scan, row by row from the top as PointCloud::Generate orders the points
+/// </summary>
+/// <param name="pCloud">pointer to cloud to fill</param>
+static void FillScan(PointCloud* pCloud)
+{
+    pCloud->Clear();
+    pCloud->Reserve(SCAN_COLUMNS * SCAN_ROWS);
+    for (int row = 0; row < SCAN_ROWS; ++row)
+    {
+        for (int column = 0; column < SCAN_COLUMNS; ++column)
+        {
+            float x = (column - SCAN_COLUMNS / 2) * SCAN_SPACING + 0.001f;
+            float y = (SCAN_ROWS / 2 - row) * SCAN_SPACING - 0.001f;
+            pCloud->AddPoint(x, y, SCAN_DEPTH);
+        }
+    }
+}
+
+/// <summary>
+/// Finds the range of one coordinate over a cloud
+/// </summary>
+/// <param name="pValues">coordinate of every point</param>
+/// <param name="count">number of points</param>
+/// <param name="pMin">pointer in which to return the smallest value</param>
+/// <param name="pMax">pointer in which to return the largest value</param>
+static void GetRange(const float* pValues, int count, float* pMin, float* pMax)
+{
+    *pMin = pValues[0];
+    *pMax = pValues[0];
+    for (int i = 1; i < count; ++i)
+    {
+        *pMin = (pValues[i] < *pMin) ? pValues[i] : *pMin;
+        *pMax = (pValues[i] > *pMax) ? pValues[i] : *pMax;
+    }
+}
+
+/// <summary>
+/// Runs the tests of the voxel grid
+/// </summary>
+void RunVoxelGridTests()
+{
+    VoxelGrid grid;
+    PointCloud input;
+    PointCloud output;
+    TEST_CHECK(grid.Configure(0.0f, 400) == E_INVALIDARG);
+    TEST_CHECK(grid.Configure(0.05f, 0) == E_INVALIDARG);
+    TEST_CHECK(grid.Filter(&input, &input) == E_INVALIDARG);
+    TEST_CHECK(SUCCEEDED(grid.Configure(0.1f, 400)));
+
+    // Points in two voxels, one on each side of zero, become their centroids in the order first seen
+    input.Reserve(4);
+    input.AddPoint(0.01f, 0.02f, 1.01f);
+    input.AddPoint(-0.05f, -0.05f, 1.05f);
+    input.AddPoint(0.03f, 0.04f, 1.03f);
+    input.AddPoint(-0.07f, -0.03f, 1.07f);
+    TEST_CHECK(SUCCEEDED(grid.Filter(&input, &output)));
+    TEST_CHECK(output.GetCount() == 2);
+    TEST_CHECK(grid.GetFrameVoxelSize() == 0.1f);
+    if (output.GetCount() == 2)
+    {
+        TEST_CHECK(fabsf(output.GetX()[0] - 0.02f) < 1e-6f && fabsf(output.GetY()[0] - 0.03f) < 1e-6f && fabsf(output.GetZ()[0] - 1.02f) < 1e-6f);
+        TEST_CHECK(fabsf(output.GetX()[1] + 0.06f) < 1e-6f && fabsf(output.GetY()[1] + 0.04f) < 1e-6f && fabsf(output.GetZ()[1] - 1.06f) < 1e-6f);
+    }
+
+    // A scan occupying 1200 voxels of 5 cm is reduced with larger voxels, still from the top row to the bottom
+    TEST_CHECK(SUCCEEDED(grid.Configure(0.05f, 400)));
+    FillScan(&input);
+    TEST_CHECK(SUCCEEDED(grid.Filter(&input, &output)));
+    TEST_CHECK(output.GetCount() > 0 && output.GetCount() <= 400);
+    TEST_CHECK(grid.GetFrameVoxelSize() == 0.1f);
+    if (output.GetCount() > 0)
+    {
+        float inputMin, inputMax, outputMin, outputMax;
+        float voxelSize = grid.GetFrameVoxelSize();
+        GetRange(input.GetY(), input.GetCount(), &inputMin, &inputMax);
+        GetRange(output.GetY(), output.GetCount(), &outputMin, &outputMax);
+        TEST_CHECK(outputMin < inputMin + voxelSize && outputMax > inputMax - voxelSize);
+        GetRange(input.GetX(), input.GetCount(), &inputMin, &inputMax);
+        GetRange(output.GetX(), output.GetCount(), &outputMin, &outputMax);
+        TEST_CHECK(outputMin < inputMin + voxelSize && outputMax > inputMax - voxelSize);
+
+        // Every point is averaged into exactly one voxel, so the centroids keep the depth of the plane
+        GetRange(output.GetZ(), output.GetCount(), &outputMin, &outputMax);
+        TEST_CHECK(outputMin == SCAN_DEPTH && outputMax == SCAN_DEPTH);
+    }
+
+    // Each frame starts again at the configured voxel size
+    input.Clear();
+    input.AddPoint(0.01f, 0.01f, 1.0f);
+    TEST_CHECK(SUCCEEDED(grid.Filter(&input, &output)));
+    TEST_CHECK(output.GetCount() == 1);
+    TEST_CHECK(grid.GetFrameVoxelSize() == 0.05f);
+
+    // Voxels on either side of zero never merge, so with room for one the edge stops growing and the
+    // points of the other side are dropped
+    TEST_CHECK(SUCCEEDED(grid.Configure(0.05f, 1)));
+    input.Clear();
+    input.AddPoint(1.0f, 1.0f, 1.0f);
+    input.AddPoint(-1.0f, 1.0f, 1.0f);
+    input.AddPoint(3.0f, 3.0f, 3.0f);
+    TEST_CHECK(SUCCEEDED(grid.Filter(&input, &output)));
+    TEST_CHECK(output.GetCount() == 1);
+    if (output.GetCount() == 1)
+    {
+        TEST_CHECK(output.GetX()[0] == 2.0f && output.GetY()[0] == 2.0f && output.GetZ()[0] == 2.0f);
+    }
+}
@@ -0,0 +1,95 @@
+//-----------------------------------------------------------------------------
+// <copyright file="TextPublisher.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation. All rights reserved.
+// </copyright>
+//-----------------------------------------------------------------------------
+
+#include "TextPublisher.h"
+
+/// <summary>
+/// Constructor
+/// </summary>
+/// <param name="pFile">stream to write to, or NULL to count the results without writing them</param>
+TextPublisher::TextPublisher(FILE* pFile) :
+    m_pFile(pFile),
+    m_sweepEventCount(0)
+{
+}
+
+/// <summary>
+/// Writes a change in sweeping state
+/// </summary>
+/// <param name="pEvent">pointer to the detected event</param>
+void TextPublisher::PublishSweepEvent(const SweepEvent* pEvent)
+{
+    ++m_sweepEventCount;
+    if (!m_pFile)
+    {
+        return;
+    }
+
+    const char* type = (pEvent->type == SWEEP_EVENT_START) ? "start" :
+        (pEvent->type == SWEEP_EVENT_STOP) ? "stop" : "intensity";
+    fprintf(m_pFile, "sweep %s %.1f\n", type, pEvent->intensity);
+}
+
+/// <summary>
+/// Writes where the moving pixels of the latest depth frame are
+/// </summary>
+/// <param name="pStats">pointer to motion statistics of the frame</param>
+void TextPublisher::PublishSweepPosition(const MotionStats* pStats)
+{
+    if (!m_pFile)
+    {
+        return;
+    }
+
+    fprintf(m_pFile, "position %d %d %.1f %.1f\n", pStats->median.x, pStats->median.y, pStats->centroid.x, pStats->centroid.y);
+}
+
+/// <summary>
+/// Writes the id, centroid and area of the blobs seen in the latest depth frame
+/// </summary>
+/// <param name="pBlobs">pointer to the tracked blobs, including those missed in the latest frame</param>
+/// <param name="count">number of tracked blobs</param>
+void TextPublisher::PublishBlobs(const TrackedBlob* pBlobs, int count)
+{
+    if (!m_pFile)
+    {
+        return;
+    }
+
+    for (int i = 0; i < count; ++i)
+    {
+        // Skip blobs that were not seen in this frame
+        if (pBlobs[i].missedFrames > 0)
+        {
+            continue;
+        }
+
+        fprintf(m_pFile, "blob %d %.1f %.1f %d\n", pBlobs[i].id, pBlobs[i].centroid.x, pBlobs[i].centroid.y, pBlobs[i].area);
+    }
+}
+
+/// <summary>
+/// Writes the number of points of the latest depth frame, if the point cloud stage produced any
+/// </summary>
+/// <param name="pCloud">pointer to point cloud of the frame</param>
+void TextPublisher::PublishPointCloud(const PointCloud* pCloud)
+{
+    if (!m_pFile || pCloud->GetCount() == 0)
+    {
+        return;
+    }
+
+    fprintf(m_pFile, "cloud %d\n", pCloud->GetCount());
+}
+
+/// <summary>
+/// Gets the number of sweep events published so far
+/// </summary>
+/// <returns>number of events</returns>
+int TextPublisher::GetSweepEventCount() const
+{
+    return m_sweepEventCount;
+}
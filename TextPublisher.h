@@ -0,0 +1,62 @@
+//-----------------------------------------------------------------------------
+// <copyright file="TextPublisher.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation. All rights reserved.
+// </copyright>
+//-----------------------------------------------------------------------------
+
+#pragma once
+
+#include "Platform.h"
+#include <stdio.h>
+
+#include "DetectionPublisher.h"
+
+/// <summary>
+/// Writes detection results as lines of text, for replaying recordings without a ROS server
+/// </summary>
+class TextPublisher : public DetectionPublisher
+{
+public:
+    // Functions:
+    /// <summary>
+    /// Constructor
+    /// </summary>
+    /// <param name="pFile">stream to write to, or NULL to count the results without writing them</param>
+    explicit TextPublisher(FILE* pFile);
+
+    /// <summary>
+    /// Writes a change in sweeping state
+    /// </summary>
+    /// <param name="pEvent">pointer to the detected event</param>
+    virtual void PublishSweepEvent(const SweepEvent* pEvent);
+
+    /// <summary>
+    /// Writes where the moving pixels of the latest depth frame are
+    /// </summary>
+    /// <param name="pStats">pointer to motion statistics of the frame</param>
+    virtual void PublishSweepPosition(const MotionStats* pStats);
+
+    /// <summary>
+    /// Writes the id, centroid and area of the blobs seen in the latest depth frame
+    /// </summary>
+    /// <param name="pBlobs">pointer to the tracked blobs, including those missed in the latest frame</param>
+    /// <param name="count">number of tracked blobs</param>
+    virtual void PublishBlobs(const TrackedBlob* pBlobs, int count);
+
+    /// <summary>
+    /// Writes the number of points of the latest depth frame, if the point cloud stage produced any
+    /// </summary>
+    /// <param name="pCloud">pointer to point cloud of the frame</param>
+    virtual void PublishPointCloud(const PointCloud* pCloud);
+
+    /// <summary>
+    /// Gets the number of sweep events published so far
+    /// </summary>
+    /// <returns>number of events</returns>
+    int GetSweepEventCount() const;
+
+private:
+    // Variables:
+    FILE* m_pFile;
+    int m_sweepEventCount;
+};
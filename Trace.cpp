@@ -0,0 +1,180 @@
+//-----------------------------------------------------------------------------
+// <copyright file="Trace.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation. All rights reserved.
+// </copyright>
+//-----------------------------------------------------------------------------
+
+#include "Trace.h"
+#include <stdio.h>
+#include <new>
+#include <vector>
+
+#ifdef _MSC_VER
+#define TRACE_THREAD_LOCAL __declspec(thread)
+#else
+#define TRACE_THREAD_LOCAL __thread
+#endif
+
+// Events each thread keeps, a power of two; at 30 frames per second this is well over a minute of frames
+static const LONG TRACE_EVENTS_PER_THREAD = 1 << 14;
+
+/// <summary>
+/// Finished trace event
+/// </summary>
+struct TraceEvent
+{
+    const char* name;
+    LONGLONG start;
+    LONGLONG duration;
+};
+
+/// <summary>
+/// Ring buffer of the events of one thread. Only that thread writes it; the event count is published
+/// after the event it counts, so a reader can tell which events it may have seen half overwritten.
+/// </summary>
+struct TraceThreadBuffer
+{
+    TraceEvent events[TRACE_EVENTS_PER_THREAD];
+    volatile LONG eventCount;
+    LONG threadID;
+    const char* volatile threadName;
+    TraceThreadBuffer* pNext;
+};
+
+// Buffers of every thread that recorded an event, newest first. Buffers are never freed, so that
+// the events of threads that have ended can still be saved.
+static TraceThreadBuffer* volatile s_pFirstBuffer = NULL;
+static volatile LONG s_threadCount = 0;
+
+// Buffer of the calling thread, created when it records its first event
+static TRACE_THREAD_LOCAL TraceThreadBuffer* t_pBuffer = NULL;
+
+/// <summary>
+/// Gets the buffer of the calling thread, creating it if needed
+/// </summary>
+/// <returns>pointer to the buffer, or NULL if it could not be allocated</returns>
+static TraceThreadBuffer* GetThreadBuffer()
+{
+    if (t_pBuffer)
+    {
+        return t_pBuffer;
+    }
+
+    TraceThreadBuffer* pBuffer = new (std::nothrow) TraceThreadBuffer;
+    if (!pBuffer)
+    {
+        return NULL;
+    }
+
+    pBuffer->eventCount = 0;
+    pBuffer->threadID = InterlockedIncrement(&s_threadCount);
+    pBuffer->threadName = NULL;
+
+    // Push onto the list without a lock; another thread may push in between, so retry until the head is unchanged
+    TraceThreadBuffer* pFirst;
+    do
+    {
+        pFirst = s_pFirstBuffer;
+        pBuffer->pNext = pFirst;
+    }
+    while (InterlockedCompareExchangePointer(reinterpret_cast<void* volatile*>(&s_pFirstBuffer), pBuffer, pFirst) != pFirst);
+
+    t_pBuffer = pBuffer;
+    return pBuffer;
+}
+
+/// <summary>
+/// Records a finished trace event of the calling thread, overwriting its oldest event once its buffer is full
+/// </summary>
+/// <param name="name">name of the event, a string literal that needs no escaping in JSON</param>
+/// <param name="start">monotonic time the event started in nanoseconds</param>
+/// <param name="end">monotonic time the event ended in nanoseconds</param>
+void RecordTraceEvent(const char* name, LONGLONG start, LONGLONG end)
+{
+    TraceThreadBuffer* pBuffer = GetThreadBuffer();
+    if (!pBuffer)
+    {
+        return;
+    }
+
+    LONG eventCount = pBuffer->eventCount;
+    TraceEvent* pEvent = &pBuffer->events[eventCount & (TRACE_EVENTS_PER_THREAD - 1)];
+    pEvent->name = name;
+    pEvent->start = start;
+    pEvent->duration = end - start;
+
+    // The event is in place before a reader can count it
+    InterlockedExchange(&pBuffer->eventCount, eventCount + 1);
+}
+
+/// <summary>
+/// Names the calling thread in the timeline
+/// </summary>
+/// <param name="name">name of the thread, a string literal that needs no escaping in JSON</param>
+void SetTraceThreadName(const char* name)
+{
+    TraceThreadBuffer* pBuffer = GetThreadBuffer();
+    if (pBuffer)
+    {
+        pBuffer->threadName = name;
+    }
+}
+
+/// <summary>
+/// Saves the recorded events of every thread as Chrome trace_event JSON. Threads may keep recording
+/// while the trace is saved; events they overwrite in the meantime are left out.
+/// </summary>
+/// <param name="path">path of the file to create</param>
+/// <returns>S_OK if successful, an error code otherwise</returns>
+HRESULT WriteChromeTrace(const std::string& path)
+{
+    FILE* pFile = NULL;
+    errno_t error = fopen_s(&pFile, path.c_str(), "w");
+    if (error != 0 || !pFile)
+    {
+        return E_FAIL;
+    }
+
+    fprintf(pFile, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+    const char* separator = "\n";
+
+    std::vector<TraceEvent> events;
+    for (TraceThreadBuffer* pBuffer = s_pFirstBuffer; pBuffer; pBuffer = pBuffer->pNext)
+    {
+        if (pBuffer->threadName)
+        {
+            fprintf(pFile, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+                separator, static_cast<int>(pBuffer->threadID), pBuffer->threadName);
+            separator = ",\n";
+        }
+
+        // Copy the events, then keep only those the writer cannot have reached again while they were copied
+        LONG end = pBuffer->eventCount;
+        MemoryBarrier();
+        LONG begin = (end > TRACE_EVENTS_PER_THREAD) ? end - TRACE_EVENTS_PER_THREAD : 0;
+        events.resize(end - begin);
+        for (LONG i = begin; i < end; ++i)
+        {
+            events[i - begin] = pBuffer->events[i & (TRACE_EVENTS_PER_THREAD - 1)];
+        }
+
+        MemoryBarrier();
+        LONG firstIntact = pBuffer->eventCount - TRACE_EVENTS_PER_THREAD + 1;
+        for (LONG i = max(begin, firstIntact); i < end; ++i)
+        {
+            const TraceEvent& event = events[i - begin];
+            fprintf(pFile, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                separator, event.name, static_cast<int>(pBuffer->threadID), event.start / 1000.0, event.duration / 1000.0);
+            separator = ",\n";
+        }
+    }
+
+    fprintf(pFile, "\n]}\n");
+    bool isWritten = (ferror(pFile) == 0);
+    if (fclose(pFile) != 0)
+    {
+        isWritten = false;
+    }
+
+    return isWritten ? S_OK : E_FAIL;
+}
@@ -0,0 +1,90 @@
+//-----------------------------------------------------------------------------
+// <copyright file="Trace.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation. All rights reserved.
+// </copyright>
+//-----------------------------------------------------------------------------
+
+#pragma once
+
+#include "Platform.h"
+#include <string>
+#include "LatencyHistogram.h"
+
+// Scoped trace points for the frame hot path. Every thread records into its own ring buffer
+// without locks, and WriteChromeTrace saves the buffers as Chrome trace_event JSON, which
+// chrome://tracing and Perfetto show as a timeline.
+//
+// Define ENABLE_TRACING to compile the trace points in. Without it TRACE_SCOPE and
+// TRACE_THREAD_NAME expand to nothing, and WriteChromeTrace writes an empty trace.
+
+#ifdef ENABLE_TRACING
+#define TRACE_CONCATENATE_INNER(a, b) a##b
+#define TRACE_CONCATENATE(a, b) TRACE_CONCATENATE_INNER(a, b)
+
+// Records the time from here to the end of the enclosing scope; name must be a string literal
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCATENATE(traceScope, __LINE__)(name)
+
+// Names the calling thread in the timeline; name must be a string literal
+#define TRACE_THREAD_NAME(name) SetTraceThreadName(name)
+#else
+#define TRACE_SCOPE(name)
+#define TRACE_THREAD_NAME(name)
+#endif
+
+/// <summary>
+/// Records a finished trace event of the calling thread, overwriting its oldest event once its buffer is full
+/// </summary>
+/// <param name="name">name of the event, a string literal that needs no escaping in JSON</param>
+/// <param name="start">monotonic time the event started in nanoseconds</param>
+/// <param name="end">monotonic time the event ended in nanoseconds</param>
+void RecordTraceEvent(const char* name, LONGLONG start, LONGLONG end);
+
+/// <summary>
+/// Names the calling thread in the timeline
+/// </summary>
+/// <param name="name">name of the thread, a string literal that needs no escaping in JSON</param>
+void SetTraceThreadName(const char* name);
+
+/// <summary>
+/// Saves the recorded events of every thread as Chrome trace_event JSON. Threads may keep recording
+/// while the trace is saved; events they overwrite in the meantime are left out.
+/// </summary>
+/// <param name="path">path of the file to create</param>
+/// <returns>S_OK if successful, an error code otherwise</returns>
+HRESULT WriteChromeTrace(const std::string& path);
+
+/// <summary>
+/// Records the time from its construction to its destruction as a trace event; use TRACE_SCOPE
+/// </summary>
+class TraceScope
+{
+public:
+    // Functions:
+    /// <summary>
+    /// Constructor, starts the event
+    /// </summary>
+    /// <param name="name">name of the event, a string literal</param>
+    explicit TraceScope(const char* name) :
+        m_name(name),
+        m_start(GetMonotonicNanoseconds())
+    {
+    }
+
+    /// <summary>
+    /// Destructor, records the event
+    /// </summary>
+    ~TraceScope()
+    {
+        RecordTraceEvent(m_name, m_start, GetMonotonicNanoseconds());
+    }
+
+private:
+    // Functions:
+    // A scope records one event, so it cannot be copied
+    TraceScope(const TraceScope&);
+    TraceScope& operator=(const TraceScope&);
+
+    // Variables:
+    const char* m_name;
+    LONGLONG m_start;
+};
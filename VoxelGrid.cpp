@@ -0,0 +1,226 @@
+//-----------------------------------------------------------------------------
+// <copyright file="VoxelGrid.cpp" company="Microsoft">
+//     Copyright (c) Microsoft Corporation. All rights reserved.
+// </copyright>
+//-----------------------------------------------------------------------------
+
+#include "VoxelGrid.h"
+#include <math.h>
+
+// Most the voxel edge grows within a frame, a power of two; points that still find no voxel are dropped
+static const float MAX_VOXEL_GROWTH = 65536.0f;
+
+/// <summary>
+/// Constructor
+/// </summary>
+VoxelGrid::VoxelGrid() :
+    m_inverseVoxelSize(20.0f),
+    m_maxVoxels(0),
+    m_frameInverseVoxelSize(20.0f),
+    m_generation(0),
+    m_slotMask(0)
+{
+    Configure(0.05f, 400);
+}
+
+/// <summary>
+/// Sets the voxel edge length and the most voxels kept per frame, sizing the hash table
+/// </summary>
+/// <param name="voxelSize">edge length of a voxel in meters</param>
+/// <param name="maxVoxels">most voxels kept; a frame that occupies more is reduced with larger voxels</param>
+/// <returns>S_OK if successful, E_INVALIDARG if either value is not positive</returns>
+HRESULT VoxelGrid::Configure(float voxelSize, int maxVoxels)
+{
+    if (!(voxelSize > 0.0f) || maxVoxels <= 0)
+    {
+        return E_INVALIDARG;
+    }
+
+    m_inverseVoxelSize = 1.0f / voxelSize;
+    m_frameInverseVoxelSize = m_inverseVoxelSize;
+
+    if (maxVoxels != m_maxVoxels)
+    {
+        m_maxVoxels = maxVoxels;
+
+        // Keep the table at most half full so that probe sequences stay short
+        unsigned int slotCount = 1;
+        while (slotCount < 2u * static_cast<unsigned int>(maxVoxels))
+        {
+            slotCount <<= 1;
+        }
+
+        m_slots.assign(slotCount, 0);
+        m_slotGenerations.assign(slotCount, 0);
+        m_slotMask = slotCount - 1;
+        m_generation = 0;
+        m_voxels.reserve(maxVoxels);
+        m_mergedVoxels.reserve(maxVoxels);
+    }
+
+    return S_OK;
+}
+
+/// <summary>
+/// Gets the most voxels kept per frame
+/// </summary>
+/// <returns>voxel limit</returns>
+int VoxelGrid::GetMaxVoxels() const
+{
+    return m_maxVoxels;
+}
+
+/// <summary>
+/// Gets the voxel edge length the last frame was reduced with, the configured one unless it had to be enlarged
+/// </summary>
+/// <returns>edge length of a voxel in meters</returns>
+float VoxelGrid::GetFrameVoxelSize() const
+{
+    return 1.0f / m_frameInverseVoxelSize;
+}
+
+/// <summary>
+/// Replaces the points of the output cloud with the centroids of the voxels the input points fall in,
+/// in the order the voxels were first seen
+/// </summary>
+/// <param name="pInput">pointer to cloud to reduce</param>
+/// <param name="pOutput">pointer to cloud in which to return the centroids, different from the input</param>
+/// <returns>S_OK if successful, an error code otherwise</returns>
+HRESULT VoxelGrid::Filter(const PointCloud* pInput, PointCloud* pOutput)
+{
+    // Fail if either pointer is invalid
+    if (!pInput || !pOutput)
+    {
+        return E_POINTER;
+    }
+
+    // Fail if the clouds are the same
+    if (pInput == pOutput)
+    {
+        return E_INVALIDARG;
+    }
+
+    m_frameInverseVoxelSize = m_inverseVoxelSize;
+    BeginFrame();
+
+    const float* pX = pInput->GetX();
+    const float* pY = pInput->GetY();
+    const float* pZ = pInput->GetZ();
+    int count = pInput->GetCount();
+
+    for (int i = 0; i < count; ++i)
+    {
+        Voxel* pVoxel = NULL;
+        for (;;)
+        {
+            int ix = static_cast<int>(floorf(pX[i] * m_frameInverseVoxelSize));
+            int iy = static_cast<int>(floorf(pY[i] * m_frameInverseVoxelSize));
+            int iz = static_cast<int>(floorf(pZ[i] * m_frameInverseVoxelSize));
+
+            pVoxel = FindOrAdd(ix, iy, iz);
+            if (pVoxel || m_frameInverseVoxelSize * MAX_VOXEL_GROWTH <= m_inverseVoxelSize)
+            {
+                break;
+            }
+
+            // Out of voxels: halve the resolution rather than lose the rest of the frame
+            Coarsen();
+        }
+
+        if (pVoxel)
+        {
+            pVoxel->count++;
+            pVoxel->sumX += pX[i];
+            pVoxel->sumY += pY[i];
+            pVoxel->sumZ += pZ[i];
+        }
+    }
+
+    // The output only grows the first time it sees the voxel limit
+    pOutput->Clear();
+    pOutput->Reserve(m_maxVoxels);
+    for (size_t i = 0; i < m_voxels.size(); ++i)
+    {
+        const Voxel& voxel = m_voxels[i];
+        float scale = 1.0f / voxel.count;
+        pOutput->AddPoint(voxel.sumX * scale, voxel.sumY * scale, voxel.sumZ * scale);
+    }
+
+    return S_OK;
+}
+
+/// <summary>
+/// Starts a new frame, emptying the table without touching every slot
+/// </summary>
+void VoxelGrid::BeginFrame()
+{
+    m_voxels.clear();
+
+    // Slots stamped with an older generation read as empty; only on wrap-around are they reset
+    if (++m_generation == 0)
+    {
+        m_slotGenerations.assign(m_slotGenerations.size(), 0);
+        m_generation = 1;
+    }
+}
+
+/// <summary>
+/// Finds the voxel with the given indices, adding it if there is room
+/// </summary>
+/// <param name="ix">voxel index along x</param>
+/// <param name="iy">voxel index along y</param>
+/// <param name="iz">voxel index along z</param>
+/// <returns>pointer to the voxel, or NULL if it is new and the limit is reached</returns>
+VoxelGrid::Voxel* VoxelGrid::FindOrAdd(int ix, int iy, int iz)
+{
+    // Spatial hash with large primes, then linear probing
+    unsigned int hash = (static_cast<unsigned int>(ix) * 73856093u) ^
+        (static_cast<unsigned int>(iy) * 19349663u) ^ (static_cast<unsigned int>(iz) * 83492791u);
+
+    for (unsigned int slot = hash & m_slotMask; ; slot = (slot + 1) & m_slotMask)
+    {
+        if (m_slotGenerations[slot] != m_generation)
+        {
+            // Empty slot: the voxel is new
+            if (static_cast<int>(m_voxels.size()) >= m_maxVoxels)
+            {
+                return NULL;
+            }
+
+            Voxel voxel = {ix, iy, iz, 0, 0.0f, 0.0f, 0.0f};
+            m_slotGenerations[slot] = m_generation;
+            m_slots[slot] = static_cast<int>(m_voxels.size());
+            m_voxels.push_back(voxel);
+            return &m_voxels.back();
+        }
+
+        Voxel& voxel = m_voxels[m_slots[slot]];
+        if (voxel.ix == ix && voxel.iy == iy && voxel.iz == iz)
+        {
+            return &voxel;
+        }
+    }
+}
+
+/// <summary>
+/// Doubles the voxel edge for the rest of the frame, merging the voxels found so far
+/// </summary>
+void VoxelGrid::Coarsen()
+{
+    m_frameInverseVoxelSize *= 0.5f;
+
+    m_mergedVoxels.swap(m_voxels);
+    BeginFrame();
+
+    // The edge is doubled exactly, so halving an index (an arithmetic shift, which rounds negative
+    // indices down too) gives the voxel the point would now fall in; merging never adds voxels
+    for (size_t i = 0; i < m_mergedVoxels.size(); ++i)
+    {
+        const Voxel& merged = m_mergedVoxels[i];
+        Voxel* pVoxel = FindOrAdd(merged.ix >> 1, merged.iy >> 1, merged.iz >> 1);
+        pVoxel->count += merged.count;
+        pVoxel->sumX += merged.sumX;
+        pVoxel->sumY += merged.sumY;
+        pVoxel->sumZ += merged.sumZ;
+    }
+}
@@ -0,0 +1,111 @@
+//-----------------------------------------------------------------------------
+// <copyright file="VoxelGrid.h" company="Microsoft">
+//     Copyright (c) Microsoft Corporation. All rights reserved.
+// </copyright>
+//-----------------------------------------------------------------------------
+
+#pragma once
+
+#include "Platform.h"
+#include <vector>
+
+#include "PointCloud.h"
+
+/// <summary>
+/// Reduces a point cloud to the centroid of each occupied cube of space. Occupied voxels are found
+/// through a fixed-size open-addressing hash table, so memory is bounded by the voxel limit and
+/// nothing is allocated per frame. When a frame occupies more voxels than the limit, the voxel edge
+/// is doubled and the voxels found so far are merged, so the whole cloud stays covered at a coarser
+/// resolution instead of only the points that came first.
+/// </summary>
+class VoxelGrid
+{
+public:
+    // Functions:
+    /// <summary>
+    /// Constructor
+    /// </summary>
+    VoxelGrid();
+
+    /// <summary>
+    /// Sets the voxel edge length and the most voxels kept per frame, sizing the hash table
+    /// </summary>
+    /// <param name="voxelSize">edge length of a voxel in meters</param>
+    /// <param name="maxVoxels">most voxels kept; a frame that occupies more is reduced with larger voxels</param>
+    /// <returns>S_OK if successful, E_INVALIDARG if either value is not positive</returns>
+    HRESULT Configure(float voxelSize, int maxVoxels);
+
+    /// <summary>
+    /// Gets the most voxels kept per frame
+    /// </summary>
+    /// <returns>voxel limit</returns>
+    int GetMaxVoxels() const;
+
+    /// <summary>
+    /// Gets the voxel edge length the last frame was reduced with, the configured one unless it had to be enlarged
+    /// </summary>
+    /// <returns>edge length of a voxel in meters</returns>
+    float GetFrameVoxelSize() const;
+
+    /// <summary>
+    /// Replaces the points of the output cloud with the centroids of the voxels the input points fall in,
+    /// in the order the voxels were first seen
+    /// </summary>
+    /// <param name="pInput">pointer to cloud to reduce</param>
+    /// <param name="pOutput">pointer to cloud in which to return the centroids, different from the input</param>
+    /// <returns>S_OK if successful, an error code otherwise</returns>
+    HRESULT Filter(const PointCloud* pInput, PointCloud* pOutput);
+
+private:
+    // Types:
+    // Accumulated points of one voxel
+    struct Voxel
+    {
+        int ix;
+        int iy;
+        int iz;
+        int count;
+        float sumX;
+        float sumY;
+        float sumZ;
+    };
+
+    // Functions:
+    /// <summary>
+    /// Starts a new frame, emptying the table without touching every slot
+    /// </summary>
+    void BeginFrame();
+
+    /// <summary>
+    /// Finds the voxel with the given indices, adding it if there is room
+    /// </summary>
+    /// <param name="ix">voxel index along x</param>
+    /// <param name="iy">voxel index along y</param>
+    /// <param name="iz">voxel index along z</param>
+    /// <returns>pointer to the voxel, or NULL if it is new and the limit is reached</returns>
+    Voxel* FindOrAdd(int ix, int iy, int iz);
+
+    /// <summary>
+    /// Doubles the voxel edge for the rest of the frame, merging the voxels found so far
+    /// </summary>
+    void Coarsen();
+
+    // Variables:
+    float m_inverseVoxelSize;
+    int m_maxVoxels;
+
+    // Inverse voxel edge of the current frame, smaller than the configured one once coarsened
+    float m_frameInverseVoxelSize;
+
+    // Hash table of indices into m_voxels; a slot is empty unless its generation is the current one
+    std::vector<int> m_slots;
+    std::vector<unsigned int> m_slotGenerations;
+    unsigned int m_generation;
+    unsigned int m_slotMask;
+
+    // Voxels of the current frame in the order they were first seen
+    std::vector<Voxel> m_voxels;
+
+    // Voxels being merged by Coarsen
+    std::vector<Voxel> m_mergedVoxels;
+};
@@ -45,6 +45,9 @@ namespace ros {
 	  virtual int deserialize(unsigned char *data) = 0;
       virtual const char * getType() = 0;
       virtual const char * getMD5() = 0;
+
+      /* length serialize() will write, or -1 if the message only knows it once serialized */
+      virtual int serializedLength() const { return -1; }
   };
 
 }
@@ -460,17 +460,28 @@ namespace ros {
 			if(id >= 100 && !configured_) 
 				return 0;
 
+			/* drop messages that cannot fit before they are written; 7 header bytes and 1 checksum byte */
+			int length = msg->serializedLength();
+			if( length > OUTPUT_SIZE - 8 ){
+				logerror("Message from device dropped: message larger than buffer.");
+				return -1;
+			}
+
 			/* serialize message */
 			int l = msg->serialize(message_out+7);
+			if( l > OUTPUT_SIZE - 8 ){
+				logerror("Message from device dropped: message larger than buffer.");
+				return -1;
+			}
 
 			/* setup the header */
 			message_out[0] = 0xff;
 			message_out[1] = PROTOCOL_VER;
-			message_out[2] = (unsigned char) l&255;
-			message_out[3] = (unsigned char) l>>8;
+			message_out[2] = (unsigned char)(l & 255);
+			message_out[3] = (unsigned char)(l >> 8);
 			message_out[4] = 255 - ((message_out[2] + message_out[3])%256);
-			message_out[5] = (unsigned char) id&255;
-			message_out[6] = ((unsigned char) id>>8);
+			message_out[5] = (unsigned char)(id & 255);
+			message_out[6] = (unsigned char)(id >> 8);
 
 			/* calculate checksum */
 			int chk = 0;
@@ -479,13 +490,8 @@ namespace ros {
 			l += 7;
 			message_out[l++] = 255 - (chk%256);
 
-			if( l <= OUTPUT_SIZE ){
-				hardware_.write(message_out, l);
-				return l;
-			}else{
-				logerror("Message from device dropped: message larger than buffer.");
-				return -1;
-			}
+			hardware_.write(message_out, l);
+			return l;
 		}
 
 		/********************************************************************